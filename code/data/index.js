@@ -14,9 +14,9 @@ let offlineData = {
     uptime: 0
 };
 let fullConfig = {
-    qs: { minRpm: 3000, debounce: 50, cutTimeMap: [] },
-    network: { staMode: false, apSsid: 'rspqs', apPassword: '', staSsid: '', staPassword: '', lastError: '' },
-    telemetry: { updateRate: 100 }
+    qs: { minRpm: 3000, debounce: 50, cutMap: null },
+    network: { staMode: false, apSsid: 'rspqs', apPasswordSet: false, staSsid: '', staPasswordSet: false, lastError: '' },
+    telemetry: { updateRate: 100, sampleRate: 100 }
 };
 
 function connect() {
@@ -58,6 +58,7 @@ function connect() {
         
         ws.onmessage = function(event) {
             const data = JSON.parse(event.data);
+            if (data.type === 'event') return;  // Shift/cut events, not telemetry
             updateTelemetry(data);
         };
     } catch (error) {
@@ -128,18 +129,22 @@ function loadConfig() {
                 qs: {
                     minRpm: data.qs.minRpm,
                     debounce: data.qs.debounce,
-                    cutTimeMap: data.qs.cutTimeMap
+                    cutMap: data.qs.cutMap || defaultCutMap(),
+                    // Quick editor works on the first load row, in ms (device stores µs)
+                    cutTimeMap: (data.qs.cutMap || defaultCutMap()).cutTimeUs[0].map(us => us / 1000)
                 },
                 network: {
                     staMode: data.network.staMode || false,
                     apSsid: data.network.apSsid || 'rspqs',
-                    apPassword: data.network.apPassword || '',
+                    // Passwords are write-only, the device only says whether one is set
+                    apPasswordSet: data.network.apPasswordSet || false,
                     staSsid: data.network.staSsid || '',
-                    staPassword: data.network.staPassword || '',
+                    staPasswordSet: data.network.staPasswordSet || false,
                     lastError: data.lastError || ''
                 },
                 telemetry: {
-                    updateRate: data.telemetry.updateRate || 100
+                    updateRate: data.telemetry.updateRate || 100,
+                    sampleRate: data.telemetry.sampleRate || 100
                 }
             };
             
@@ -152,16 +157,24 @@ function loadConfig() {
             // Load telemetry config
             document.getElementById('updateRateSlider').value = fullConfig.telemetry.updateRate;
             document.getElementById('updateRateValue').textContent = fullConfig.telemetry.updateRate + ' ms';
+            document.getElementById('sampleRateSlider').value = fullConfig.telemetry.sampleRate;
+            document.getElementById('sampleRateValue').textContent = fullConfig.telemetry.sampleRate + ' Hz';
             
             // Load network config
             if (fullConfig.network.staMode) {
                 selectWifiMode('sta');
                 document.getElementById('staSsid').value = fullConfig.network.staSsid;
-                document.getElementById('staPassword').value = fullConfig.network.staPassword;
+                document.getElementById('staPassword').value = '';
+                if (fullConfig.network.staPasswordSet) {
+                    document.getElementById('staPassword').placeholder = 'Unchanged';
+                }
             } else {
                 selectWifiMode('ap');
                 document.getElementById('apSsid').value = fullConfig.network.apSsid;
-                document.getElementById('apPassword').value = fullConfig.network.apPassword;
+                document.getElementById('apPassword').value = '';
+                if (fullConfig.network.apPasswordSet) {
+                    document.getElementById('apPassword').placeholder = 'Unchanged';
+                }
             }
             
             // Display error if present
@@ -179,6 +192,7 @@ function loadConfig() {
             window.currentQsConfig = {
                 minRpm: 3000,
                 debounce: 50,
+                cutMap: defaultCutMap(),
                 cutTimeMap: [80, 80, 80, 80, 80, 80, 80, 80, 80, 80, 80]
             };
             updateConfigSummary();
@@ -186,6 +200,8 @@ function loadConfig() {
             // Set default telemetry
             document.getElementById('updateRateSlider').value = 100;
             document.getElementById('updateRateValue').textContent = '100 ms';
+            document.getElementById('sampleRateSlider').value = 100;
+            document.getElementById('sampleRateValue').textContent = '100 Hz';
             
             // Set default network config
             selectWifiMode('ap');
@@ -193,11 +209,22 @@ function loadConfig() {
         });
 }
 
+// Flat 80ms map matching the firmware defaults (RPM × load, µs)
+function defaultCutMap() {
+    return {
+        loadSource: 'none',
+        rpmAxis: [5000, 6000, 7000, 8000, 9000, 10000, 11000, 12000, 13000, 14000, 15000],
+        loadAxis: [0, 200, 400, 600, 800, 1000],
+        cutTimeUs: Array.from({ length: 6 }, () => new Array(11).fill(80000))
+    };
+}
+
 function updateConfigSummary() {
     const config = window.currentQsConfig;
     document.getElementById('minRpmDisplay').textContent = config.minRpm + ' RPM';
     document.getElementById('debounceDisplay').textContent = config.debounce + ' ms';
-    document.getElementById('cutTimePointsDisplay').textContent = config.cutTimeMap.length + ' points';
+    document.getElementById('cutTimePointsDisplay').textContent =
+        config.cutMap.rpmAxis.length + ' × ' + config.cutMap.loadAxis.length + ' points';
 }
 
 function sendConfig(extraData = {}) {
@@ -205,7 +232,7 @@ function sendConfig(extraData = {}) {
     fullConfig.qs = {
         minRpm: window.currentQsConfig.minRpm,
         debounce: window.currentQsConfig.debounce,
-        cutTimeMap: window.currentQsConfig.cutTimeMap
+        cutMap: window.currentQsConfig.cutMap
     };
     
     const staMode = document.getElementById('modeSTABtn').classList.contains('active');
@@ -215,14 +242,20 @@ function sendConfig(extraData = {}) {
         staMode: staMode,
         // Preserve existing values and only update the fields for the active mode
         apSsid: staMode ? fullConfig.network.apSsid : (document.getElementById('apSsid').value || 'rspqs'),
-        apPassword: staMode ? fullConfig.network.apPassword : (document.getElementById('apPassword').value || ''),
         staSsid: staMode ? (document.getElementById('staSsid').value || '') : fullConfig.network.staSsid,
-        staPassword: staMode ? (document.getElementById('staPassword').value || '') : fullConfig.network.staPassword,
         lastError: fullConfig.network.lastError || ''
     };
     
+    // A password is only sent when one was typed, an empty field keeps the stored one
+    const passwordField = staMode ? 'staPassword' : 'apPassword';
+    const password = document.getElementById(passwordField).value;
+    if (password) {
+        fullConfig.network[passwordField] = password;
+    }
+    
     fullConfig.telemetry = {
-        updateRate: parseInt(document.getElementById('updateRateSlider').value)
+        updateRate: parseInt(document.getElementById('updateRateSlider').value),
+        sampleRate: parseInt(document.getElementById('sampleRateSlider').value)
     };
     
     // Merge any extra data (like ota flag)
@@ -243,10 +276,16 @@ function saveQsConfigFromModal() {
     // Build cut time map from graph points
     const cutTimeMap = buildCutTimeMapFromPoints();
     
+    // Quick edit applies the same curve to every load row (use the map editor page for 2D)
+    const cutMap = window.currentQsConfig.cutMap;
+    const cutTimeUs = cutTimeMap.map(ms => Math.round(ms * 1000));
+    cutMap.cutTimeUs = cutMap.cutTimeUs.map(() => cutTimeUs.slice());
+    
     // Update current config
     window.currentQsConfig = {
         minRpm: parseInt(document.getElementById('minRpmSlider').value),
         debounce: parseInt(document.getElementById('debounceSlider').value),
+        cutMap: cutMap,
         cutTimeMap: cutTimeMap
     };
     
@@ -262,9 +301,9 @@ function buildCutTimeMapFromPoints() {
     // Sort points by RPM
     const sorted = [...graphPoints].sort((a, b) => a.rpm - b.rpm);
     
-    // Generate map from 5000 to 15000 RPM in 1000 RPM steps (11 points)
+    // Sample curve at the map RPM breakpoints (11 points)
     const map = [];
-    for (let rpm = 5000; rpm <= 15000; rpm += 1000) {
+    for (const rpm of window.currentQsConfig.cutMap.rpmAxis) {
         // Find interpolated value
         let value = 80; // default
         
@@ -285,7 +324,7 @@ function buildCutTimeMapFromPoints() {
             }
         }
         
-        map.push(Math.round(value));
+        map.push(Math.round(value * 10) / 10);  // 0.1ms resolution
     }
     
     return map;
@@ -293,6 +332,8 @@ function buildCutTimeMapFromPoints() {
 function updateTelemetryRate() {
     const value = document.getElementById('updateRateSlider').value;
     document.getElementById('updateRateValue').textContent = value + ' ms';
+    const sampleRate = document.getElementById('sampleRateSlider').value;
+    document.getElementById('sampleRateValue').textContent = sampleRate + ' Hz';
     
     // Clear existing timer
     if (telemetryUpdateTimer) {
@@ -302,7 +343,7 @@ function updateTelemetryRate() {
     // Set new timer to save after 1 second of no changes
     telemetryUpdateTimer = setTimeout(() => {
         sendConfig();
-        console.log('Telemetry rate updated:', value + 'ms');
+        console.log('Telemetry rate updated:', value + 'ms,', sampleRate + 'Hz');
     }, 1000);
 }
 
@@ -634,7 +675,7 @@ function drawGraph() {
         ctx.fillStyle = '#fff';
         ctx.font = 'bold 11px sans-serif';
         ctx.textAlign = 'center';
-        ctx.fillText(Math.round(point.rpm) + ' / ' + Math.round(point.cutTime) + 'ms', x, y - 15);
+        ctx.fillText(Math.round(point.rpm) + ' / ' + point.cutTime.toFixed(1) + 'ms', x, y - 15);
     });
 }
 
@@ -684,7 +725,7 @@ function onGraphMouseMove(e) {
     cutTime = Math.max(0, Math.min(200, cutTime));
     
     graphPoints[selectedPointIndex].rpm = Math.round(rpm);
-    graphPoints[selectedPointIndex].cutTime = Math.round(cutTime);
+    graphPoints[selectedPointIndex].cutTime = Math.round(cutTime * 10) / 10;
     
     drawGraph();
 }
@@ -19,9 +19,23 @@ let touchStartY = 0;
 let currentConfig = {
     minRpm: 3000,
     debounce: 50,
-    cutTimeMap: []
+    cutMode: 'open',
+    minCutPercent: 40,
+    dropPercent: 4,
+    skipSparks: 1,
+    skipCycle: 0,
+    minThrottle: 5,
+    triggerTeeth: 1,
+    triggerMissing: 0,
+    shiftSensor: 'switch',
+    forceThreshold: 400,
+    forceHysteresis: 150,
+    cutMap: null
 };
 
+// Load row currently shown in the graph
+let currentLoadRow = 0;
+
 // Initialize
 function init() {
     canvas = document.getElementById('cutTimeGraph');
@@ -181,7 +195,7 @@ function onPointerMove(e) {
     cutTime = Math.max(0, Math.min(200, cutTime));
     
     graphPoints[selectedPointIndex].rpm = Math.round(rpm);
-    graphPoints[selectedPointIndex].cutTime = Math.round(cutTime);
+    graphPoints[selectedPointIndex].cutTime = Math.round(cutTime * 10) / 10;
     
     drawGraph();
 }
@@ -345,7 +359,7 @@ function drawGraph() {
         
         // Draw tooltip only for the selected point
         if (index === showingTooltipIndex) {
-            const tooltipText = Math.round(point.rpm) + ' RPM / ' + Math.round(point.cutTime) + ' ms';
+            const tooltipText = Math.round(point.rpm) + ' RPM / ' + point.cutTime.toFixed(1) + ' ms';
             const tooltipFontSize = Math.max(11, Math.min(13, width * 0.016));
             ctx.font = `bold ${tooltipFontSize}px sans-serif`;
             
@@ -501,13 +515,81 @@ function updateGraphPointCount() {
     document.getElementById('graphPointCount').textContent = graphPoints.length;
 }
 
+// Flat 80ms map matching the firmware defaults (RPM × load, µs)
+function defaultCutMap() {
+    return {
+        loadSource: 'none',
+        rpmAxis: [5000, 6000, 7000, 8000, 9000, 10000, 11000, 12000, 13000, 14000, 15000],
+        loadAxis: [0, 200, 400, 600, 800, 1000],
+        cutTimeUs: Array.from({ length: 6 }, () => new Array(11).fill(80000))
+    };
+}
+
+// Label for a load breakpoint
+function loadLabel(source, value) {
+    if (source === 'tps') return (value / 10) + '% throttle';
+    return 'All loads';
+}
+
+// Populate load row selector from the map load axis
+function updateLoadRowSelect() {
+    const cutMap = currentConfig.cutMap;
+    const select = document.getElementById('loadRowSelect');
+    document.getElementById('loadSourceSelect').value = cutMap.loadSource;
+    
+    select.innerHTML = '';
+    const rows = cutMap.loadSource === 'none' ? 1 : cutMap.loadAxis.length;
+    for (let i = 0; i < rows; i++) {
+        const option = document.createElement('option');
+        option.value = i;
+        option.textContent = loadLabel(cutMap.loadSource, cutMap.loadAxis[i]);
+        select.appendChild(option);
+    }
+    if (currentLoadRow >= rows) currentLoadRow = 0;
+    select.value = currentLoadRow;
+    select.disabled = rows === 1;
+}
+
+// Store graph into the current row before switching
+function storeCurrentRow() {
+    const row = buildCutTimeMapFromPoints();
+    currentConfig.cutMap.cutTimeUs[currentLoadRow] = row.map(ms => Math.round(ms * 1000));
+    if (currentConfig.cutMap.loadSource === 'none') {
+        // 1D map: keep every row identical
+        currentConfig.cutMap.cutTimeUs = currentConfig.cutMap.cutTimeUs.map(() =>
+            currentConfig.cutMap.cutTimeUs[currentLoadRow].slice());
+    }
+}
+
+function showLoadRow(row) {
+    currentLoadRow = row;
+    initGraphPoints(currentConfig.cutMap.cutTimeUs[row].map(us => us / 1000));
+    drawGraph();
+}
+
+function selectLoadRow() {
+    storeCurrentRow();
+    showLoadRow(parseInt(document.getElementById('loadRowSelect').value));
+}
+
+function changeLoadSource() {
+    storeCurrentRow();
+    const source = document.getElementById('loadSourceSelect').value;
+    const cutMap = currentConfig.cutMap;
+    cutMap.loadSource = source;
+    cutMap.loadAxis = [0, 200, 400, 600, 800, 1000];
+    currentLoadRow = 0;
+    updateLoadRowSelect();
+    showLoadRow(0);
+}
+
 // Build cut time map from points
 function buildCutTimeMapFromPoints() {
     const sorted = [...graphPoints].sort((a, b) => a.rpm - b.rpm);
     const map = [];
     
     for (let i = 0; i < 11; i++) {
-        const rpm = 5000 + (i * 1000);
+        const rpm = currentConfig.cutMap.rpmAxis[i];
         let cutTime = 80;
         
         if (sorted.length === 1) {
@@ -526,7 +608,7 @@ function buildCutTimeMapFromPoints() {
             }
         }
         
-        map.push(Math.round(cutTime));
+        map.push(Math.round(cutTime * 10) / 10);  // 0.1ms resolution
     }
     
     return map;
@@ -540,9 +622,66 @@ function updateSliderValue(type) {
     } else if (type === 'debounce') {
         const value = document.getElementById('debounceSlider').value;
         document.getElementById('debounceValue').textContent = value + ' ms';
+    } else if (type === 'minCutPercent' || type === 'dropPercent' || type === 'minThrottle') {
+        const value = document.getElementById(type + 'Slider').value;
+        document.getElementById(type + 'Value').textContent = value + ' %';
+    } else if (type === 'forceThreshold' || type === 'forceHysteresis') {
+        // Raw ADC counts above the sensor baseline
+        document.getElementById(type + 'Value').textContent = document.getElementById(type + 'Slider').value;
     }
 }
 
+// Force sliders only apply to the strain gauge/piezo sensor
+function updateShiftSensorControls() {
+    const force = document.getElementById('shiftSensorSelect').value === 'force';
+    document.querySelectorAll('.force-control').forEach(el => {
+        el.style.display = force ? '' : 'none';
+    });
+}
+
+// Closed-loop sliders only apply when the cut ends on RPM drop
+function updateCutModeControls() {
+    const closedLoop = document.getElementById('cutModeSelect').value === 'closed';
+    document.querySelectorAll('.closed-loop-control').forEach(el => {
+        el.style.display = closedLoop ? '' : 'none';
+    });
+}
+
+function showCutModeConfig() {
+    document.getElementById('cutModeSelect').value = currentConfig.cutMode;
+    document.getElementById('minCutPercentSlider').value = currentConfig.minCutPercent;
+    document.getElementById('dropPercentSlider').value = currentConfig.dropPercent;
+    updateSliderValue('minCutPercent');
+    updateSliderValue('dropPercent');
+    updateCutModeControls();
+    
+    // Patterns not in the list (set through the API) are added as-is
+    const select = document.getElementById('skipPatternSelect');
+    const pattern = currentConfig.skipCycle > 0 ? currentConfig.skipSparks + '/' + currentConfig.skipCycle : '1/0';
+    if (![...select.options].some(option => option.value === pattern)) {
+        select.add(new Option(currentConfig.skipSparks + ' of ' + currentConfig.skipCycle + ' sparks', pattern));
+    }
+    select.value = pattern;
+    
+    const wheelSelect = document.getElementById('triggerWheelSelect');
+    const wheel = currentConfig.triggerTeeth + '/' + currentConfig.triggerMissing;
+    if (![...wheelSelect.options].some(option => option.value === wheel)) {
+        wheelSelect.add(new Option(currentConfig.triggerTeeth + '-' + currentConfig.triggerMissing, wheel));
+    }
+    wheelSelect.value = wheel;
+    
+    // Applies only with a calibrated throttle sensor
+    document.getElementById('minThrottleSlider').value = currentConfig.minThrottle;
+    updateSliderValue('minThrottle');
+    
+    document.getElementById('shiftSensorSelect').value = currentConfig.shiftSensor;
+    document.getElementById('forceThresholdSlider').value = currentConfig.forceThreshold;
+    document.getElementById('forceHysteresisSlider').value = currentConfig.forceHysteresis;
+    updateSliderValue('forceThreshold');
+    updateSliderValue('forceHysteresis');
+    updateShiftSensorControls();
+}
+
 // WebSocket connection
 function connectWebSocket() {
     try {
@@ -601,7 +740,18 @@ function loadConfig() {
             currentConfig = {
                 minRpm: data.qs.minRpm,
                 debounce: data.qs.debounce,
-                cutTimeMap: data.qs.cutTimeMap
+                cutMode: data.qs.cutMode || 'open',
+                minCutPercent: data.qs.minCutPercent ?? 40,
+                dropPercent: data.qs.dropPercent ?? 4,
+                skipSparks: data.qs.skipSparks ?? 1,
+                skipCycle: data.qs.skipCycle ?? 0,
+                minThrottle: data.qs.minThrottle ?? 5,
+                triggerTeeth: data.qs.triggerTeeth ?? 1,
+                triggerMissing: data.qs.triggerMissing ?? 0,
+                shiftSensor: data.qs.shiftSensor || 'switch',
+                forceThreshold: data.qs.forceThreshold ?? 400,
+                forceHysteresis: data.qs.forceHysteresis ?? 150,
+                cutMap: data.qs.cutMap || defaultCutMap()
             };
             
             // Update sliders
@@ -609,10 +759,11 @@ function loadConfig() {
             document.getElementById('minRpmValue').textContent = currentConfig.minRpm + ' RPM';
             document.getElementById('debounceSlider').value = currentConfig.debounce;
             document.getElementById('debounceValue').textContent = currentConfig.debounce + ' ms';
+            showCutModeConfig();
             
-            // Initialize graph
-            initGraphPoints(currentConfig.cutTimeMap);
-            drawGraph();
+            // Initialize graph (device stores µs, the editor works in ms)
+            updateLoadRowSelect();
+            showLoadRow(0);
             
             showLoading(false);
         })
@@ -623,11 +774,23 @@ function loadConfig() {
             currentConfig = {
                 minRpm: 3000,
                 debounce: 50,
-                cutTimeMap: [80, 80, 80, 80, 80, 80, 80, 80, 80, 80, 80]
+                cutMode: 'open',
+                minCutPercent: 40,
+                dropPercent: 4,
+                skipSparks: 1,
+                skipCycle: 0,
+                minThrottle: 5,
+                triggerTeeth: 1,
+                triggerMissing: 0,
+                shiftSensor: 'switch',
+                forceThreshold: 400,
+                forceHysteresis: 150,
+                cutMap: defaultCutMap()
             };
+            showCutModeConfig();
             
-            initGraphPoints(currentConfig.cutTimeMap);
-            drawGraph();
+            updateLoadRowSelect();
+            showLoadRow(0);
             
             showLoading(false);
             showToast('Running in offline mode', 2000);
@@ -636,12 +799,24 @@ function loadConfig() {
 
 // Save configuration
 function saveConfiguration() {
-    const cutTimeMap = buildCutTimeMapFromPoints();
+    storeCurrentRow();
     
     // Update current config
     currentConfig.minRpm = parseInt(document.getElementById('minRpmSlider').value);
     currentConfig.debounce = parseInt(document.getElementById('debounceSlider').value);
-    currentConfig.cutTimeMap = cutTimeMap;
+    currentConfig.cutMode = document.getElementById('cutModeSelect').value;
+    currentConfig.minCutPercent = parseInt(document.getElementById('minCutPercentSlider').value);
+    currentConfig.dropPercent = parseInt(document.getElementById('dropPercentSlider').value);
+    const [skipSparks, skipCycle] = document.getElementById('skipPatternSelect').value.split('/').map(Number);
+    currentConfig.skipSparks = skipSparks;
+    currentConfig.skipCycle = skipCycle;
+    currentConfig.minThrottle = parseInt(document.getElementById('minThrottleSlider').value);
+    const [triggerTeeth, triggerMissing] = document.getElementById('triggerWheelSelect').value.split('/').map(Number);
+    currentConfig.triggerTeeth = triggerTeeth;
+    currentConfig.triggerMissing = triggerMissing;
+    currentConfig.shiftSensor = document.getElementById('shiftSensorSelect').value;
+    currentConfig.forceThreshold = parseInt(document.getElementById('forceThresholdSlider').value);
+    currentConfig.forceHysteresis = parseInt(document.getElementById('forceHysteresisSlider').value);
     
     // Load network and telemetry config from API to build full config
     fetch('/api/config')
@@ -652,14 +827,23 @@ function saveConfiguration() {
                 qs: {
                     minRpm: currentConfig.minRpm,
                     debounce: currentConfig.debounce,
-                    cutTimeMap: cutTimeMap
+                    cutMode: currentConfig.cutMode,
+                    minCutPercent: currentConfig.minCutPercent,
+                    dropPercent: currentConfig.dropPercent,
+                    skipSparks: currentConfig.skipSparks,
+                    skipCycle: currentConfig.skipCycle,
+                    minThrottle: currentConfig.minThrottle,
+                    triggerTeeth: currentConfig.triggerTeeth,
+                    triggerMissing: currentConfig.triggerMissing,
+                    shiftSensor: currentConfig.shiftSensor,
+                    forceThreshold: currentConfig.forceThreshold,
+                    forceHysteresis: currentConfig.forceHysteresis,
+                    cutMap: currentConfig.cutMap
                 },
                 network: {
                     staMode: data.network.staMode,
                     apSsid: data.network.apSsid,
-                    apPassword: data.network.apPassword,
-                    staSsid: data.network.staSsid,
-                    staPassword: data.network.staPassword
+                    staSsid: data.network.staSsid
                 },
                 telemetry: {
                     updateRate: data.telemetry.updateRate
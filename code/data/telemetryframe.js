@@ -0,0 +1,91 @@
+// Binary telemetry frame decoder (see include/TelemetryFrame.hpp)
+//
+// Frame: 8-byte header followed by sampleCount samples of sampleSize bytes.
+// All fields little-endian. Unknown trailing sample fields are skipped via
+// sampleSize so older pages keep working with newer firmware.
+
+const TELEMETRY_FRAME_MAGIC = 0x51;
+const TELEMETRY_FRAME_VERSION = 1;
+const TELEMETRY_HEADER_SIZE = 8;
+const TELEMETRY_MIN_SAMPLE_SIZE = 12;
+const TELEMETRY_ACCEL_SAMPLE_SIZE = 14;   // Firmware with the rpmAccel field
+const TELEMETRY_RPM_ACCEL_SCALE = 10;     // RPM/s per unit
+
+const TELEMETRY_FLAG_SIGNAL_ACTIVE = 0x01;
+const TELEMETRY_FLAG_CUT_ACTIVE = 0x02;
+const TELEMETRY_FLAG_TPS_VALID = 0x04;
+const TELEMETRY_FLAG_MAP_VALID = 0x08;
+
+// Ask the device to switch this connection to binary frames
+function requestBinaryTelemetry(ws) {
+    ws.binaryType = 'arraybuffer';
+    ws.send(JSON.stringify({ stream: 'binary' }));
+}
+
+// Decode one frame at byteOffset.
+// Returns { sequence, configGeneration, size, samples: [...] } or null if invalid.
+// configGeneration is 0 in capture frames.
+function decodeTelemetryFrame(buffer, byteOffset = 0) {
+    if (!(buffer instanceof ArrayBuffer) || buffer.byteLength < byteOffset + TELEMETRY_HEADER_SIZE) {
+        return null;
+    }
+
+    const view = new DataView(buffer, byteOffset);
+    const magic = view.getUint8(0);
+    const version = view.getUint8(1);
+    const sampleCount = view.getUint8(2);
+    const sampleSize = view.getUint8(3);
+    const sequence = view.getUint16(4, true);
+    const configGeneration = view.getUint16(6, true);
+
+    if (magic !== TELEMETRY_FRAME_MAGIC || version > TELEMETRY_FRAME_VERSION) {
+        console.warn('Unsupported telemetry frame:', magic, version);
+        return null;
+    }
+    if (sampleSize < TELEMETRY_MIN_SAMPLE_SIZE ||
+        view.byteLength < TELEMETRY_HEADER_SIZE + sampleCount * sampleSize) {
+        console.warn('Truncated telemetry frame');
+        return null;
+    }
+
+    const samples = new Array(sampleCount);
+    for (let i = 0; i < sampleCount; i++) {
+        const offset = TELEMETRY_HEADER_SIZE + i * sampleSize;
+        const flags = view.getUint8(offset + 10);
+        samples[i] = {
+            timestampUs: view.getUint32(offset, true),
+            rpm: view.getUint16(offset + 4, true),
+            tps: (flags & TELEMETRY_FLAG_TPS_VALID) ? view.getUint16(offset + 6, true) / 10 : null,
+            map: (flags & TELEMETRY_FLAG_MAP_VALID) ? view.getUint16(offset + 8, true) / 10 : null,
+            signalActive: (flags & TELEMETRY_FLAG_SIGNAL_ACTIVE) !== 0,
+            cutActive: (flags & TELEMETRY_FLAG_CUT_ACTIVE) !== 0,
+            rpmAccel: sampleSize >= TELEMETRY_ACCEL_SAMPLE_SIZE
+                ? view.getInt16(offset + 12, true) * TELEMETRY_RPM_ACCEL_SCALE : null
+        };
+    }
+
+    return { sequence, configGeneration, size: TELEMETRY_HEADER_SIZE + sampleCount * sampleSize, samples };
+}
+
+// Fetch a shift capture (/api/telemetry/capture, concatenated frames).
+// age 0 = last shift. Resolves to a flat sample array, zeroed samples
+// (overwritten during download) are dropped.
+async function fetchShiftCapture(age = 0, preMs = 500, postMs = 1000) {
+    const response = await fetch(`/api/telemetry/capture?shift=${age}&pre=${preMs}&post=${postMs}`);
+    if (!response.ok) {
+        throw new Error('Capture not available (' + response.status + ')');
+    }
+
+    const buffer = await response.arrayBuffer();
+    const samples = [];
+    let offset = 0;
+    while (offset < buffer.byteLength) {
+        const frame = decodeTelemetryFrame(buffer, offset);
+        if (!frame) break;
+        for (const sample of frame.samples) {
+            if (sample.timestampUs !== 0) samples.push(sample);
+        }
+        offset += frame.size;
+    }
+    return samples;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <array>
+
+/**
+ * @brief Asset Server - Pre-compressed, cached static file serving
+ *
+ * Serves the web interface from the table built by tools/build_assets.py
+ * (/assets.json, loaded once in begin()). Each entry maps a URL to its
+ * gzip-compressed file on LittleFS with a precomputed MIME type and ETag, so
+ * a request costs one table lookup and no filesystem probing:
+ * - If-None-Match equal to the ETag answers 304 with no body
+ * - Content-hashed names (index.<hash>.js) are sent as immutable
+ * - HTML is sent with no-cache (always revalidated, usually a 304)
+ *
+ * Without a manifest (data/ uploaded as-is) handle() returns false, and the
+ * caller falls back to plain LittleFS serving.
+ */
+class AssetServer {
+public:
+    static constexpr size_t MAX_ASSETS = 16;
+    static constexpr const char* MANIFEST_FILE = "/assets.json";
+
+    AssetServer();
+
+    /**
+     * @brief Load asset table from the manifest
+     * @return true if a manifest was loaded
+     */
+    bool begin();
+
+    /**
+     * @brief Serve request URL from the asset table
+     * @return false if the URL is not a known asset
+     */
+    bool handle(AsyncWebServerRequest* request);
+
+    /**
+     * @brief Serve a specific asset URL (e.g. "/index.html" for "/")
+     * @return false if the URL is not a known asset
+     */
+    bool handle(AsyncWebServerRequest* request, const char* url);
+
+    /**
+     * @brief Check whether an asset URL is available
+     */
+    bool has(const char* url) const;
+
+    size_t getAssetCount() const { return _assetCount; }
+
+    /**
+     * @brief MIME type for a path, from the file extension
+     */
+    static const char* mimeType(const char* path);
+
+private:
+    struct Asset {
+        char url[40];
+        char file[44];
+        char etag[12];      // Quoted content hash
+        const char* mime;   // Points into the static MIME table
+        bool immutable;
+    };
+
+    std::array<Asset, MAX_ASSETS> _assets;
+    size_t _assetCount;
+
+    const Asset* find(const char* url) const;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <array>
+#include <esp_system.h>
+
+/**
+ * @brief Boot Profile - Staged boot timestamps and reset cause
+ *
+ * setup() arms the cut path first and leaves storage, WiFi and the web
+ * server to later stages. Each stage is marked with esp_timer_get_time()
+ * (µs since the application started, the ROM and second-stage bootloader
+ * are not included), printed to Serial and served on /api/boot.
+ *
+ * The reset reason tells whether RTC memory can still hold the recovery
+ * config (StorageHandler::loadRecoveryConfig()): anything but a power
+ * cycle or the reset pin keeps it.
+ */
+class BootProfile {
+public:
+    enum class Stage : uint8_t {
+        SETUP,          // setup() entered (Arduino core, PSRAM and NVS init done)
+        ENGINE_ARMED,   // Engine, shift sensors and their tasks running: ready to cut
+        CONFIG,         // Configuration cache read from NVS
+        FILESYSTEM,     // LittleFS mounted
+        NETWORK,        // WiFi, mDNS and web server up
+        COUNT
+    };
+
+    // Where the engine got the config it armed with
+    enum class ConfigSource : uint8_t {
+        DEFAULTS,
+        STORED,         // NVS
+        RECOVERY        // RTC memory copy, no flash access
+    };
+
+    BootProfile();
+
+    /**
+     * @brief Read the reset reason and mark SETUP (first thing in setup())
+     */
+    void begin();
+
+    /**
+     * @brief Record the time a stage was reached and print it
+     */
+    void mark(Stage stage);
+
+    /**
+     * @brief µs since start at which a stage was reached, 0 if not (yet)
+     */
+    uint32_t getStageUs(Stage stage) const { return _stageUs[static_cast<size_t>(stage)]; }
+
+    void setConfigSource(ConfigSource source) { _configSource = source; }
+    ConfigSource getConfigSource() const { return _configSource; }
+
+    esp_reset_reason_t getResetReason() const { return _resetReason; }
+
+    /**
+     * @brief Reset kept RTC memory (software, panic, watchdog, brownout, deep sleep)
+     */
+    bool isWarmReset() const;
+
+    /**
+     * @brief {"resetReason","warm","configSource","stagesUs":{..}}
+     */
+    void toJson(JsonObject out) const;
+
+    static const char* stageToString(Stage stage);
+    static const char* configSourceToString(ConfigSource source);
+    static const char* resetReasonToString(esp_reset_reason_t reason);
+
+private:
+    std::array<volatile uint32_t, static_cast<size_t>(Stage::COUNT)> _stageUs;
+    esp_reset_reason_t _resetReason;
+    ConfigSource _configSource;
+};
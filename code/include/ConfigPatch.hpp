@@ -0,0 +1,120 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "StorageHandler.hpp"
+
+/**
+ * @brief Config Patch - Field-addressable configuration edits
+ *
+ * Every configurable value has a path named after its /api/config key,
+ * array cells addressed by index:
+ *   qs.minRpm, qs.cutMap.rpmAxis[3], qs.cutMap.cutTimeUs[2][7],
+ *   network.staSsid, telemetry.sampleRate, sensors.tpsOpenMv
+ * qs.cutTimeMap[x] is the legacy 1D map in ms, written to column x of
+ * every load row.
+ *
+ * A patch is a JSON object of path/value pairs. All of them are checked
+ * (path, index, type, range, then cross-field rules such as ascending map
+ * axes) on a copy before anything is applied, so a patch is applied whole
+ * or not at all. The schema is one static table of offsets into
+ * SystemConfig; nothing is allocated per field.
+ *
+ * Passwords are write-only: query() and diff() never return their values.
+ */
+class ConfigPatch {
+public:
+    static constexpr size_t MAX_PATH = 40;          // Longest path including indices
+    static constexpr size_t MAX_CHANGED = 24;       // Changed fields listed in a reply, beyond that "resync"
+
+    /**
+     * @brief Validate a patch and apply it onto config
+     * @param sections Set to the StorageHandler::DIRTY_* bits of the sections touched
+     * @param errors Receives path: reason for every rejected entry
+     * @return false if any entry was rejected (config unchanged)
+     */
+    static bool apply(JsonObjectConst patch, StorageHandler::SystemConfig& config,
+                      uint8_t& sections, JsonObject errors);
+
+    /**
+     * @brief Write the fields of the given sections that differ between two configs
+     * @return Number of changed fields, more than MAX_CHANGED are counted but not written
+     */
+    static size_t diff(const StorageHandler::SystemConfig& before, const StorageHandler::SystemConfig& after,
+                       uint8_t sections, JsonObject changed);
+
+    /**
+     * @brief Write the current value of one cell, or of all fields under a path prefix
+     * Array fields without an index are written as (nested) arrays.
+     * @return Number of fields written, 0 for an unknown path
+     */
+    static size_t query(const StorageHandler::SystemConfig& config, const char* path, JsonObject out);
+
+    /**
+     * @brief Streaming filter keeping only the patch members of a message
+     */
+    static void makeFilter(JsonDocument& filter);
+
+private:
+    enum class Type : uint8_t {
+        BOOL,
+        U8,
+        U16,
+        U32,
+        ENUM,       // uint8_t index into names
+        TEXT        // char array, max = buffer size
+    };
+
+    // Field flags
+    static constexpr uint8_t WRITE_ONLY = 0x01;     // Never returned (passwords)
+    static constexpr uint8_t ALL_ROWS = 0x02;       // One column index, written to every row
+    static constexpr uint8_t READ_ONLY = 0x04;
+
+    struct Field {
+        const char* path;
+        uint8_t section;            // StorageHandler::DIRTY_* bit
+        Type type;
+        uint16_t offset;            // Into SystemConfig
+        uint8_t rows;               // Array shape, 1 × 1 for scalars
+        uint8_t cols;
+        uint16_t scale;             // Stored value = JSON value × scale
+        uint32_t min;               // Stored units
+        uint32_t max;
+        const char* const* names;   // ENUM values, nullptr terminated
+        uint8_t flags;
+    };
+
+    static const Field FIELDS[];
+    static const size_t FIELD_COUNT;
+
+    /**
+     * @brief Resolve "name[y][x]" to a field and element index
+     * @return nullptr with reason set if the path or index is invalid
+     */
+    static const Field* resolve(const char* path, size_t& element, const char*& reason);
+
+    /**
+     * @brief Raw stored value of one element (0 for TEXT)
+     */
+    static uint32_t readElement(const Field& field, const StorageHandler::SystemConfig& config, size_t element);
+    static void writeElement(const Field& field, StorageHandler::SystemConfig& config, size_t element, uint32_t value);
+
+    /**
+     * @brief Check one value against the field, store it into config
+     * @return nullptr on success, else the reason
+     */
+    static const char* setValue(const Field& field, size_t element, JsonVariantConst value,
+                                StorageHandler::SystemConfig& config);
+
+    /**
+     * @brief Cross-field rules on the sections touched
+     * @return nullptr if consistent, else the reason with path set to the offending field
+     */
+    static const char* checkConsistency(const StorageHandler::SystemConfig& config, uint8_t sections,
+                                        const char*& path);
+
+    static void writeValue(const Field& field, const StorageHandler::SystemConfig& config, size_t element,
+                           JsonVariant out);
+    static void formatPath(const Field& field, size_t element, char* buffer, size_t size);
+    static bool sameElement(const Field& field, const StorageHandler::SystemConfig& a,
+                            const StorageHandler::SystemConfig& b, size_t element);
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include <Arduino.h>
+#include <soc/gpio_struct.h>
+#include "pins.hpp"
+
+/**
+ * @brief Ignition cut output backends, selected at compile time
+ *
+ * Each backend is a type with begin(), engage() and release(). engage() and
+ * release() are single writes to the GPIO set/clear registers with the pin
+ * and polarity as template constants, so the ISR path has no digitalWrite()
+ * call and no runtime branch on the output type.
+ *
+ * The backend for a build is chosen with QS_CUT_OUTPUT (see platformio.ini):
+ * - QS_CUT_CDI  : SCR kill on the CDI charge (QS_SCR), default
+ * - QS_CUT_TCI  : TCI trigger interrupt (QS_TCI)
+ * - QS_CUT_SSR  : Solid state relay in the ignition feed (QS_SSR)
+ * - QS_CUT_RELAY: Mechanical relay (QS_RELAY). The contacts open
+ *   QS_RELAY_LEAD_US after the coil is energized, so the cut alarm is
+ *   extended by that lead to keep the spark interrupted for the map time
+ * QS_CUT_PIN overrides the backend's default pin.
+ */
+#define QS_CUT_CDI   1
+#define QS_CUT_TCI   2
+#define QS_CUT_SSR   3
+#define QS_CUT_RELAY 4
+
+#ifndef QS_CUT_OUTPUT
+#define QS_CUT_OUTPUT QS_CUT_CDI
+#endif
+
+#ifndef QS_RELAY_LEAD_US
+#define QS_RELAY_LEAD_US 5000
+#endif
+
+namespace CutOutput {
+
+/**
+ * @brief Direct GPIO output through the W1TS/W1TC registers
+ */
+template <uint8_t Pin>
+struct GpioOutput {
+    static_assert(Pin < 46, "Not an ESP32-S2 output-capable GPIO");
+
+    static constexpr uint32_t MASK = 1UL << (Pin & 31);
+
+    static inline __attribute__((always_inline)) void setLevel(bool high) {
+        // Pin is a constant, the compiler keeps only one of these writes
+        if (Pin < 32) {
+            if (high) GPIO.out_w1ts = MASK;
+            else GPIO.out_w1tc = MASK;
+        } else {
+            if (high) GPIO.out1_w1ts.val = MASK;
+            else GPIO.out1_w1tc.val = MASK;
+        }
+    }
+};
+
+/**
+ * @brief Cut output on one pin with a fixed polarity and actuation lead
+ */
+template <uint8_t Pin, bool ActiveHigh, uint32_t LeadUs>
+struct Driver {
+    static constexpr uint8_t PIN = Pin;
+    static constexpr uint32_t LEAD_US = LeadUs;    // Delay from engage() to an effective cut
+
+    static void begin() {
+        pinMode(Pin, OUTPUT);
+        release();
+    }
+
+    static inline __attribute__((always_inline)) void engage() {
+        GpioOutput<Pin>::setLevel(ActiveHigh);
+    }
+
+    static inline __attribute__((always_inline)) void release() {
+        GpioOutput<Pin>::setLevel(!ActiveHigh);
+    }
+};
+
+#if QS_CUT_OUTPUT == QS_CUT_CDI
+#ifndef QS_CUT_PIN
+#define QS_CUT_PIN QS_SCR
+#endif
+using Active = Driver<QS_CUT_PIN, true, 0>;
+constexpr const char* NAME = "CDI kill";
+#elif QS_CUT_OUTPUT == QS_CUT_TCI
+#ifndef QS_CUT_PIN
+#define QS_CUT_PIN QS_TCI
+#endif
+using Active = Driver<QS_CUT_PIN, true, 0>;
+constexpr const char* NAME = "TCI interrupt";
+#elif QS_CUT_OUTPUT == QS_CUT_SSR
+#ifndef QS_CUT_PIN
+#define QS_CUT_PIN QS_SSR
+#endif
+using Active = Driver<QS_CUT_PIN, true, 0>;
+constexpr const char* NAME = "SSR";
+#elif QS_CUT_OUTPUT == QS_CUT_RELAY
+#ifndef QS_CUT_PIN
+#define QS_CUT_PIN QS_RELAY
+#endif
+using Active = Driver<QS_CUT_PIN, true, QS_RELAY_LEAD_US>;
+constexpr const char* NAME = "Relay";
+#else
+#error "Unknown QS_CUT_OUTPUT, use QS_CUT_CDI, QS_CUT_TCI, QS_CUT_SSR or QS_CUT_RELAY"
+#endif
+
+}  // namespace CutOutput
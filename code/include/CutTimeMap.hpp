@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include <array>
+
+/**
+ * @brief Cut Time Map - 2D cut time table (RPM × load) with compiled lookup
+ *
+ * The editable table has configurable RPM and load breakpoints. The load axis
+ * is either throttle position (0.1% units) or unused.
+ *
+ * compile() bakes the table into a dense lookup table by bilinear
+ * interpolation. The table lives in internal RAM and has LUT_LOAD_ROWS load
+ * rows and one column per LUT_RPM_STEP RPM. Each cell holds a base value and
+ * a fixed-point slope, so lookup() is safe to call from an ISR and does only
+ * an index and a multiply-add.
+ */
+class CutTimeMap {
+public:
+    static constexpr size_t RPM_POINTS = 11;
+    static constexpr size_t LOAD_POINTS = 6;
+
+    // Second map axis
+    enum class LoadSource : uint8_t {
+        NONE,       // 1D map, only the first load row is used
+        THROTTLE    // Throttle position in 0.1% (0-1000)
+    };
+
+    // Editable map definition (stored in config)
+    struct Table {
+        LoadSource loadSource;
+        std::array<uint16_t, RPM_POINTS> rpmAxis;    // Strictly ascending RPM breakpoints
+        std::array<uint16_t, LOAD_POINTS> loadAxis;  // Strictly ascending load breakpoints
+        std::array<std::array<uint32_t, RPM_POINTS>, LOAD_POINTS> cutTimeUs; // [load][rpm]
+    };
+
+    // Compiled lookup table geometry
+    static constexpr uint16_t LUT_RPM_STEP = 250;
+    static constexpr uint16_t LUT_RPM_MAX = 20000;
+    static constexpr size_t LUT_RPM_COLS = LUT_RPM_MAX / LUT_RPM_STEP + 1;
+    static constexpr size_t LUT_LOAD_ROWS = 16;  // 15 intervals over the load axis
+    static constexpr uint8_t LUT_SLOPE_SHIFT = 8;
+
+    CutTimeMap();
+
+    /**
+     * @brief Fill table with default axes and a flat cut time
+     */
+    static void getDefaultTable(Table& table, uint32_t cutTimeUs);
+
+    /**
+     * @brief Check axes are strictly ascending
+     */
+    static bool isValid(const Table& table);
+
+    /**
+     * @brief Bilinear interpolation on the editable table (clamped at both ends)
+     * Not ISR-safe (floating point), used by compile() and diagnostics
+     */
+    static float interpolate(const Table& table, float rpm, float load);
+
+    /**
+     * @brief Load source to/from config string ("none", "tps"), unknown values are NONE
+     */
+    static const char* loadSourceToString(LoadSource source);
+    static LoadSource loadSourceFromString(const char* str);
+
+    /**
+     * @brief Precompute dense lookup table from the editable table
+     * @return false if the table is invalid (lookup table left unchanged)
+     */
+    bool compile(const Table& table);
+
+    /**
+     * @brief Cut time in µs for given RPM and load (ISR-safe)
+     */
+    uint32_t IRAM_ATTR lookup(uint16_t rpm, uint16_t load) const;
+
+private:
+    struct Cell {
+        uint32_t baseUs;    // Cut time at the start of the column
+        int32_t slope;      // µs per RPM, scaled by 2^LUT_SLOPE_SHIFT
+    };
+
+    std::array<std::array<Cell, LUT_RPM_COLS>, LUT_LOAD_ROWS> _lut;
+    uint16_t _loadMin;
+    uint16_t _loadRange;
+    uint32_t _loadScale;    // Row index per load unit, 16.16 fixed point (0 = single row)
+};
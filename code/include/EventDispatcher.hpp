@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include "QuickShifterEngine.hpp"
+
+/**
+ * @brief Event Dispatcher - Drains the engine event ring in a low-priority task
+ * 
+ * Pulls binary event records out of QuickShifterEngine and hands each one to
+ * the registered sinks (Serial, WebSocket, flash logger, ...). All formatting
+ * and I/O happens here, outside ISR context and off the main loop.
+ * drain() is run periodically by the TaskManager events task (the only
+ * consumer of the engine event ring).
+ */
+class EventDispatcher {
+public:
+    using Sink = void (*)(const QuickShifterEngine::Event& event, void* context);
+    
+    static constexpr size_t MAX_SINKS = 6;
+
+    explicit EventDispatcher(QuickShifterEngine& qsEngine);
+    
+    /**
+     * @brief Register a sink (call before the drain task starts)
+     * @return false if all sink slots are taken
+     */
+    bool addSink(Sink sink, void* context);
+    
+    /**
+     * @brief Deliver all pending events to sinks (single consumer task only)
+     */
+    void drain();
+    
+    /**
+     * @brief TaskManager entry point
+     * @param context EventDispatcher instance
+     */
+    static void drainTask(void* context);
+    
+    /**
+     * @brief Print shift/cut events on Serial
+     * @param includePulses Also print every pickup pulse (very verbose)
+     */
+    void setSerialOutput(bool enabled, bool includePulses = false);
+    
+    /**
+     * @brief Human-readable name of an event type
+     */
+    static const char* eventTypeToString(QuickShifterEngine::EventType type);
+
+private:
+    QuickShifterEngine& _qsEngine;
+    
+    struct SinkSlot {
+        Sink sink;
+        void* context;
+    };
+    SinkSlot _sinks[MAX_SINKS];
+    size_t _sinkCount;
+    
+    bool _serialEnabled;
+    bool _serialPulses;
+    uint32_t _reportedDropped;
+    
+    /**
+     * @brief Built-in Serial sink
+     */
+    void printEvent(const QuickShifterEngine::Event& event);
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer
+ *
+ * Fixed size, no allocation, O(1) push and pop. The producer side is meant to
+ * be called from ISRs. On the single-core ESP32-S2 all engine interrupts run
+ * at the same level, so they never preempt each other and together they act
+ * as one producer. The consumer is a single task.
+ *
+ * When the buffer is full, push() drops the new item and counts it, so the
+ * producer never blocks.
+ */
+template <typename T, size_t N>
+class EventRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "EventRing size must be a power of two");
+
+public:
+    EventRing() : _head(0), _tail(0), _dropped(0) {}
+
+    /**
+     * @brief Append item (producer side, ISR-safe)
+     * @return false if the ring was full and the item was dropped
+     */
+    inline __attribute__((always_inline)) bool push(const T& item) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        const uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail >= N) {
+            _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        _buffer[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove oldest item (consumer side)
+     * @return false if the ring was empty
+     */
+    bool pop(T& item) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        const uint32_t head = _head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        item = _buffer[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Number of items waiting to be consumed
+     */
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Total items dropped because the ring was full
+     */
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    std::array<T, N> _buffer;
+    std::atomic<uint32_t> _head;     // Written by producer only
+    std::atomic<uint32_t> _tail;     // Written by consumer only
+    std::atomic<uint32_t> _dropped;  // Written by producer only
+};
@@ -1,11 +1,23 @@
 #pragma once
 #include <Arduino.h>
+#include <driver/ledc.h>
 
 /**
  * @brief LED Controller - Hardware abstraction for visual feedback
- * 
+ *
  * Provides a clean interface for controlling the RGB LED and built-in LED
  * Isolates the rest of the system from specific pin assignments and PWM details
+ *
+ * The RGB channels run on LEDC (one timer, three channels). Blink and fade
+ * patterns are hardware fades: each phase (on/off hold, ramp up/down) is
+ * one LEDC fade, and the fade end interrupt of the brightest channel
+ * programs the next phase, so nothing needs to be polled. Registers are
+ * only written when the colour or pattern actually changes.
+ *
+ * Engine states arrive through onEngineState() (QuickShifterEngine state
+ * listener) straight from the cut path, so the cut colour follows the real
+ * cut output. A held status (OTA) keeps the LED until released; engine
+ * states received meanwhile are shown on release.
  */
 class LedController {
 public:
@@ -13,67 +25,116 @@ public:
         NO_SIGNAL,      // Red - No pickup coil signal detected
         SIGNAL_OK,      // Green - Normal operation with signal
         IGNITION_CUT,   // Blue - Ignition cut active
-        WIFI_AP,        // Yellow - WiFi in AP mode
-        WIFI_STA,       // Cyan - WiFi in STA mode
-        OTA_UPDATE,     // Magenta - OTA update in progress
+        WIFI_AP,        // Yellow flash - WiFi in AP mode
+        WIFI_STA,       // Cyan flash - WiFi in STA mode
+        OTA_UPDATE,     // Magenta fade - OTA update in progress
         ERROR           // Red blink - System error
     };
 
+    enum class Pattern : uint8_t {
+        SOLID,
+        BLINK,          // On/off, half a period each
+        FADE,           // Ramp up/down, half a period each
+        FLASH           // Solid for half a period, then back to the engine state
+    };
+
+    static constexpr ledc_mode_t LEDC_MODE = LEDC_LOW_SPEED_MODE;
+    static constexpr ledc_timer_t LEDC_TIMER = LEDC_TIMER_0;
+    static constexpr ledc_channel_t LEDC_CHANNEL_RED = LEDC_CHANNEL_0;   // Green and blue follow
+    static constexpr uint32_t PWM_FREQUENCY_HZ = 5000;                     // 8-bit duty
+    static constexpr uint32_t MAX_FADE_CYCLES = 1023;                      // 10-bit step length
+    static constexpr uint16_t DEFAULT_PERIOD_MS = 500;
+
     LedController();
-    
+
     /**
      * @brief Initialize LED controller with pin assignments
      */
     void begin(uint8_t redPin, uint8_t greenPin, uint8_t bluePin, uint8_t builtinPin);
-    
+
     /**
-     * @brief Update LED state - call in main loop for blinking effects
+     * @brief Set status LED color and pattern based on system state
      */
-    void update();
-    
+    void setStatus(Status status);
+
     /**
-     * @brief Set status LED color based on system state
+     * @brief Show a status and ignore engine states until releaseStatus()
      */
-    void setStatus(Status status);
-    
+    void holdStatus(Status status);
+
+    /**
+     * @brief Drop a held status, shows the latest engine state
+     */
+    void releaseStatus();
+
     /**
      * @brief Set custom RGB color (0-255 for each channel)
      */
     void setRgb(uint8_t r, uint8_t g, uint8_t b);
-    
+
     /**
-     * @brief Control built-in LED
+     * @brief Control built-in LED (ISR safe, direct GPIO register write)
      */
-    void setBuiltinLed(bool state);
-    
+    void IRAM_ATTR setBuiltinLed(bool state);
+
     /**
      * @brief Enable/disable blinking for current status
      */
-    void setBlinking(bool enabled, uint16_t periodMs = 500);
+    void setBlinking(bool enabled, uint16_t periodMs = DEFAULT_PERIOD_MS);
+
+    /**
+     * @brief Run a pattern on the current colour
+     */
+    void setPattern(Pattern pattern, uint16_t periodMs = DEFAULT_PERIOD_MS);
+
+    /**
+     * @brief QuickShifterEngine state listener (cut path or engine task)
+     *
+     * Shows the cut/signal status unless one is held and mirrors the cut
+     * on the built-in LED.
+     */
+    static void IRAM_ATTR onEngineState(bool signalActive, bool cutActive, void* context);
 
 private:
     uint8_t _redPin;
     uint8_t _greenPin;
     uint8_t _bluePin;
     uint8_t _builtinPin;
-    
-    Status _currentStatus;
-    bool _blinkEnabled;
-    uint16_t _blinkPeriod;
-    unsigned long _lastBlinkTime;
-    bool _blinkState;
-    
-    uint8_t _currentR;
-    uint8_t _currentG;
-    uint8_t _currentB;
-    
+    bool _ready;
+
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;  // Engine ISRs, the fade interrupt and tasks
+    intr_handle_t _fadeIsr;
+
+    volatile Status _engineStatus;  // Latest engine state, shown when nothing is held
+    volatile bool _held;
+
+    // What the hardware currently shows
+    uint8_t _rgb[3];
+    Pattern _pattern;
+    uint16_t _periodMs;
+    bool _phaseOn;                  // Pattern phase: on/ramping up
+    ledc_channel_t _masterChannel;  // Channel whose fade end drives the pattern
+
     /**
      * @brief Get RGB values for a given status
      */
-    void getStatusColor(Status status, uint8_t& r, uint8_t& g, uint8_t& b);
-    
+    static void IRAM_ATTR getStatusColor(Status status, uint8_t& r, uint8_t& g, uint8_t& b);
+    static Pattern IRAM_ATTR getStatusPattern(Status status);
+
+    /**
+     * @brief Show a status (lock held)
+     */
+    void IRAM_ATTR showStatus(Status status);
+
     /**
-     * @brief Apply current RGB values to hardware
+     * @brief Show colour and pattern, no register writes if both are unchanged (lock held)
      */
-    void applyRgb();
+    void IRAM_ATTR show(uint8_t r, uint8_t g, uint8_t b, Pattern pattern, uint16_t periodMs);
+
+    /**
+     * @brief Program the current pattern phase on all channels (lock held)
+     */
+    void IRAM_ATTR startPhase();
+
+    static void IRAM_ATTR fadeEndISR(void* arg);
 };
@@ -0,0 +1,168 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include "SlabPool.hpp"
+#include "TelemetryFrame.hpp"
+
+/**
+ * @brief Message Pool - Recycled WebSocket message and HTTP response buffers
+ *
+ * The web server queues WebSocket messages as shared
+ * std::vector<uint8_t> buffers (AsyncWebSocketSharedBuffer). Handing it
+ * buffers from here means the same BUFFER_COUNT vectors, reserved once in
+ * begin(), circulate for the whole session instead of one allocation per
+ * message and client: acquire() copies the message into the smallest free
+ * size class and the shared pointer's deleter puts the vector back once
+ * the last client has sent it. The shared pointer control blocks come from
+ * a slab as well. One buffer is shared by all clients of a broadcast.
+ *
+ * Size classes: SMALL for events and OTA progress, MEDIUM for JSON and
+ * binary telemetry frames and perf, LARGE for config JSON (HTTP responses
+ * through PooledResponse). A message that fits no free buffer falls back to
+ * the heap and is counted, so a too small pool shows up in the stats
+ * instead of failing.
+ *
+ * The library still allocates its own bookkeeping (message queue, request
+ * objects), so heap free, minimum and largest free block are sampled
+ * (sampleHeap(), 1 Hz from the network task) to watch fragmentation.
+ */
+class MessagePool {
+public:
+    static constexpr size_t SMALL_SIZE = 256;
+    static constexpr size_t SMALL_COUNT = 16;
+    static constexpr size_t MEDIUM_SIZE = 640;      // Binary telemetry frame, perf JSON
+    static constexpr size_t MEDIUM_COUNT = 8;
+    static constexpr size_t LARGE_SIZE = 2048;      // Config JSON
+    static constexpr size_t LARGE_COUNT = 4;
+    static constexpr size_t BUFFER_COUNT = SMALL_COUNT + MEDIUM_COUNT + LARGE_COUNT;
+    static constexpr size_t CONTROL_BLOCK_SIZE = 32;    // shared_ptr control block with deleter and allocator
+
+    static_assert(BUFFER_COUNT < 32, "One free bit per buffer");
+    static_assert(TelemetryFrame::MAX_FRAME_SIZE <= MEDIUM_SIZE, "Binary telemetry frames must fit MEDIUM");
+
+    enum class SizeClass : uint8_t {
+        SMALL,
+        MEDIUM,
+        LARGE,
+        COUNT
+    };
+
+    struct HeapStats {
+        uint32_t freeBytes;
+        uint32_t minFreeBytes;      // Low-water mark since boot
+        uint32_t largestBlock;      // Largest single allocation possible
+        uint8_t fragmentation;      // 100 - largest block in % of free
+    };
+
+    MessagePool();
+
+    /**
+     * @brief Reserve all buffers (once, at boot, before the server starts)
+     */
+    bool begin();
+
+    /**
+     * @brief Buffer holding a copy of data, pooled if one is free, else from the heap
+     * @return nullptr only if the heap fallback failed as well
+     */
+    AsyncWebSocketSharedBuffer acquire(const void* data, size_t len);
+
+    /**
+     * @brief Refresh the heap counters (walks the heap, keep it slow)
+     */
+    void sampleHeap();
+
+    const HeapStats& getHeapStats() const { return _heap; }
+
+    /**
+     * @brief Messages that found no pooled buffer since boot
+     */
+    uint32_t getFallbacks() const { return _fallbacks; }
+
+    /**
+     * @brief Pool and heap counters ({"heap":{..},"classes":[..],..})
+     */
+    void toJson(JsonObject out) const;
+
+    static const char* sizeClassToString(SizeClass sizeClass);
+
+private:
+    /**
+     * @brief Returns a buffer to the pool once the last reference is gone
+     */
+    struct Releaser {
+        MessagePool* pool;
+        uint8_t index;
+        void operator()(std::vector<uint8_t>* buffer) const { pool->release(index, buffer); }
+    };
+
+    /**
+     * @brief Allocator placing shared_ptr control blocks in the slab
+     */
+    template <typename T>
+    struct ControlBlockAllocator {
+        typedef T value_type;
+        MessagePool* pool;
+
+        explicit ControlBlockAllocator(MessagePool* p) : pool(p) {}
+        template <typename U>
+        ControlBlockAllocator(const ControlBlockAllocator<U>& other) : pool(other.pool) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(pool->allocateControlBlock(n * sizeof(T))); }
+        void deallocate(T* p, size_t) { pool->releaseControlBlock(p); }
+
+        template <typename U>
+        bool operator==(const ControlBlockAllocator<U>& other) const { return pool == other.pool; }
+        template <typename U>
+        bool operator!=(const ControlBlockAllocator<U>& other) const { return pool != other.pool; }
+    };
+
+    std::array<std::vector<uint8_t>, BUFFER_COUNT> _buffers;
+    SlabPool<CONTROL_BLOCK_SIZE, BUFFER_COUNT> _controlBlocks;
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t _used;                 // Bit per buffer in use
+    bool _ready;
+
+    std::array<uint8_t, static_cast<size_t>(SizeClass::COUNT)> _inUse;
+    std::array<uint8_t, static_cast<size_t>(SizeClass::COUNT)> _peak;
+    volatile uint32_t _fallbacks;
+    HeapStats _heap;
+
+    static SizeClass classOf(size_t index);
+    static size_t capacityOf(SizeClass sizeClass);
+    static size_t firstIndexOf(SizeClass sizeClass);
+    static size_t countOf(SizeClass sizeClass);
+
+    void release(uint8_t index, std::vector<uint8_t>* buffer);
+    void* allocateControlBlock(size_t size);
+    void releaseControlBlock(void* ptr);
+};
+
+/**
+ * @brief HTTP response sending a pooled buffer, itself placed in a slab
+ *
+ * The server deletes responses through the base class; the class-specific
+ * operator new/delete keep up to POOL_COUNT of them out of the heap (heap
+ * fallback beyond that).
+ */
+class PooledResponse : public AsyncAbstractResponse {
+public:
+    static constexpr size_t POOL_COUNT = 4;         // Concurrent pooled responses
+    static constexpr size_t SLOT_SIZE = 256;
+
+    PooledResponse(int code, const char* contentType, AsyncWebSocketSharedBuffer body);
+
+    bool _sourceValid() const override { return static_cast<bool>(_body); }
+    size_t _fillBuffer(uint8_t* buf, size_t maxLen) override;
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
+private:
+    AsyncWebSocketSharedBuffer _body;
+    size_t _offset;
+};
@@ -11,46 +11,19 @@
 #include "StorageHandler.hpp"
 #include "QuickShifterEngine.hpp"
 #include "LedController.hpp"
-
-/**
- * @brief OTA Update States
- */
-enum class OTAState {
-    IDLE,
-    CONNECTING,
-    DOWNLOADING,
-    UPLOADING,
-    WRITING,
-    VERIFYING,
-    REBOOTING,
-    SUCCESS,
-    ERROR
-};
-
-/**
- * @brief OTA Error Codes
- */
-enum class OTAError {
-    NONE,
-    CONNECTION_REFUSED,
-    TIMEOUT,
-    DNS_FAILED,
-    SSL_FAILED,
-    HTTP_404,
-    HTTP_500,
-    INVALID_RESPONSE,
-    FILE_TOO_LARGE,
-    PARTITION_NOT_FOUND,
-    FLASH_WRITE_FAILED,
-    FLASH_VERIFY_FAILED,
-    INSUFFICIENT_SPACE,
-    OTA_BEGIN_FAILED,
-    OTA_END_FAILED,
-    ROLLBACK_FAILED,
-    INVALID_URL,
-    INVALID_FILE,
-    UNKNOWN
-};
+#include "TelemetryFrame.hpp"
+#include "TelemetrySampler.hpp"
+#include "SessionLogger.hpp"
+#include "SensorAcquisition.hpp"
+#include "AssetServer.hpp"
+#include "OtaUpdater.hpp"
+#include "MessagePool.hpp"
+#include "SlabPool.hpp"
+#include "ConfigPatch.hpp"
+#include "PickupSimulator.hpp"
+#include "ShiftAnalytics.hpp"
+#include "BootProfile.hpp"
+#include <array>
 
 /**
  * @brief Network Manager - Handles all network operations
@@ -72,7 +45,9 @@ public:
         ERROR
     };
 
-    NetworkManager(StorageHandler& storage, QuickShifterEngine& qsEngine, LedController& led);
+    NetworkManager(StorageHandler& storage, QuickShifterEngine& qsEngine, LedController& led,
+                   TelemetrySampler& sampler, SessionLogger& logger, SensorAcquisition& sensors,
+                   ShiftAnalytics& analytics, const BootProfile& boot);
     
     /**
      * @brief Initialize network with configuration
@@ -80,10 +55,18 @@ public:
     bool begin();
     
     /**
-     * @brief Main loop update - handles WebSocket broadcasts and state machine
+     * @brief Housekeeping update - WebSocket client cleanup (network task)
      */
     void update();
     
+    /**
+     * @brief Telemetry update (telemetry task)
+     *
+     * Streams new history samples to binary clients in batched frames and
+     * broadcasts the latest sample as JSON at the configured update rate.
+     */
+    void updateTelemetry();
+    
     /**
      * @brief Get current network state
      */
@@ -110,41 +93,119 @@ public:
     bool switchToStaMode(const char* ssid, const char* password);
     
     /**
-     * @brief Start OTA update process (firmware then filesystem)
+     * @brief Start a background OTA download (firmware then filesystem)
+     * @return false without a WiFi station connection or while an update runs
+     */
+    bool startOtaUpdate(const String& url = OTA_UPDATE_URL);
+    
+    /**
+     * @brief An OTA update or rollback is in progress
+     */
+    bool isOtaActive() const { return _ota.isBusy(); }
+    
+    /**
+     * @brief EventDispatcher sink - forwards shift/cut events to WebSocket clients
+     * @param context NetworkManager instance
+     */
+    static void onEngineEvent(const QuickShifterEngine::Event& event, void* context);
+    
+#if QS_HIL
+    /**
+     * @brief Serve /api/hil for the bench pickup generator (HIL builds)
      */
-    void startOtaUpdate();
+    void setPickupSimulator(PickupSimulator* simulator) { _hil = simulator; }
+#endif
 
 private:
     // Component references
     StorageHandler& _storage;
     QuickShifterEngine& _qsEngine;
     LedController& _led;
+    TelemetrySampler& _sampler;
+    SessionLogger& _logger;
+    SensorAcquisition& _sensors;
+    ShiftAnalytics& _analytics;
+    const BootProfile& _boot;
     
     // Network state
     State _state;
     String _hardwareId;
     AsyncWebServer _server;
     AsyncWebSocket _ws;
+    AssetServer _assets;
     
     // Telemetry timing
     unsigned long _lastTelemetryUpdate;
     uint16_t _telemetryUpdateRate;
+    unsigned long _lastPerfBroadcast;
+    
+    // WebSocket clients: stream format, subscriptions and flow control
+    static constexpr size_t MAX_WS_CLIENTS = 6;         // Further connections are refused
+    static constexpr size_t MAX_CLIENT_QUEUE = 4;       // Queued messages before a client counts as lagging
+    static constexpr uint16_t MAX_DECIMATION = 16;      // A lagging client gets 1 of this many telemetry messages
+    static constexpr uint8_t RECOVER_SENDS = 8;         // Sends to a drained queue before the decimation halves
+    static constexpr uint16_t MAX_CLIENT_INTERVAL_MS = 10000;
+    static constexpr uint32_t PERF_BROADCAST_MS = 1000;
+    static constexpr uint32_t HEAP_SAMPLE_MS = 1000;
+    static constexpr size_t MAX_PATCH_SIZE = 1024;      // Config patch message or PATCH body
+    static constexpr size_t PATCH_BODY_SIZE = (MAX_PATCH_SIZE + 1 + 7) & ~size_t(7);  // Body plus terminator
+    static constexpr size_t PATCH_BODY_COUNT = 2;       // PATCH bodies received at once
+    
+    enum Channel : uint8_t {
+        CHANNEL_TELEMETRY = 0x01,   // JSON or binary telemetry
+        CHANNEL_EVENTS = 0x02,      // {"type":"event",...}
+        CHANNEL_OTA = 0x04,         // {"type":"ota",...}
+        CHANNEL_PERF = 0x08,        // {"type":"perf",...} every PERF_BROADCAST_MS, opt-in
+        CHANNEL_DEFAULT = 0x07      // New connections: telemetry, events and OTA
+    };
+    
+    struct ClientSlot {
+        uint32_t id;                // WebSocket client ID, 0 = free slot
+        bool binary;                // Binary telemetry frames instead of JSON
+        uint8_t channels;           // Subscribed Channel bits
+        uint16_t intervalMs;        // JSON telemetry interval, 0 = telemetry update rate
+        uint16_t decimation;        // Telemetry: send 1 of N, raised while the client lags
+        uint16_t skipped;           // Binary frames skipped since the last one sent
+        uint8_t drainedSends;
+        uint32_t lastTelemetryMs;
+        uint32_t dropped;           // Messages not queued because the client lagged
+    };
+    std::array<ClientSlot, MAX_WS_CLIENTS> _clients;
+    
+    // Held around every walk of _ws.getClients() and slot change. The
+    // library fires WS_EVT_CONNECT/DISCONNECT (AsyncTCP task or
+    // cleanupClients()) before it frees a client, and those handlers take
+    // it too, so no client is freed while a fan-out iterates the list.
+    SemaphoreHandle_t _clientsMutex;
+    
+    // Binary telemetry sample batch
+    std::array<TelemetryFrame::Sample, TelemetryFrame::MAX_SAMPLES> _telemetryBatch;
+    size_t _telemetryBatchCount;
+    uint32_t _streamIndex;  // Next sampler index to stream
+    uint16_t _telemetrySequence;
+    
+    // Pooled WebSocket/HTTP buffers, heap fragmentation counters
+    MessagePool _messages;
+    unsigned long _lastHeapSample;
+    
+    // PATCH /api/config bodies, held in the request's _tempObject
+    SlabPool<PATCH_BODY_SIZE, PATCH_BODY_COUNT> _patchBodies;
     
     // Error tracking
     String _lastError;
     
-    // OTA state tracking
-    OTAState _otaState;
-    OTAError _lastOtaError;
-    uint8_t _otaProgress;
-    unsigned long _otaStartTime;
-    unsigned long _lastProgressUpdate;
-    size_t _totalSize;
-    size_t _writtenSize;
-    bool _updateInProgress;
+    // OTA pipeline (own tasks), progress pushed to WebSocket clients
+    OtaUpdater _ota;
+    uint32_t _otaRevision;      // Last OtaUpdater revision broadcast
+    State _stateBeforeOta;      // Restored when an update fails
+    bool _uploadAccepted;       // Current browser upload owns the pipeline
     
-    // OTA update server URL (placeholder)
-    static constexpr const char* OTA_UPDATE_URL = "https://github.com/D3stan/ecu-dev-board/releases/latest/download/firmware.bin";
+#if QS_HIL
+    PickupSimulator* _hil;      // Bench pickup generator, nullptr if not attached
+#endif
+    
+    // OTA update server URL (legacy {"ota":true} trigger, littlefs.bin is fetched next to it)
+    static constexpr const char* OTA_UPDATE_URL = "https://test.rsp-industries.com/firmware.bin";
     
     // Firmware and filesystem version strings
     static constexpr const char* FIRMWARE_VERSION = "1.0.0";
@@ -201,15 +262,97 @@ private:
                          AwsEventType type, void* arg, uint8_t* data, size_t len);
     
     /**
-     * @brief Broadcast telemetry to all WebSocket clients
+     * @brief Broadcast JSON telemetry to clients that did not opt into binary
      */
     void broadcastTelemetry();
     
+    /**
+     * @brief Send the batched samples as one binary frame to binary clients
+     */
+    void flushTelemetryBatch();
+    
+    /**
+     * @brief Handle {"stream":"binary"|"json"} format negotiation and
+     * {"subscribe":[channels],"intervalMs":n} subscriptions
+     * @return true if the message was a stream request
+     */
+    bool handleStreamRequest(AsyncWebSocketClient* client, const char* jsonData);
+    
+    /**
+     * @brief Client table, a new client starts on JSON with all channels
+     */
+    ClientSlot* addClient(uint32_t clientId);
+    ClientSlot* findClient(uint32_t clientId);
+    void removeClient(uint32_t clientId);
+    bool hasBinaryClients() const;
+    
+    /**
+     * @brief Flow control: false (and decimation raised) while the client's
+     * send queue is at MAX_CLIENT_QUEUE, decimation relaxed once it drains
+     */
+    bool canQueue(AsyncWebSocketClient& client, ClientSlot& slot);
+    
+    /**
+     * @brief Send a text message to connected clients subscribed to channel
+     */
+    void sendToChannel(Channel channel, const char* text, size_t len);
+    
+    /**
+     * @brief HTTP response with the body in a pooled buffer (add headers, then send)
+     */
+    AsyncWebServerResponse* beginPooledResponse(int code, const char* contentType, const char* body, size_t len);
+    void sendPooled(AsyncWebServerRequest* request, int code, const char* contentType, const char* body, size_t len) {
+        request->send(beginPooledResponse(code, contentType, body, len));
+    }
+    
+    /**
+     * @brief Serve a shift capture window as concatenated binary frames
+     */
+    void handleTelemetryCapture(AsyncWebServerRequest* request);
+    
     /**
      * @brief Handle configuration update from web interface
      */
     void handleConfigUpdate(const char* jsonData);
     
+    /**
+     * @brief WebSocket field patch {"patch":{"qs.cutMap.cutTimeUs[2][7]":75000},"id":1}
+     * Replies {"type":"config","id":1,"rev":N,"changed":{..}} (or "errors") to the sender.
+     * @return true if the message was a patch
+     */
+    bool handleConfigPatch(AsyncWebSocketClient* client, const char* jsonData, size_t len);
+    
+    /**
+     * @brief Parse a patch message, keeping only its "patch" and "id" members
+     */
+    static DeserializationError parseConfigPatch(JsonDocument& doc, const char* json, size_t len);
+    
+    /**
+     * @brief Validate and apply a patch, fill the reply with rev and changed fields or errors
+     * Applies the touched sections to the engine, sensors and sampler, then
+     * caches them for the deferred flash write.
+     * @return HTTP status: 200 applied, 400 rejected
+     */
+    int applyConfigPatch(JsonObjectConst patch, JsonObject reply);
+    
+    /**
+     * @brief GET /api/config?path=..: one field or all fields under a prefix
+     */
+    void handleConfigQuery(AsyncWebServerRequest* request);
+    
+    /**
+     * @brief PATCH /api/config once the body has arrived
+     */
+    void handleConfigPatchRequest(AsyncWebServerRequest* request);
+    
+    /**
+     * @brief Give a PATCH body slot back and detach it from the request
+     *
+     * The server free()s _tempObject with the request, so the slot has to
+     * be released (after parsing, or on disconnect) before that.
+     */
+    void releasePatchBody(AsyncWebServerRequest* request);
+    
     // OTA handlers
     void handleOTAPage(AsyncWebServerRequest* request);
     void handleOTAInfo(AsyncWebServerRequest* request);
@@ -222,27 +365,26 @@ private:
     // OTA utility functions
     bool validateURL(const String& url);
     bool checkSpace(size_t requiredSize);
-    bool beginOTA(size_t size, int type);
-    bool writeOTA(uint8_t* data, size_t len);
-    bool endOTA();
-    void setOTAState(OTAState state);
-    void setOTAError(OTAError error);
-    void updateOTAProgress(size_t current, size_t total);
-    const char* getOTAStateString() const;
-    String getOTAErrorString() const;
-    const char* otaErrorToString(OTAError error) const;
     String getCurrentPartition() const;
     size_t getAvailableSpace() const;
     size_t getMaxFirmwareSize() const;
     bool canRollback() const;
-    bool rollback();
     String getPartitionInfo() const;
     
     /**
-     * @brief Perform OTA update from server
-     * @param updateFirmware If true, update firmware; if false, update filesystem
+     * @brief Push OTA progress to clients, record failures, reboot when due
+     */
+    void updateOta();
+    
+    /**
+     * @brief Send {"type":"ota",...} with the current OTA status to subscribed clients
+     */
+    void broadcastOtaStatus();
+    
+    /**
+     * @brief Send {"type":"perf",...} (shift path histograms) to perf subscribers
      */
-    bool performOtaUpdate(bool updateFirmware);
+    void broadcastPerf();
     
     /**
      * @brief Setup mDNS responder
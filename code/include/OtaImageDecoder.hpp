@@ -0,0 +1,141 @@
+#pragma once
+#include <Arduino.h>
+#include <Update.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#if CONFIG_IDF_TARGET_ESP32S2
+#include <esp32s2/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+#include "OtaStatus.hpp"
+
+/**
+ * @brief OTA Image Decoder - Plain, compressed and delta images into Update
+ *
+ * Sits between the OTA writer task and Update.write(). A plain image
+ * (firmware.bin or a LittleFS image) passes through unchanged. A container
+ * image, built by tools/make_ota_image.py, starts with a Header and carries:
+ * - COMPRESSED: the payload is a zlib stream, inflated with the ROM tinfl
+ *   through a 32 KB dictionary window
+ * - DELTA: the payload is a patch against the running app partition
+ *   (firmware only). Each record is a control block (addLength, copyLength,
+ *   seek), addLength bytes added to the base byte by byte, then copyLength
+ *   literal bytes; the base position then moves by seek (bsdiff layout,
+ *   streamed in one sequence)
+ *
+ * A delta is only applied if the running partition's first baseSize bytes
+ * hash to baseSha256. The produced image is hashed while it is written and
+ * must match imageSha256 before Update.end() switches the boot partition.
+ *
+ * The inflate state (~43 KB) is allocated only while a compressed image is
+ * decoded, from PSRAM if available.
+ */
+class OtaImageDecoder {
+public:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr size_t MAGIC_SIZE = 4;                 // "QOTA"
+    static constexpr size_t DICT_SIZE = TINFL_LZ_DICT_SIZE; // 32 KB deflate window
+    static constexpr size_t BASE_CHUNK = 512;               // Base partition reads
+    static constexpr size_t CONTROL_SIZE = 12;              // addLength, copyLength, seek
+
+    enum Flags : uint8_t {
+        COMPRESSED = 0x01,
+        DELTA = 0x02
+    };
+
+    // Container header, little endian
+    struct Header {
+        char magic[MAGIC_SIZE];
+        uint8_t version;
+        uint8_t flags;
+        uint16_t reserved;
+        uint32_t imageSize;         // Size of the decoded image
+        uint32_t baseSize;          // DELTA: bytes of the running partition the patch reads
+        uint8_t baseSha256[32];     // DELTA: SHA-256 of those bytes
+        uint8_t imageSha256[32];    // SHA-256 of the decoded image
+    };
+    static_assert(sizeof(Header) == 80, "Header layout is shared with tools/make_ota_image.py");
+
+    OtaImageDecoder();
+    ~OtaImageDecoder();
+
+    /**
+     * @brief Prepare for a new image (no flash access yet)
+     * @param type U_FLASH or U_SPIFFS
+     * @param inputSize Bytes that will be written, 0 if unknown
+     */
+    void begin(int type, size_t inputSize);
+
+    /**
+     * @brief Decode input bytes into the update partition
+     * @return false on the first error (getError())
+     */
+    bool write(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Check size and hash, then Update.end() (sets the boot partition)
+     */
+    bool finish();
+
+    /**
+     * @brief Drop the image, the boot partition stays as it is
+     */
+    void abort();
+
+    OTAError getError() const { return _error; }
+    uint8_t getFlags() const { return _flags; }
+    size_t getImageWritten() const { return _imageWritten; }
+
+private:
+    enum class Phase : uint8_t {
+        HEADER,                     // Collecting the magic/header
+        RAW,                        // Plain image, pass through
+        PAYLOAD                     // Container payload
+    };
+
+    enum class PatchPhase : uint8_t {
+        CONTROL,
+        ADD,
+        COPY
+    };
+
+    int _type;
+    size_t _inputSize;
+    Phase _phase;
+    OTAError _error;
+    bool _started;                  // Update.begin() succeeded
+
+    Header _header;
+    size_t _headerLength;
+    uint8_t _flags;
+    size_t _imageWritten;
+    mbedtls_sha256_context _sha;
+
+    // Inflate
+    tinfl_decompressor* _inflator;
+    uint8_t* _dict;
+    size_t _dictOffset;
+    bool _inflateDone;
+
+    // Patch
+    const esp_partition_t* _base;
+    int64_t _basePos;
+    PatchPhase _patchPhase;
+    uint8_t _control[CONTROL_SIZE];
+    size_t _controlLength;
+    uint32_t _addRemaining;
+    uint32_t _copyRemaining;
+    int32_t _seek;
+    uint8_t _baseChunk[BASE_CHUNK];
+
+    bool consumeHeader(const uint8_t*& data, size_t& len);
+    bool startImage(size_t size);
+    bool verifyBase();
+    bool inflate(const uint8_t* data, size_t len);
+    bool unpack(const uint8_t* data, size_t len);
+    bool patch(const uint8_t* data, size_t len);
+    bool emit(const uint8_t* data, size_t len);
+    bool fail(OTAError error);
+    void release();
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+/**
+ * @brief OTA Update States
+ */
+enum class OTAState {
+    IDLE,
+    CONNECTING,
+    DOWNLOADING,
+    UPLOADING,
+    WRITING,
+    VERIFYING,
+    REBOOTING,
+    SUCCESS,
+    ERROR
+};
+
+/**
+ * @brief OTA Error Codes
+ */
+enum class OTAError {
+    NONE,
+    CONNECTION_REFUSED,
+    TIMEOUT,
+    DNS_FAILED,
+    SSL_FAILED,
+    HTTP_404,
+    HTTP_500,
+    INVALID_RESPONSE,
+    FILE_TOO_LARGE,
+    PARTITION_NOT_FOUND,
+    FLASH_WRITE_FAILED,
+    FLASH_VERIFY_FAILED,
+    INSUFFICIENT_SPACE,
+    OTA_BEGIN_FAILED,
+    OTA_END_FAILED,
+    ROLLBACK_FAILED,
+    INVALID_URL,
+    INVALID_FILE,
+    BUSY,
+    DECOMPRESS_FAILED,
+    BASE_MISMATCH,
+    UNKNOWN
+};
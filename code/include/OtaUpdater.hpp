@@ -0,0 +1,159 @@
+#pragma once
+#include <Arduino.h>
+#include "OtaStatus.hpp"
+#include "OtaImageDecoder.hpp"
+
+/**
+ * @brief OTA Updater - Background firmware/filesystem updates
+ *
+ * Image data flows through BUFFER_COUNT sector sized buffers: the producer
+ * (the download task for URL updates, the web server for browser uploads)
+ * fills one buffer while the writer task decodes the other into flash
+ * (OtaImageDecoder: plain, compressed or delta images), so network receive
+ * and flash writes overlap and neither blocks the web server, telemetry or
+ * the engine tasks. Both OTA tasks run below the network task.
+ *
+ * Nothing here blocks to reboot: after a successful update (or rollback)
+ * a reboot is scheduled REBOOT_DELAY_MS ahead, and the owner restarts once
+ * isRebootDue() (after flushing storage). State, stage and progress are
+ * polled through getRevision(), which changes whenever one of them does.
+ */
+class OtaUpdater {
+public:
+    static constexpr size_t BUFFER_SIZE = 4096;             // One flash sector
+    static constexpr size_t BUFFER_COUNT = 2;               // Receive one while writing the other
+    static constexpr uint32_t STREAM_TIMEOUT_MS = 15000;    // No data from the server/browser
+    static constexpr uint32_t BUFFER_WAIT_MS = 5000;        // Writer did not free a buffer
+    static constexpr uint32_t REBOOT_DELAY_MS = 2000;       // Lets the last responses go out
+    static constexpr uint32_t DOWNLOAD_STACK_SIZE = 8192;   // TLS handshake
+    static constexpr uint32_t WRITER_STACK_SIZE = 4096;     // Inflate and SHA-256
+    static constexpr UBaseType_t PRIORITY_WRITER = 3;       // Below the network task
+    static constexpr UBaseType_t PRIORITY_DOWNLOAD = 2;
+
+    enum class Stage : uint8_t {
+        NONE,
+        FIRMWARE,
+        FILESYSTEM
+    };
+
+    OtaUpdater();
+
+    /**
+     * @brief Create the buffers queues and both OTA tasks (idle until used)
+     * @param hardwareId Sent as "hwid" header with downloads
+     */
+    bool begin(const String& hardwareId);
+
+    /**
+     * @brief Download and flash an image in the background
+     * @param url Image URL (plain or container image), a filesystem image if the name says so
+     * @param withFilesystem After a firmware image, also fetch littlefs.bin next to it
+     * @return false if an update is already running
+     */
+    bool startDownload(const String& url, bool withFilesystem);
+
+    /**
+     * @brief Browser upload: begin an image of unknown size
+     * @param expectedSize Request length, only used for progress
+     * @return false if busy
+     */
+    bool beginUpload(Stage stage, size_t expectedSize);
+
+    /**
+     * @brief Browser upload: queue image data (waits for a free buffer)
+     */
+    bool feedUpload(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Browser upload: queue the last buffer, the writer verifies
+     * and finishes in the background
+     */
+    bool finishUpload();
+
+    /**
+     * @brief Switch the boot partition back and schedule a reboot
+     */
+    bool rollback();
+
+    /**
+     * @brief Abort a stream that stalled (network task, every cycle)
+     */
+    void update();
+
+    bool isBusy() const { return _busy; }
+    bool isRebootDue() const;
+
+    OTAState getState() const { return _state; }
+    OTAError getError() const { return _error; }
+    Stage getStage() const { return _stage; }
+    uint8_t getProgress() const { return _progress; }
+    size_t getWrittenSize() const { return _written; }
+    size_t getTotalSize() const { return _total; }
+    uint32_t getRevision() const { return _revision; }
+
+    const char* getStateString() const;
+    static const char* stateToString(OTAState state);
+    static const char* errorToString(OTAError error);
+    static const char* stageToString(Stage stage);
+
+    /**
+     * @brief Image type from a file name or URL (littlefs/spiffs/filesystem)
+     */
+    static Stage stageForName(const String& name);
+
+private:
+    struct Block {
+        uint8_t index;
+        uint16_t length;
+        bool last;                  // Finish the image after this block
+    };
+
+    String _hardwareId;
+    QueueHandle_t _free;            // Buffer indices ready to fill
+    QueueHandle_t _filled;          // Blocks waiting for the writer
+    SemaphoreHandle_t _stageDone;   // Writer finished (or aborted) an image
+    TaskHandle_t _downloadTask;
+
+    OtaImageDecoder _decoder;       // Writer task side: plain, compressed or delta images
+    uint8_t _buffers[BUFFER_COUNT][BUFFER_SIZE];
+    int16_t _fillIndex;             // Buffer held by the producer, -1 = none
+    size_t _fillLength;
+
+    volatile bool _busy;
+    volatile bool _uploading;       // Browser upload is the producer
+    volatile OTAState _state;
+    volatile OTAError _error;
+    volatile Stage _stage;
+    volatile uint8_t _progress;
+    volatile size_t _written;
+    size_t _total;
+    volatile uint32_t _revision;
+    volatile uint32_t _lastActivity;
+    uint32_t _lastProgressLog;
+    bool _finalStage;               // Reboot once this image is finished
+    uint32_t _rebootAt;             // 0 = none
+
+    String _url;
+    bool _withFilesystem;
+
+    static void downloadTaskEntry(void* context);
+    static void writerTaskEntry(void* context);
+    void runDownload();
+    void runWriter();
+
+    /**
+     * @brief Fetch one image and stream it into the buffers
+     */
+    bool downloadImage(const String& url, Stage stage, bool finalStage);
+
+    void beginImage(Stage stage, size_t size, bool finalStage);
+    bool reserve(uint8_t*& data, size_t& space);
+    bool commit(size_t len);
+    bool submit(bool last);
+    void finishImage();
+
+    void setState(OTAState state);
+    void fail(OTAError error);
+    void touch() { _lastActivity = millis(); }
+    void scheduleReboot();
+};
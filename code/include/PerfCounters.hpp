@@ -0,0 +1,181 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <array>
+#include <hal/cpu_hal.h>
+
+/**
+ * @brief Shift path latency and jitter histograms (CPU cycle counter)
+ *
+ * QuickShifterEngine time-stamps its ISRs with CCOUNT and records into one
+ * fixed-bin histogram per Probe:
+ * - SHIFT_LATENCY: shift switch/button ISR entry to the cut output engaged
+ * - CUT_END_ERROR: cut timer ticks (1 µs) from the alarm target to the
+ *   alarm ISR releasing the output (alarm ends only, not closed-loop ends)
+ * - PICKUP_ISR: pickup pulse handler run time
+ * - CUT_TIMER_ISR: cut alarm handler run time
+ *
+ * Each histogram has BIN_COUNT bins of 2^binShift raw units, the last one
+ * also counts everything above. Recording is a shift, a compare and an
+ * increment; min and max are exact, p50/p99 are bin upper edges.
+ * The engine ISRs never preempt each other, so they are the single writer.
+ * Readers do not lock; a summary taken during a record may be off by one.
+ *
+ * Built with QS_PERF=0 every hook is an empty inline function and the
+ * histograms are not allocated.
+ */
+#ifndef QS_PERF
+#define QS_PERF 1
+#endif
+
+class PerfCounters {
+public:
+    static constexpr size_t BIN_COUNT = 64;
+
+    enum class Probe : uint8_t {
+        SHIFT_LATENCY,
+        CUT_END_ERROR,
+        PICKUP_ISR,
+        CUT_TIMER_ISR,
+        COUNT
+    };
+    static constexpr size_t PROBE_COUNT = static_cast<size_t>(Probe::COUNT);
+
+    struct Summary {
+        uint32_t count;
+        uint32_t overflow;      // Samples in the last bin's open range
+        uint32_t minNs;
+        uint32_t maxNs;
+        uint32_t p50Ns;
+        uint32_t p99Ns;
+    };
+
+    PerfCounters();
+
+    /**
+     * @brief Cycle counter (ISR-safe)
+     */
+    static inline __attribute__((always_inline)) uint32_t now() {
+#if QS_PERF
+        return cpu_hal_get_cycle_count();
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief Handler run time since start (cycles) into probe
+     */
+    inline __attribute__((always_inline)) void end(Probe probe, uint32_t start) {
+#if QS_PERF
+        record(probe, now() - start);
+#else
+        (void)probe;
+        (void)start;
+#endif
+    }
+
+    /**
+     * @brief Shift ISR entry; shiftDone() at its exit clears a mark no cut used
+     */
+    inline __attribute__((always_inline)) void shiftEdge() {
+#if QS_PERF
+        _shiftStart = now() | 1;  // 0 = no pending edge
+#endif
+    }
+    inline __attribute__((always_inline)) void shiftDone() {
+#if QS_PERF
+        _shiftStart = 0;
+#endif
+    }
+
+    /**
+     * @brief Cut output engaged, records SHIFT_LATENCY for a pending edge
+     */
+    inline __attribute__((always_inline)) void cutEngaged() {
+#if QS_PERF
+        if (_shiftStart) {
+            record(Probe::SHIFT_LATENCY, now() - _shiftStart);
+            _shiftStart = 0;
+        }
+#endif
+    }
+
+    /**
+     * @brief Cut alarm (re)armed for targetTicks
+     */
+    inline __attribute__((always_inline)) void cutArmed(uint64_t targetTicks) {
+#if QS_PERF
+        _cutTargetTicks = targetTicks;
+#else
+        (void)targetTicks;
+#endif
+    }
+
+    /**
+     * @brief Alarm ISR released the cut at nowTicks, records CUT_END_ERROR
+     */
+    inline __attribute__((always_inline)) void cutReleased(uint64_t nowTicks) {
+#if QS_PERF
+        if (nowTicks >= _cutTargetTicks) {
+            const uint64_t late = nowTicks - _cutTargetTicks;
+            record(Probe::CUT_END_ERROR, late > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(late));
+        }
+#else
+        (void)nowTicks;
+#endif
+    }
+
+    /**
+     * @brief Clear all histograms (task context, interrupts masked for the clear)
+     */
+    void reset();
+
+    /**
+     * @brief Summary of one probe in ns
+     * @return false if nothing was recorded (or QS_PERF=0)
+     */
+    bool summarize(Probe probe, Summary& summary) const;
+
+    /**
+     * @brief All probes as JSON ({"enabled":..,"cpuMhz":..,"shiftLatency":{..},..})
+     */
+    void toJson(JsonObject out) const;
+
+    static const char* probeToString(Probe probe);
+
+private:
+    void clear();
+
+#if QS_PERF
+    struct Histogram {
+        std::array<uint32_t, BIN_COUNT> bins;
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+    };
+
+    std::array<Histogram, PROBE_COUNT> _histograms;
+    volatile uint32_t _shiftStart;
+    uint64_t _cutTargetTicks;
+
+    inline __attribute__((always_inline)) void record(Probe probe, uint32_t value) {
+        Histogram& h = _histograms[static_cast<size_t>(probe)];
+        uint32_t bin = value >> binShift(probe);
+        if (bin >= BIN_COUNT) bin = BIN_COUNT - 1;
+        h.bins[bin]++;
+        h.count++;
+        if (value < h.min) h.min = value;
+        if (value > h.max) h.max = value;
+    }
+
+    // Bin width per probe; a function, not a table, so the ISRs never read flash
+    static constexpr uint8_t binShift(Probe probe) {
+        return probe == Probe::SHIFT_LATENCY ? 6 :  // 64 cycles (0.27 µs at 240 MHz), up to ~17 µs
+               probe == Probe::CUT_END_ERROR ? 0 :  // 1 µs timer ticks, up to 63 µs
+               5;                                   // ISR run times: 32 cycles, up to ~8.5 µs
+    }
+
+    uint32_t toNs(Probe probe, uint32_t value) const;
+#endif
+};
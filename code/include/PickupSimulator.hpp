@@ -0,0 +1,165 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <array>
+#include <atomic>
+#include <driver/rmt.h>
+#include "QuickShifterEngine.hpp"
+
+/**
+ * @brief Pickup Simulator - Bench benchmark of the pickup and cut path (HIL builds)
+ *
+ * Generates the pickup signal with RMT channel 0 (1 µs ticks, one rising
+ * edge per revolution) from a built-in suite of scenarios: steady RPM,
+ * sweeps, acceleration/deceleration ramps, injected noise spikes (short
+ * pulses mid-interval that pass the PCNT glitch filter) and missing pulses.
+ * Shift scenarios also request shifts through QuickShifterEngine::requestShift().
+ *
+ * Each scenario's waveform is built up front (pulse times rounded without
+ * drift, spikes from a fixed-seed generator, so every run is identical) and
+ * transmitted in one piece. The output is PICKUP_SQUARE; with
+ * Loopback::INTERNAL the same RMT signal also drives the engine's pickup
+ * pad through the GPIO matrix, so no wiring is needed (disconnect the real
+ * pickup conditioner). Loopback::EXTERNAL expects PICKUP_SQUARE wired to the
+ * pickup input circuit.
+ *
+ * The engine's own events (event dispatcher sink) are compared with the
+ * generated profile: RPM error of every accepted pulse against the true RPM
+ * at the middle of its measured interval, rejected pulses against injected
+ * anomalies, and actual against requested cut length.
+ *
+ * Only compiled in with QS_HIL=1 (env lolin_s2_mini_hil). A run refuses to
+ * start while a real pickup signal is present or a multi-tooth trigger
+ * wheel is configured. Flash writes stall the RMT
+ * refill interrupt, so avoid saving config or log rotation during a run.
+ */
+#ifndef QS_HIL
+#define QS_HIL 0
+#endif
+
+class PickupSimulator {
+public:
+    static constexpr rmt_channel_t RMT_CHANNEL = RMT_CHANNEL_0;
+    static constexpr uint8_t RMT_CLOCK_DIVIDER = 80;    // 80 MHz APB / 80 = 1 µs ticks
+    static constexpr uint16_t MAX_HALF_TICKS = 32767;   // 15-bit RMT item duration
+    static constexpr size_t MAX_ITEMS = 2048;           // Waveform of one scenario
+    static constexpr uint16_t PULSE_WIDTH_US = 200;
+    static constexpr uint16_t SPIKE_WIDTH_US = 20;      // Above the 12.8 µs PCNT glitch filter
+    static constexpr uint16_t MIN_RPM = 1000;
+    static constexpr uint16_t MAX_RPM = 20000;
+    static constexpr uint32_t SETTLE_MS = 1500;         // Signal timeout between scenarios
+    static constexpr uint32_t DRAIN_MS = 100;           // Events still in the ring after the last pulse
+
+    enum class Loopback : uint8_t {
+        INTERNAL,       // RMT output routed onto the pickup pad
+        EXTERNAL        // PICKUP_SQUARE wired to the pickup input
+    };
+
+    enum class Phase : uint8_t {
+        IDLE,
+        SETTLE,         // Waiting for the engine to lose the previous signal
+        RUNNING,        // Waveform transmitting
+        DRAIN           // Waiting for the last events
+    };
+
+    struct Scenario {
+        const char* name;
+        uint16_t startRpm;
+        uint16_t endRpm;            // Linear ramp over durationMs
+        uint16_t durationMs;
+        uint16_t noisePerMille;     // Intervals with a spike
+        uint8_t missingEvery;       // Every Nth pulse left out, 0 = none
+        uint16_t shiftEveryMs;      // requestShift() period, 0 = none
+    };
+
+    struct Report {
+        bool complete;
+        uint32_t pulses;            // Generated pulses
+        uint32_t spikes;            // Injected spikes
+        uint32_t missing;           // Left out pulses
+        uint32_t accepted;          // PULSE_ACCEPTED events
+        uint32_t rejected;          // PULSE_REJECTED events
+        uint32_t rpmSamples;        // Accepted pulses compared with the profile
+        uint32_t rpmErrorSum;       // Sum of |measured - true| RPM
+        uint16_t rpmErrorMax;
+        uint32_t shifts;            // Shift requests sent
+        uint32_t cuts;              // Completed cuts measured
+        int32_t cutErrorMinUs;      // Actual - requested cut length
+        int32_t cutErrorMaxUs;
+        int32_t cutErrorSumUs;
+    };
+
+    static constexpr size_t SCENARIO_COUNT = 7;
+
+    explicit PickupSimulator(QuickShifterEngine& qsEngine);
+
+    /**
+     * @brief Install the RMT channel on the output pin (idle low)
+     */
+    bool begin(uint8_t outputPin);
+
+    /**
+     * @brief Run one scenario by name, or "all" for the whole suite
+     * @return false if running, unknown scenario, a real signal is present or a wheel is configured
+     */
+    bool start(const char* scenario, Loopback loopback);
+
+    /**
+     * @brief Abort the run (reports so far are kept)
+     */
+    void stop();
+
+    /**
+     * @brief Advance the run (network task, every cycle)
+     */
+    void update();
+
+    bool isRunning() const { return _phase.load(std::memory_order_acquire) != Phase::IDLE; }
+
+    /**
+     * @brief Status and reports ({"running":..,"scenarios":[..]})
+     */
+    void toJson(JsonObject out) const;
+
+    /**
+     * @brief EventDispatcher sink, compares engine events with the profile
+     */
+    static void onEngineEvent(const QuickShifterEngine::Event& event, void* context);
+
+    static const Scenario SCENARIOS[SCENARIO_COUNT];
+
+private:
+    QuickShifterEngine& _qsEngine;
+    uint8_t _outputPin;
+    bool _ready;
+
+    std::atomic<Phase> _phase;
+    Loopback _loopback;
+    size_t _current;                // Scenario being run
+    size_t _last;                   // Last scenario of this run
+    uint32_t _phaseStartMs;
+    uint32_t _nextShiftMs;
+    volatile uint32_t _txStartUs;   // micros() when the waveform started
+    uint32_t _pendingCutUs;         // Requested length of the running cut (events task)
+
+    std::array<Report, SCENARIO_COUNT> _reports;
+    rmt_item32_t _items[MAX_ITEMS];
+    size_t _itemCount;
+    uint8_t _pendingHalf;           // Half of _items[_itemCount] already used
+    uint32_t _noiseSeed;
+
+    /**
+     * @brief Build the waveform of a scenario into _items
+     * @return false if it does not fit (truncated)
+     */
+    bool buildWaveform(const Scenario& scenario, Report& report);
+    void addSegment(uint8_t level, uint32_t durationUs);
+    void addHalf(uint8_t level, uint16_t ticks);
+
+    void startScenario();
+    void finishScenario();
+    void connectLoopback(bool enable);
+    void printReport(const Scenario& scenario, const Report& report) const;
+
+    static uint16_t rpmAt(const Scenario& scenario, int32_t timeUs);
+};
@@ -1,6 +1,17 @@
 #pragma once
 #include <Arduino.h>
 #include <array>
+#include <atomic>
+#include <driver/timer.h>
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+#include "CutTimeMap.hpp"
+#include "EventRing.hpp"
+#include "RpmEstimator.hpp"
+#include "TriggerWheel.hpp"
+#include "CutOutput.hpp"
+#include "SensorValues.hpp"
+#include "PerfCounters.hpp"
 
 /**
  * @brief Core QuickShifter Engine - Handles real-time ignition cut logic
@@ -8,38 +19,251 @@
  * This component manages the critical path operations:
  * - RPM calculation from pickup coil pulses
  * - Shift sensor debouncing
- * - Ignition cut timing based on RPM map
+ * - Ignition cut timing based on RPM map, indexed by the RPM predicted for
+ *   the moment of the shift request (see RpmEstimator)
  * - Hardware timer management for precise cut duration
+ *
+ * The cut is timed by a one-shot alarm on hardware timer group 0 / timer 0,
+ * ticking at 1 µs. The alarm ISR releases the cut pin directly, so the cut
+ * length no longer depends on the FreeRTOS tick or timer-service task.
+ * Nothing else in the firmware may claim that timer.
+ *
+ * The cut output (CDI kill, TCI, SSR or relay) and its pin are fixed per
+ * build by CutOutput::Active (see CutOutput.hpp); the ISRs drive it through
+ * direct register writes.
+ *
+ * In CutMode::CLOSED_LOOP pickup intervals keep being measured during the
+ * cut. Once the RPM has dropped closedLoopDropPercent below its peak during
+ * the cut for CLOSED_LOOP_CONFIRM_INTERVALS accepted intervals in a row
+ * (next gear engaged), the cut ends early, but not before
+ * closedLoopMinPercent of the map time. The map time remains the maximum.
+ * In CutMode::OPEN_LOOP the pickup is ignored during the cut and the map
+ * time is always used in full.
+ *
+ * With a spark-skip pattern (skipSparks of every skipCycle sparks) the cut
+ * window is not held continuously: each pickup pulse sets the output for
+ * the next spark, so the suppressed sparks follow the ignition events
+ * instead of wall-clock time. In PCNT capture mode a per-edge GPIO
+ * interrupt is attached for this only while a pattern is configured.
+ * Needs an output without lead time (not the relay backend).
+ *
+ * Shift requests come from the digital switch ISR or, in
+ * ShiftSensorMode::FORCE, from ShiftForceSensor through requestShift() and
+ * a direct notification of the engine task. The boot button always works.
+ * With a valid TPS reading (SensorAcquisition) requests below minThrottle
+ * are ignored and the TPS feeds the map's throttle load axis.
+ *
+ * Pickup pulses can be measured either from a per-edge GPIO interrupt or in
+ * PCNT capture mode, where PCNT unit 0 counts edges behind its hardware
+ * glitch filter and interrupts once per batch. The batch interval is averaged
+ * over PICKUP_CAPTURE_BATCH pulses, dividing ISR latency error and ISR load
+ * by the batch size.
+ *
+ * Multi-tooth pickups (triggerTeeth positions, the last triggerMissing of
+ * them left out, e.g. 24-2) are decoded by TriggerWheel: every tooth is
+ * filtered as the revolution period at its speed and feeds the RPM
+ * estimator, so the shift request sees a prediction at most one tooth old.
+ * The RPM, PULSE_ACCEPTED events, closed-loop termination and the spark
+ * pattern run per decoded revolution. PCNT capture then interrupts on every
+ * edge (gap detection needs each tooth), and the wheel keeps being decoded
+ * during an open-loop cut so it does not lose sync.
+ *
+ * The configuration lives in two banks, each a validated Config with its
+ * compiled cut map and a generation number. setConfig() fills the bank the
+ * ISRs are not using and publishes it with one atomic pointer store, so a
+ * live map edit never needs a critical section and every ISR works on one
+ * consistent generation: each handler loads the pointer once on entry.
+ *
+ * The shift, pickup and cut timer ISRs feed PerfCounters (shift latency,
+ * cut end error, handler run times); with QS_PERF=0 the hooks are empty.
  */
 class QuickShifterEngine {
 public:
-    // Configuration structure (loaded from storage)
+    // Cut termination
+    enum class CutMode : uint8_t {
+        OPEN_LOOP,      // Cut lasts the map time
+        CLOSED_LOOP     // Map time is the maximum, ends early on RPM drop
+    };
+    
+    // Shift request source
+    enum class ShiftSensorMode : uint8_t {
+        SWITCH,         // Digital switch on the shift sensor pin (RISING edge ISR)
+        FORCE           // Strain gauge/piezo force threshold (ShiftForceSensor)
+    };
+    
+    // Configuration structure (loaded from storage, append new fields at the end)
     struct Config {
         uint16_t minRpmThreshold;           // Minimum RPM to enable quickshift (default: 3000)
         uint16_t debounceTimeMs;            // Shift sensor debounce time (default: 50ms)
-        std::array<uint16_t, 11> cutTimeMap; // Cut time in ms for RPM ranges 5k-15k (step 1k)
+        CutTimeMap::Table cutMap;           // Cut time in µs over RPM × load
+        CutMode cutMode;                    // Cut termination (default: open loop)
+        uint8_t closedLoopMinPercent;       // Earliest closed-loop end, % of map time (default: 40)
+        uint8_t closedLoopDropPercent;      // RPM drop from peak that ends the cut (default: 4)
+        uint8_t skipSparks;                 // Sparks suppressed per cycle (default: 1)
+        uint8_t skipCycle;                  // Spark-skip cycle length, 0 = continuous cut (default: 0)
+        ShiftSensorMode shiftSensorMode;    // Shift request source (default: switch)
+        uint16_t forceThreshold;            // Force mode: trigger level above baseline, ADC counts (default: 400)
+        uint16_t forceHysteresis;           // Force mode: re-arm below threshold minus this (default: 150)
+        uint16_t minThrottle;               // No cut below this throttle, 0.1 % (default: 5.0 %, needs a valid TPS)
+        uint8_t triggerTeeth;               // Pickup tooth positions per revolution incl. missing (default: 1)
+        uint8_t triggerMissing;             // Missing teeth marking the sync gap (default: 0)
     };
 
+    static constexpr uint32_t DEFAULT_CUT_TIME_US = 80000;  // 80ms
+    static constexpr uint32_t MIN_CUT_TIME_US = 100;        // Floor so the alarm is always in the future
+    static constexpr uint32_t MAX_CUT_TIME_US = 500000;     // 500ms safety ceiling
+    
+    static constexpr uint8_t DEFAULT_CLOSED_LOOP_MIN_PERCENT = 40;
+    static constexpr uint8_t DEFAULT_CLOSED_LOOP_DROP_PERCENT = 4;
+    static constexpr uint8_t MAX_CLOSED_LOOP_DROP_PERCENT = 50;
+    static constexpr uint8_t CLOSED_LOOP_CONFIRM_INTERVALS = 2;  // One noisy interval never ends a cut
+    static constexpr uint8_t MAX_SKIP_CYCLE = 16;
+    
+    static constexpr uint16_t DEFAULT_FORCE_THRESHOLD = 400;
+    static constexpr uint16_t DEFAULT_FORCE_HYSTERESIS = 150;
+    static constexpr uint16_t DEFAULT_MIN_THROTTLE = 50;     // 5.0 %
+
+    // Pickup measurement backend
+    enum class PickupMode {
+        GPIO_ISR,       // One interrupt per edge, timestamped with micros()
+        PCNT_CAPTURE    // Hardware edge counting, one interrupt per batch
+    };
+    
+    // Engine event types recorded from ISR context
+    enum class EventType : uint8_t {
+        PULSE_ACCEPTED,     // Pickup interval passed the predictive filter
+        PULSE_REJECTED,     // Pickup interval rejected as noise/missed pulse
+        SHIFT,              // Shift request accepted (rpm = predicted RPM used for the map)
+        SHIFT_DEBOUNCED,    // Shift request ignored by debounce window
+        CUT_START,          // Ignition cut output asserted
+        CUT_END,            // Ignition cut output released (cutTimeUs = actual cut length)
+        SHIFT_BLOCKED       // Shift request ignored at closed throttle (cutTimeUs = TPS, 0.1 %)
+    };
+    
+    // Compact binary event record (12 bytes)
+    struct Event {
+        uint32_t timestampUs;   // micros() at the event (SHIFT: at the shift request)
+        uint32_t cutTimeUs;     // Cut time for SHIFT/CUT_START, pickup interval for PULSE_*
+        uint16_t rpm;           // RPM at the event
+        EventType type;
+        uint8_t reserved;
+    };
+    
+    static constexpr size_t EVENT_RING_SIZE = 512;  // ~2s of pulses at 15k RPM plus shift events
+    
+    static constexpr uint8_t PICKUP_CAPTURE_BATCH = 4;        // Pulses per PCNT interrupt
+    static constexpr uint16_t PICKUP_GLITCH_FILTER_APB = 1023; // ~12.8µs at 80 MHz (hardware max)
+
     QuickShifterEngine();
     
     /**
      * @brief Initialize the engine with pin configuration and default config
      */
-    void begin(uint8_t pickupPin, uint8_t shiftSensorPin, uint8_t ignitionCutPin);
+    void begin(uint8_t pickupPin, uint8_t shiftSensorPin,
+               PickupMode pickupMode = PickupMode::GPIO_ISR);
     
     /**
-     * @brief Update configuration from storage
+     * @brief Pickup input as passed to begin()
+     */
+    uint8_t getPickupPin() const { return _pickupPin; }
+    PickupMode getPickupMode() const { return _pickupMode; }
+    
+    /**
+     * @brief Pickup intervals per PULSE_ACCEPTED event (the event's interval
+     * × this is the time it was measured over)
+     */
+    uint8_t getIntervalsPerEvent() const {
+        return _pickupMode == PickupMode::PCNT_CAPTURE && !_wheel.isMultiTooth() ? _captureBatch : 1;
+    }
+    
+    /**
+     * @brief Trigger wheel crank angle sync (a 1-tooth pickup needs none)
+     */
+    bool isTriggerSynced() const { return !_wheel.isMultiTooth() || _wheel.isSynced(); }
+    uint32_t getTriggerSyncLosses() const { return _wheel.getSyncLosses(); }
+    
+    /**
+     * @brief Validate and publish a new configuration generation
+     *
+     * Single writer (setup, then the web server task only). Takes effect
+     * with the next ISR, no reboot needed.
      */
     void setConfig(const Config& config);
     
     /**
-     * @brief Get current configuration
+     * @brief Get current configuration (consistent copy, any task)
      */
-    Config getConfig() const { return _config; }
+    Config getConfig() const;
+    
+    /**
+     * @brief Generation of the active configuration, incremented per setConfig()
+     */
+    uint32_t getConfigGeneration() const { return activeConfig().generation; }
+    
+    /**
+     * @brief Cut mode to/from config string ("open", "closed")
+     */
+    static const char* cutModeToString(CutMode mode);
+    static CutMode cutModeFromString(const char* str);
+    
+    /**
+     * @brief Shift sensor mode to/from config string ("switch", "force")
+     */
+    static const char* shiftSensorModeToString(ShiftSensorMode mode);
+    static ShiftSensorMode shiftSensorModeFromString(const char* str);
+    
+    /**
+     * @brief Force sensor settings, read by ShiftForceSensor every DMA frame
+     */
+    ShiftSensorMode getShiftSensorMode() const { return activeConfig().config.shiftSensorMode; }
+    uint16_t getForceThreshold() const { return activeConfig().config.forceThreshold; }
+    uint16_t getForceHysteresis() const { return activeConfig().config.forceHysteresis; }
+    
+    /**
+     * @brief Queue a shift request from task context (force sensor)
+     *
+     * The request is handled by the next update(); the caller wakes the
+     * engine task with a direct notification so that happens immediately.
+     */
+    void requestShift() { _shiftRequested = true; }
+    
+    /**
+     * @brief Feed the cut map load axis (throttle in 0.1 % without a TPS input)
+     */
+    void setLoadInput(uint16_t load) { _loadInput = load; }
+    
+    /**
+     * @brief Attach the analog sensor snapshot (throttle gate, TPS load axis)
+     */
+    void setSensorInput(const SensorSnapshot* sensors) { _sensors = sensors; }
+    
+    /**
+     * @brief Signal/cut state listener, called on every change of either
+     *
+     * Cut start/end call it from the cut path (ISR or interrupts disabled),
+     * signal changes from the engine task: IRAM only, no blocking.
+     */
+    typedef void (*StateListener)(bool signalActive, bool cutActive, void* context);
+    
+    /**
+     * @brief Attach the state listener (setup only), reports the current state once
+     */
+    void setStateListener(StateListener listener, void* context);
+    
+    /**
+     * @brief Latest analog sensor values (lock-free)
+     * @return false if no sensor input is attached
+     */
+    bool readSensors(SensorValues& values) const {
+        if (!_sensors) return false;
+        values = _sensors->read();
+        return true;
+    }
     
     /**
      * @brief Main loop update - must be called frequently
-     * Handles signal timeout detection and non-critical processing
+     * Handles queued shift requests, signal timeout detection and
+     * non-critical processing
      */
     void update();
     
@@ -48,6 +272,16 @@ public:
      */
     uint16_t getCurrentRpm() const;
     
+    /**
+     * @brief Get RPM extrapolated to now from the recent acceleration
+     */
+    uint16_t getPredictedRpm() const;
+    
+    /**
+     * @brief Get RPM rate of change in RPM/s over the estimator window
+     */
+    int32_t getRpmAcceleration() const { return _rpmEstimator.getAcceleration(); }
+    
     /**
      * @brief Check if signal is active
      */
@@ -57,62 +291,130 @@ public:
      * @brief Get ignition cut state
      */
     bool isCutActive() const { return _cutActive; }
+    
+    /**
+     * @brief Pop oldest engine event (single consumer task only)
+     * @return false if no event is pending
+     */
+    bool popEvent(Event& event) { return _events.pop(event); }
+    
+    /**
+     * @brief Events lost because the consumer fell behind
+     */
+    uint32_t getDroppedEvents() const { return _events.dropped(); }
+    
+    /**
+     * @brief Shift path latency/jitter histograms
+     */
+    const PerfCounters& getPerf() const { return _perf; }
+    void resetPerf() { _perf.reset(); }
 
     /**
      * @brief ISR trampolines - must be public for interrupt attachment
      */
     static void IRAM_ATTR pickupCoilISR();
+    static void IRAM_ATTR pickupCaptureISR(void* arg);
     static void IRAM_ATTR shiftSensorISR();
     static void IRAM_ATTR buttonISR();
+    static void IRAM_ATTR sparkSyncISR();
     
 private:
     // Singleton instance pointer for ISR trampolines
     static QuickShifterEngine* _instance;
     
-    // Configuration
-    Config _config;
+    // One validated configuration generation with its compiled cut map
+    struct ConfigBank {
+        Config config;
+        CutTimeMap cutMap;                  // Compiled from config.cutMap, read from the shift sensor ISR
+        std::atomic<uint32_t> generation;   // 0 while the bank is being written
+    };
+    
+    // Active bank for the ISRs, the other one is written by setConfig()
+    std::array<ConfigBank, 2> _configBanks;
+    std::atomic<ConfigBank*> _activeConfig;
+    
+    inline __attribute__((always_inline)) const ConfigBank& activeConfig() const {
+        return *_activeConfig.load(std::memory_order_acquire);
+    }
+    
+    volatile uint16_t _loadInput;
+    const SensorSnapshot* _sensors;     // Analog sensors, nullptr if not attached
     
     // Pin assignments
     uint8_t _pickupPin;
     uint8_t _shiftSensorPin;
-    uint8_t _ignitionCutPin;
+    PickupMode _pickupMode;
     
     // Timing variables (accessed from ISR - must be volatile)
     volatile unsigned long _lastPulseTime;
     volatile unsigned long _pulseInterval;
     volatile unsigned long _lastValidInterval;
     volatile bool _isIntervalValid;
+    volatile uint16_t _rejectedEdges;   // Capture mode: edges since last valid timestamp
+    volatile uint8_t _captureBatch;     // Capture mode: edges per PCNT interrupt
     volatile unsigned long _lastShiftSensorTime;
+    volatile bool _shiftRequested;      // Set by requestShift(), handled in update()
     volatile uint16_t _currentRpm;
     volatile bool _cutActive;
     
-    // Debug data (accessed from ISR - must be volatile)
-    struct DebugData {
-        volatile bool hasEvent;
-        volatile bool debounced;
-        volatile bool rpmTooLow;
-        volatile uint16_t rpm;
-        volatile uint16_t cutTime;
-    };
-    DebugData _debugData;
+    // Acceleration tracking and prediction over accepted intervals
+    RpmEstimator _rpmEstimator;
+    
+    // Multi-tooth decoding, written from the pickup ISR only
+    TriggerWheel _wheel;
+    
+    // Current cut (cut timer ticks, 1 µs), written from ISRs only
+    uint64_t _cutStartTicks;        // Effective start (after the output lead time)
+    uint32_t _cutMinTimeUs;         // Closed loop: earliest end
+    uint16_t _cutPeakRpm;           // Closed loop: highest RPM seen during the cut
+    uint8_t _cutDropCount;          // Closed loop: consecutive intervals below the drop threshold
+    
+    // Spark-skip pattern position, written from ISRs only
+    uint8_t _sparkIndex;            // Spark within the skip cycle (0 = first after cut start)
+    unsigned long _lastSparkEdgeTime;
+    bool _sparkSyncAttached;        // PCNT mode: per-edge ISR attached for the pattern
+    
+    // Event ring (ISRs produce, event task consumes)
+    EventRing<Event, EVENT_RING_SIZE> _events;
+    
+    // Latency histograms, written from ISRs only
+    PerfCounters _perf;
     
     // Signal timeout tracking
     bool _signalActive;
+    StateListener _stateListener;
+    void* _stateListenerContext;
     unsigned long _lastUpdateTime;
     static constexpr unsigned long SIGNAL_TIMEOUT_MS = 1000;
     
-    // Hardware timer for ignition cut
-    TimerHandle_t _cutTimer;
+    // Hardware timer for ignition cut (free-running, 1 µs resolution)
+    static constexpr timer_group_t CUT_TIMER_GROUP = TIMER_GROUP_0;
+    static constexpr timer_idx_t CUT_TIMER_IDX = TIMER_0;
+    static constexpr uint32_t CUT_TIMER_DIVIDER = 80;  // 80 MHz APB / 80 = 1 MHz
+    
+    /**
+     * @brief Configure the cut timer and register its alarm ISR
+     */
+    void setupCutTimer();
+    
+    /**
+     * @brief Alarm ISR to end ignition cut
+     * @return true if a higher priority task was woken
+     */
+    static bool IRAM_ATTR cutTimerCallback(void* arg);
     
     /**
-     * @brief Timer callback to end ignition cut
+     * @brief Calculate cut time (µs) based on RPM and map load
      */
-    static void cutTimerCallback(TimerHandle_t xTimer);
+    uint32_t IRAM_ATTR calculateCutTime(const ConfigBank& bank, uint16_t rpm, uint16_t load) const;
+    
+    // PCNT unit used in capture mode
+    static constexpr pcnt_unit_t PICKUP_PCNT_UNIT = PCNT_UNIT_0;
     
     /**
-     * @brief Calculate cut time based on current RPM
+     * @brief Configure PCNT unit for batched pickup edge capture
      */
-    uint16_t calculateCutTime(uint16_t rpm) const;
+    void setupPickupCapture();
     
     /**
      * @brief Handle pickup coil pulse (called from ISR)
@@ -120,12 +422,78 @@ private:
     void IRAM_ATTR handlePickupPulse();
     
     /**
-     * @brief Handle shift sensor trigger (called from ISR)
+     * @brief Run predictive filter on a timestamp covering edgeCount pulses
+     * since the previous one (called from ISR)
+     */
+    void IRAM_ATTR processPickupEdges(unsigned long timestamp, uint8_t edgeCount);
+    
+    /**
+     * @brief Handle shift sensor trigger (called from ISR, or from update()
+     * with interrupts disabled)
      */
     void IRAM_ATTR handleShiftSensor(bool fromButton = false);
     
+    /**
+     * @brief micros() for ISRs that run with the flash cache disabled
+     * micros() is not IRAM resident in the stock core; esp_timer_get_time()
+     * is, and it is the clock micros() reads.
+     */
+    static inline __attribute__((always_inline)) uint32_t isrMicros() {
+        return static_cast<uint32_t>(esp_timer_get_time());
+    }
+    
+    /**
+     * @brief Record an engine event (called from ISR, including the IRAM
+     * cut timer and PCNT ISRs, hence isrMicros())
+     */
+    inline __attribute__((always_inline)) void recordEvent(EventType type, uint16_t rpm, uint32_t value) {
+        recordEvent(type, rpm, value, isrMicros());
+    }
+    inline __attribute__((always_inline)) void recordEvent(EventType type, uint16_t rpm, uint32_t value,
+                                                           uint32_t timestampUs) {
+        Event event;
+        event.timestampUs = timestampUs;
+        event.cutTimeUs = value;
+        event.rpm = rpm;
+        event.type = type;
+        event.reserved = 0;
+        _events.push(event);
+    }
+    
     /**
      * @brief Trigger ignition cut
      */
-    void IRAM_ATTR triggerIgnitionCut(uint16_t cutTimeMs);
+    void IRAM_ATTR triggerIgnitionCut(const Config& config, uint32_t cutTimeUs);
+    
+    /**
+     * @brief Release the cut output (alarm ISR or closed-loop termination)
+     */
+    void IRAM_ATTR endIgnitionCut(uint64_t nowTicks);
+    
+    /**
+     * @brief Report signal/cut state to the listener
+     */
+    inline __attribute__((always_inline)) void notifyState() {
+        if (_stateListener) _stateListener(_signalActive, _cutActive, _stateListenerContext);
+    }
+    
+    /**
+     * @brief Spark skip: set the cut output for the next spark (called from ISR)
+     */
+    void IRAM_ATTR handleSparkPulse(unsigned long timestamp);
+    
+    /**
+     * @brief Attach/detach the per-edge spark ISR in PCNT mode for the current pattern
+     */
+    void updateSparkSync();
+    
+    /**
+     * @brief PCNT edges per interrupt for the configured wheel (task context)
+     */
+    void updateCaptureBatch();
+    
+    /**
+     * @brief Closed loop: end the cut once the RPM drop is confirmed (called from ISR)
+     */
+    void IRAM_ATTR checkCutTermination(const Config& config);
 };
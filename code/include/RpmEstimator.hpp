@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief RPM Estimator - Instantaneous RPM, acceleration and short-term prediction
+ *
+ * Fed with every accepted pickup interval from the pickup ISR. The RPM of an
+ * interval is its mean, so each point is placed at the middle of the time
+ * it was measured over. Acceleration (RPM/s) is the slope from the oldest to the newest
+ * of the last WINDOW points, which averages per-interval jitter over the
+ * window instead of differentiating two neighbouring intervals.
+ * With a multi-tooth trigger wheel every tooth is a point (addTooth()), so
+ * the window spans WINDOW teeth instead of WINDOW revolutions.
+ *
+ * predict() extrapolates linearly from the newest point, so a shift request
+ * half a revolution after the last pulse still sees the RPM the engine has
+ * now rather than the one it had during the last interval. Extrapolation is
+ * capped at MAX_PREDICTION_US, beyond that the slope is no longer trusted.
+ *
+ * Integer math only and all ISR entry points in IRAM. Writers (pickup ISR)
+ * and ISR readers share one interrupt level and never nest; task readers
+ * read single 32-bit values.
+ */
+class RpmEstimator {
+public:
+    static constexpr size_t WINDOW = 8;                     // Points in the slope (power of 2)
+    static constexpr uint32_t MAX_PREDICTION_US = 100000;   // Longest extrapolation
+    static constexpr int32_t MAX_ACCELERATION = 200000;     // RPM/s clamp
+    static constexpr uint16_t MAX_RPM = 20000;
+
+    RpmEstimator();
+
+    /**
+     * @brief Forget history (signal lost or re-established)
+     */
+    void IRAM_ATTR reset();
+
+    /**
+     * @brief Add an accepted interval ending at timestampUs (called from ISR)
+     * @param intervalUs Time per pulse, averaged over pulses (PCNT batches)
+     */
+    void IRAM_ATTR addInterval(uint32_t timestampUs, uint32_t intervalUs, uint16_t pulses = 1);
+
+    /**
+     * @brief Add an accepted trigger wheel tooth ending at timestampUs (called from ISR)
+     * @param spanUs Time since the previous accepted tooth
+     * @param revolutionUs Revolution period at that speed
+     */
+    void IRAM_ATTR addTooth(uint32_t timestampUs, uint32_t spanUs, uint32_t revolutionUs);
+
+    /**
+     * @brief RPM of the last accepted interval
+     */
+    uint16_t getRpm() const { return _rpm; }
+
+    /**
+     * @brief RPM/s over the window (0 until two points are known)
+     */
+    int32_t getAcceleration() const { return _acceleration; }
+
+    /**
+     * @brief RPM extrapolated to timestampUs (micros() clock)
+     */
+    uint16_t IRAM_ATTR predict(uint32_t timestampUs) const;
+
+private:
+    static_assert((WINDOW & (WINDOW - 1)) == 0, "WINDOW must be a power of 2");
+
+    struct Point {
+        uint32_t timestampUs;   // Middle of the interval
+        uint16_t rpm;
+    };
+
+    void IRAM_ATTR addPoint(uint32_t pointUs, uint32_t intervalUs);
+
+    Point _points[WINDOW];
+    uint8_t _head;              // Next slot to write
+    uint8_t _count;
+
+    volatile uint16_t _rpm;
+    volatile int32_t _acceleration;
+    volatile uint32_t _lastPointUs;
+};
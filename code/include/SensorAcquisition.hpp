@@ -0,0 +1,133 @@
+#pragma once
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+#include "SensorValues.hpp"
+#include "ShiftForceSensor.hpp"
+
+/**
+ * @brief Sensor Acquisition - Throttle position and MAP on a fixed schedule
+ *
+ * update() runs every PERIOD_MS from its own task. Each input is
+ * oversampled (OVERSAMPLE conversions averaged), converted to mV with the
+ * chip's eFuse ADC calibration and then to engineering units with the
+ * two-point calibration from the config (Calibration):
+ * - TPS: closed/open throttle voltage -> 0-100.0 %
+ * - MAP: two voltage/pressure points -> 0.1 kPa
+ *
+ * A reading is valid only if the input is enabled and its voltage lies
+ * within the calibrated range plus FAULT_MARGIN_MV (an open or shorted
+ * sensor reads invalid instead of a wrong value).
+ *
+ * Results are published through a SensorSnapshot (seqlock), which the
+ * engine ISRs, the telemetry sampler and the session logger read without
+ * locks via snapshot().
+ *
+ * The TPS is on ADC1. While ShiftForceSensor streams ADC1 by DMA the TPS is
+ * part of that conversion pattern and its DMA samples are averaged instead
+ * of one-shot reads. The MAP input is on ADC2, which WiFi may hold; a read
+ * that loses the arbitration is skipped and the previous value kept for up
+ * to STALE_PERIODS periods.
+ */
+class SensorAcquisition {
+public:
+    // Two-point calibration (stored as its own config section, append new fields at the end)
+    struct Calibration {
+        bool tpsEnabled;            // TPS connected (default: false)
+        bool mapEnabled;            // MAP sensor connected (default: false)
+        uint16_t tpsClosedMv;       // TPS voltage at closed throttle (default: 400)
+        uint16_t tpsOpenMv;         // TPS voltage at wide open throttle (default: 2400)
+        uint16_t mapLowMv;          // MAP voltage at mapLowKpa (default: 200)
+        uint16_t mapHighMv;         // MAP voltage at mapHighKpa (default: 2400)
+        uint16_t mapLowKpa;         // Pressure at mapLowMv, 0.1 kPa (default: 100)
+        uint16_t mapHighKpa;        // Pressure at mapHighMv, 0.1 kPa (default: 1050)
+    };
+
+    static constexpr uint32_t PERIOD_MS = 10;           // 100 Hz acquisition
+    static constexpr uint8_t OVERSAMPLE = 8;            // One-shot reads averaged per value
+    static constexpr uint16_t FAULT_MARGIN_MV = 150;    // Beyond the calibrated range = sensor fault
+    static constexpr uint8_t STALE_PERIODS = 10;        // MAP reads lost to WiFi before invalid
+    static constexpr uint16_t TPS_FULL_SCALE = 1000;    // 100.0 %
+
+    explicit SensorAcquisition(ShiftForceSensor& forceSensor);
+
+    /**
+     * @brief Fill calibration with defaults (both inputs disabled)
+     */
+    static void getDefaultCalibration(Calibration& calibration);
+
+    /**
+     * @brief Configure the ADC inputs (before forceSensor.begin(), which
+     * needs the TPS in its DMA pattern)
+     * @return false if a pin has no ADC channel
+     */
+    bool begin(uint8_t tpsPin, uint8_t mapPin);
+
+    /**
+     * @brief Apply calibration (clamped, takes effect next period)
+     */
+    void setCalibration(const Calibration& calibration);
+    Calibration getCalibration() const { return _calibration; }
+
+    /**
+     * @brief Acquire and publish one set of values (acquisition task)
+     */
+    void update();
+
+    /**
+     * @brief TaskManager entry, context is the SensorAcquisition
+     */
+    static void acquireTask(void* context);
+
+    /**
+     * @brief Lock-free published values (any task or ISR)
+     */
+    const SensorSnapshot& snapshot() const { return _snapshot; }
+
+    /**
+     * @brief Latest input voltages before calibration, for setting it up
+     */
+    uint16_t getTpsMv() const { return _tpsMv; }
+    uint16_t getMapMv() const { return _mapMv; }
+
+private:
+    struct Input {
+        int8_t unit;                // 1 = ADC1, 2 = ADC2, 0 = none
+        uint8_t channel;
+        esp_adc_cal_characteristics_t characteristics;
+    };
+
+    ShiftForceSensor& _forceSensor;
+    Calibration _calibration;
+    SensorSnapshot _snapshot;
+
+    Input _tps;
+    Input _map;
+    bool _tpsFromDma;
+
+    volatile uint16_t _tpsMv;
+    volatile uint16_t _mapMv;
+    uint8_t _mapStale;
+    SensorValues _values;
+
+    /**
+     * @brief Map a GPIO to its ADC unit/channel and calibrate it
+     */
+    static bool setupInput(uint8_t pin, Input& input);
+
+    /**
+     * @brief Oversampled one-shot read in mV
+     * @return false if no conversion succeeded (ADC2 busy)
+     */
+    static bool readMv(Input& input, uint16_t& mv);
+
+    /**
+     * @brief Linear two-point conversion, clamped to the output range
+     */
+    static int32_t scale(int32_t mv, int32_t mv0, int32_t mv1, int32_t out0, int32_t out1);
+
+    /**
+     * @brief Voltage lies within the calibrated range plus the fault margin
+     */
+    static bool inRange(uint16_t mv, uint16_t lowMv, uint16_t highMv);
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+#include "Seqlock.hpp"
+
+/**
+ * @brief Latest calibrated analog sensor readings (published by SensorAcquisition)
+ */
+struct SensorValues {
+    enum Flags : uint8_t {
+        TPS_VALID = 0x01,       // Sensor enabled and reading within its calibrated range
+        MAP_VALID = 0x02
+    };
+
+    uint32_t timestampUs;       // micros() of the acquisition
+    uint16_t tps;               // Throttle position, 0.1 % units
+    uint16_t map;               // Manifold pressure, 0.1 kPa units
+    uint8_t flags;
+};
+
+using SensorSnapshot = Seqlock<SensorValues>;
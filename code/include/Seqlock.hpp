@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-writer snapshot (seqlock with two copies)
+ *
+ * The writer bumps the sequence before updating each of two copies, so at
+ * any moment one copy is stable and the sequence says which. Readers copy
+ * the stable one and retry only if the writer moved on meanwhile; they
+ * never block the writer and the writer never blocks them.
+ *
+ * Unlike a plain seqlock a reader never has to wait for the writer to
+ * finish, which matters on the single-core ESP32-S2: an ISR that
+ * interrupts the writer mid-update still reads a consistent copy on the
+ * first try. A task preempted by the writer retries once.
+ *
+ * T must be trivially copyable. write() has a single caller (one task).
+ */
+template <typename T>
+class Seqlock {
+public:
+    Seqlock() : _sequence(0), _copies{} {}
+
+    /**
+     * @brief Publish a new value (single writer)
+     */
+    void write(const T& value) {
+        const uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+
+        // Odd: readers use copy 1 while copy 0 is written
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _copies[0] = value;
+
+        // Even: readers use copy 0 while copy 1 is written
+        std::atomic_thread_fence(std::memory_order_release);
+        _sequence.store(sequence + 2, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _copies[1] = value;
+    }
+
+    /**
+     * @brief Latest consistent value (any task or ISR)
+     */
+    inline __attribute__((always_inline)) T read() const {
+        T value;
+        uint32_t sequence;
+        do {
+            sequence = _sequence.load(std::memory_order_acquire);
+            value = _copies[sequence & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (_sequence.load(std::memory_order_relaxed) != sequence);
+        return value;
+    }
+
+    /**
+     * @brief Number of write() calls so far
+     */
+    uint32_t version() const { return _sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint32_t> _sequence;
+    T _copies[2];
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief Session log file format (written by SessionLogger)
+ *
+ * A file is a sequence of BLOCK_SIZE blocks (the last one may be short),
+ * each holding chunks that never straddle a block boundary:
+ *   ChunkHeader { type, count, size } + size bytes of payload
+ * - HEADER : FileHeader (first chunk of every file)
+ * - SAMPLES: count x TelemetryFrame::Sample
+ * - EVENTS : count x QuickShifterEngine::Event
+ * - PAD    : rest of the block is unused, skip to the next block
+ *
+ * Kept free of LittleFS and the logger so host tools (native replay) can
+ * read logs with the same definitions.
+ */
+namespace SessionLogFormat {
+
+constexpr size_t BLOCK_SIZE = 4096;                 // LittleFS block size
+constexpr uint32_t FILE_MAGIC = 0x474C5351;         // "QSLG"
+constexpr uint8_t FILE_VERSION = 2;                 // v2: 14-byte samples with rpmAccel
+
+enum class ChunkType : uint8_t {
+    PAD = 0,
+    HEADER = 1,
+    SAMPLES = 2,
+    EVENTS = 3
+};
+
+struct __attribute__((packed)) ChunkHeader {
+    uint8_t type;       // ChunkType
+    uint8_t count;      // Records in payload
+    uint16_t size;      // Payload bytes
+};
+
+struct __attribute__((packed)) FileHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t sampleRateHz;
+    uint32_t fileId;        // Matches file name
+    uint32_t sessionId;     // fileId of the first file of this session
+    uint32_t startMs;       // millis() when the file was opened
+};
+
+}  // namespace SessionLogFormat
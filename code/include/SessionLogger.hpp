@@ -0,0 +1,129 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include "QuickShifterEngine.hpp"
+#include "TelemetrySampler.hpp"
+#include "EventRing.hpp"
+#include "SessionLogFormat.hpp"
+
+/**
+ * @brief Session Logger - Binary telemetry/event log files on LittleFS
+ *
+ * A session starts when the pickup signal appears and ends after
+ * SESSION_IDLE_TIMEOUT_MS without signal. While active, the logger task
+ * copies new samples from the TelemetrySampler history (the sampler never
+ * waits on flash) plus shift/cut events into a pre-allocated 4 KB block,
+ * and writes the block to the log file only when it is full.
+ *
+ * File layout: BLOCK_SIZE blocks of chunks (HEADER, SAMPLES, EVENTS, PAD),
+ * see SessionLogFormat.hpp.
+ *
+ * Files rotate at MAX_FILE_SIZE, and the oldest files are deleted to keep
+ * at most MAX_LOG_FILES on flash.
+ */
+class SessionLogger {
+public:
+    static constexpr size_t BLOCK_SIZE = SessionLogFormat::BLOCK_SIZE;
+    static constexpr size_t MAX_FILE_SIZE = 128 * 1024;
+    static constexpr size_t MAX_LOG_FILES = 4;
+    static constexpr uint32_t SESSION_IDLE_TIMEOUT_MS = 10000;
+    static constexpr const char* LOG_DIR = "/logs";
+
+    // File format, see SessionLogFormat.hpp
+    static constexpr uint32_t FILE_MAGIC = SessionLogFormat::FILE_MAGIC;
+    static constexpr uint8_t FILE_VERSION = SessionLogFormat::FILE_VERSION;
+    using ChunkType = SessionLogFormat::ChunkType;
+    using ChunkHeader = SessionLogFormat::ChunkHeader;
+    using FileHeader = SessionLogFormat::FileHeader;
+
+    SessionLogger(QuickShifterEngine& qsEngine, TelemetrySampler& sampler);
+
+    /**
+     * @brief Create log directory and find next file ID
+     * @return true if successful
+     */
+    bool begin();
+
+    /**
+     * @brief Session tracking and block writes (logger task)
+     */
+    void update();
+
+    /**
+     * @brief TaskManager entry point
+     * @param context SessionLogger instance
+     */
+    static void logTask(void* context);
+
+    /**
+     * @brief EventDispatcher sink - queues shift/cut events for the log
+     * @param context SessionLogger instance
+     */
+    static void onEngineEvent(const QuickShifterEngine::Event& event, void* context);
+
+    bool isSessionActive() const { return _sessionActive; }
+
+    /**
+     * @brief Samples the sampler overwrote before the logger read them
+     */
+    uint32_t getLostSamples() const { return _lostSamples; }
+
+    /**
+     * @brief Append log files (name, size, active) to a JSON array
+     */
+    void listFiles(JsonArray files) const;
+
+    /**
+     * @brief Build full path for a log file name, rejecting anything else
+     * @return false if name is not a log file name
+     */
+    static bool getLogPath(const char* name, char* path, size_t pathSize);
+
+    /**
+     * @brief Delete a log file (not the one being written)
+     */
+    bool removeFile(const char* name);
+
+private:
+    QuickShifterEngine& _qsEngine;
+    TelemetrySampler& _sampler;
+
+    // Write block, filled by the logger task only
+    alignas(4) uint8_t _block[BLOCK_SIZE];
+    size_t _blockUsed;
+
+    File _file;
+    size_t _fileSize;
+    uint32_t _nextFileId;
+    uint32_t _currentFileId;
+    uint32_t _sessionId;
+
+    bool _initialized;
+    volatile bool _sessionActive;
+    unsigned long _lastSignalMs;
+    uint32_t _sampleIndex;      // Next sampler index to log
+    uint32_t _lostSamples;
+
+    // Events from the dispatcher task, consumed by the logger task
+    EventRing<QuickShifterEngine::Event, 64> _events;
+
+    void startSession();
+    void endSession();
+    bool openNextFile();
+    void closeFile();
+    void pruneOldFiles();
+
+    /**
+     * @brief Reserve room for a chunk in the current block, writing the block if needed
+     * @return Payload pointer, nullptr if the file could not be written
+     */
+    uint8_t* beginChunk(ChunkType type, uint8_t count, size_t payloadSize);
+    void appendSamples();
+    void appendEvents();
+
+    /**
+     * @brief Write the current block (padded when full is true) and rotate if needed
+     */
+    bool writeBlock(bool pad);
+};
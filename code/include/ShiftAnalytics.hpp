@@ -0,0 +1,153 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <array>
+#include "QuickShifterEngine.hpp"
+#include "RpmEstimator.hpp"
+#include "TelemetrySampler.hpp"
+
+/**
+ * @brief Shift Analytics - One compact summary record per shift
+ *
+ * Fed from the engine event stream (EventDispatcher sink, events task):
+ * SHIFT opens a record, CUT_START gives the request-to-cut latency and the
+ * map cut time, CUT_END the actual cut length, and PULSE_ACCEPTED events
+ * the RPM before the shift, its slope and the lowest RPM from cut start
+ * until SETTLE_US after the cut. Debounced requests during that time are counted
+ * into the record. The throttle position at the request comes from the
+ * TelemetrySampler history.
+ *
+ * Records go into a fixed table of CAPACITY entries addressed by shift
+ * sequence number (like sampler indices), the oldest being overwritten. A
+ * record is visible from CUT_END on and gets FLAG_COMPLETE once its settle
+ * window is over. Readers in other tasks copy records under a short
+ * critical section.
+ */
+class ShiftAnalytics {
+public:
+    static constexpr size_t CAPACITY = 128;             // Power of two
+    static constexpr uint32_t SETTLE_US = 150000;       // RPM tracked this long after the cut
+    static constexpr size_t MAX_QUERY = 16;             // Records per /api/analytics/shifts reply
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    // Record flag bits
+    static constexpr uint8_t FLAG_COMPLETE = 0x01;      // Settle window over, record final
+    static constexpr uint8_t FLAG_CLOSED_LOOP = 0x02;   // Closed-loop cut mode
+    static constexpr uint8_t FLAG_ENDED_EARLY = 0x04;   // Closed loop ended the cut before the map time
+    static constexpr uint8_t FLAG_TPS_VALID = 0x08;
+    static constexpr uint8_t FLAG_RETRIGGERED = 0x10;   // Cut extended by the next shift, no cut length
+
+    struct Record {
+        uint32_t sequence;          // Shift number since boot
+        uint32_t timeMs;            // millis() at the request
+        uint16_t entryRpm;          // Last measured RPM before the request
+        uint16_t predictedRpm;      // RPM the map was looked up at
+        uint16_t minRpm;            // Lowest measured RPM from cut start to the end of settling
+        uint16_t expectedDropRpm;   // Closed loop: drop that ends the cut, open loop: entry slope × map cut time
+        uint32_t mapCutUs;          // Cut time from the map
+        uint32_t cutUs;             // Actual cut length
+        uint16_t latencyUs;         // Shift request to cut asserted (saturated)
+        uint16_t tps;               // Throttle at the request, 0.1 % (FLAG_TPS_VALID)
+        uint8_t debounced;          // Requests rejected by debounce during the shift
+        uint8_t flags;
+    };
+
+    static_assert(sizeof(Record) == 32, "ShiftAnalytics::Record layout changed");
+
+    struct Totals {
+        uint32_t shifts;
+        uint32_t cuts;              // Shifts that reached CUT_START, the latency average is over these
+        uint32_t debounced;         // All debounce rejections since boot
+        uint32_t blocked;           // Requests ignored at closed throttle
+        uint32_t latencySumUs;
+        uint16_t latencyMaxUs;
+    };
+
+    ShiftAnalytics(QuickShifterEngine& qsEngine, TelemetrySampler& sampler);
+
+    /**
+     * @brief EventDispatcher sink
+     * @param context ShiftAnalytics instance
+     */
+    static void onEngineEvent(const QuickShifterEngine::Event& event, void* context);
+
+    /**
+     * @brief Sequence number the next shift will get
+     */
+    uint32_t getNext() const;
+
+    /**
+     * @brief Oldest sequence number still held
+     */
+    uint32_t getOldest() const;
+
+    /**
+     * @brief Copy records starting at sequence number from
+     *
+     * Sequence numbers older than the table are skipped forward.
+     * @param from In: first record wanted, out: next one to read
+     * @return Number of records copied
+     */
+    size_t read(uint32_t& from, Record* out, size_t maxRecords) const;
+
+    Totals getTotals() const;
+
+    /**
+     * @brief Records from..from+count as {"oldest","next","fields":[..],"shifts":[[..],..],"totals":{..}}
+     * count is limited to MAX_QUERY.
+     */
+    void toJson(uint32_t from, size_t count, JsonObject out) const;
+
+private:
+    enum class Phase : uint8_t {
+        IDLE,
+        SHIFTED,        // Waiting for CUT_START
+        CUTTING,        // Waiting for CUT_END
+        SETTLING        // Tracking the RPM after the cut
+    };
+
+    QuickShifterEngine& _qsEngine;
+    TelemetrySampler& _sampler;
+
+    std::array<Record, CAPACITY> _records;
+    volatile uint32_t _next;
+    mutable portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // Events task only
+    Record _open;
+    Phase _phase;
+    
+    // Accepted pulses before the request, for the entry RPM slope
+    struct Pulse {
+        uint32_t timestampUs;
+        uint16_t rpm;
+    };
+    std::array<Pulse, RpmEstimator::WINDOW> _pulses;
+    uint8_t _pulseHead;
+    uint8_t _pulseCount;
+
+    bool _published;
+    uint32_t _shiftUs;
+    uint32_t _cutEndUs;
+    uint16_t _lastRpm;
+    Totals _totals;
+
+    void handleEvent(const QuickShifterEngine::Event& event);
+    void beginShift(const QuickShifterEngine::Event& event);
+    
+    /**
+     * @brief RPM/s over the buffered pulses, the way RpmEstimator slopes them
+     */
+    int32_t entryAcceleration() const;
+
+    /**
+     * @brief Store the open record in its table slot
+     */
+    void publish();
+
+    /**
+     * @brief Publish the open record as final and go idle
+     */
+    void finish();
+};
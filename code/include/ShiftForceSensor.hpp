@@ -0,0 +1,136 @@
+#pragma once
+#include <Arduino.h>
+#include <driver/adc.h>
+#include "QuickShifterEngine.hpp"
+
+/**
+ * @brief Shift Force Sensor - Strain gauge/piezo shift detection on the ADC DMA
+ *
+ * ADC1 samples the sensor pin continuously at SAMPLE_RATE_HZ through the
+ * digital controller and DMA, so the CPU only sees one DMA frame
+ * (SAMPLES_PER_FRAME conversions, 1 ms) at a time no matter the sample rate.
+ * update() drains the frames from the sensor task and runs each sample
+ * through a fixed-point filter:
+ * - A fast IIR low-pass (FILTER_SHIFT) removes ADC and ignition noise
+ * - A slow IIR baseline (BASELINE_SHIFT) follows temperature/preload drift,
+ *   frozen while the lever is pressed
+ * - force = low-pass - baseline, in ADC counts
+ *
+ * force rising to the configured threshold triggers one shift request;
+ * the detector re-arms once force falls below threshold - hysteresis. The
+ * request is handed to the engine with requestShift() and a direct
+ * notification of the engine task, which handles it immediately instead of
+ * at its next period. Detection only runs in ShiftSensorMode::FORCE.
+ *
+ * Only pins on ADC1 can be used (ADC2 is shared with WiFi).
+ *
+ * While the DMA stream runs ADC1 cannot take one-shot reads, so one more
+ * ADC1 input (the TPS) can ride along in the conversion pattern
+ * (setAuxPin(), before begin()). Its samples are only summed up for
+ * takeAuxAverage(); the sensor channel keeps SAMPLE_RATE_HZ.
+ */
+class ShiftForceSensor {
+public:
+    static constexpr uint32_t SAMPLE_RATE_HZ = 20000;
+    static constexpr size_t SAMPLES_PER_FRAME = 20;         // One DMA frame per ms
+    static constexpr size_t DMA_BUFFER_FRAMES = 8;          // Driver pool, covers 8 ms of task latency
+    static constexpr size_t MAX_CHANNELS = 2;               // Sensor plus aux
+
+    static constexpr uint8_t FRACTION_BITS = 16;            // Filter state fixed point (Q16)
+    static constexpr uint8_t FILTER_SHIFT = 2;              // Low-pass over ~4 samples (0.2 ms)
+    static constexpr uint8_t BASELINE_SHIFT = 12;           // Baseline over ~4096 samples (0.2 s)
+    static constexpr uint32_t MAX_PRESS_SAMPLES = SAMPLE_RATE_HZ;  // Resume baseline tracking after 1 s pressed
+
+    explicit ShiftForceSensor(QuickShifterEngine& qsEngine);
+
+    /**
+     * @brief Configure and start continuous ADC DMA sampling on a pin
+     * @return false if the pin is not on ADC1 or the driver failed
+     */
+    bool begin(uint8_t pin);
+
+    /**
+     * @brief Add an ADC1 input to the DMA pattern (call before begin())
+     * @return false if the pin is not on ADC1
+     */
+    bool setAuxPin(uint8_t pin);
+
+    /**
+     * @brief Average aux sample (12 bit) since the previous call
+     * @return false if no aux sample arrived
+     */
+    bool takeAuxAverage(uint16_t& raw);
+
+    /**
+     * @brief Task to notify on a detected shift (the engine task)
+     */
+    void setEngineTask(TaskHandle_t task) { _engineTask = task; }
+
+    /**
+     * @brief Process all complete DMA frames (sensor task)
+     */
+    void update();
+
+    /**
+     * @brief TaskManager entry, context is the ShiftForceSensor
+     */
+    static void sensorTask(void* context);
+
+    /**
+     * @brief Current force above baseline in ADC counts (negative below)
+     */
+    int16_t getForce() const { return _force; }
+
+    /**
+     * @brief Force is above the threshold (not re-armed yet)
+     */
+    bool isPressed() const { return _pressed; }
+
+    /**
+     * @brief Shift requests triggered since boot
+     */
+    uint32_t getTriggerCount() const { return _triggerCount; }
+
+    /**
+     * @brief DMA frames lost because the sensor task fell behind
+     */
+    uint32_t getOverruns() const { return _overruns; }
+
+    bool isRunning() const { return _running; }
+
+private:
+    QuickShifterEngine& _qsEngine;
+    TaskHandle_t _engineTask;
+    adc1_channel_t _channel;
+    int8_t _auxChannel;             // -1 = none
+    bool _running;
+    size_t _frameBytes;             // One DMA frame for all channels
+
+    // Filter state, Q16 ADC counts
+    int32_t _filtered;
+    int32_t _baseline;
+    bool _primed;
+
+    // Threshold detector
+    volatile int16_t _force;
+    volatile bool _pressed;
+    uint32_t _pressSamples;
+    volatile uint32_t _triggerCount;
+    volatile uint32_t _overruns;
+
+    // Aux channel accumulator, reset by takeAuxAverage()
+    uint32_t _auxSum;
+    uint32_t _auxCount;
+
+    uint8_t _frame[SAMPLES_PER_FRAME * MAX_CHANNELS * sizeof(adc_digi_output_data_t)];
+
+    /**
+     * @brief Filter one sample and run the threshold detector
+     */
+    void processSample(uint16_t raw, bool armed, int32_t threshold, int32_t release);
+
+    /**
+     * @brief Hand a shift request to the engine and wake its task
+     */
+    void trigger();
+};
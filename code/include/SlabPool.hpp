@@ -0,0 +1,78 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief Fixed-size slab allocator over static storage
+ *
+ * SLOT_COUNT slots of SLOT_SIZE bytes (8-byte aligned) tracked in one free
+ * bitmask, O(1) allocate and release under a short critical section, so any
+ * task may allocate and any other release. Nothing ever comes from the heap;
+ * callers decide what to do when the pool is exhausted (allocate() returns
+ * nullptr and counts a miss).
+ */
+template <size_t SLOT_SIZE, size_t SLOT_COUNT>
+class SlabPool {
+    static_assert(SLOT_COUNT > 0 && SLOT_COUNT <= 32, "SlabPool holds 1..32 slots");
+    static_assert(SLOT_SIZE % 8 == 0, "SlabPool slots must keep 8-byte alignment");
+
+public:
+    static constexpr size_t slotSize() { return SLOT_SIZE; }
+    static constexpr size_t slotCount() { return SLOT_COUNT; }
+
+    SlabPool() : _used(0), _inUse(0), _peak(0), _misses(0) {}
+
+    /**
+     * @brief Take a free slot
+     * @return nullptr if all slots are in use
+     */
+    void* allocate() {
+        void* slot = nullptr;
+        portENTER_CRITICAL_SAFE(&_lock);
+        const uint32_t free = ~_used & ALL_SLOTS;
+        if (free) {
+            const uint32_t index = __builtin_ctz(free);
+            _used |= 1UL << index;
+            if (++_inUse > _peak) _peak = _inUse;
+            slot = _storage[index];
+        } else {
+            _misses++;
+        }
+        portEXIT_CRITICAL_SAFE(&_lock);
+        return slot;
+    }
+
+    /**
+     * @brief Return a slot taken with allocate()
+     * @return false if the pointer is not from this pool (nothing released)
+     */
+    bool release(void* ptr) {
+        if (!owns(ptr)) return false;
+        const uint32_t index = (static_cast<uint8_t*>(ptr) - _storage[0]) / SLOT_SIZE;
+        portENTER_CRITICAL_SAFE(&_lock);
+        if (_used & (1UL << index)) {
+            _used &= ~(1UL << index);
+            _inUse--;
+        }
+        portEXIT_CRITICAL_SAFE(&_lock);
+        return true;
+    }
+
+    bool owns(const void* ptr) const {
+        const uint8_t* p = static_cast<const uint8_t*>(ptr);
+        return p >= _storage[0] && p < _storage[0] + sizeof(_storage);
+    }
+
+    uint8_t inUse() const { return _inUse; }
+    uint8_t peak() const { return _peak; }
+    uint32_t misses() const { return _misses; }
+
+private:
+    static constexpr uint32_t ALL_SLOTS = SLOT_COUNT == 32 ? 0xFFFFFFFFUL : (1UL << SLOT_COUNT) - 1;
+
+    alignas(8) uint8_t _storage[SLOT_COUNT][SLOT_SIZE];
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t _used;                 // Bit per slot in use
+    volatile uint8_t _inUse;
+    volatile uint8_t _peak;
+    volatile uint32_t _misses;      // allocate() calls that found the pool full
+};
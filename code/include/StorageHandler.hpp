@@ -2,14 +2,33 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <Preferences.h>
 #include "QuickShifterEngine.hpp"
+#include "SensorAcquisition.hpp"
 
 /**
  * @brief Storage Handler - Abstraction layer for persistent configuration
  * 
- * Manages all file system operations with LittleFS
- * Ensures safe serialization/deserialization without flash corruption
- * Uses atomic writes (write to temp file, then rename)
+ * Mounts LittleFS (web interface, logs) and keeps the configuration in the
+ * nvs partition as one binary blob per section (qs, network, telemetry,
+ * sensors):
+ *   BlobHeader { magic, version, size, crc32 } + raw section struct
+ * Boot reads the blobs straight into the structs, with no parser involved.
+ * NVS writes are atomic per key, so a power loss leaves each section either
+ * old or new. JSON is only used for HTTP import/export and to migrate a
+ * legacy /config.json once, when NVS holds no configuration yet.
+ *
+ * The configuration is read from flash once in begin() and then held in RAM.
+ * load*() return a copy of the cached sections without touching flash.
+ * save*() update the cache and mark the changed sections dirty. update()
+ * rewrites only the dirty sections once no change arrived for
+ * COMMIT_DELAY_MS, so a burst of slider updates costs a single flash write.
+ *
+ * begin() only reads NVS. LittleFS is mounted separately by
+ * mountFileSystem(), which can take seconds when it formats, after the
+ * engine is armed. The engine and sensor sections last read or committed
+ * are also kept in RTC memory, so a warm reset (brownout, watchdog,
+ * software restart) can arm the engine before any flash access.
  */
 class StorageHandler {
 public:
@@ -26,6 +45,7 @@ public:
     // Telemetry configuration
     struct TelemetryConfig {
         uint16_t updateRateMs;  // WebSocket update rate (default: 100ms)
+        uint16_t sampleRateHz;  // History sample rate (default: 100Hz, max 1kHz)
     };
     
     // Complete system configuration
@@ -33,30 +53,86 @@ public:
         QuickShifterEngine::Config qsConfig;
         NetworkConfig networkConfig;
         TelemetryConfig telemetryConfig;
+        SensorAcquisition::Calibration sensorConfig;
     };
 
+    // Dirty section bits
+    static constexpr uint8_t DIRTY_QS = 0x01;
+    static constexpr uint8_t DIRTY_NETWORK = 0x02;
+    static constexpr uint8_t DIRTY_TELEMETRY = 0x04;
+    static constexpr uint8_t DIRTY_SENSORS = 0x08;
+    static constexpr uint8_t DIRTY_ALL = DIRTY_QS | DIRTY_NETWORK | DIRTY_TELEMETRY | DIRTY_SENSORS;
+    
+    static constexpr unsigned long COMMIT_DELAY_MS = 1000;  // Quiet period before a deferred write
+    
+    // Section schema versions, bump when a section struct changes. A blob
+    // with an older version is read as a prefix of the current struct, then
+    // the fields appended since are reset to their defaults (the prefix can
+    // end in struct padding that now holds a field, see migrateQsConfig()).
+    static constexpr uint16_t QS_CONFIG_VERSION = 6;           // v2: closed-loop cut, v3: spark skip, v4: force sensor, v5: throttle gate, v6: trigger wheel
+    static constexpr uint16_t NETWORK_CONFIG_VERSION = 1;
+    static constexpr uint16_t TELEMETRY_CONFIG_VERSION = 1;
+    static constexpr uint16_t SENSOR_CONFIG_VERSION = 1;
+    
     StorageHandler();
     
     /**
-     * @brief Initialize LittleFS and load configuration
-     * @return true if successful, false otherwise
+     * @brief Load configuration from NVS into the cache (defaults if unavailable)
+     * @return true if NVS could be opened
      */
     bool begin();
     
     /**
-     * @brief Load complete system configuration from flash
+     * @brief Mount LittleFS (formatted on mount failure), migrate a legacy /config.json
+     * A migration changes the cache, see getRevision().
+     * @return false if the file system is unusable
+     */
+    bool mountFileSystem();
+    
+    /**
+     * @brief Engine and sensor sections kept in RTC memory, usable before begin()
+     * Only meaningful after a reset that keeps RTC memory; contents are CRC checked.
+     * @return false if no valid copy is held
+     */
+    static bool loadRecoveryConfig(QuickShifterEngine::Config& qsConfig,
+                                   SensorAcquisition::Calibration& sensorConfig);
+    
+    /**
+     * @brief Copy complete system configuration from the cache
      * @param config Output parameter for loaded configuration
-     * @return true if loaded successfully, false if using defaults
+     * @return true if the cache was loaded from flash, false if using defaults
      */
     bool loadConfig(SystemConfig& config);
     
     /**
-     * @brief Save complete system configuration to flash
+     * @brief Update cached configuration, the flash write is deferred
      * @param config Configuration to save
-     * @return true if saved successfully
+     * @return true if the cache was updated
      */
     bool saveConfig(const SystemConfig& config);
     
+    /**
+     * @brief Commit dirty sections after the quiet period (network task)
+     */
+    void update();
+    
+    /**
+     * @brief Commit dirty sections now (before reboot)
+     * @return true if nothing was pending or the write succeeded
+     */
+    bool flush();
+    
+    /**
+     * @brief Sections changed since the last commit (DIRTY_* bits)
+     */
+    uint8_t getDirtySections() const { return _dirty; }
+    
+    /**
+     * @brief Configuration revision, counts cache changes since boot
+     * Clients compare it to tell whether their copy is still current.
+     */
+    uint32_t getRevision() const { return _revision; }
+    
     /**
      * @brief Load QuickShifter configuration only
      */
@@ -87,6 +163,47 @@ public:
      */
     bool saveTelemetryConfig(const TelemetryConfig& config);
     
+    /**
+     * @brief Load sensor calibration only
+     */
+    bool loadSensorConfig(SensorAcquisition::Calibration& config);
+    
+    /**
+     * @brief Save sensor calibration only
+     */
+    bool saveSensorConfig(const SensorAcquisition::Calibration& config);
+    
+    /**
+     * @brief Read cut map from a "qs" JSON object into table (partial updates allowed)
+     * Accepts the "cutMap" object and the legacy 1D "cutTimeMapUs" (µs) and
+     * "cutTimeMap" (ms) arrays, which are applied to every load row.
+     * @return true if any map field was present
+     */
+    static bool readCutMap(JsonObject qs, CutTimeMap::Table& table);
+    
+    /**
+     * @brief Write cut map as "cutMap" object into a "qs" JSON object
+     */
+    static void writeCutMap(JsonObject qs, const CutTimeMap::Table& table);
+    
+    /**
+     * @brief Write complete configuration as JSON (export)
+     */
+    static void configToJson(const SystemConfig& config, JsonObject root);
+    
+    /**
+     * @brief Apply JSON configuration onto config (import, missing fields unchanged)
+     * An invalid cut map is ignored and the previous map kept.
+     * @return false if root is not a JSON object
+     */
+    static bool configFromJson(JsonObject root, SystemConfig& config);
+    
+    /**
+     * @brief Sensor calibration to/from a "sensors" JSON object (missing fields unchanged)
+     */
+    static void sensorConfigToJson(const SensorAcquisition::Calibration& config, JsonObject sensors);
+    static bool sensorConfigFromJson(JsonObject sensors, SensorAcquisition::Calibration& config);
+    
     /**
      * @brief Check if web interface HTML exists
      */
@@ -98,11 +215,48 @@ public:
     void printInfo();
 
 private:
-    static constexpr const char* CONFIG_FILE = "/config.json";
-    static constexpr const char* CONFIG_TEMP_FILE = "/config.tmp";
+    static constexpr const char* LEGACY_CONFIG_FILE = "/config.json";
     static constexpr const char* WEB_HTML_FILE = "/index.html";
     
+    static constexpr const char* NVS_NAMESPACE = "qsconfig";
+    static constexpr const char* KEY_QS = "qs";
+    static constexpr const char* KEY_NETWORK = "network";
+    static constexpr const char* KEY_TELEMETRY = "telemetry";
+    static constexpr const char* KEY_SENSORS = "sensors";
+    
+    static constexpr uint32_t BLOB_MAGIC = 0x47464351;     // "QCFG"
+    static constexpr size_t MAX_SECTION_SIZE = 512;
+    
+    static constexpr uint32_t RECOVERY_MAGIC = 0x56434552;  // "RECV"
+    
+    // RTC memory copy of the sections needed to arm the engine
+    struct RecoveryBlock {
+        uint32_t magic;
+        uint16_t qsVersion;
+        uint16_t sensorVersion;
+        uint32_t crc;       // CRC32 of both sections
+        QuickShifterEngine::Config qsConfig;
+        SensorAcquisition::Calibration sensorConfig;
+    };
+    
+    struct __attribute__((packed)) BlobHeader {
+        uint32_t magic;
+        uint16_t version;   // Section schema version
+        uint16_t size;      // Payload bytes
+        uint32_t crc;       // CRC32 of the payload
+    };
+    
     bool _initialized;
+    Preferences _prefs;
+    bool _nvsReady;
+    
+    // Authoritative in-RAM configuration
+    SystemConfig _config;
+    bool _configFromFlash;
+    volatile uint8_t _dirty;
+    volatile uint32_t _revision;
+    unsigned long _lastChangeMs;
+    SemaphoreHandle_t _mutex;
     
     /**
      * @brief Get default configuration
@@ -110,7 +264,51 @@ private:
     void getDefaultConfig(SystemConfig& config);
     
     /**
-     * @brief Perform atomic file write (write to temp, then rename)
+     * @brief Copy the engine and sensor sections into RTC memory
+     */
+    static void storeRecoveryConfig(const SystemConfig& config);
+    static uint32_t recoveryCrc(const RecoveryBlock& block);
+    
+    static RecoveryBlock _recovery;
+    
+    /**
+     * @brief Read all section blobs from NVS into config
+     * @return DIRTY_* bits of the sections found
+     */
+    uint8_t readSections(SystemConfig& config);
+    
+    /**
+     * @brief Write the sections selected by DIRTY_* bits to NVS
+     * @return DIRTY_* bits of the sections that failed
+     */
+    uint8_t writeSections(const SystemConfig& config, uint8_t sections);
+    
+    /**
+     * @brief Read one section blob, checking magic, version, size and CRC
+     * @param storedVersion Set to the version of the blob read
+     * @return false if missing or invalid (section left unchanged)
+     */
+    bool readSection(const char* key, uint16_t version, void* section, size_t size, uint16_t& storedVersion);
+    
+    /**
+     * @brief Reset the QS fields added after fromVersion to their defaults
+     */
+    void migrateQsConfig(uint16_t fromVersion, QuickShifterEngine::Config& config);
+    
+    /**
+     * @brief Write one section blob with header and CRC
+     */
+    bool writeSection(const char* key, uint16_t version, const void* section, size_t size);
+    
+    /**
+     * @brief Parse the legacy JSON configuration file from LittleFS
+     * @return true if loaded successfully
+     */
+    bool readLegacyConfig(SystemConfig& config);
+    
+    /**
+     * @brief Update one cached section, marking it dirty and bumping the revision if it changed
      */
-    bool atomicWrite(const char* filename, const char* data, size_t len);
+    template <typename T>
+    void saveSection(T& cached, const T& value, uint8_t dirtyBit);
 };
@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief Task Manager - Periodic FreeRTOS tasks with explicit priorities
+ *
+ * Each registered task runs its function at a fixed period (vTaskDelayUntil)
+ * on the real-time core, so a slow low-priority task (web server, JSON) can
+ * never delay a higher one (engine supervision). A task created with
+ * wakeOnNotify also runs as soon as another task calls xTaskNotifyGive() on
+ * its handle (getHandle()), without shifting its periodic schedule.
+ *
+ * Priority scheme (higher runs first):
+ * - PRIORITY_ENGINE    : Signal timeout, cut supervision (above AsyncTCP)
+ * - PRIORITY_SENSOR    : ADC DMA frame processing (shift force sensor)
+ * - PRIORITY_ACQUISITION: Throttle position/MAP reads
+ * - PRIORITY_SAMPLER   : Fixed-rate telemetry history sampling
+ * - PRIORITY_TELEMETRY : Telemetry broadcast
+ * - PRIORITY_NETWORK   : WebSocket housekeeping, LED status, storage
+ * - (OtaUpdater writer/download tasks, 3 and 2, created by OtaUpdater itself)
+ * - PRIORITY_LOGGER    : Session log block writes to flash
+ * - PRIORITY_EVENTS    : Event log drain (just above idle)
+ */
+class TaskManager {
+public:
+    using TaskFunction = void (*)(void* context);
+
+    static constexpr UBaseType_t PRIORITY_ENGINE = 12;
+    static constexpr UBaseType_t PRIORITY_SENSOR = 10;
+    static constexpr UBaseType_t PRIORITY_ACQUISITION = 9;
+    static constexpr UBaseType_t PRIORITY_SAMPLER = 8;
+    static constexpr UBaseType_t PRIORITY_TELEMETRY = 6;
+    static constexpr UBaseType_t PRIORITY_NETWORK = 4;
+    static constexpr UBaseType_t PRIORITY_LOGGER = 2;
+    static constexpr UBaseType_t PRIORITY_EVENTS = 1;
+
+    static constexpr BaseType_t TASK_CORE = 0;  // ESP32-S2 is single core
+    static constexpr size_t MAX_TASKS = 12;     // setup() starts 8, the rest is headroom
+
+    struct TaskConfig {
+        const char* name;
+        TaskFunction function;
+        void* context;
+        uint32_t periodMs;
+        UBaseType_t priority;
+        uint32_t stackSize;
+        bool wakeOnNotify;          // Also run on a direct task notification
+    };
+
+    TaskManager();
+
+    /**
+     * @brief Create and start a periodic task
+     * @return Task index, or -1 on failure (table full, invalid config or
+     *         xTaskCreate failed, reported on Serial)
+     */
+    int addTask(const TaskConfig& config);
+
+    /**
+     * @brief Change task period at runtime (takes effect next cycle)
+     */
+    bool setPeriod(int index, uint32_t periodMs);
+    
+    /**
+     * @brief Current task period, 0 for an invalid index
+     */
+    uint32_t getPeriod(int index) const;
+
+    /**
+     * @brief FreeRTOS handle of a task (notification target), nullptr for an invalid index
+     */
+    TaskHandle_t getHandle(int index) const;
+
+    /**
+     * @brief Number of registered tasks
+     */
+    size_t getTaskCount() const { return _taskCount; }
+
+    /**
+     * @brief Minimum free stack ever seen for a task, in bytes
+     */
+    uint32_t getStackHighWaterMark(int index) const;
+
+    /**
+     * @brief Print period, priority and stack usage of all tasks to Serial
+     */
+    void printStackReport() const;
+
+private:
+    struct TaskSlot {
+        TaskConfig config;
+        volatile uint32_t periodMs;
+        TaskHandle_t handle;
+    };
+
+    TaskSlot _tasks[MAX_TASKS];
+    size_t _taskCount;
+
+    static void taskEntry(void* arg);
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief Binary WebSocket telemetry frame format
+ *
+ * One frame carries a batch of samples taken at the internal sample rate, so
+ * a 100 Hz trace costs one WebSocket message per broadcast period instead of
+ * one JSON message per sample. All fields are little-endian (native on the
+ * ESP32 and read with DataView(..., true) in the browser).
+ *
+ * Layout: Header followed by header.sampleCount samples of header.sampleSize
+ * bytes each. Decoders must use sampleSize as the stride so newer firmware can
+ * append fields to Sample without breaking older pages.
+ *
+ * Clients opt in by sending {"stream":"binary"} over the WebSocket and can
+ * switch back with {"stream":"json"}. JSON remains the default.
+ */
+namespace TelemetryFrame {
+
+constexpr uint8_t MAGIC = 0x51;  // 'Q'
+constexpr uint8_t VERSION = 1;
+constexpr size_t MAX_SAMPLES = 32;
+
+/**
+ * @brief Sample flag bits
+ */
+enum Flags : uint8_t {
+    FLAG_SIGNAL_ACTIVE = 0x01,
+    FLAG_CUT_ACTIVE    = 0x02,
+    FLAG_TPS_VALID     = 0x04,
+    FLAG_MAP_VALID     = 0x08
+};
+
+struct __attribute__((packed)) Header {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t sampleCount;
+    uint8_t sampleSize;
+    uint16_t sequence;      // Incremented per frame, gaps mean lost frames
+    uint16_t configGeneration;  // Engine config generation (low 16 bits), 0 in captures
+};
+
+struct __attribute__((packed)) Sample {
+    uint32_t timestampUs;   // micros() at sample time
+    uint16_t rpm;
+    uint16_t tps;           // Throttle position, 0.1% units (valid if FLAG_TPS_VALID)
+    uint16_t map;           // Manifold pressure, 0.1 kPa units (valid if FLAG_MAP_VALID)
+    uint8_t flags;
+    uint8_t reserved;
+    int16_t rpmAccel;       // RPM rate of change, 10 RPM/s units (saturated)
+};
+
+static_assert(sizeof(Header) == 8, "TelemetryFrame::Header must stay 8 bytes");
+static_assert(sizeof(Sample) == 14, "TelemetryFrame::Sample layout changed, append fields only");
+
+constexpr int32_t RPM_ACCEL_SCALE = 10;  // RPM/s per rpmAccel unit
+
+constexpr size_t MAX_FRAME_SIZE = sizeof(Header) + MAX_SAMPLES * sizeof(Sample);
+
+}  // namespace TelemetryFrame
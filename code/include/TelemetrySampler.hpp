@@ -0,0 +1,137 @@
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+#include "QuickShifterEngine.hpp"
+#include "TelemetryFrame.hpp"
+
+/**
+ * @brief Telemetry Sampler - Fixed-rate engine history independent of the network
+ *
+ * Samples engine state from its own task at a configurable rate (up to 1 kHz)
+ * into a ring buffer holding the last few seconds. The buffer is a
+ * struct-of-arrays of fixed-point fields, allocated once in begin() from PSRAM
+ * when available, DRAM otherwise.
+ *
+ * Samples are addressed by a monotonically increasing sample index, so readers
+ * (live WebSocket stream, capture download) keep their own cursor and detect
+ * overwritten data without locking the sampler.
+ *
+ * Shift events are recorded as triggers so a client connecting later can pull
+ * the pre/post-trigger window of the last shifts.
+ */
+class TelemetrySampler {
+public:
+    static constexpr uint16_t DEFAULT_SAMPLE_RATE_HZ = 100;
+    static constexpr uint16_t MAX_SAMPLE_RATE_HZ = 1000;
+
+    static constexpr size_t PSRAM_CAPACITY = 16384;  // 16.4s at 1 kHz
+    static constexpr size_t DRAM_CAPACITY = 2048;    // 2s at 1 kHz, 20s at 100 Hz
+    static constexpr size_t MAX_TRIGGERS = 8;
+
+    /**
+     * @brief Recorded shift trigger
+     */
+    struct Trigger {
+        uint32_t timestampUs;   // micros() at the shift
+        uint32_t cutTimeUs;
+        uint16_t rpm;
+    };
+
+    TelemetrySampler(QuickShifterEngine& qsEngine);
+
+    /**
+     * @brief Allocate history buffer
+     * @return true if successful
+     */
+    bool begin();
+
+    /**
+     * @brief Take one sample (sampler task)
+     */
+    void sample();
+
+    /**
+     * @brief EventDispatcher sink - records shift triggers
+     * @param context TelemetrySampler instance
+     */
+    static void onEngineEvent(const QuickShifterEngine::Event& event, void* context);
+
+    /**
+     * @brief Set sample rate, clamped to 1..MAX_SAMPLE_RATE_HZ
+     *
+     * Rounded down to a rate whose period is a whole number of ms dividing
+     * a second (1000, 500, 250, 200, 125, 100, 50, ...), so getSampleRate()
+     * is the rate actually sampled at, as logged and reported.
+     */
+    void setSampleRate(uint16_t rateHz);
+    uint16_t getSampleRate() const { return _sampleRateHz; }
+
+    /**
+     * @brief Sample period in ms for the sampler task
+     */
+    uint32_t getPeriodMs() const { return 1000 / _sampleRateHz; }
+
+    /**
+     * @brief Index the next sample will be written to
+     */
+    uint32_t getHead() const { return _head.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Oldest index still held in the buffer
+     */
+    uint32_t getOldest() const;
+
+    size_t getCapacity() const { return _capacity; }
+
+    /**
+     * @brief Copy samples starting at index into out
+     *
+     * Indices older than the buffer are skipped forward to the oldest sample.
+     * @param index In: first sample wanted, out: next index to read
+     * @return Number of samples copied
+     */
+    size_t read(uint32_t& index, TelemetryFrame::Sample* out, size_t maxSamples) const;
+
+    /**
+     * @brief Index of the first held sample taken at or after timestampUs
+     * @return getHead() if no such sample exists yet
+     */
+    uint32_t findIndex(uint32_t timestampUs) const;
+
+    /**
+     * @brief Most recent sample
+     * @return false if nothing was sampled yet
+     */
+    bool latest(TelemetryFrame::Sample& out) const;
+
+    /**
+     * @brief Number of recorded triggers (up to MAX_TRIGGERS)
+     */
+    size_t getTriggerCount() const;
+
+    /**
+     * @brief Get trigger, 0 = most recent
+     */
+    bool getTrigger(size_t age, Trigger& out) const;
+
+private:
+    QuickShifterEngine& _qsEngine;
+
+    // Struct-of-arrays history (fixed point)
+    uint32_t* _timestampUs;   // micros()
+    uint16_t* _rpm;
+    uint16_t* _tps;           // 0.1 %
+    uint16_t* _map;           // 0.1 kPa
+    int16_t* _rpmAccel;       // 10 RPM/s
+    uint8_t* _flags;          // TelemetryFrame::Flags
+    size_t _capacity;         // Power of two
+    std::atomic<uint32_t> _head;
+
+    volatile uint16_t _sampleRateHz;
+
+    std::array<Trigger, MAX_TRIGGERS> _triggers;
+    std::atomic<uint32_t> _triggerCount;
+
+    void copySample(uint32_t index, TelemetryFrame::Sample& out) const;
+};
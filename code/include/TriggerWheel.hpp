@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief Trigger Wheel - Multi-tooth pickup decoding with missing-tooth sync
+ *
+ * Describes the wheel as teeth positions per revolution with the last
+ * missing of them left out (12-1: 12 positions, 11 teeth). Every accepted
+ * pickup interval is measured in tooth pitches against the previous tooth
+ * (rounded, so the gap counts missing + 1 pitches and a lost tooth counts
+ * two) and advances the tooth position by that much.
+ *
+ * Sync: with missing teeth, the first interval of missing + 1 pitches is
+ * taken as the gap (position 0 = first tooth after it); the wheel is synced
+ * once the next gap lands exactly on position 0 again. A tooth landing on
+ * a missing position, or a dropout of more than MAX_PITCHES, drops sync
+ * until the next consistent revolution. Rejected teeth need no special
+ * handling: the next interval is measured from the last accepted tooth and
+ * simply spans more pitches. Wheels without missing teeth have no angle
+ * reference but still count revolutions.
+ *
+ * Revolution boundaries (position wrapping to 0) give the revolution
+ * period, an average over all teeth that removes tooth spacing error and
+ * the speed variation within a revolution.
+ *
+ * Per-tooth work is constant (one rounding division, no loops), all entry
+ * points in IRAM. Only the pickup ISR calls into it.
+ */
+class TriggerWheel {
+public:
+    static constexpr uint8_t MAX_TEETH = 60;
+    static constexpr uint8_t MAX_MISSING = 3;
+    static constexpr uint8_t MAX_PITCHES = 8;       // Longest interval still counted tooth by tooth
+
+    TriggerWheel();
+
+    /**
+     * @brief Set the wheel layout (ISR, on a new config generation), resets sync
+     */
+    void IRAM_ATTR configure(uint8_t teeth, uint8_t missing);
+
+    /**
+     * @brief Forget tooth history (signal lost or re-established)
+     */
+    void IRAM_ATTR reset();
+
+    /**
+     * @brief Tooth pitches spanned by an interval since the last accepted tooth
+     * @return 0 for the first interval after reset (kept as reference), else 1..255
+     */
+    uint8_t IRAM_ATTR measure(uint32_t intervalUs);
+
+    /**
+     * @brief Revolution period the interval corresponds to (for the RPM filter)
+     */
+    inline __attribute__((always_inline)) uint32_t revolutionInterval(uint32_t intervalUs, uint8_t pitches) const {
+        const uint32_t perRevolution = intervalUs * _teeth;
+        return pitches > 1 ? perRevolution / pitches : perRevolution;
+    }
+
+    /**
+     * @brief Advance by an accepted interval
+     * @return true if it completed a revolution (getRevolutionUs() updated)
+     */
+    bool IRAM_ATTR accept(uint32_t timestampUs, uint32_t intervalUs, uint8_t pitches);
+
+    uint8_t getTeeth() const { return _teeth; }
+    uint8_t getMissing() const { return _missing; }
+    bool isMultiTooth() const { return _teeth > 1; }
+
+    /**
+     * @brief Crank angle reference known (position 0 = first tooth after the gap)
+     */
+    bool isSynced() const { return _synced; }
+    uint8_t getPosition() const { return _position; }
+
+    /**
+     * @brief Last full revolution period, 0 until one was measured
+     */
+    uint32_t getRevolutionUs() const { return _revolutionUs; }
+
+    /**
+     * @brief Sync losses since boot (tooth count mismatch or dropout)
+     */
+    uint32_t getSyncLosses() const { return _syncLosses; }
+
+private:
+    uint8_t _teeth;                 // Positions per revolution, including missing ones
+    uint8_t _missing;
+    uint8_t _present;               // _teeth - _missing
+
+    volatile uint8_t _position;     // Tooth position of the last accepted tooth
+    volatile bool _synced;
+    bool _positionKnown;            // Counting from a gap (or any tooth without missing teeth)
+    uint32_t _pitchUs;              // Last accepted interval per tooth pitch, 0 = no reference
+    uint32_t _revolutionStartUs;
+    bool _revolutionStarted;
+    volatile uint32_t _revolutionUs;
+    volatile uint32_t _syncLosses;
+
+    void IRAM_ATTR loseSync();
+};
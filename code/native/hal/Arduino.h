@@ -0,0 +1,77 @@
+#pragma once
+/**
+ * @brief Host HAL shim - the Arduino subset the engine uses (native env only)
+ *
+ * Time is simulated: micros()/millis() return HostHal::now(), set by the
+ * replay loop. Pins keep their level, attachInterrupt() stores the ISR so
+ * HostHal::edge() can call it. Interrupt masking is a no-op, the replay is
+ * single threaded and calls the ISRs itself.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define LED_BUILTIN 15
+
+using std::max;
+using std::min;
+
+// FreeRTOS handles, declarations only: nothing on the host creates tasks or semaphores
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+// newlib has it, glibc only since 2.38
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    const size_t len = strlen(src);
+    if (size) {
+        const size_t copy = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return len;
+}
+#endif
+
+namespace HostHal {
+uint64_t now();
+}
+
+inline unsigned long micros() { return static_cast<unsigned long>(HostHal::now()); }
+inline unsigned long millis() { return static_cast<unsigned long>(HostHal::now() / 1000); }
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/**
+ * @brief Serial on stdout, silenced with HostHal::setSerialEnabled(false)
+ */
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void println(const char* text);
+};
+extern HostSerial Serial;
@@ -0,0 +1,154 @@
+#include "HostHal.hpp"
+#include <cstdarg>
+#include <driver/pcnt.h>
+#include <driver/timer.h>
+#include <soc/gpio_struct.h>
+
+HostSerial Serial;
+HostGpio GPIO;
+
+namespace {
+
+struct PinState {
+    bool level;
+    void (*isr)();
+    int mode;
+};
+
+uint64_t simTime = 0;
+bool serialEnabled = true;
+PinState pins[HostHal::PIN_COUNT] = {};
+
+// Cut timer (only one timer is used by the firmware)
+timer_isr_t timerIsr = nullptr;
+void* timerArg = nullptr;
+uint64_t alarmAt = 0;
+bool alarmArmed = false;
+
+// Pulse counter unit 0
+int pcntPin = -1;
+int16_t pcntLimit = 0;
+int16_t pcntCount = 0;
+bool pcntRunning = false;
+void (*pcntIsr)(void*) = nullptr;
+void* pcntArg = nullptr;
+
+}  // namespace
+
+namespace HostHal {
+
+uint64_t now() { return simTime; }
+void setTime(uint64_t us) { simTime = us; }
+void setSerialEnabled(bool enabled) { serialEnabled = enabled; }
+
+bool pinLevel(uint8_t pin) { return pin < PIN_COUNT && pins[pin].level; }
+
+void edge(uint8_t pin, bool level) {
+    if (pin >= PIN_COUNT || pins[pin].level == level) return;
+    pins[pin].level = level;
+
+    if (level && pin == pcntPin && pcntRunning && ++pcntCount >= pcntLimit) {
+        pcntCount = 0;
+        if (pcntIsr) pcntIsr(pcntArg);
+    }
+
+    const int mode = pins[pin].mode;
+    if (pins[pin].isr && (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level))) {
+        pins[pin].isr();
+    }
+}
+
+bool nextAlarm(uint64_t& at) {
+    at = alarmAt;
+    return alarmArmed && timerIsr;
+}
+
+void fireAlarm() {
+    alarmArmed = false;
+    if (timerIsr) timerIsr(timerArg);
+}
+
+}  // namespace HostHal
+
+// Arduino
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin < HostHal::PIN_COUNT) pins[pin].level = level != LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    return HostHal::pinLevel(pin) ? HIGH : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    if (pin >= HostHal::PIN_COUNT) return;
+    pins[pin].isr = isr;
+    pins[pin].mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < HostHal::PIN_COUNT) pins[pin].isr = nullptr;
+}
+
+int HostSerial::printf(const char* format, ...) {
+    if (!serialEnabled) return 0;
+    va_list args;
+    va_start(args, format);
+    const int len = vprintf(format, args);
+    va_end(args);
+    return len;
+}
+
+void HostSerial::println(const char* text) {
+    if (serialEnabled) puts(text);
+}
+
+HostGpioSetClear& HostGpioSetClear::operator=(uint32_t mask) {
+    for (uint8_t bit = 0; bit < 32; bit++) {
+        const uint8_t pin = bank * 32 + bit;
+        if ((mask & (1UL << bit)) && pin < HostHal::PIN_COUNT) pins[pin].level = set;
+    }
+    return *this;
+}
+
+// Timer
+esp_err_t timer_init(timer_group_t, timer_idx_t, const timer_config_t*) { return ESP_OK; }
+esp_err_t timer_set_counter_value(timer_group_t, timer_idx_t, uint64_t) { return ESP_OK; }
+esp_err_t timer_enable_intr(timer_group_t, timer_idx_t) { return ESP_OK; }
+esp_err_t timer_start(timer_group_t, timer_idx_t) { return ESP_OK; }
+
+esp_err_t timer_isr_callback_add(timer_group_t, timer_idx_t, timer_isr_t isr, void* arg, int) {
+    timerIsr = isr;
+    timerArg = arg;
+    return ESP_OK;
+}
+
+uint64_t timer_group_get_counter_value_in_isr(timer_group_t, timer_idx_t) { return simTime; }
+void timer_group_set_alarm_value_in_isr(timer_group_t, timer_idx_t, uint64_t value) { alarmAt = value; }
+void timer_group_enable_alarm_in_isr(timer_group_t, timer_idx_t) { alarmArmed = true; }
+
+// Pulse counter
+esp_err_t pcnt_unit_config(const pcnt_config_t* config) {
+    pcntPin = config->pulse_gpio_num;
+    pcntLimit = config->counter_h_lim > 0 ? config->counter_h_lim : 1;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_set_filter_value(pcnt_unit_t, uint16_t) { return ESP_OK; }
+esp_err_t pcnt_filter_enable(pcnt_unit_t) { return ESP_OK; }
+esp_err_t pcnt_event_enable(pcnt_unit_t, pcnt_evt_type_t) { return ESP_OK; }
+esp_err_t pcnt_set_event_value(pcnt_unit_t, pcnt_evt_type_t event, int16_t value) {
+    if (event == PCNT_EVT_H_LIM) pcntLimit = value;
+    return ESP_OK;
+}
+esp_err_t pcnt_counter_pause(pcnt_unit_t) { pcntRunning = false; return ESP_OK; }
+esp_err_t pcnt_counter_resume(pcnt_unit_t) { pcntRunning = pcntPin >= 0; return ESP_OK; }
+esp_err_t pcnt_counter_clear(pcnt_unit_t) { pcntCount = 0; return ESP_OK; }
+esp_err_t pcnt_isr_service_install(int) { return ESP_OK; }
+
+esp_err_t pcnt_isr_handler_add(pcnt_unit_t, void (*isr)(void*), void* arg) {
+    pcntIsr = isr;
+    pcntArg = arg;
+    return ESP_OK;
+}
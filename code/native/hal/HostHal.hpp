@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief Host HAL - simulated time, pins, cut timer and pulse counter (native env)
+ *
+ * The replay loop owns time: it sets now(), fires the cut timer alarm when
+ * it is due and feeds pin edges, which call the ISRs the firmware attached
+ * (GPIO interrupts, and the PCNT handler every counter_h_lim rising edges
+ * on the PCNT pulse pin). Everything runs on one thread.
+ */
+namespace HostHal {
+
+static constexpr size_t PIN_COUNT = 54;
+
+uint64_t now();
+void setTime(uint64_t us);
+
+/**
+ * @brief Level change on an input pin, calls the matching ISRs
+ */
+void edge(uint8_t pin, bool level);
+
+/**
+ * @brief Current pin level (outputs include GPIO register writes)
+ */
+bool pinLevel(uint8_t pin);
+
+/**
+ * @brief Time of the armed cut timer alarm
+ * @return false if no alarm is armed
+ */
+bool nextAlarm(uint64_t& at);
+
+/**
+ * @brief Disarm and run the alarm callback (time must be set to the alarm first)
+ */
+void fireAlarm();
+
+void setSerialEnabled(bool enabled);
+
+/**
+ * @brief Contents of the running app partition (esp_partition_read(), OTA delta base)
+ * The data is not copied and must outlive its use.
+ */
+void setRunningPartition(const uint8_t* data, uint32_t size);
+
+}  // namespace HostHal
@@ -0,0 +1,224 @@
+#include "HostHal.hpp"
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp32/rom/miniz.h>
+#include <mbedtls/sha256.h>
+
+UpdateClass Update;
+
+namespace {
+
+esp_partition_t runningPartition = {0x10000, 0, "app0"};
+const uint8_t* runningData = nullptr;
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+uint32_t rotr(uint32_t x, uint32_t n) { return (x >> n) | (x << (32 - n)); }
+
+void sha256Block(mbedtls_sha256_context* ctx, const uint8_t* block) {
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; i++) {
+        w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+               (uint32_t(block[i * 4 + 2]) << 8) | block[i * 4 + 3];
+    }
+    for (size_t i = 16; i < 64; i++) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t v[8];
+    memcpy(v, ctx->state, sizeof(v));
+    for (size_t i = 0; i < 64; i++) {
+        const uint32_t s1 = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+        const uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        const uint32_t t1 = v[7] + s1 + ch + SHA256_K[i] + w[i];
+        const uint32_t s0 = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+        const uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        memmove(v + 1, v, 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + s0 + maj;
+    }
+    for (size_t i = 0; i < 8; i++) ctx->state[i] += v[i];
+}
+
+}  // namespace
+
+namespace HostHal {
+
+void setRunningPartition(const uint8_t* data, uint32_t size) {
+    runningData = data;
+    runningPartition.size = size;
+}
+
+}  // namespace HostHal
+
+// Update
+
+bool UpdateClass::begin(size_t size, int command) {
+    if (_running) return false;
+    _image.clear();
+    _size = size;
+    _command = command;
+    _error = UPDATE_ERROR_OK;
+    _running = true;
+    _finished = false;
+    _aborted = false;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+    if (!_running) return 0;
+    if (_size != UPDATE_SIZE_UNKNOWN && _image.size() + len > _size) {
+        _error = UPDATE_ERROR_SPACE;
+        return 0;
+    }
+    _image.insert(_image.end(), data, data + len);
+    return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if (!_running) return false;
+    if (!evenIfRemaining && _image.size() != _size) {
+        _error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    _running = false;
+    _finished = true;
+    return true;
+}
+
+void UpdateClass::abort() {
+    _running = false;
+    _aborted = true;
+    _error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() const {
+    switch (_error) {
+        case UPDATE_ERROR_OK: return "No Error";
+        case UPDATE_ERROR_SPACE: return "Not Enough Space";
+        case UPDATE_ERROR_SIZE: return "Bad Size Given";
+        case UPDATE_ERROR_ABORT: return "Update Aborted";
+        default: return "UNKNOWN";
+    }
+}
+
+// Partitions
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    return runningData ? &runningPartition : nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+    if (partition != &runningPartition || !runningData || offset + size > partition->size) return ESP_FAIL;
+    memcpy(dst, runningData + offset, size);
+    return ESP_OK;
+}
+
+// SHA-256
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context* ctx, int) {
+    static const uint32_t INITIAL[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, INITIAL, sizeof(INITIAL));
+    ctx->length = 0;
+    ctx->used = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update_ret(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len) {
+    ctx->length += len;
+    while (len > 0) {
+        const size_t chunk = std::min(len, sizeof(ctx->block) - ctx->used);
+        memcpy(ctx->block + ctx->used, input, chunk);
+        ctx->used += chunk;
+        input += chunk;
+        len -= chunk;
+        if (ctx->used == sizeof(ctx->block)) {
+            sha256Block(ctx, ctx->block);
+            ctx->used = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+    const uint64_t bits = ctx->length * 8;
+    ctx->block[ctx->used++] = 0x80;
+    if (ctx->used > 56) {
+        memset(ctx->block + ctx->used, 0, sizeof(ctx->block) - ctx->used);
+        sha256Block(ctx, ctx->block);
+        ctx->used = 0;
+    }
+    memset(ctx->block + ctx->used, 0, 56 - ctx->used);
+    for (size_t i = 0; i < 8; i++) {
+        ctx->block[56 + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+    sha256Block(ctx, ctx->block);
+    for (size_t i = 0; i < 8; i++) {
+        output[i * 4] = static_cast<uint8_t>(ctx->state[i] >> 24);
+        output[i * 4 + 1] = static_cast<uint8_t>(ctx->state[i] >> 16);
+        output[i * 4 + 2] = static_cast<uint8_t>(ctx->state[i] >> 8);
+        output[i * 4 + 3] = static_cast<uint8_t>(ctx->state[i]);
+    }
+    return 0;
+}
+
+// tinfl on zlib
+
+void tinfl_init(tinfl_decompressor* r) {
+    memset(r, 0, sizeof(*r));
+    r->active = inflateInit(&r->stream) == Z_OK;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t*, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const uint32_t decomp_flags) {
+    if (!r->active || !(decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER)) {
+        *pIn_buf_size = 0;
+        *pOut_buf_size = 0;
+        return TINFL_STATUS_BAD_PARAM;
+    }
+
+    z_stream& stream = r->stream;
+    stream.next_in = const_cast<Bytef*>(pIn_buf_next);
+    stream.avail_in = *pIn_buf_size;
+    stream.next_out = pOut_buf_next;
+    stream.avail_out = *pOut_buf_size;
+    const int result = inflate(&stream, Z_NO_FLUSH);
+    *pIn_buf_size -= stream.avail_in;
+    *pOut_buf_size -= stream.avail_out;
+
+    if (result == Z_STREAM_END) {
+        inflateEnd(&stream);
+        r->active = false;
+        return TINFL_STATUS_DONE;
+    }
+    if (result == Z_OK || result == Z_BUF_ERROR) {
+        if (stream.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+        if (stream.avail_in == 0 && (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT)) return TINFL_STATUS_NEEDS_MORE_INPUT;
+    }
+    inflateEnd(&stream);
+    r->active = false;
+    return TINFL_STATUS_FAILED;
+}
@@ -0,0 +1,4 @@
+#pragma once
+/**
+ * @brief Host HAL shim - LittleFS (StorageHandler declarations only, no file system)
+ */
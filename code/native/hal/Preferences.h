@@ -0,0 +1,5 @@
+#pragma once
+/**
+ * @brief Host HAL shim - NVS preferences (StorageHandler declarations only, no storage)
+ */
+class Preferences {};
@@ -0,0 +1,53 @@
+#pragma once
+/**
+ * @brief Host HAL shim - Update (keeps the written image in memory)
+ *
+ * begin(), write() and end() follow the Arduino class closely enough for
+ * OtaImageDecoder: end() without evenIfRemaining fails unless exactly the
+ * announced size was written. Image contents are not checked (no magic
+ * byte or MD5). image() and the state flags are host-only, for tests.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define UPDATE_ERROR_OK (0)
+#define UPDATE_ERROR_WRITE (1)
+#define UPDATE_ERROR_SPACE (4)
+#define UPDATE_ERROR_SIZE (5)
+#define UPDATE_ERROR_MD5 (7)
+#define UPDATE_ERROR_MAGIC_BYTE (8)
+#define UPDATE_ERROR_ABORT (12)
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+class UpdateClass {
+public:
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH);
+    size_t write(uint8_t* data, size_t len);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+
+    uint8_t getError() const { return _error; }
+    const char* errorString() const;
+    bool isRunning() const { return _running; }
+
+    // Host only
+    const std::vector<uint8_t>& image() const { return _image; }
+    int command() const { return _command; }
+    bool isFinished() const { return _finished; }
+    bool isAborted() const { return _aborted; }
+
+private:
+    std::vector<uint8_t> _image;
+    size_t _size = 0;
+    int _command = U_FLASH;
+    uint8_t _error = UPDATE_ERROR_OK;
+    bool _running = false;
+    bool _finished = false;
+    bool _aborted = false;
+};
+extern UpdateClass Update;
@@ -0,0 +1,14 @@
+#pragma once
+/**
+ * @brief Host HAL shim - ADC types (sensor declarations only, no conversions)
+ */
+#include <cstdint>
+
+typedef enum { ADC1_CHANNEL_0, ADC1_CHANNEL_MAX = 10 } adc1_channel_t;
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef enum { ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+
+// ESP32-S2 DMA output word
+typedef struct {
+    uint16_t val;
+} adc_digi_output_data_t;
@@ -0,0 +1,40 @@
+#pragma once
+/**
+ * @brief Host HAL shim - ROM tinfl inflater, on top of the host zlib (-lz)
+ *
+ * Same calls, flags and status codes as miniz. zlib keeps its own window,
+ * so the circular output buffer tinfl requires is only written to. The
+ * zlib state is released when the stream ends or fails; a decompressor
+ * freed mid-stream leaks it (host only, a few KB per aborted test).
+ */
+#include <cstddef>
+#include <cstdint>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct {
+    z_stream stream;
+    bool active;            // inflateInit done, not ended yet
+} tinfl_decompressor;
+
+void tinfl_init(tinfl_decompressor* r);
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const uint32_t decomp_flags);
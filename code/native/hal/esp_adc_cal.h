@@ -0,0 +1,10 @@
+#pragma once
+/**
+ * @brief Host HAL shim - ADC calibration (SensorAcquisition declarations only)
+ */
+#include <cstdint>
+
+typedef struct {
+    uint32_t coeff_a;
+    uint32_t coeff_b;
+} esp_adc_cal_characteristics_t;
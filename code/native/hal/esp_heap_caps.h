@@ -0,0 +1,10 @@
+#pragma once
+/**
+ * @brief Host HAL shim - capability heap (plain malloc, no PSRAM)
+ */
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+static inline void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
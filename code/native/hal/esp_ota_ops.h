@@ -0,0 +1,7 @@
+#pragma once
+/**
+ * @brief Host HAL shim - running partition lookup
+ */
+#include "esp_partition.h"
+
+const esp_partition_t* esp_ota_get_running_partition();
@@ -0,0 +1,17 @@
+#pragma once
+/**
+ * @brief Host HAL shim - partition reads (the running app, see HostHal::setRunningPartition())
+ */
+#include <cstddef>
+#include <cstdint>
+#include "driver/timer.h"   // esp_err_t, ESP_OK
+
+#define ESP_FAIL (-1)
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size);
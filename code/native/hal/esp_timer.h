@@ -0,0 +1,11 @@
+#pragma once
+/**
+ * @brief Host HAL shim - esp_timer clock (simulated time, same base as micros())
+ */
+#include <cstdint>
+
+namespace HostHal {
+uint64_t now();
+}
+
+static inline int64_t esp_timer_get_time() { return static_cast<int64_t>(HostHal::now()); }
@@ -0,0 +1,11 @@
+#pragma once
+/**
+ * @brief Host HAL shim - cycle counter (simulated time at 240 MHz)
+ */
+#include <cstdint>
+
+namespace HostHal {
+uint64_t now();
+}
+
+static inline uint32_t cpu_hal_get_cycle_count() { return static_cast<uint32_t>(HostHal::now() * 240); }
@@ -0,0 +1,19 @@
+#pragma once
+/**
+ * @brief Host HAL shim - SHA-256 with the mbedtls 2.x (ESP-IDF 4) call names
+ */
+#include <cstddef>
+#include <cstdint>
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;        // Bytes hashed
+    uint8_t block[64];
+    size_t used;            // Bytes in block
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx);
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context* ctx, int is224);
+int mbedtls_sha256_update_ret(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len);
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context* ctx, unsigned char output[32]);
@@ -0,0 +1,23 @@
+#pragma once
+/**
+ * @brief Host HAL shim - GPIO set/clear registers (writes update HostHal pin levels)
+ */
+#include <cstdint>
+
+struct HostGpioSetClear {
+    uint8_t bank;   // 0: GPIO 0-31, 1: GPIO 32-53
+    bool set;
+    HostGpioSetClear& operator=(uint32_t mask);
+};
+
+struct HostGpioBank {
+    HostGpioSetClear val;
+};
+
+struct HostGpio {
+    HostGpioSetClear out_w1ts{0, true};
+    HostGpioSetClear out_w1tc{0, false};
+    HostGpioBank out1_w1ts{{1, true}};
+    HostGpioBank out1_w1tc{{1, false}};
+};
+extern HostGpio GPIO;
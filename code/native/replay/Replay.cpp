@@ -0,0 +1,771 @@
+/**
+ * @brief Native replay harness - pulse/shift traces through QuickShifterEngine on the host
+ *
+ * Runs the firmware's engine (ISRs, predictive filter, RPM estimator, cut
+ * map and cut timer logic) against the host HAL shim in simulated time, as
+ * fast as the host allows. Inputs are CSV traces or SessionLogger files
+ * (.bin); the report covers throughput, filter accuracy against the
+ * trace's reference RPM and the cut decisions, compared with the recorded
+ * ones for session logs.
+ *
+ * Usage: replay [options] <trace.csv|log.bin>...
+ * See the "Native Replay" section of the README for the trace format.
+ */
+#ifndef PIO_UNIT_TESTING  // pio test links this env's sources into every suite, each has its own main()
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "HostHal.hpp"
+#include "pins.hpp"
+#include "QuickShifterEngine.hpp"
+#include "SessionLogFormat.hpp"
+#include "TelemetryFrame.hpp"
+
+namespace {
+
+constexpr uint64_t START_US = 1000000;          // micros() 0 means "no pulse yet" to the engine
+constexpr uint64_t SOURCE_GAP_US = 2000000;     // Between unrelated sources, past the signal timeout
+constexpr uint64_t UPDATE_PERIOD_US = 5000;     // Engine task cycle
+constexpr uint64_t SESSION_JOIN_US = 10000000;  // Longest gap between files of one session
+constexpr uint16_t MIN_SYNTH_RPM = 300;         // Below this log samples produce no pulses
+constexpr size_t MAX_REFERENCES = 64;           // Reference points kept for scoring
+
+using EventType = QuickShifterEngine::EventType;
+
+struct Input {
+    enum class Kind : uint8_t {
+        PULSE,          // Pickup edge
+        SHIFT,          // Shift switch edge
+        THROTTLE,       // value = TPS, 0.1 %
+        REFERENCE       // value = true RPM at this time
+    };
+
+    uint64_t timeUs;            // Relative to the start of its source
+    Kind kind;
+    bool recorded;              // SHIFT: outcome below was recorded by the firmware
+    EventType recordedType;
+    uint32_t value;             // THROTTLE/REFERENCE value, recorded cut time for SHIFT
+};
+
+struct Options {
+    QuickShifterEngine::PickupMode pickupMode = QuickShifterEngine::PickupMode::PCNT_CAPTURE;
+    QuickShifterEngine::Config config;
+    bool quiet = false;
+    const char* decisionsPath = nullptr;
+};
+
+struct Stats {
+    uint64_t inputs = 0;
+    uint64_t pulses = 0;
+    uint64_t engineEvents = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t rpmSamples = 0;
+    uint64_t rpmErrorSum = 0;
+    uint32_t rpmErrorMax = 0;
+    uint64_t shiftRequests = 0;
+    uint64_t shifts = 0;
+    uint64_t debounced = 0;
+    uint64_t blocked = 0;
+    uint64_t cuts = 0;
+    uint64_t cutRequestedSumUs = 0;
+    uint64_t cutActualSumUs = 0;
+    uint64_t cutsShortened = 0;         // Actual below requested (closed loop end)
+    uint64_t compared = 0;              // Log shifts with a recorded outcome
+    uint64_t outcomeChanged = 0;
+    uint64_t cutTimeChanged = 0;
+    uint64_t cutDeltaAbsSumUs = 0;
+    uint32_t cutDeltaAbsMaxUs = 0;
+    uint32_t droppedEvents = 0;
+};
+
+const char* outcomeToString(EventType type) {
+    switch (type) {
+        case EventType::SHIFT: return "shift";
+        case EventType::SHIFT_DEBOUNCED: return "debounced";
+        case EventType::SHIFT_BLOCKED: return "blocked";
+        default: return "none";
+    }
+}
+
+/**
+ * @brief Drives the engine through one continuous simulated timeline
+ */
+class Replay {
+public:
+    Replay(QuickShifterEngine& qsEngine, const Options& options)
+        : _qsEngine(qsEngine)
+        , _options(options)
+        , _decisions(nullptr)
+        , _sourceBase(START_US)
+        , _nextUpdate(START_US)
+        , _pendingCutUs(0)
+        , _lastShiftType(EventType::PULSE_ACCEPTED)
+        , _lastShiftCutUs(0)
+        , _lastShiftRpm(0)
+        , _shiftSeen(false)
+    {
+        _sensorValues = SensorValues();
+    }
+
+    bool begin() {
+        HostHal::setTime(START_US);
+        _qsEngine.begin(SPARK_CDI, QS_SW, _options.pickupMode);
+        _qsEngine.setConfig(_options.config);
+        _qsEngine.setSensorInput(&_sensors);
+        _sensors.write(_sensorValues);
+
+        if (_options.decisionsPath) {
+            _decisions = fopen(_options.decisionsPath, "w");
+            if (!_decisions) {
+                fprintf(stderr, "[Replay] Cannot write %s\n", _options.decisionsPath);
+                return false;
+            }
+            fprintf(_decisions, "time_us,rpm,outcome,cut_us,recorded_outcome,recorded_cut_us\n");
+        }
+        return true;
+    }
+
+    /**
+     * @brief Start the next source after the previous one
+     * @param gapUs Simulated time between the end of the last source and this one
+     */
+    void beginSource(uint64_t gapUs) {
+        _sourceBase = HostHal::now() + gapUs;
+        _references.clear();
+        _pending.clear();
+    }
+
+    void feed(const Input& input) {
+        const uint64_t at = _sourceBase + input.timeUs;
+        advanceTo(at > HostHal::now() ? at : HostHal::now());
+        _stats.inputs++;
+
+        switch (input.kind) {
+            case Input::Kind::PULSE:
+                _stats.pulses++;
+                HostHal::edge(SPARK_CDI, true);
+                HostHal::edge(SPARK_CDI, false);
+                drain();
+                break;
+
+            case Input::Kind::SHIFT:
+                _stats.shiftRequests++;
+                _shiftSeen = false;
+                HostHal::edge(QS_SW, true);
+                HostHal::edge(QS_SW, false);
+                drain();
+                compareDecision(input);
+                break;
+
+            case Input::Kind::THROTTLE:
+                _sensorValues.timestampUs = micros();
+                _sensorValues.tps = input.value;
+                _sensorValues.flags |= SensorValues::TPS_VALID;
+                _sensors.write(_sensorValues);
+                break;
+
+            case Input::Kind::REFERENCE:
+                addReference(at, input.value);
+                break;
+        }
+    }
+
+    /**
+     * @brief Run until the last cut has ended and the signal timed out
+     */
+    void finish() {
+        advanceTo(HostHal::now() + SOURCE_GAP_US);
+        _stats.droppedEvents = _qsEngine.getDroppedEvents();
+        if (_decisions) fclose(_decisions);
+        _decisions = nullptr;
+    }
+
+    uint64_t simulatedUs() const { return HostHal::now() - START_US; }
+    const Stats& stats() const { return _stats; }
+
+private:
+    struct PendingPulse {
+        uint64_t midUs;         // Middle of the measured interval
+        uint16_t rpm;
+    };
+
+    struct ReferencePoint {
+        uint64_t timeUs;
+        uint16_t rpm;
+    };
+
+    QuickShifterEngine& _qsEngine;
+    const Options& _options;
+    FILE* _decisions;
+
+    SensorSnapshot _sensors;
+    SensorValues _sensorValues;
+
+    uint64_t _sourceBase;
+    uint64_t _nextUpdate;
+
+    // Accepted pulses waiting for a reference point past their middle, and
+    // the recent reference points (a PCNT batch spans several)
+    std::vector<PendingPulse> _pending;
+    std::vector<ReferencePoint> _references;
+
+    uint32_t _pendingCutUs;         // Requested length of the running cut
+    EventType _lastShiftType;       // Outcome of the last shift edge
+    uint32_t _lastShiftCutUs;
+    uint16_t _lastShiftRpm;
+    bool _shiftSeen;
+
+    Stats _stats;
+
+    /**
+     * @brief Advance simulated time, running engine updates and cut alarms on the way
+     */
+    void advanceTo(uint64_t at) {
+        for (;;) {
+            uint64_t alarm;
+            const bool armed = HostHal::nextAlarm(alarm);
+            if (armed && alarm <= at && alarm <= _nextUpdate) {
+                HostHal::setTime(alarm);
+                HostHal::fireAlarm();
+                drain();
+            } else if (_nextUpdate <= at) {
+                HostHal::setTime(_nextUpdate);
+                _nextUpdate += UPDATE_PERIOD_US;
+                _qsEngine.update();
+                drain();
+            } else {
+                break;
+            }
+        }
+        HostHal::setTime(at);
+    }
+
+    void drain() {
+        QuickShifterEngine::Event event;
+        while (_qsEngine.popEvent(event)) {
+            _stats.engineEvents++;
+            onEvent(event);
+        }
+    }
+
+    void onEvent(const QuickShifterEngine::Event& event) {
+        switch (event.type) {
+            case EventType::PULSE_ACCEPTED: {
+                _stats.accepted++;
+                const uint32_t edges = _qsEngine.getIntervalsPerEvent();
+                const uint64_t span = static_cast<uint64_t>(event.cutTimeUs) * edges / 2;
+                const uint64_t now = HostHal::now();
+                _pending.push_back({now > span ? now - span : 0, event.rpm});
+                break;
+            }
+
+            case EventType::PULSE_REJECTED:
+                _stats.rejected++;
+                break;
+
+            case EventType::SHIFT:
+            case EventType::SHIFT_DEBOUNCED:
+            case EventType::SHIFT_BLOCKED:
+                if (event.type == EventType::SHIFT) _stats.shifts++;
+                if (event.type == EventType::SHIFT_DEBOUNCED) _stats.debounced++;
+                if (event.type == EventType::SHIFT_BLOCKED) _stats.blocked++;
+                _lastShiftType = event.type;
+                _lastShiftCutUs = event.type == EventType::SHIFT ? event.cutTimeUs : 0;
+                _lastShiftRpm = event.rpm;
+                _shiftSeen = true;
+                break;
+
+            case EventType::CUT_START:
+                _pendingCutUs = event.cutTimeUs;
+                break;
+
+            case EventType::CUT_END:
+                if (_pendingCutUs == 0) break;
+                _stats.cuts++;
+                _stats.cutRequestedSumUs += _pendingCutUs;
+                _stats.cutActualSumUs += event.cutTimeUs;
+                if (event.cutTimeUs < _pendingCutUs) _stats.cutsShortened++;
+                _pendingCutUs = 0;
+                break;
+        }
+    }
+
+    /**
+     * @brief Score the accepted pulses whose middle the reference now covers
+     *
+     * The reference is linear between points; pulses before the oldest
+     * point kept (or the first one of a source) are not scored.
+     */
+    void addReference(uint64_t at, uint16_t rpm) {
+        if (!_references.empty() && at <= _references.back().timeUs) return;
+        if (_references.size() == MAX_REFERENCES) _references.erase(_references.begin());
+        _references.push_back({at, rpm});
+
+        size_t kept = 0;
+        for (const PendingPulse& pulse : _pending) {
+            if (pulse.midUs > at) {
+                _pending[kept++] = pulse;
+                continue;
+            }
+            if (pulse.midUs < _references.front().timeUs) continue;
+
+            size_t i = _references.size() - 1;
+            while (i > 0 && _references[i - 1].timeUs > pulse.midUs) i--;
+            if (i == 0) continue;
+            const ReferencePoint& from = _references[i - 1];
+            const ReferencePoint& to = _references[i];
+            const int64_t span = static_cast<int64_t>(to.timeUs - from.timeUs);
+            const int64_t offset = static_cast<int64_t>(pulse.midUs - from.timeUs);
+            const int64_t expected = from.rpm + (static_cast<int64_t>(to.rpm) - from.rpm) * offset / span;
+            const uint32_t error = static_cast<uint32_t>(llabs(static_cast<int64_t>(pulse.rpm) - expected));
+            _stats.rpmSamples++;
+            _stats.rpmErrorSum += error;
+            if (error > _stats.rpmErrorMax) _stats.rpmErrorMax = error;
+        }
+        _pending.resize(kept);
+    }
+
+    void compareDecision(const Input& input) {
+        const EventType outcome = _shiftSeen ? _lastShiftType : EventType::PULSE_ACCEPTED;
+        const uint32_t cutUs = _shiftSeen ? _lastShiftCutUs : 0;
+
+        if (input.recorded) {
+            _stats.compared++;
+            if (outcome != input.recordedType) {
+                _stats.outcomeChanged++;
+            } else if (outcome == EventType::SHIFT && cutUs != input.value) {
+                const uint32_t delta = cutUs > input.value ? cutUs - input.value : input.value - cutUs;
+                _stats.cutTimeChanged++;
+                _stats.cutDeltaAbsSumUs += delta;
+                if (delta > _stats.cutDeltaAbsMaxUs) _stats.cutDeltaAbsMaxUs = delta;
+            }
+        }
+
+        if (_decisions) {
+            fprintf(_decisions, "%llu,%u,%s,%u,%s,%u\n",
+                    static_cast<unsigned long long>(HostHal::now() - START_US),
+                    _shiftSeen ? _lastShiftRpm : 0, outcomeToString(outcome), cutUs,
+                    input.recorded ? outcomeToString(input.recordedType) : "",
+                    input.recorded ? input.value : 0);
+        }
+    }
+};
+
+/**
+ * @brief Stream a CSV trace: <time_us>,<P|S|T|R>[,<value>] per line, # comments
+ */
+bool replayCsv(Replay& replay, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "[Replay] Cannot open %s\n", path);
+        return false;
+    }
+
+    replay.beginSource(SOURCE_GAP_US);
+    char line[128];
+    size_t lineNumber = 0;
+    uint64_t lastUs = 0;
+    size_t errors = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+
+        unsigned long long timeUs = 0;
+        char kind = 0;
+        unsigned long value = 0;
+        const int fields = sscanf(line, "%llu,%c,%lu", &timeUs, &kind, &value);
+        Input input = {};
+        input.timeUs = timeUs;
+        switch (fields >= 2 ? kind : 0) {
+            case 'P': input.kind = Input::Kind::PULSE; break;
+            case 'S': input.kind = Input::Kind::SHIFT; break;
+            case 'T': input.kind = Input::Kind::THROTTLE; break;
+            case 'R': input.kind = Input::Kind::REFERENCE; break;
+            default:
+                if (errors++ < 5) fprintf(stderr, "[Replay] %s:%zu: not a trace line\n", path, lineNumber);
+                continue;
+        }
+        if ((input.kind == Input::Kind::THROTTLE || input.kind == Input::Kind::REFERENCE) && fields < 3) {
+            if (errors++ < 5) fprintf(stderr, "[Replay] %s:%zu: missing value\n", path, lineNumber);
+            continue;
+        }
+        if (input.timeUs < lastUs) {
+            if (errors++ < 5) fprintf(stderr, "[Replay] %s:%zu: time goes backwards\n", path, lineNumber);
+            input.timeUs = lastUs;
+        }
+        lastUs = input.timeUs;
+        input.value = value;
+        replay.feed(input);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Synthesized pickup signal state: next tooth time (0 = signal off)
+ * and its wheel position
+ */
+struct PulseSynth {
+    double nextUs;
+    uint8_t position;
+};
+
+/**
+ * @brief Pickup edges for one sample interval, integrating the linearly
+ * interpolated RPM over the configured wheel (missing teeth left out)
+ */
+void synthesizePulses(std::vector<Input>& inputs, PulseSynth& synth, const QuickShifterEngine::Config& config,
+                      uint64_t t0, uint16_t rpm0, uint64_t t1, uint16_t rpm1) {
+    if (rpm0 < MIN_SYNTH_RPM || t1 <= t0) {
+        synth.nextUs = 0;
+        return;
+    }
+    if (synth.nextUs < t0) synth.nextUs = t0;
+    const uint8_t present = config.triggerTeeth - config.triggerMissing;
+    while (synth.nextUs < t1) {
+        if (synth.position < present) {
+            Input input = {};
+            input.timeUs = static_cast<uint64_t>(synth.nextUs);
+            input.kind = Input::Kind::PULSE;
+            inputs.push_back(input);
+        }
+        if (++synth.position >= config.triggerTeeth) synth.position = 0;
+
+        const double f = (synth.nextUs - t0) / static_cast<double>(t1 - t0);
+        const double rpm = rpm0 + (static_cast<double>(rpm1) - rpm0) * f;
+        synth.nextUs += 60000000.0 / ((rpm < MIN_SYNTH_RPM ? MIN_SYNTH_RPM : rpm) * config.triggerTeeth);
+    }
+}
+
+/**
+ * @brief Replay one SessionLogger file
+ *
+ * The log holds the decimated telemetry samples, not the pickup edges, so
+ * edges are synthesized from the sampled RPM (signal-active samples only,
+ * teeth of the configured trigger wheel).
+ * Sampled RPM is the reference, samples with a valid TPS feed the throttle
+ * and the recorded shift events become shift edges whose new outcome is
+ * compared with the recorded one.
+ */
+bool replayLog(Replay& replay, const char* path, const QuickShifterEngine::Config& config,
+               uint32_t& lastSessionId, uint32_t& lastDeviceUs) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "[Replay] Cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[SessionLogFormat::BLOCK_SIZE];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    using SessionLogFormat::ChunkHeader;
+    using SessionLogFormat::ChunkType;
+    using SessionLogFormat::FileHeader;
+
+    std::vector<TelemetryFrame::Sample> samples;
+    std::vector<QuickShifterEngine::Event> events;
+    FileHeader header = {};
+    bool haveHeader = false;
+
+    for (size_t block = 0; block < data.size(); block += SessionLogFormat::BLOCK_SIZE) {
+        const size_t end = min(data.size(), block + SessionLogFormat::BLOCK_SIZE);
+        size_t pos = block;
+        while (pos + sizeof(ChunkHeader) <= end) {
+            ChunkHeader chunk;
+            memcpy(&chunk, &data[pos], sizeof(chunk));
+            pos += sizeof(chunk);
+            if (chunk.type == static_cast<uint8_t>(ChunkType::PAD) || pos + chunk.size > end) break;
+
+            const uint8_t* payload = &data[pos];
+            pos += chunk.size;
+            switch (static_cast<ChunkType>(chunk.type)) {
+                case ChunkType::HEADER:
+                    if (chunk.size < sizeof(FileHeader)) break;
+                    memcpy(&header, payload, sizeof(header));
+                    haveHeader = header.magic == SessionLogFormat::FILE_MAGIC;
+                    break;
+                case ChunkType::SAMPLES:
+                    for (size_t i = 0; i < chunk.count && (i + 1) * sizeof(TelemetryFrame::Sample) <= chunk.size; i++) {
+                        TelemetryFrame::Sample sample;
+                        memcpy(&sample, payload + i * sizeof(sample), sizeof(sample));
+                        samples.push_back(sample);
+                    }
+                    break;
+                case ChunkType::EVENTS:
+                    for (size_t i = 0; i < chunk.count && (i + 1) * sizeof(QuickShifterEngine::Event) <= chunk.size; i++) {
+                        QuickShifterEngine::Event event;
+                        memcpy(&event, payload + i * sizeof(event), sizeof(event));
+                        events.push_back(event);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    if (!haveHeader || header.version != SessionLogFormat::FILE_VERSION) {
+        fprintf(stderr, "[Replay] %s: not a v%u session log\n", path, SessionLogFormat::FILE_VERSION);
+        return false;
+    }
+    if (samples.empty()) {
+        fprintf(stderr, "[Replay] %s: no samples\n", path);
+        return true;
+    }
+
+    // Device micros() relative to the earliest record (32-bit wrap safe)
+    uint32_t first = samples.front().timestampUs;
+    for (const auto& event : events) {
+        if (static_cast<int32_t>(event.timestampUs - first) < 0) first = event.timestampUs;
+    }
+    auto relative = [first](uint32_t timestampUs) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(timestampUs - first));
+    };
+
+    std::vector<Input> inputs;
+    inputs.reserve(samples.size() * 8 + events.size());
+    PulseSynth synth = {0, 0};
+    for (size_t i = 0; i < samples.size(); i++) {
+        const TelemetryFrame::Sample& sample = samples[i];
+        const uint64_t at = relative(sample.timestampUs);
+        const bool active = sample.flags & TelemetryFrame::FLAG_SIGNAL_ACTIVE;
+
+        Input input = {};
+        input.timeUs = at;
+        if (sample.flags & TelemetryFrame::FLAG_TPS_VALID) {
+            input.kind = Input::Kind::THROTTLE;
+            input.value = sample.tps;
+            inputs.push_back(input);
+        }
+        if (active) {
+            input.kind = Input::Kind::REFERENCE;
+            input.value = sample.rpm;
+            inputs.push_back(input);
+        }
+        if (i + 1 < samples.size() && active) {
+            synthesizePulses(inputs, synth, config, at, sample.rpm,
+                             relative(samples[i + 1].timestampUs), samples[i + 1].rpm);
+        } else {
+            synth.nextUs = 0;
+        }
+    }
+    for (const auto& event : events) {
+        if (event.type != EventType::SHIFT && event.type != EventType::SHIFT_DEBOUNCED &&
+            event.type != EventType::SHIFT_BLOCKED) continue;
+        Input input = {};
+        input.timeUs = relative(event.timestampUs);
+        input.kind = Input::Kind::SHIFT;
+        input.recorded = true;
+        input.recordedType = event.type;
+        input.value = event.type == EventType::SHIFT ? event.cutTimeUs : 0;
+        inputs.push_back(input);
+    }
+    std::stable_sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) {
+        return a.timeUs < b.timeUs;
+    });
+
+    // Files of one session continue the timeline, anything else starts after a gap
+    const uint32_t gap = first - lastDeviceUs;
+    const bool joined = lastSessionId != 0 && header.sessionId == lastSessionId && gap <= SESSION_JOIN_US;
+    replay.beginSource(joined ? gap : SOURCE_GAP_US);
+    for (const Input& input : inputs) {
+        replay.feed(input);
+    }
+
+    lastSessionId = header.sessionId;
+    lastDeviceUs = first + static_cast<uint32_t>(inputs.back().timeUs);
+    return true;
+}
+
+/**
+ * @brief Cut map from "rpm:us,rpm:us,..." (same time at every load)
+ */
+bool parseMap(const char* text, CutTimeMap::Table& table) {
+    CutTimeMap::getDefaultTable(table, QuickShifterEngine::DEFAULT_CUT_TIME_US);
+    size_t points = 0;
+    uint16_t rpm = 0;
+    uint32_t cutUs = 0;
+    const char* pos = text;
+    while (*pos && points < CutTimeMap::RPM_POINTS) {
+        unsigned int r;
+        unsigned long us;
+        int used = 0;
+        if (sscanf(pos, "%u:%lu%n", &r, &us, &used) != 2) return false;
+        rpm = r;
+        cutUs = us;
+        table.rpmAxis[points] = rpm;
+        for (auto& row : table.cutTimeUs) row[points] = cutUs;
+        points++;
+        pos += used;
+        if (*pos == ',') pos++;
+    }
+    if (points == 0 || *pos) return false;
+
+    // Pad the axis past the last point with its time
+    for (size_t i = points; i < CutTimeMap::RPM_POINTS; i++) {
+        table.rpmAxis[i] = rpm + (i - points + 1) * 500;
+        for (auto& row : table.cutTimeUs) row[i] = cutUs;
+    }
+    table.loadSource = CutTimeMap::LoadSource::NONE;
+    return CutTimeMap::isValid(table);
+}
+
+void usage() {
+    fprintf(stderr,
+        "Usage: replay [options] <trace.csv|log.bin>...\n"
+        "  --pickup gpio|pcnt     Pickup backend (default pcnt)\n"
+        "  --mode open|closed     Cut termination\n"
+        "  --drop N               Closed loop RPM drop, %%\n"
+        "  --min-percent N        Closed loop earliest end, %% of map time\n"
+        "  --debounce MS          Shift debounce\n"
+        "  --min-throttle N       Throttle gate, 0.1 %%\n"
+        "  --map RPM:US,...       Cut map (1D, up to %u points)\n"
+        "  --wheel TEETH-MISSING  Trigger wheel, e.g. 24-2 (default 1-0)\n"
+        "  --decisions FILE       Write every shift decision as CSV\n"
+        "  --verbose              Show the engine's serial output\n"
+        "  --quiet                Report only\n",
+        static_cast<unsigned>(CutTimeMap::RPM_POINTS));
+}
+
+void printReport(const Stats& stats, double simSeconds, double wallSeconds) {
+    printf("[Replay] Simulated %.1f s in %.3f s wall (%.0fx real time)\n",
+           simSeconds, wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0.0);
+    printf("[Replay] %llu inputs, %llu engine events (%.2f M events/s)\n",
+           static_cast<unsigned long long>(stats.inputs), static_cast<unsigned long long>(stats.engineEvents),
+           wallSeconds > 0 ? (stats.inputs + stats.engineEvents) / wallSeconds / 1e6 : 0.0);
+
+    const uint64_t judged = stats.accepted + stats.rejected;
+    printf("[Replay] Filter: %llu pulses, %llu accepted, %llu rejected (%.2f %%)\n",
+           static_cast<unsigned long long>(stats.pulses), static_cast<unsigned long long>(stats.accepted),
+           static_cast<unsigned long long>(stats.rejected), judged ? 100.0 * stats.rejected / judged : 0.0);
+    if (stats.rpmSamples > 0) {
+        printf("[Replay] RPM vs reference: mean error %.1f, max %u (%llu pulses)\n",
+               static_cast<double>(stats.rpmErrorSum) / stats.rpmSamples, stats.rpmErrorMax,
+               static_cast<unsigned long long>(stats.rpmSamples));
+    }
+
+    printf("[Replay] Shifts: %llu requests, %llu cut, %llu debounced, %llu blocked\n",
+           static_cast<unsigned long long>(stats.shiftRequests), static_cast<unsigned long long>(stats.shifts),
+           static_cast<unsigned long long>(stats.debounced), static_cast<unsigned long long>(stats.blocked));
+    if (stats.cuts > 0) {
+        printf("[Replay] Cuts: %llu, mean requested %.0f us, mean actual %.0f us, %llu ended early\n",
+               static_cast<unsigned long long>(stats.cuts),
+               static_cast<double>(stats.cutRequestedSumUs) / stats.cuts,
+               static_cast<double>(stats.cutActualSumUs) / stats.cuts,
+               static_cast<unsigned long long>(stats.cutsShortened));
+    }
+    if (stats.compared > 0) {
+        printf("[Replay] vs recorded: %llu shifts, %llu outcome changed, %llu cut time changed",
+               static_cast<unsigned long long>(stats.compared), static_cast<unsigned long long>(stats.outcomeChanged),
+               static_cast<unsigned long long>(stats.cutTimeChanged));
+        if (stats.cutTimeChanged > 0) {
+            printf(" (mean |delta| %.0f us, max %u us)",
+                   static_cast<double>(stats.cutDeltaAbsSumUs) / stats.cutTimeChanged, stats.cutDeltaAbsMaxUs);
+        }
+        printf("\n");
+    }
+    if (stats.droppedEvents > 0) {
+        printf("[Replay] Warning: %u engine events dropped\n", stats.droppedEvents);
+    }
+}
+
+bool endsWith(const char* text, const char* suffix) {
+    const size_t textLen = strlen(text);
+    const size_t suffixLen = strlen(suffix);
+    return textLen >= suffixLen && strcmp(text + textLen - suffixLen, suffix) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static QuickShifterEngine qsEngine;
+    Options options;
+    options.config = qsEngine.getConfig();
+    bool verbose = false;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        const bool hasValue = value != nullptr;
+
+        if (strcmp(arg, "--pickup") == 0 && hasValue) {
+            options.pickupMode = strcmp(value, "gpio") == 0 ? QuickShifterEngine::PickupMode::GPIO_ISR
+                                                            : QuickShifterEngine::PickupMode::PCNT_CAPTURE;
+            i++;
+        } else if (strcmp(arg, "--mode") == 0 && hasValue) {
+            options.config.cutMode = QuickShifterEngine::cutModeFromString(value);
+            i++;
+        } else if (strcmp(arg, "--drop") == 0 && hasValue) {
+            options.config.closedLoopDropPercent = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--min-percent") == 0 && hasValue) {
+            options.config.closedLoopMinPercent = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--debounce") == 0 && hasValue) {
+            options.config.debounceTimeMs = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--min-throttle") == 0 && hasValue) {
+            options.config.minThrottle = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--map") == 0 && hasValue) {
+            if (!parseMap(value, options.config.cutMap)) {
+                fprintf(stderr, "[Replay] Invalid map: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--wheel") == 0 && hasValue) {
+            unsigned int teeth = 0;
+            unsigned int missing = 0;
+            if (sscanf(value, "%u-%u", &teeth, &missing) != 2 || teeth == 0 || missing >= teeth) {
+                fprintf(stderr, "[Replay] Invalid wheel: %s\n", value);
+                return 2;
+            }
+            options.config.triggerTeeth = teeth;
+            options.config.triggerMissing = missing;
+            i++;
+        } else if (strcmp(arg, "--decisions") == 0 && hasValue) {
+            options.decisionsPath = value;
+            i++;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        } else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 2;
+    }
+
+    HostHal::setSerialEnabled(verbose);
+    Replay replay(qsEngine, options);
+    if (!replay.begin()) return 1;
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    uint32_t lastSessionId = 0;
+    uint32_t lastDeviceUs = 0;
+    bool ok = true;
+    for (const char* path : paths) {
+        if (!options.quiet) fprintf(stderr, "[Replay] %s\n", path);
+        ok &= endsWith(path, ".bin") ? replayLog(replay, path, options.config, lastSessionId, lastDeviceUs)
+                                     : replayCsv(replay, path);
+    }
+    replay.finish();
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printReport(replay.stats(), replay.simulatedUs() / 1e6, wallSeconds);
+    return ok ? 0 : 1;
+}
+#endif
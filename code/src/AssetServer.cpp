@@ -0,0 +1,121 @@
+#include "AssetServer.hpp"
+
+namespace {
+struct MimeEntry {
+    const char* extension;
+    const char* type;
+};
+
+constexpr MimeEntry MIME_TYPES[] = {
+    {".html", "text/html"},
+    {".js",   "application/javascript"},
+    {".css",  "text/css"},
+    {".json", "application/json"},
+    {".svg",  "image/svg+xml"},
+    {".png",  "image/png"},
+    {".jpg",  "image/jpeg"},
+    {".ico",  "image/x-icon"},
+    {".bin",  "application/octet-stream"},
+};
+
+constexpr const char* CACHE_IMMUTABLE = "public, max-age=31536000, immutable";
+constexpr const char* CACHE_REVALIDATE = "no-cache";
+}
+
+AssetServer::AssetServer()
+    : _assets{}
+    , _assetCount(0)
+{
+}
+
+bool AssetServer::begin() {
+    _assetCount = 0;
+
+    File file = LittleFS.open(MANIFEST_FILE, "r");
+    if (!file) {
+        Serial.println("[Assets] No asset manifest, serving files uncompressed");
+        return false;
+    }
+
+    StaticJsonDocument<2048> doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        Serial.printf("[Assets] Invalid manifest: %s\n", error.c_str());
+        return false;
+    }
+
+    for (JsonObject entry : doc["assets"].as<JsonArray>()) {
+        if (_assetCount >= MAX_ASSETS) {
+            Serial.println("[Assets] Too many assets, rest ignored");
+            break;
+        }
+
+        const char* url = entry["url"];
+        const char* path = entry["file"];
+        const char* etag = entry["etag"];
+        if (!url || !path || !etag) continue;
+
+        Asset& asset = _assets[_assetCount];
+        strlcpy(asset.url, url, sizeof(asset.url));
+        strlcpy(asset.file, path, sizeof(asset.file));
+        snprintf(asset.etag, sizeof(asset.etag), "\"%s\"", etag);
+        asset.mime = mimeType(url);
+        asset.immutable = entry["immutable"] | false;
+        _assetCount++;
+    }
+
+    Serial.printf("[Assets] %u compressed assets\n", _assetCount);
+    return _assetCount > 0;
+}
+
+bool AssetServer::handle(AsyncWebServerRequest* request) {
+    return handle(request, request->url().c_str());
+}
+
+bool AssetServer::handle(AsyncWebServerRequest* request, const char* url) {
+    const Asset* asset = find(url);
+    if (!asset) return false;
+
+    // Browser copy is current, nothing to send
+    if (request->hasHeader("If-None-Match") &&
+        request->header("If-None-Match").equals(asset->etag)) {
+        AsyncWebServerResponse* response = request->beginResponse(304);
+        response->addHeader("ETag", asset->etag);
+        response->addHeader("Cache-Control", asset->immutable ? CACHE_IMMUTABLE : CACHE_REVALIDATE);
+        request->send(response);
+        return true;
+    }
+
+    AsyncWebServerResponse* response = request->beginResponse(LittleFS, asset->file, asset->mime);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", asset->immutable ? CACHE_IMMUTABLE : CACHE_REVALIDATE);
+    request->send(response);
+    return true;
+}
+
+bool AssetServer::has(const char* url) const {
+    return find(url) != nullptr;
+}
+
+const AssetServer::Asset* AssetServer::find(const char* url) const {
+    for (size_t i = 0; i < _assetCount; i++) {
+        if (strcmp(_assets[i].url, url) == 0) {
+            return &_assets[i];
+        }
+    }
+    return nullptr;
+}
+
+const char* AssetServer::mimeType(const char* path) {
+    const char* extension = strrchr(path, '.');
+    if (extension) {
+        for (const MimeEntry& entry : MIME_TYPES) {
+            if (strcmp(extension, entry.extension) == 0) {
+                return entry.type;
+            }
+        }
+    }
+    return "text/plain";
+}
@@ -0,0 +1,85 @@
+#include "BootProfile.hpp"
+#include <esp_timer.h>
+
+BootProfile::BootProfile()
+    : _stageUs{}
+    , _resetReason(ESP_RST_UNKNOWN)
+    , _configSource(ConfigSource::DEFAULTS)
+{
+}
+
+void BootProfile::begin() {
+    _resetReason = esp_reset_reason();
+    mark(Stage::SETUP);
+    Serial.printf("[Boot] Reset reason: %s\n", resetReasonToString(_resetReason));
+}
+
+void BootProfile::mark(Stage stage) {
+    const uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+    _stageUs[static_cast<size_t>(stage)] = now ? now : 1;  // 0 means not reached
+    Serial.printf("[Boot] %-12s %lu.%03lu ms\n", stageToString(stage),
+                  static_cast<unsigned long>(now / 1000), static_cast<unsigned long>(now % 1000));
+}
+
+bool BootProfile::isWarmReset() const {
+    switch (_resetReason) {
+        case ESP_RST_SW:
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+        case ESP_RST_DEEPSLEEP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void BootProfile::toJson(JsonObject out) const {
+    out["resetReason"] = resetReasonToString(_resetReason);
+    out["warm"] = isWarmReset();
+    out["configSource"] = configSourceToString(_configSource);
+
+    JsonObject stages = out.createNestedObject("stagesUs");
+    for (size_t i = 0; i < _stageUs.size(); i++) {
+        const uint32_t us = _stageUs[i];
+        if (us) stages[stageToString(static_cast<Stage>(i))] = us;
+    }
+}
+
+const char* BootProfile::stageToString(Stage stage) {
+    switch (stage) {
+        case Stage::SETUP: return "setup";
+        case Stage::ENGINE_ARMED: return "engineArmed";
+        case Stage::CONFIG: return "config";
+        case Stage::FILESYSTEM: return "filesystem";
+        case Stage::NETWORK: return "network";
+        default: return "unknown";
+    }
+}
+
+const char* BootProfile::configSourceToString(ConfigSource source) {
+    switch (source) {
+        case ConfigSource::DEFAULTS: return "defaults";
+        case ConfigSource::STORED: return "nvs";
+        case ConfigSource::RECOVERY: return "rtc";
+        default: return "unknown";
+    }
+}
+
+const char* BootProfile::resetReasonToString(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON: return "powerOn";
+        case ESP_RST_EXT: return "external";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "interruptWatchdog";
+        case ESP_RST_TASK_WDT: return "taskWatchdog";
+        case ESP_RST_WDT: return "watchdog";
+        case ESP_RST_DEEPSLEEP: return "deepSleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        case ESP_RST_SDIO: return "sdio";
+        default: return "unknown";
+    }
+}
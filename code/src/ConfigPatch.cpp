@@ -0,0 +1,433 @@
+#include "ConfigPatch.hpp"
+#include "TelemetrySampler.hpp"
+#include <stddef.h>
+
+#define CONFIG_OFFSET(member) static_cast<uint16_t>(offsetof(StorageHandler::SystemConfig, member))
+
+namespace {
+
+using Section = uint8_t;
+constexpr Section QS = StorageHandler::DIRTY_QS;
+constexpr Section NETWORK = StorageHandler::DIRTY_NETWORK;
+constexpr Section TELEMETRY = StorageHandler::DIRTY_TELEMETRY;
+constexpr Section SENSORS = StorageHandler::DIRTY_SENSORS;
+
+// Enum value names in declaration order, matching the *ToString() helpers
+const char* const CUT_MODES[] = {"open", "closed", nullptr};
+const char* const SHIFT_SENSORS[] = {"switch", "force", nullptr};
+const char* const LOAD_SOURCES[] = {"none", "tps", nullptr};
+
+constexpr uint8_t RPM_POINTS = CutTimeMap::RPM_POINTS;
+constexpr uint8_t LOAD_POINTS = CutTimeMap::LOAD_POINTS;
+constexpr uint16_t MAX_ADC_MV = 3300;
+constexpr uint16_t MAX_ADC_COUNTS = 4095;
+
+static_assert(sizeof(CutTimeMap::Table::cutTimeUs) == RPM_POINTS * LOAD_POINTS * sizeof(uint32_t),
+              "Cut map cells are addressed as one flat array");
+static_assert(sizeof(QuickShifterEngine::CutMode) == 1 && sizeof(QuickShifterEngine::ShiftSensorMode) == 1 &&
+              sizeof(CutTimeMap::LoadSource) == 1, "ENUM fields are stored as uint8_t");
+
+}  // namespace
+
+const ConfigPatch::Field ConfigPatch::FIELDS[] = {
+    // path, section, type, offset, rows, cols, scale, min, max, names, flags
+    {"qs.minRpm", QS, Type::U16, CONFIG_OFFSET(qsConfig.minRpmThreshold), 1, 1, 1, 0, CutTimeMap::LUT_RPM_MAX, nullptr, 0},
+    {"qs.debounce", QS, Type::U16, CONFIG_OFFSET(qsConfig.debounceTimeMs), 1, 1, 1, 0, 1000, nullptr, 0},
+    {"qs.cutMode", QS, Type::ENUM, CONFIG_OFFSET(qsConfig.cutMode), 1, 1, 1, 0, 0, CUT_MODES, 0},
+    {"qs.minCutPercent", QS, Type::U8, CONFIG_OFFSET(qsConfig.closedLoopMinPercent), 1, 1, 1, 0, 100, nullptr, 0},
+    {"qs.dropPercent", QS, Type::U8, CONFIG_OFFSET(qsConfig.closedLoopDropPercent), 1, 1, 1,
+        1, QuickShifterEngine::MAX_CLOSED_LOOP_DROP_PERCENT, nullptr, 0},
+    {"qs.skipSparks", QS, Type::U8, CONFIG_OFFSET(qsConfig.skipSparks), 1, 1, 1, 1, QuickShifterEngine::MAX_SKIP_CYCLE, nullptr, 0},
+    {"qs.skipCycle", QS, Type::U8, CONFIG_OFFSET(qsConfig.skipCycle), 1, 1, 1, 0, QuickShifterEngine::MAX_SKIP_CYCLE, nullptr, 0},
+    {"qs.shiftSensor", QS, Type::ENUM, CONFIG_OFFSET(qsConfig.shiftSensorMode), 1, 1, 1, 0, 0, SHIFT_SENSORS, 0},
+    {"qs.forceThreshold", QS, Type::U16, CONFIG_OFFSET(qsConfig.forceThreshold), 1, 1, 1, 1, MAX_ADC_COUNTS, nullptr, 0},
+    {"qs.forceHysteresis", QS, Type::U16, CONFIG_OFFSET(qsConfig.forceHysteresis), 1, 1, 1, 0, MAX_ADC_COUNTS - 1, nullptr, 0},
+    {"qs.minThrottle", QS, Type::U16, CONFIG_OFFSET(qsConfig.minThrottle), 1, 1, 10, 0, 1000, nullptr, 0},
+    {"qs.triggerTeeth", QS, Type::U8, CONFIG_OFFSET(qsConfig.triggerTeeth), 1, 1, 1, 1, TriggerWheel::MAX_TEETH, nullptr, 0},
+    {"qs.triggerMissing", QS, Type::U8, CONFIG_OFFSET(qsConfig.triggerMissing), 1, 1, 1, 0, TriggerWheel::MAX_MISSING, nullptr, 0},
+    {"qs.cutMap.loadSource", QS, Type::ENUM, CONFIG_OFFSET(qsConfig.cutMap.loadSource), 1, 1, 1, 0, 0, LOAD_SOURCES, 0},
+    {"qs.cutMap.rpmAxis", QS, Type::U16, CONFIG_OFFSET(qsConfig.cutMap.rpmAxis), 1, RPM_POINTS, 1,
+        0, CutTimeMap::LUT_RPM_MAX, nullptr, 0},
+    {"qs.cutMap.loadAxis", QS, Type::U16, CONFIG_OFFSET(qsConfig.cutMap.loadAxis), 1, LOAD_POINTS, 1, 0, 1000, nullptr, 0},
+    {"qs.cutMap.cutTimeUs", QS, Type::U32, CONFIG_OFFSET(qsConfig.cutMap.cutTimeUs), LOAD_POINTS, RPM_POINTS, 1,
+        QuickShifterEngine::MIN_CUT_TIME_US, QuickShifterEngine::MAX_CUT_TIME_US, nullptr, 0},
+    {"qs.cutTimeMap", QS, Type::U32, CONFIG_OFFSET(qsConfig.cutMap.cutTimeUs), LOAD_POINTS, RPM_POINTS, 1000,
+        QuickShifterEngine::MIN_CUT_TIME_US, QuickShifterEngine::MAX_CUT_TIME_US, nullptr, ALL_ROWS},
+
+    // Network settings apply on the next reboot
+    {"network.apSsid", NETWORK, Type::TEXT, CONFIG_OFFSET(networkConfig.apSsid), 1, 1, 1,
+        1, sizeof(StorageHandler::NetworkConfig::apSsid), nullptr, 0},
+    {"network.apPassword", NETWORK, Type::TEXT, CONFIG_OFFSET(networkConfig.apPassword), 1, 1, 1,
+        0, sizeof(StorageHandler::NetworkConfig::apPassword), nullptr, WRITE_ONLY},
+    {"network.staSsid", NETWORK, Type::TEXT, CONFIG_OFFSET(networkConfig.staSsid), 1, 1, 1,
+        0, sizeof(StorageHandler::NetworkConfig::staSsid), nullptr, 0},
+    {"network.staPassword", NETWORK, Type::TEXT, CONFIG_OFFSET(networkConfig.staPassword), 1, 1, 1,
+        0, sizeof(StorageHandler::NetworkConfig::staPassword), nullptr, WRITE_ONLY},
+    {"network.staMode", NETWORK, Type::BOOL, CONFIG_OFFSET(networkConfig.staMode), 1, 1, 1, 0, 1, nullptr, 0},
+    {"network.lastError", NETWORK, Type::TEXT, CONFIG_OFFSET(networkConfig.lastError), 1, 1, 1,
+        0, sizeof(StorageHandler::NetworkConfig::lastError), nullptr, READ_ONLY},
+
+    {"telemetry.updateRate", TELEMETRY, Type::U16, CONFIG_OFFSET(telemetryConfig.updateRateMs), 1, 1, 1, 10, 5000, nullptr, 0},
+    {"telemetry.sampleRate", TELEMETRY, Type::U16, CONFIG_OFFSET(telemetryConfig.sampleRateHz), 1, 1, 1,
+        1, TelemetrySampler::MAX_SAMPLE_RATE_HZ, nullptr, 0},
+
+    {"sensors.tpsEnabled", SENSORS, Type::BOOL, CONFIG_OFFSET(sensorConfig.tpsEnabled), 1, 1, 1, 0, 1, nullptr, 0},
+    {"sensors.mapEnabled", SENSORS, Type::BOOL, CONFIG_OFFSET(sensorConfig.mapEnabled), 1, 1, 1, 0, 1, nullptr, 0},
+    {"sensors.tpsClosedMv", SENSORS, Type::U16, CONFIG_OFFSET(sensorConfig.tpsClosedMv), 1, 1, 1, 0, MAX_ADC_MV, nullptr, 0},
+    {"sensors.tpsOpenMv", SENSORS, Type::U16, CONFIG_OFFSET(sensorConfig.tpsOpenMv), 1, 1, 1, 0, MAX_ADC_MV, nullptr, 0},
+    {"sensors.mapLowMv", SENSORS, Type::U16, CONFIG_OFFSET(sensorConfig.mapLowMv), 1, 1, 1, 0, MAX_ADC_MV, nullptr, 0},
+    {"sensors.mapHighMv", SENSORS, Type::U16, CONFIG_OFFSET(sensorConfig.mapHighMv), 1, 1, 1, 0, MAX_ADC_MV, nullptr, 0},
+    {"sensors.mapLowKpa", SENSORS, Type::U16, CONFIG_OFFSET(sensorConfig.mapLowKpa), 1, 1, 10, 0, 6000, nullptr, 0},
+    {"sensors.mapHighKpa", SENSORS, Type::U16, CONFIG_OFFSET(sensorConfig.mapHighKpa), 1, 1, 10, 0, 6000, nullptr, 0},
+};
+
+const size_t ConfigPatch::FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+void ConfigPatch::makeFilter(JsonDocument& filter) {
+    filter["patch"] = true;
+    filter["id"] = true;
+}
+
+bool ConfigPatch::apply(JsonObjectConst patch, StorageHandler::SystemConfig& config,
+                        uint8_t& sections, JsonObject errors) {
+    sections = 0;
+    if (patch.isNull()) {
+        errors["patch"] = "expected an object";
+        return false;
+    }
+
+    // Edits land on a copy, config only changes if every entry is valid
+    StorageHandler::SystemConfig next = config;
+    uint8_t touched = 0;
+    bool valid = true;
+
+    for (JsonPairConst entry : patch) {
+        const char* path = entry.key().c_str();
+        size_t element = 0;
+        const char* reason = nullptr;
+        const Field* field = resolve(path, element, reason);
+        if (field) {
+            reason = setValue(*field, element, entry.value(), next);
+        }
+        if (reason) {
+            errors[path] = reason;
+            valid = false;
+            continue;
+        }
+        touched |= field->section;
+    }
+    if (!valid) return false;
+
+    const char* path = nullptr;
+    const char* reason = checkConsistency(next, touched, path);
+    if (reason) {
+        errors[path] = reason;
+        return false;
+    }
+
+    config = next;
+    sections = touched;
+    return true;
+}
+
+size_t ConfigPatch::diff(const StorageHandler::SystemConfig& before, const StorageHandler::SystemConfig& after,
+                         uint8_t sections, JsonObject changed) {
+    size_t count = 0;
+    char key[MAX_PATH];
+
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const Field& field = FIELDS[i];
+        if (!(field.section & sections) || (field.flags & ALL_ROWS)) continue;
+
+        const size_t elements = field.type == Type::TEXT ? 1 : field.rows * field.cols;
+        for (size_t element = 0; element < elements; element++) {
+            if (sameElement(field, before, after, element)) continue;
+            if (++count > MAX_CHANGED) continue;
+
+            formatPath(field, element, key, sizeof(key));
+            if (field.flags & WRITE_ONLY) {
+                changed[key] = nullptr;     // Changed, value withheld
+            } else {
+                writeValue(field, after, element, changed[key].to<JsonVariant>());
+            }
+        }
+    }
+    return count;
+}
+
+size_t ConfigPatch::query(const StorageHandler::SystemConfig& config, const char* path, JsonObject out) {
+    if (!path) return 0;
+
+    // One cell
+    if (strchr(path, '[')) {
+        size_t element = 0;
+        const char* reason = nullptr;
+        const Field* field = resolve(path, element, reason);
+        if (!field || (field->flags & (WRITE_ONLY | ALL_ROWS))) return 0;
+
+        char key[MAX_PATH];
+        formatPath(*field, element, key, sizeof(key));
+        writeValue(*field, config, element, out[key].to<JsonVariant>());
+        return 1;
+    }
+
+    // Every field under a prefix ("" for all), arrays whole
+    const size_t len = strlen(path);
+    size_t count = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const Field& field = FIELDS[i];
+        if (field.flags & (WRITE_ONLY | ALL_ROWS)) continue;
+        if (len && (strncmp(field.path, path, len) != 0 || (field.path[len] != '\0' && field.path[len] != '.'))) {
+            continue;
+        }
+
+        if (field.type == Type::TEXT || (field.rows == 1 && field.cols == 1)) {
+            writeValue(field, config, 0, out[field.path].to<JsonVariant>());
+        } else if (field.rows == 1) {
+            JsonArray values = out.createNestedArray(field.path);
+            for (size_t x = 0; x < field.cols; x++) {
+                writeValue(field, config, x, values.add<JsonVariant>());
+            }
+        } else {
+            JsonArray rows = out.createNestedArray(field.path);
+            for (size_t y = 0; y < field.rows; y++) {
+                JsonArray values = rows.createNestedArray();
+                for (size_t x = 0; x < field.cols; x++) {
+                    writeValue(field, config, y * field.cols + x, values.add<JsonVariant>());
+                }
+            }
+        }
+        count++;
+    }
+    return count;
+}
+
+const ConfigPatch::Field* ConfigPatch::resolve(const char* path, size_t& element, const char*& reason) {
+    const char* bracket = strchr(path, '[');
+    const size_t nameLen = bracket ? static_cast<size_t>(bracket - path) : strlen(path);
+
+    const Field* field = nullptr;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (strncmp(FIELDS[i].path, path, nameLen) == 0 && FIELDS[i].path[nameLen] == '\0') {
+            field = &FIELDS[i];
+            break;
+        }
+    }
+    if (!field) {
+        reason = "unknown field";
+        return nullptr;
+    }
+
+    // [x] for 1D fields and the all-rows alias, [y][x] for 2D ones
+    const size_t needed = field->type == Type::TEXT ? 0
+                        : (field->rows > 1 && !(field->flags & ALL_ROWS)) ? 2
+                        : field->cols > 1 ? 1 : 0;
+    uint32_t index[2] = {0, 0};
+    size_t found = 0;
+    const char* p = bracket;
+    while (p && *p == '[' && found < 2) {
+        char* end = nullptr;
+        index[found++] = strtoul(p + 1, &end, 10);
+        if (end == p + 1 || *end != ']') {
+            reason = "invalid index";
+            return nullptr;
+        }
+        p = end + 1;
+    }
+    if (p && *p != '\0') {
+        reason = "invalid index";
+        return nullptr;
+    }
+    if (found != needed) {
+        reason = needed ? "index required" : "not an array";
+        return nullptr;
+    }
+
+    const uint32_t row = needed == 2 ? index[0] : 0;
+    const uint32_t col = needed == 2 ? index[1] : index[0];
+    const uint32_t rows = (field->flags & ALL_ROWS) ? 1 : field->rows;
+    if (row >= rows || col >= field->cols) {
+        reason = "index out of range";
+        return nullptr;
+    }
+
+    element = row * field->cols + col;
+    return field;
+}
+
+uint32_t ConfigPatch::readElement(const Field& field, const StorageHandler::SystemConfig& config, size_t element) {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&config) + field.offset;
+    switch (field.type) {
+        case Type::U16: {
+            uint16_t value;
+            memcpy(&value, base + element * sizeof(value), sizeof(value));
+            return value;
+        }
+        case Type::U32: {
+            uint32_t value;
+            memcpy(&value, base + element * sizeof(value), sizeof(value));
+            return value;
+        }
+        case Type::TEXT:
+            return 0;
+        default:
+            return base[element];
+    }
+}
+
+void ConfigPatch::writeElement(const Field& field, StorageHandler::SystemConfig& config, size_t element, uint32_t value) {
+    uint8_t* base = reinterpret_cast<uint8_t*>(&config) + field.offset;
+    switch (field.type) {
+        case Type::U16: {
+            const uint16_t stored = static_cast<uint16_t>(value);
+            memcpy(base + element * sizeof(stored), &stored, sizeof(stored));
+            break;
+        }
+        case Type::U32:
+            memcpy(base + element * sizeof(value), &value, sizeof(value));
+            break;
+        case Type::TEXT:
+            break;
+        case Type::BOOL:
+            base[element] = value ? 1 : 0;
+            break;
+        default:
+            base[element] = static_cast<uint8_t>(value);
+            break;
+    }
+}
+
+const char* ConfigPatch::setValue(const Field& field, size_t element, JsonVariantConst value,
+                                  StorageHandler::SystemConfig& config) {
+    if (field.flags & READ_ONLY) return "read-only";
+
+    uint32_t stored = 0;
+    switch (field.type) {
+        case Type::BOOL:
+            if (!value.is<bool>()) return "expected a boolean";
+            stored = value.as<bool>() ? 1 : 0;
+            break;
+
+        case Type::ENUM: {
+            const char* name = value.as<const char*>();
+            if (!name) return "expected a string";
+            size_t index = 0;
+            while (field.names[index] && strcmp(field.names[index], name) != 0) index++;
+            if (!field.names[index]) return "unknown value";
+            stored = index;
+            break;
+        }
+
+        case Type::TEXT: {
+            const char* text = value.as<const char*>();
+            if (!text) return "expected a string";
+            const size_t len = strlen(text);
+            if (len >= field.max) return "too long";
+            if (len < field.min) return "too short";
+            strlcpy(reinterpret_cast<char*>(&config) + field.offset, text, field.max);
+            return nullptr;
+        }
+
+        default: {
+            if (value.is<bool>() || !value.is<float>()) return "expected a number";
+            if (field.scale == 1 && value.is<uint32_t>()) {
+                stored = value.as<uint32_t>();
+            } else {
+                const float scaled = value.as<float>() * field.scale;
+                if (scaled < 0.0f || scaled > field.max + 0.5f) return "out of range";
+                stored = lroundf(scaled);
+            }
+            if (stored < field.min || stored > field.max) return "out of range";
+            break;
+        }
+    }
+
+    if (field.flags & ALL_ROWS) {
+        for (size_t row = 0; row < field.rows; row++) {
+            writeElement(field, config, row * field.cols + element, stored);
+        }
+    } else {
+        writeElement(field, config, element, stored);
+    }
+    return nullptr;
+}
+
+const char* ConfigPatch::checkConsistency(const StorageHandler::SystemConfig& config, uint8_t sections,
+                                          const char*& path) {
+    if (!(sections & QS)) return nullptr;
+
+    // The rules the engine would otherwise resolve by clamping or keeping the old map
+    const QuickShifterEngine::Config& qs = config.qsConfig;
+    if (!CutTimeMap::isValid(qs.cutMap)) {
+        path = "qs.cutMap";
+        return "axes must be strictly ascending";
+    }
+    if (qs.forceHysteresis >= qs.forceThreshold) {
+        path = "qs.forceHysteresis";
+        return "must be below forceThreshold";
+    }
+    if (qs.skipCycle > 0 && qs.skipSparks > qs.skipCycle) {
+        path = "qs.skipSparks";
+        return "must not exceed skipCycle";
+    }
+    if (qs.triggerMissing >= qs.triggerTeeth) {
+        path = "qs.triggerMissing";
+        return "must be below triggerTeeth";
+    }
+    return nullptr;
+}
+
+void ConfigPatch::writeValue(const Field& field, const StorageHandler::SystemConfig& config, size_t element,
+                             JsonVariant out) {
+    switch (field.type) {
+        case Type::BOOL:
+            out.set(readElement(field, config, element) != 0);
+            break;
+
+        case Type::ENUM: {
+            // Unknown stored values show as the first (default) name
+            const uint32_t index = readElement(field, config, element);
+            size_t count = 0;
+            while (field.names[count]) count++;
+            out.set(field.names[index < count ? index : 0]);
+            break;
+        }
+
+        case Type::TEXT: {
+            char text[128];
+            strlcpy(text, reinterpret_cast<const char*>(&config) + field.offset, min<size_t>(sizeof(text), field.max));
+            out.set(static_cast<char*>(text));     // Copied into the document
+            break;
+        }
+
+        default: {
+            const uint32_t value = readElement(field, config, element);
+            if (field.scale == 1) {
+                out.set(value);
+            } else {
+                out.set(static_cast<float>(value) / field.scale);
+            }
+            break;
+        }
+    }
+}
+
+void ConfigPatch::formatPath(const Field& field, size_t element, char* buffer, size_t size) {
+    if (field.type == Type::TEXT || (field.rows == 1 && field.cols == 1)) {
+        strlcpy(buffer, field.path, size);
+    } else if (field.rows == 1) {
+        snprintf(buffer, size, "%s[%u]", field.path, static_cast<unsigned>(element));
+    } else {
+        snprintf(buffer, size, "%s[%u][%u]", field.path,
+                 static_cast<unsigned>(element / field.cols), static_cast<unsigned>(element % field.cols));
+    }
+}
+
+bool ConfigPatch::sameElement(const Field& field, const StorageHandler::SystemConfig& a,
+                              const StorageHandler::SystemConfig& b, size_t element) {
+    if (field.type == Type::TEXT) {
+        return strncmp(reinterpret_cast<const char*>(&a) + field.offset,
+                       reinterpret_cast<const char*>(&b) + field.offset, field.max) == 0;
+    }
+    return readElement(field, a, element) == readElement(field, b, element);
+}
@@ -0,0 +1,152 @@
+#include "CutTimeMap.hpp"
+
+namespace {
+// Find lower breakpoint index and fraction for value on an ascending axis (clamped)
+template <size_t N>
+void locate(const std::array<uint16_t, N>& axis, float value, size_t& index, float& fraction) {
+    if (value <= axis[0]) {
+        index = 0;
+        fraction = 0.0f;
+        return;
+    }
+    if (value >= axis[N - 1]) {
+        index = N - 2;
+        fraction = 1.0f;
+        return;
+    }
+    index = 0;
+    while (index < N - 2 && value >= axis[index + 1]) {
+        index++;
+    }
+    fraction = (value - axis[index]) / float(axis[index + 1] - axis[index]);
+}
+}
+
+CutTimeMap::CutTimeMap()
+    : _loadMin(0)
+    , _loadRange(0)
+    , _loadScale(0)
+{
+    for (auto& row : _lut) {
+        for (auto& cell : row) {
+            cell.baseUs = 0;
+            cell.slope = 0;
+        }
+    }
+}
+
+void CutTimeMap::getDefaultTable(Table& table, uint32_t cutTimeUs) {
+    table.loadSource = LoadSource::NONE;
+
+    // 5k-15k RPM in 1k steps
+    for (size_t i = 0; i < RPM_POINTS; i++) {
+        table.rpmAxis[i] = 5000 + i * 1000;
+    }
+
+    // 0-100% throttle in 20% steps
+    for (size_t i = 0; i < LOAD_POINTS; i++) {
+        table.loadAxis[i] = i * 200;
+    }
+
+    for (auto& row : table.cutTimeUs) {
+        for (auto& cutTime : row) {
+            cutTime = cutTimeUs;
+        }
+    }
+}
+
+bool CutTimeMap::isValid(const Table& table) {
+    for (size_t i = 1; i < RPM_POINTS; i++) {
+        if (table.rpmAxis[i] <= table.rpmAxis[i - 1]) return false;
+    }
+    for (size_t i = 1; i < LOAD_POINTS; i++) {
+        if (table.loadAxis[i] <= table.loadAxis[i - 1]) return false;
+    }
+    return true;
+}
+
+float CutTimeMap::interpolate(const Table& table, float rpm, float load) {
+    size_t x, y;
+    float fx, fy;
+    locate(table.rpmAxis, rpm, x, fx);
+
+    if (table.loadSource == LoadSource::NONE) {
+        y = 0;
+        fy = 0.0f;
+    } else {
+        locate(table.loadAxis, load, y, fy);
+    }
+
+    const float c00 = table.cutTimeUs[y][x];
+    const float c01 = table.cutTimeUs[y][x + 1];
+    const float c10 = table.cutTimeUs[y + 1][x];
+    const float c11 = table.cutTimeUs[y + 1][x + 1];
+
+    const float low = c00 + (c01 - c00) * fx;
+    const float high = c10 + (c11 - c10) * fx;
+    return low + (high - low) * fy;
+}
+
+const char* CutTimeMap::loadSourceToString(LoadSource source) {
+    switch (source) {
+        case LoadSource::THROTTLE: return "tps";
+        case LoadSource::NONE:
+        default:                   return "none";
+    }
+}
+
+CutTimeMap::LoadSource CutTimeMap::loadSourceFromString(const char* str) {
+    if (!str) return LoadSource::NONE;
+    if (strcmp(str, "tps") == 0) return LoadSource::THROTTLE;
+    return LoadSource::NONE;
+}
+
+bool CutTimeMap::compile(const Table& table) {
+    if (!isValid(table)) {
+        return false;
+    }
+
+    const bool singleRow = (table.loadSource == LoadSource::NONE);
+    const uint16_t loadMin = table.loadAxis[0];
+    const uint16_t loadRange = table.loadAxis[LOAD_POINTS - 1] - loadMin;
+
+    for (size_t row = 0; row < LUT_LOAD_ROWS; row++) {
+        const float load = singleRow ? loadMin
+                                     : loadMin + (float(loadRange) * row) / (LUT_LOAD_ROWS - 1);
+
+        float next = interpolate(table, 0.0f, load);
+        for (size_t col = 0; col < LUT_RPM_COLS; col++) {
+            const float current = next;
+            next = (col + 1 < LUT_RPM_COLS)
+                 ? interpolate(table, float((col + 1) * LUT_RPM_STEP), load)
+                 : current;  // Flat beyond LUT_RPM_MAX
+
+            Cell& cell = _lut[row][col];
+            cell.baseUs = uint32_t(current + 0.5f);
+            cell.slope = int32_t(((next - current) * (1 << LUT_SLOPE_SHIFT)) / LUT_RPM_STEP);
+        }
+    }
+
+    _loadMin = loadMin;
+    _loadRange = loadRange;
+    _loadScale = singleRow ? 0 : ((uint32_t(LUT_LOAD_ROWS - 1) << 16) / loadRange);
+    return true;
+}
+
+uint32_t IRAM_ATTR CutTimeMap::lookup(uint16_t rpm, uint16_t load) const {
+    if (rpm > LUT_RPM_MAX) rpm = LUT_RPM_MAX;
+
+    // Nearest load row (rows are dense enough to hide the rounding)
+    uint32_t row = 0;
+    if (_loadScale) {
+        uint32_t offset = (load > _loadMin) ? (load - _loadMin) : 0;
+        if (offset > _loadRange) offset = _loadRange;
+        row = (offset * _loadScale + 0x8000) >> 16;
+    }
+
+    const uint32_t col = rpm / LUT_RPM_STEP;
+    const int32_t remainder = rpm - col * LUT_RPM_STEP;
+
+    const Cell& cell = _lut[row][col];
+    return cell.baseUs + ((cell.slope * remainder) >> LUT_SLOPE_SHIFT);
+}
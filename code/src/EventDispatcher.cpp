@@ -0,0 +1,105 @@
+#include "EventDispatcher.hpp"
+
+EventDispatcher::EventDispatcher(QuickShifterEngine& qsEngine)
+    : _qsEngine(qsEngine)
+    , _sinkCount(0)
+    , _serialEnabled(true)
+    , _serialPulses(false)
+    , _reportedDropped(0)
+{
+}
+
+bool EventDispatcher::addSink(Sink sink, void* context) {
+    if (!sink || _sinkCount >= MAX_SINKS) {
+        return false;
+    }
+
+    _sinks[_sinkCount].sink = sink;
+    _sinks[_sinkCount].context = context;
+    _sinkCount++;
+    return true;
+}
+
+void EventDispatcher::setSerialOutput(bool enabled, bool includePulses) {
+    _serialEnabled = enabled;
+    _serialPulses = includePulses;
+}
+
+void EventDispatcher::drainTask(void* context) {
+    static_cast<EventDispatcher*>(context)->drain();
+}
+
+void EventDispatcher::drain() {
+    QuickShifterEngine::Event event;
+
+    while (_qsEngine.popEvent(event)) {
+        if (_serialEnabled) {
+            printEvent(event);
+        }
+
+        for (size_t i = 0; i < _sinkCount; i++) {
+            _sinks[i].sink(event, _sinks[i].context);
+        }
+    }
+
+    // Report overflow once per burst
+    uint32_t dropped = _qsEngine.getDroppedEvents();
+    if (dropped != _reportedDropped) {
+        Serial.printf("[QS] Event ring overflow: %u events dropped\n", dropped - _reportedDropped);
+        _reportedDropped = dropped;
+    }
+}
+
+void EventDispatcher::printEvent(const QuickShifterEngine::Event& event) {
+    using EventType = QuickShifterEngine::EventType;
+
+    switch (event.type) {
+        case EventType::PULSE_ACCEPTED:
+        case EventType::PULSE_REJECTED:
+            if (_serialPulses) {
+                Serial.printf("[QS] %10u %s | RPM: %u | Interval: %uus\n",
+                              event.timestampUs, eventTypeToString(event.type),
+                              event.rpm, event.cutTimeUs);
+            }
+            break;
+
+        case EventType::SHIFT:
+            Serial.printf("[QS] %10u Shift sensor triggered! | RPM: %u | Cut time: %uus | CUT TRIGGERED\n",
+                          event.timestampUs, event.rpm, event.cutTimeUs);
+            break;
+
+        case EventType::SHIFT_DEBOUNCED:
+            Serial.printf("[QS] %10u Shift sensor triggered! | RPM: %u | DEBOUNCED - ignoring\n",
+                          event.timestampUs, event.rpm);
+            break;
+
+        case EventType::SHIFT_BLOCKED:
+            Serial.printf("[QS] %10u Shift sensor triggered! | RPM: %u | TPS: %u.%u%% - CLOSED THROTTLE, ignoring\n",
+                          event.timestampUs, event.rpm, event.cutTimeUs / 10, event.cutTimeUs % 10);
+            break;
+
+        case EventType::CUT_START:
+        case EventType::CUT_END:
+            Serial.printf("[QS] %10u %s | RPM: %u\n",
+                          event.timestampUs, eventTypeToString(event.type), event.rpm);
+            break;
+
+        default:
+            break;
+    }
+}
+
+const char* EventDispatcher::eventTypeToString(QuickShifterEngine::EventType type) {
+    using EventType = QuickShifterEngine::EventType;
+
+    switch (type) {
+        case EventType::PULSE_ACCEPTED:  return "PULSE_ACCEPTED";
+        case EventType::PULSE_REJECTED:  return "PULSE_REJECTED";
+        case EventType::SHIFT:           return "SHIFT";
+        case EventType::SHIFT_DEBOUNCED: return "SHIFT_DEBOUNCED";
+        case EventType::CUT_START:       return "CUT_START";
+        case EventType::CUT_END:         return "CUT_END";
+        case EventType::SHIFT_BLOCKED:   return "SHIFT_BLOCKED";
+        default:                         return "UNKNOWN";
+    }
+}
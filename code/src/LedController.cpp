@@ -1,18 +1,55 @@
 #include "LedController.hpp"
+#include <hal/ledc_ll.h>
+#include <soc/ledc_struct.h>
+#include <soc/gpio_struct.h>
+
+namespace {
+
+constexpr uint8_t CHANNEL_COUNT = 3;
+
+/**
+ * @brief Start one LEDC fade: steps × cycles PWM periods, duty moving scale per step
+ *
+ * Register level, as the driver's fade API blocks and is not IRAM safe.
+ * A solid duty is one step of one cycle with scale 0.
+ */
+inline void IRAM_ATTR startFade(ledc_channel_t channel, uint32_t duty, bool increase,
+                                uint32_t steps, uint32_t cycles, uint32_t scale) {
+    ledc_dev_t* hw = &LEDC;
+    ledc_ll_set_duty_int_part(hw, LedController::LEDC_MODE, channel, duty);
+    ledc_ll_set_duty_direction(hw, LedController::LEDC_MODE, channel,
+                               increase ? LEDC_DUTY_DIR_INCREASE : LEDC_DUTY_DIR_DECREASE);
+    ledc_ll_set_duty_num(hw, LedController::LEDC_MODE, channel, steps);
+    ledc_ll_set_duty_cycle(hw, LedController::LEDC_MODE, channel, cycles);
+    ledc_ll_set_duty_scale(hw, LedController::LEDC_MODE, channel, scale);
+    ledc_ll_set_duty_start(hw, LedController::LEDC_MODE, channel, true);
+    ledc_ll_ls_channel_update(hw, LedController::LEDC_MODE, channel);
+}
+
+/**
+ * @brief Hold a duty for a number of PWM periods (scale 0)
+ */
+inline void IRAM_ATTR holdDuty(ledc_channel_t channel, uint32_t duty, uint32_t periods) {
+    const uint32_t steps = (periods + LedController::MAX_FADE_CYCLES - 1) / LedController::MAX_FADE_CYCLES;
+    startFade(channel, duty, true, steps ? steps : 1, steps ? periods / steps : 1, 0);
+}
+
+}  // namespace
 
 LedController::LedController()
     : _redPin(0)
     , _greenPin(0)
     , _bluePin(0)
     , _builtinPin(0)
-    , _currentStatus(Status::NO_SIGNAL)
-    , _blinkEnabled(false)
-    , _blinkPeriod(500)
-    , _lastBlinkTime(0)
-    , _blinkState(false)
-    , _currentR(0)
-    , _currentG(0)
-    , _currentB(0)
+    , _ready(false)
+    , _fadeIsr(nullptr)
+    , _engineStatus(Status::NO_SIGNAL)
+    , _held(false)
+    , _rgb{0, 0, 0}
+    , _pattern(Pattern::SOLID)
+    , _periodMs(DEFAULT_PERIOD_MS)
+    , _phaseOn(true)
+    , _masterChannel(LEDC_CHANNEL_RED)
 {
 }
 
@@ -21,76 +58,118 @@ void LedController::begin(uint8_t redPin, uint8_t greenPin, uint8_t bluePin, uin
     _greenPin = greenPin;
     _bluePin = bluePin;
     _builtinPin = builtinPin;
-    
-    // Configure pins as outputs
-    pinMode(_redPin, OUTPUT);
-    pinMode(_greenPin, OUTPUT);
-    pinMode(_bluePin, OUTPUT);
+
     pinMode(_builtinPin, OUTPUT);
-    
-    // Initialize to OFF
-    setRgb(0, 0, 0);
     setBuiltinLed(false);
-    
-    
-}
 
-void LedController::update() {
-    if (!_blinkEnabled) {
+    // One 8-bit timer for all three colours
+    ledc_timer_config_t timer = {};
+    timer.speed_mode = LEDC_MODE;
+    timer.duty_resolution = LEDC_TIMER_8_BIT;
+    timer.timer_num = LEDC_TIMER;
+    timer.freq_hz = PWM_FREQUENCY_HZ;
+    timer.clk_cfg = LEDC_AUTO_CLK;
+    if (ledc_timer_config(&timer) != ESP_OK) {
+        Serial.println("[LED] LEDC timer setup failed");
         return;
     }
-    
-    unsigned long currentMillis = millis();
-    if (currentMillis - _lastBlinkTime >= _blinkPeriod) {
-        _lastBlinkTime = currentMillis;
-        _blinkState = !_blinkState;
-        
-        if (_blinkState) {
-            applyRgb();
-        } else {
-            analogWrite(_redPin, 0);
-            analogWrite(_greenPin, 0);
-            analogWrite(_bluePin, 0);
+
+    const uint8_t pins[CHANNEL_COUNT] = {_redPin, _greenPin, _bluePin};
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        ledc_channel_config_t channel = {};
+        channel.gpio_num = pins[i];
+        channel.speed_mode = LEDC_MODE;
+        channel.channel = static_cast<ledc_channel_t>(LEDC_CHANNEL_RED + i);
+        channel.intr_type = LEDC_INTR_DISABLE;
+        channel.timer_sel = LEDC_TIMER;
+        channel.duty = 0;
+        channel.hpoint = 0;
+        if (ledc_channel_config(&channel) != ESP_OK) {
+            Serial.printf("[LED] LEDC channel %u setup failed\n", i);
+            return;
         }
     }
+
+    // Our own fade end interrupt (no driver fade service)
+    if (ledc_isr_register(fadeEndISR, this, ESP_INTR_FLAG_IRAM, &_fadeIsr) != ESP_OK) {
+        Serial.println("[LED] Fade interrupt unavailable, patterns stay solid");
+        _fadeIsr = nullptr;
+    }
+
+    _ready = true;
 }
 
 void LedController::setStatus(Status status) {
-    _currentStatus = status;
-    
-    // Get color for this status
-    getStatusColor(status, _currentR, _currentG, _currentB);
-    
-    // Apply immediately if not blinking
-    if (!_blinkEnabled) {
-        applyRgb();
+    portENTER_CRITICAL_SAFE(&_lock);
+    _held = false;
+    showStatus(status);
+    portEXIT_CRITICAL_SAFE(&_lock);
+}
+
+void LedController::holdStatus(Status status) {
+    portENTER_CRITICAL_SAFE(&_lock);
+    _held = true;
+    showStatus(status);
+    portEXIT_CRITICAL_SAFE(&_lock);
+}
+
+void LedController::releaseStatus() {
+    portENTER_CRITICAL_SAFE(&_lock);
+    if (_held) {
+        _held = false;
+        showStatus(_engineStatus);
     }
+    portEXIT_CRITICAL_SAFE(&_lock);
 }
 
 void LedController::setRgb(uint8_t r, uint8_t g, uint8_t b) {
-    _currentR = r;
-    _currentG = g;
-    _currentB = b;
-    _blinkEnabled = false;
-    applyRgb();
+    portENTER_CRITICAL_SAFE(&_lock);
+    show(r, g, b, Pattern::SOLID, _periodMs);
+    portEXIT_CRITICAL_SAFE(&_lock);
 }
 
-void LedController::setBuiltinLed(bool state) {
-    digitalWrite(_builtinPin, state ? HIGH : LOW);
+void IRAM_ATTR LedController::setBuiltinLed(bool state) {
+    // Register writes like CutOutput: called from the cut timer ISR, which
+    // also runs with the flash cache off, so no digitalWrite()
+    const uint32_t mask = 1UL << (_builtinPin & 31);
+    if (_builtinPin < 32) {
+        if (state) GPIO.out_w1ts = mask;
+        else GPIO.out_w1tc = mask;
+    } else {
+        if (state) GPIO.out1_w1ts.val = mask;
+        else GPIO.out1_w1tc.val = mask;
+    }
 }
 
 void LedController::setBlinking(bool enabled, uint16_t periodMs) {
-    _blinkEnabled = enabled;
-    _blinkPeriod = periodMs;
-    _lastBlinkTime = millis();
-    _blinkState = false;
-    
-    if (!enabled) {
-        applyRgb(); // Restore solid color
+    setPattern(enabled ? Pattern::BLINK : Pattern::SOLID, periodMs);
+}
+
+void LedController::setPattern(Pattern pattern, uint16_t periodMs) {
+    portENTER_CRITICAL_SAFE(&_lock);
+    show(_rgb[0], _rgb[1], _rgb[2], pattern, periodMs);
+    portEXIT_CRITICAL_SAFE(&_lock);
+}
+
+void IRAM_ATTR LedController::onEngineState(bool signalActive, bool cutActive, void* context) {
+    LedController* led = static_cast<LedController*>(context);
+    if (!led) return;
+
+    const Status status = cutActive ? Status::IGNITION_CUT
+                        : signalActive ? Status::SIGNAL_OK
+                        : Status::NO_SIGNAL;
+
+    portENTER_CRITICAL_SAFE(&led->_lock);
+    led->_engineStatus = status;
+    if (!led->_held) {
+        led->showStatus(status);
     }
+    portEXIT_CRITICAL_SAFE(&led->_lock);
+
+    led->setBuiltinLed(cutActive);
 }
 
-void LedController::getStatusColor(Status status, uint8_t& r, uint8_t& g, uint8_t& b) {
+void IRAM_ATTR LedController::getStatusColor(Status status, uint8_t& r, uint8_t& g, uint8_t& b) {
     switch (status) {
         case Status::NO_SIGNAL:
             r = 255; g = 0; b = 0;  // Red
@@ -119,8 +198,107 @@ void LedController::getStatusColor(Status status, uint8_t& r, uint8_t& g, uint8_
     }
 }
 
-void LedController::applyRgb() {
-    analogWrite(_redPin, _currentR);
-    analogWrite(_greenPin, _currentG);
-    analogWrite(_bluePin, _currentB);
+LedController::Pattern IRAM_ATTR LedController::getStatusPattern(Status status) {
+    switch (status) {
+        case Status::WIFI_AP:
+        case Status::WIFI_STA:
+            return Pattern::FLASH;
+        case Status::OTA_UPDATE:
+            return Pattern::FADE;
+        case Status::ERROR:
+            return Pattern::BLINK;
+        default:
+            return Pattern::SOLID;
+    }
+}
+
+void IRAM_ATTR LedController::showStatus(Status status) {
+    uint8_t r, g, b;
+    getStatusColor(status, r, g, b);
+    show(r, g, b, getStatusPattern(status), DEFAULT_PERIOD_MS);
+}
+
+void IRAM_ATTR LedController::show(uint8_t r, uint8_t g, uint8_t b, Pattern pattern, uint16_t periodMs) {
+    // Patterns need the fade interrupt to advance
+    if (!_fadeIsr) pattern = Pattern::SOLID;
+    if (periodMs < 2) periodMs = 2;
+
+    const bool sameColour = r == _rgb[0] && g == _rgb[1] && b == _rgb[2];
+    if (sameColour && pattern == _pattern && (pattern == Pattern::SOLID || periodMs == _periodMs)) {
+        return;
+    }
+
+    _rgb[0] = r;
+    _rgb[1] = g;
+    _rgb[2] = b;
+    _pattern = pattern;
+    _periodMs = periodMs;
+    _phaseOn = true;
+    if (_ready) startPhase();
+}
+
+void IRAM_ATTR LedController::startPhase() {
+    ledc_dev_t* hw = &LEDC;
+
+    if (_pattern == Pattern::SOLID) {
+        for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+            const ledc_channel_t channel = static_cast<ledc_channel_t>(LEDC_CHANNEL_RED + i);
+            ledc_ll_set_fade_end_intr(hw, LEDC_MODE, channel, false);
+            startFade(channel, _rgb[i], true, 1, 1, 0);
+        }
+        return;
+    }
+
+    // The brightest channel has the longest ramp and ends the phase
+    uint8_t master = 0;
+    for (uint8_t i = 1; i < CHANNEL_COUNT; i++) {
+        if (_rgb[i] > _rgb[master]) master = i;
+    }
+    _masterChannel = static_cast<ledc_channel_t>(LEDC_CHANNEL_RED + master);
+
+    const uint32_t phasePeriods = static_cast<uint32_t>(_periodMs) * PWM_FREQUENCY_HZ / 2000;
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        const ledc_channel_t channel = static_cast<ledc_channel_t>(LEDC_CHANNEL_RED + i);
+        const uint8_t value = _rgb[i];
+
+        ledc_ll_clear_fade_end_intr_status(hw, LEDC_MODE, channel);
+        ledc_ll_set_fade_end_intr(hw, LEDC_MODE, channel, channel == _masterChannel);
+
+        if (_pattern == Pattern::FADE && value > 0) {
+            // One duty step per value, spread over the phase
+            uint32_t cycles = phasePeriods / value;
+            if (cycles < 1) cycles = 1;
+            if (cycles > MAX_FADE_CYCLES) cycles = MAX_FADE_CYCLES;
+            startFade(channel, _phaseOn ? 0 : value, _phaseOn, value, cycles, 1);
+        } else {
+            const bool lit = _phaseOn || _pattern == Pattern::FLASH;
+            holdDuty(channel, lit ? value : 0, phasePeriods);
+        }
+    }
+}
+
+void IRAM_ATTR LedController::fadeEndISR(void* arg) {
+    LedController* led = static_cast<LedController*>(arg);
+    ledc_dev_t* hw = &LEDC;
+
+    uint32_t status = 0;
+    ledc_ll_get_fade_end_intr_status(hw, LEDC_MODE, &status);
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        const ledc_channel_t channel = static_cast<ledc_channel_t>(LEDC_CHANNEL_RED + i);
+        if (status & (1UL << channel)) {
+            ledc_ll_clear_fade_end_intr_status(hw, LEDC_MODE, channel);
+        }
+    }
+
+    portENTER_CRITICAL_ISR(&led->_lock);
+    if ((status & (1UL << led->_masterChannel)) && led->_pattern != Pattern::SOLID) {
+        if (led->_pattern == Pattern::FLASH) {
+            // Flash over, back to what the engine reports
+            led->showStatus(led->_engineStatus);
+        } else {
+            led->_phaseOn = !led->_phaseOn;
+            led->startPhase();
+        }
+    }
+    portEXIT_CRITICAL_ISR(&led->_lock);
 }
@@ -0,0 +1,187 @@
+#include "MessagePool.hpp"
+#include <esp_heap_caps.h>
+
+MessagePool::MessagePool()
+    : _buffers{}
+    , _used(0)
+    , _ready(false)
+    , _inUse{}
+    , _peak{}
+    , _fallbacks(0)
+    , _heap{0, 0, 0, 0}
+{
+}
+
+bool MessagePool::begin() {
+    // Reserved once and never freed, so they never fragment the heap
+    for (size_t i = 0; i < BUFFER_COUNT; i++) {
+        _buffers[i].reserve(capacityOf(classOf(i)));
+        if (_buffers[i].capacity() < capacityOf(classOf(i))) {
+            Serial.printf("[Pool] Buffer %u reserve failed\n", i);
+            return false;
+        }
+    }
+    _ready = true;
+    sampleHeap();
+
+    Serial.printf("[Pool] %u message buffers (%u/%u/%u B), heap free=%u largest=%u\n",
+                  BUFFER_COUNT, SMALL_SIZE, MEDIUM_SIZE, LARGE_SIZE,
+                  _heap.freeBytes, _heap.largestBlock);
+    return true;
+}
+
+AsyncWebSocketSharedBuffer MessagePool::acquire(const void* data, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    // Smallest class that fits, larger ones if it is exhausted
+    int index = -1;
+    if (_ready && len <= LARGE_SIZE) {
+        const size_t first = firstIndexOf(len <= SMALL_SIZE ? SizeClass::SMALL
+                                          : len <= MEDIUM_SIZE ? SizeClass::MEDIUM
+                                          : SizeClass::LARGE);
+        const uint32_t candidates = ~((1UL << first) - 1) & ((1UL << BUFFER_COUNT) - 1);
+
+        portENTER_CRITICAL_SAFE(&_lock);
+        const uint32_t free = ~_used & candidates;
+        if (free) {
+            index = __builtin_ctz(free);
+            _used |= 1UL << index;
+            const size_t sizeClass = static_cast<size_t>(classOf(index));
+            if (++_inUse[sizeClass] > _peak[sizeClass]) _peak[sizeClass] = _inUse[sizeClass];
+        }
+        portEXIT_CRITICAL_SAFE(&_lock);
+    }
+
+    if (index >= 0) {
+        std::vector<uint8_t>* buffer = &_buffers[index];
+        buffer->assign(bytes, bytes + len);     // Within the reserved capacity
+        return AsyncWebSocketSharedBuffer(buffer, Releaser{this, static_cast<uint8_t>(index)},
+                                          ControlBlockAllocator<std::vector<uint8_t>>(this));
+    }
+
+    _fallbacks++;
+    return std::make_shared<std::vector<uint8_t>>(bytes, bytes + len);
+}
+
+void MessagePool::release(uint8_t index, std::vector<uint8_t>* buffer) {
+    buffer->clear();    // Keeps the capacity
+
+    portENTER_CRITICAL_SAFE(&_lock);
+    if (_used & (1UL << index)) {
+        _used &= ~(1UL << index);
+        _inUse[static_cast<size_t>(classOf(index))]--;
+    }
+    portEXIT_CRITICAL_SAFE(&_lock);
+}
+
+void* MessagePool::allocateControlBlock(size_t size) {
+    void* block = size <= CONTROL_BLOCK_SIZE ? _controlBlocks.allocate() : nullptr;
+    return block ? block : ::operator new(size);
+}
+
+void MessagePool::releaseControlBlock(void* ptr) {
+    if (!_controlBlocks.release(ptr)) {
+        ::operator delete(ptr);
+    }
+}
+
+void MessagePool::sampleHeap() {
+    _heap.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    _heap.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    _heap.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    _heap.fragmentation = _heap.freeBytes
+        ? static_cast<uint8_t>(100 - static_cast<uint64_t>(_heap.largestBlock) * 100 / _heap.freeBytes)
+        : 0;
+}
+
+void MessagePool::toJson(JsonObject out) const {
+    JsonObject heap = out.createNestedObject("heap");
+    heap["free"] = _heap.freeBytes;
+    heap["minFree"] = _heap.minFreeBytes;
+    heap["largest"] = _heap.largestBlock;
+    heap["fragmentation"] = _heap.fragmentation;
+
+    JsonArray classes = out.createNestedArray("classes");
+    for (size_t i = 0; i < static_cast<size_t>(SizeClass::COUNT); i++) {
+        const SizeClass sizeClass = static_cast<SizeClass>(i);
+        JsonObject obj = classes.createNestedObject();
+        obj["name"] = sizeClassToString(sizeClass);
+        obj["size"] = capacityOf(sizeClass);
+        obj["count"] = countOf(sizeClass);
+        obj["inUse"] = _inUse[i];
+        obj["peak"] = _peak[i];
+    }
+    out["fallbacks"] = _fallbacks;
+    out["controlBlockMisses"] = _controlBlocks.misses();
+}
+
+const char* MessagePool::sizeClassToString(SizeClass sizeClass) {
+    switch (sizeClass) {
+        case SizeClass::SMALL: return "small";
+        case SizeClass::MEDIUM: return "medium";
+        case SizeClass::LARGE: return "large";
+        default: return "unknown";
+    }
+}
+
+MessagePool::SizeClass MessagePool::classOf(size_t index) {
+    if (index < SMALL_COUNT) return SizeClass::SMALL;
+    if (index < SMALL_COUNT + MEDIUM_COUNT) return SizeClass::MEDIUM;
+    return SizeClass::LARGE;
+}
+
+size_t MessagePool::capacityOf(SizeClass sizeClass) {
+    switch (sizeClass) {
+        case SizeClass::SMALL: return SMALL_SIZE;
+        case SizeClass::MEDIUM: return MEDIUM_SIZE;
+        default: return LARGE_SIZE;
+    }
+}
+
+size_t MessagePool::firstIndexOf(SizeClass sizeClass) {
+    switch (sizeClass) {
+        case SizeClass::SMALL: return 0;
+        case SizeClass::MEDIUM: return SMALL_COUNT;
+        default: return SMALL_COUNT + MEDIUM_COUNT;
+    }
+}
+
+size_t MessagePool::countOf(SizeClass sizeClass) {
+    switch (sizeClass) {
+        case SizeClass::SMALL: return SMALL_COUNT;
+        case SizeClass::MEDIUM: return MEDIUM_COUNT;
+        default: return LARGE_COUNT;
+    }
+}
+
+// Response objects: the server news and deletes them, one slab behind both
+static SlabPool<PooledResponse::SLOT_SIZE, PooledResponse::POOL_COUNT> s_responses;
+
+PooledResponse::PooledResponse(int code, const char* contentType, AsyncWebSocketSharedBuffer body)
+    : AsyncAbstractResponse()
+    , _body(body)
+    , _offset(0)
+{
+    setCode(code);
+    setContentType(contentType);
+    setContentLength(_body ? _body->size() : 0);
+}
+
+size_t PooledResponse::_fillBuffer(uint8_t* buf, size_t maxLen) {
+    if (!_body || _offset >= _body->size()) return 0;
+    const size_t len = min(maxLen, _body->size() - _offset);
+    memcpy(buf, _body->data() + _offset, len);
+    _offset += len;
+    return len;
+}
+
+void* PooledResponse::operator new(size_t size) {
+    void* slot = size <= SLOT_SIZE ? s_responses.allocate() : nullptr;
+    return slot ? slot : ::operator new(size);
+}
+
+void PooledResponse::operator delete(void* ptr) {
+    if (!s_responses.release(ptr)) {
+        ::operator delete(ptr);
+    }
+}
@@ -1,26 +1,38 @@
 #include "NetworkManager.hpp"
-#include <HTTPClient.h>
-#include <HTTPUpdate.h>
+#include <AsyncJson.h>
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
 
-NetworkManager::NetworkManager(StorageHandler& storage, QuickShifterEngine& qsEngine, LedController& led)
+NetworkManager::NetworkManager(StorageHandler& storage, QuickShifterEngine& qsEngine, LedController& led,
+                               TelemetrySampler& sampler, SessionLogger& logger, SensorAcquisition& sensors,
+                               ShiftAnalytics& analytics, const BootProfile& boot)
     : _storage(storage)
     , _qsEngine(qsEngine)
     , _led(led)
+    , _sampler(sampler)
+    , _logger(logger)
+    , _sensors(sensors)
+    , _analytics(analytics)
+    , _boot(boot)
     , _state(State::INIT)
     , _server(80)
     , _ws("/ws")
     , _lastTelemetryUpdate(0)
     , _telemetryUpdateRate(100)
-    , _otaState(OTAState::IDLE)
-    , _lastOtaError(OTAError::NONE)
-    , _otaProgress(0)
-    , _otaStartTime(0)
-    , _lastProgressUpdate(0)
-    , _totalSize(0)
-    , _writtenSize(0)
-    , _updateInProgress(false)
+    , _lastPerfBroadcast(0)
+    , _clients{}
+    , _clientsMutex(nullptr)
+    , _telemetryBatch{}
+    , _telemetryBatchCount(0)
+    , _streamIndex(0)
+    , _telemetrySequence(0)
+    , _lastHeapSample(0)
+    , _otaRevision(0)
+    , _stateBeforeOta(State::INIT)
+    , _uploadAccepted(false)
+#if QS_HIL
+    , _hil(nullptr)
+#endif
 {
 }
 
@@ -28,6 +40,11 @@ bool NetworkManager::begin() {
     // Generate hardware ID
     generateHardwareId();
     
+    // OTA tasks idle until an update is started
+    _ota.begin(_hardwareId);
+    
+    // Message buffers before any client can connect (failure falls back to the heap)
+    _messages.begin();
     
     // Load network configuration
     StorageHandler::NetworkConfig netConfig;
@@ -37,8 +54,15 @@ bool NetworkManager::begin() {
     StorageHandler::TelemetryConfig telConfig;
     _storage.loadTelemetryConfig(telConfig);
     _telemetryUpdateRate = telConfig.updateRateMs;
+    _sampler.setSampleRate(telConfig.sampleRateHz);
+    
+    // Load compressed asset table (built by tools/build_assets.py)
+    _assets.begin();
     
     // Setup WebSocket
+    if (!_clientsMutex) {
+        _clientsMutex = xSemaphoreCreateMutex();
+    }
     setupWebSocket();
     _server.addHandler(&_ws);
     
@@ -68,13 +92,45 @@ bool NetworkManager::begin() {
 }
 
 void NetworkManager::update() {
-    // Clean up WebSocket clients
-    _ws.cleanupClients();
+    // Free closed clients (and their queues) promptly. Not under
+    // _clientsMutex: the WS_EVT_DISCONNECT it fires takes the mutex itself
+    _ws.cleanupClients(MAX_WS_CLIENTS);
+    
+    updateOta();
+    
+    if (millis() - _lastPerfBroadcast >= PERF_BROADCAST_MS) {
+        _lastPerfBroadcast = millis();
+        broadcastPerf();
+    }
+    
+    if (millis() - _lastHeapSample >= HEAP_SAMPLE_MS) {
+        _lastHeapSample = millis();
+        _messages.sampleHeap();
+    }
+}
+
+void NetworkManager::updateTelemetry() {
+    if (_ws.count() == 0 || !hasBinaryClients()) {
+        // Nobody streams binary, keep the cursor at the live edge
+        _streamIndex = _sampler.getHead();
+        _telemetryBatchCount = 0;
+        if (_ws.count() == 0) return;  // No clients connected
+    } else {
+        // Binary clients get every history sample, batched into frames
+        for (;;) {
+            _telemetryBatchCount += _sampler.read(_streamIndex,
+                                                  _telemetryBatch.data() + _telemetryBatchCount,
+                                                  TelemetryFrame::MAX_SAMPLES - _telemetryBatchCount);
+            if (_telemetryBatchCount < TelemetryFrame::MAX_SAMPLES) break;
+            flushTelemetryBatch();
+        }
+    }
     
     // Broadcast telemetry at configured rate
     unsigned long currentMillis = millis();
     if (currentMillis - _lastTelemetryUpdate >= _telemetryUpdateRate) {
         _lastTelemetryUpdate = currentMillis;
+        flushTelemetryBatch();
         broadcastTelemetry();
     }
 }
@@ -135,7 +191,6 @@ void NetworkManager::switchToApMode() {
         _lastError = "Failed to start AP mode";
         _state = State::ERROR;
         _led.setStatus(LedController::Status::ERROR);
-        _led.setBlinking(true);
     }
 }
 
@@ -259,12 +314,23 @@ void NetworkManager::setupWebSocket() {
 void NetworkManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
                                       AwsEventType type, void* arg, uint8_t* data, size_t len) {
     switch (type) {
-        case WS_EVT_CONNECT:
-            
+        case WS_EVT_CONNECT: {
+            // New clients start on JSON telemetry with every channel
+            xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+            const bool added = addClient(client->id()) != nullptr;
+            xSemaphoreGive(_clientsMutex);
+            if (!added) {
+                Serial.printf("[WS] Client %u refused, %u clients connected\n", client->id(), MAX_WS_CLIENTS);
+                client->close();
+            }
             break;
+        }
             
         case WS_EVT_DISCONNECT:
-            
+            // Waits for a running fan-out, which may still hold this client
+            xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+            removeClient(client->id());
+            xSemaphoreGive(_clientsMutex);
             break;
             
         case WS_EVT_DATA: {
@@ -272,7 +338,9 @@ void NetworkManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClie
             if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
                 data[len] = 0;  // Null terminate
                 
-                handleConfigUpdate((char*)data);
+                if (!handleStreamRequest(client, (char*)data) && !handleConfigPatch(client, (char*)data, len)) {
+                    handleConfigUpdate((char*)data);
+                }
             }
             break;
         }
@@ -289,20 +357,47 @@ void NetworkManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClie
 void NetworkManager::broadcastTelemetry() {
     if (_ws.count() == 0) return;  // No clients connected
     
+    // Skip JSON serialization unless a JSON client is due
+    const uint32_t now = millis();
+    bool hasDueClients = false;
+    for (const auto& slot : _clients) {
+        if (slot.id != 0 && !slot.binary && (slot.channels & CHANNEL_TELEMETRY) &&
+            now - slot.lastTelemetryMs >= max<uint32_t>(slot.intervalMs, _telemetryUpdateRate) * slot.decimation) {
+            hasDueClients = true;
+            break;
+        }
+    }
+    if (!hasDueClients) return;
+    
+    TelemetryFrame::Sample sample;
+    if (!_sampler.latest(sample)) return;
+    
     // Create telemetry JSON with fixed buffer
-    StaticJsonDocument<256> doc;
-    doc["rpm"] = _qsEngine.getCurrentRpm();
-    doc["signalActive"] = _qsEngine.isSignalActive();
-    doc["cutActive"] = _qsEngine.isCutActive();
+    StaticJsonDocument<384> doc;
+    doc["rpm"] = sample.rpm;
+    doc["rpmAccel"] = sample.rpmAccel * TelemetryFrame::RPM_ACCEL_SCALE;
+    doc["signalActive"] = (sample.flags & TelemetryFrame::FLAG_SIGNAL_ACTIVE) != 0;
+    doc["cutActive"] = (sample.flags & TelemetryFrame::FLAG_CUT_ACTIVE) != 0;
+    doc["triggerSync"] = _qsEngine.isTriggerSynced();
+    if (sample.flags & TelemetryFrame::FLAG_TPS_VALID) doc["tps"] = sample.tps / 10.0f;
+    if (sample.flags & TelemetryFrame::FLAG_MAP_VALID) doc["map"] = sample.map / 10.0f;
+    doc["configGen"] = _qsEngine.getConfigGeneration();
     doc["uptime"] = millis();
     
+    // Heap health (sampled at 1 Hz) and messages the pool could not hold
+    const MessagePool::HeapStats& heap = _messages.getHeapStats();
+    doc["heapFree"] = heap.freeBytes;
+    doc["heapLargest"] = heap.largestBlock;
+    doc["heapFrag"] = heap.fragmentation;
+    doc["poolFallbacks"] = _messages.getFallbacks();
+    
     // Check for overflow
     if (doc.overflowed()) {
         doc.clear();
         return;
     }
     
-    char jsonBuffer[256];
+    char jsonBuffer[384];
     size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
     
     if (jsonSize == 0 || jsonSize >= sizeof(jsonBuffer)) {
@@ -310,13 +405,280 @@ void NetworkManager::broadcastTelemetry() {
         return;
     }
     
-    _ws.textAll(jsonBuffer, jsonSize);
+    AsyncWebSocketSharedBuffer buffer;
+    xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+    for (auto& client : _ws.getClients()) {
+        ClientSlot* slot = findClient(client.id());
+        if (client.status() != WS_CONNECTED || !slot || slot->binary || !(slot->channels & CHANNEL_TELEMETRY)) {
+            continue;
+        }
+        // Own interval per client, stretched by the decimation while it lags
+        const uint32_t interval = max<uint32_t>(slot->intervalMs, _telemetryUpdateRate) * slot->decimation;
+        if (now - slot->lastTelemetryMs < interval) continue;
+        slot->lastTelemetryMs = now;
+        if (canQueue(client, *slot)) {
+            if (!buffer) buffer = _messages.acquire(jsonBuffer, jsonSize);
+            if (buffer) client.text(buffer);
+        }
+    }
+    xSemaphoreGive(_clientsMutex);
     doc.clear();
 }
 
+void NetworkManager::flushTelemetryBatch() {
+    if (_telemetryBatchCount == 0) return;
+    
+    uint8_t frame[TelemetryFrame::MAX_FRAME_SIZE];
+    TelemetryFrame::Header header;
+    header.magic = TelemetryFrame::MAGIC;
+    header.version = TelemetryFrame::VERSION;
+    header.sampleCount = _telemetryBatchCount;
+    header.sampleSize = sizeof(TelemetryFrame::Sample);
+    header.sequence = _telemetrySequence++;
+    header.configGeneration = static_cast<uint16_t>(_qsEngine.getConfigGeneration());
+    
+    const size_t samplesSize = _telemetryBatchCount * sizeof(TelemetryFrame::Sample);
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), _telemetryBatch.data(), samplesSize);
+    _telemetryBatchCount = 0;
+    
+    // One pooled buffer shared by all clients, taken for the first one
+    AsyncWebSocketSharedBuffer buffer;
+    xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+    for (auto& client : _ws.getClients()) {
+        ClientSlot* slot = findClient(client.id());
+        if (client.status() != WS_CONNECTED || !slot || !slot->binary || !(slot->channels & CHANNEL_TELEMETRY)) {
+            continue;
+        }
+        // A lagging client gets every Nth frame, the sequence shows the gap
+        if (++slot->skipped < slot->decimation) continue;
+        slot->skipped = 0;
+        if (canQueue(client, *slot)) {
+            if (!buffer) buffer = _messages.acquire(frame, sizeof(header) + samplesSize);
+            if (buffer) client.binary(buffer);
+        }
+    }
+    xSemaphoreGive(_clientsMutex);
+}
+
+void NetworkManager::handleTelemetryCapture(AsyncWebServerRequest* request) {
+    // ?shift=<age, 0 = last>&pre=<ms>&post=<ms>
+    size_t age = request->hasParam("shift") ? request->getParam("shift")->value().toInt() : 0;
+    uint32_t preMs = request->hasParam("pre") ? request->getParam("pre")->value().toInt() : 500;
+    uint32_t postMs = request->hasParam("post") ? request->getParam("post")->value().toInt() : 1000;
+    
+    TelemetrySampler::Trigger trigger;
+    if (!_sampler.getTrigger(age, trigger)) {
+        request->send(404, "application/json", "{\"success\":false,\"message\":\"No such shift\"}");
+        return;
+    }
+    
+    uint32_t start = _sampler.findIndex(trigger.timestampUs - preMs * 1000);
+    uint32_t end = _sampler.findIndex(trigger.timestampUs + postMs * 1000);  // Head if still recording
+    if (start < _sampler.getOldest() || end <= start) {
+        request->send(410, "application/json", "{\"success\":false,\"message\":\"Shift no longer in history\"}");
+        return;
+    }
+    
+    // Every frame but the last is full, so a byte offset maps straight to a frame
+    constexpr size_t FULL_FRAME = TelemetryFrame::MAX_FRAME_SIZE;
+    const uint32_t sampleCount = end - start;
+    const uint32_t frameCount = (sampleCount + TelemetryFrame::MAX_SAMPLES - 1) / TelemetryFrame::MAX_SAMPLES;
+    const size_t totalSize = frameCount * sizeof(TelemetryFrame::Header)
+                             + sampleCount * sizeof(TelemetryFrame::Sample);
+    
+    TelemetrySampler& sampler = _sampler;
+    request->send(request->beginResponse("application/octet-stream", totalSize,
+        [&sampler, start, sampleCount](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+            const uint32_t frameNumber = index / FULL_FRAME;
+            const size_t frameOffset = index - frameNumber * FULL_FRAME;
+            const uint32_t first = frameNumber * TelemetryFrame::MAX_SAMPLES;
+            if (first >= sampleCount) return 0;
+            
+            const size_t samples = min<size_t>(TelemetryFrame::MAX_SAMPLES, sampleCount - first);
+            uint8_t frame[TelemetryFrame::MAX_FRAME_SIZE];
+            TelemetryFrame::Header header;
+            header.magic = TelemetryFrame::MAGIC;
+            header.version = TelemetryFrame::VERSION;
+            header.sampleCount = samples;
+            header.sampleSize = sizeof(TelemetryFrame::Sample);
+            header.sequence = frameNumber;
+            header.configGeneration = 0;  // History, generation at sample time not kept
+            memcpy(frame, &header, sizeof(header));
+            
+            // Samples overwritten during a slow download are sent zeroed
+            TelemetryFrame::Sample* out = reinterpret_cast<TelemetryFrame::Sample*>(frame + sizeof(header));
+            uint32_t readIndex = start + first;
+            size_t copied = (readIndex >= sampler.getOldest()) ? sampler.read(readIndex, out, samples) : 0;
+            memset(out + copied, 0, (samples - copied) * sizeof(TelemetryFrame::Sample));
+            
+            const size_t frameSize = sizeof(header) + samples * sizeof(TelemetryFrame::Sample);
+            const size_t len = min(maxLen, frameSize - frameOffset);
+            memcpy(buffer, frame + frameOffset, len);
+            return len;
+        }));
+}
+
+bool NetworkManager::handleStreamRequest(AsyncWebSocketClient* client, const char* jsonData) {
+    // Cheap pre-check, config messages are far more common than stream requests
+    if (!strstr(jsonData, "\"stream\"") && !strstr(jsonData, "\"subscribe\"")) return false;
+    
+    StaticJsonDocument<192> doc;
+    if (deserializeJson(doc, jsonData) || (!doc.containsKey("stream") && !doc.containsKey("subscribe"))) {
+        return false;
+    }
+    
+    xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+    ClientSlot* slot = findClient(client->id());
+    if (!slot) {
+        xSemaphoreGive(_clientsMutex);
+        return true;
+    }
+    
+    if (doc.containsKey("stream")) {
+        const char* format = doc["stream"];
+        slot->binary = format && strcmp(format, "binary") == 0;
+        slot->skipped = 0;
+    }
+    
+    // {"subscribe":["telemetry","events","ota"],"intervalMs":250} replaces the channel set
+    if (doc.containsKey("subscribe")) {
+        uint8_t channels = 0;
+        for (const char* name : doc["subscribe"].as<JsonArray>()) {
+            if (!name) continue;
+            if (strcmp(name, "telemetry") == 0) channels |= CHANNEL_TELEMETRY;
+            else if (strcmp(name, "events") == 0) channels |= CHANNEL_EVENTS;
+            else if (strcmp(name, "ota") == 0) channels |= CHANNEL_OTA;
+            else if (strcmp(name, "perf") == 0) channels |= CHANNEL_PERF;
+        }
+        slot->channels = channels;
+    }
+    if (doc.containsKey("intervalMs")) {
+        slot->intervalMs = min<uint32_t>(doc["intervalMs"].as<uint32_t>(), MAX_CLIENT_INTERVAL_MS);
+    }
+    const ClientSlot settings = *slot;
+    xSemaphoreGive(_clientsMutex);
+    
+    Serial.printf("[WS] Client %u: %s, channels 0x%02x, interval %u ms\n", client->id(),
+                  settings.binary ? "binary" : "json", settings.channels, settings.intervalMs);
+    return true;
+}
+
+NetworkManager::ClientSlot* NetworkManager::addClient(uint32_t clientId) {
+    ClientSlot* slot = findClient(clientId);
+    if (!slot) slot = findClient(0);
+    if (!slot) return nullptr;
+    
+    slot->binary = false;
+    slot->channels = CHANNEL_DEFAULT;
+    slot->intervalMs = 0;
+    slot->decimation = 1;
+    slot->skipped = 0;
+    slot->drainedSends = 0;
+    slot->lastTelemetryMs = 0;
+    slot->dropped = 0;
+    slot->id = clientId;
+    return slot;
+}
+
+NetworkManager::ClientSlot* NetworkManager::findClient(uint32_t clientId) {
+    for (auto& slot : _clients) {
+        if (slot.id == clientId) return &slot;
+    }
+    return nullptr;
+}
+
+void NetworkManager::removeClient(uint32_t clientId) {
+    ClientSlot* slot = clientId ? findClient(clientId) : nullptr;
+    if (!slot) return;
+    
+    if (slot->dropped > 0) {
+        Serial.printf("[WS] Client %u left, %u messages dropped while lagging\n", clientId, slot->dropped);
+    }
+    slot->id = 0;
+}
+
+bool NetworkManager::hasBinaryClients() const {
+    bool found = false;
+    xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+    for (const auto& slot : _clients) {
+        if (slot.id != 0 && slot.binary && (slot.channels & CHANNEL_TELEMETRY)) {
+            found = true;
+            break;
+        }
+    }
+    xSemaphoreGive(_clientsMutex);
+    return found;
+}
+
+bool NetworkManager::canQueue(AsyncWebSocketClient& client, ClientSlot& slot) {
+    const size_t queued = client.queueLen();
+    if (queued >= MAX_CLIENT_QUEUE) {
+        // Don't pile up heap behind a slow client, thin its telemetry instead
+        slot.dropped++;
+        slot.drainedSends = 0;
+        if (slot.decimation < MAX_DECIMATION) {
+            slot.decimation *= 2;
+            Serial.printf("[WS] Client %u lagging (%u queued), telemetry 1/%u\n",
+                          client.id(), queued, slot.decimation);
+        }
+        return false;
+    }
+    
+    if (queued == 0 && slot.decimation > 1 && ++slot.drainedSends >= RECOVER_SENDS) {
+        slot.decimation /= 2;
+        slot.drainedSends = 0;
+    }
+    return true;
+}
+
+void NetworkManager::sendToChannel(Channel channel, const char* text, size_t len) {
+    if (!_clientsMutex) return;  // Before begin(), nobody can be connected
+    
+    // One pooled buffer shared by all subscribers, taken for the first one
+    AsyncWebSocketSharedBuffer buffer;
+    xSemaphoreTake(_clientsMutex, portMAX_DELAY);
+    for (auto& client : _ws.getClients()) {
+        ClientSlot* slot = findClient(client.id());
+        if (client.status() == WS_CONNECTED && slot && (slot->channels & channel) && canQueue(client, *slot)) {
+            if (!buffer) buffer = _messages.acquire(text, len);
+            if (buffer) client.text(buffer);
+        }
+    }
+    xSemaphoreGive(_clientsMutex);
+}
+
+AsyncWebServerResponse* NetworkManager::beginPooledResponse(int code, const char* contentType,
+                                                            const char* body, size_t len) {
+    return new PooledResponse(code, contentType, _messages.acquire(body, len));
+}
+
+void NetworkManager::onEngineEvent(const QuickShifterEngine::Event& event, void* context) {
+    NetworkManager* self = static_cast<NetworkManager*>(context);
+    if (!self || self->_ws.count() == 0) return;
+    
+    // Pulse events are too frequent for the WebSocket, only forward shift/cut
+    const char* name = nullptr;
+    switch (event.type) {
+        case QuickShifterEngine::EventType::SHIFT:           name = "shift"; break;
+        case QuickShifterEngine::EventType::SHIFT_DEBOUNCED: name = "debounced"; break;
+        case QuickShifterEngine::EventType::SHIFT_BLOCKED:   name = "blocked"; break;
+        case QuickShifterEngine::EventType::CUT_END:         name = "cutEnd"; break;
+        default: return;
+    }
+    
+    char buffer[96];
+    int len = snprintf(buffer, sizeof(buffer),
+                       "{\"type\":\"event\",\"event\":\"%s\",\"t\":%u,\"rpm\":%u,\"cutUs\":%u}",
+                       name, event.timestampUs, event.rpm, event.cutTimeUs);
+    if (len > 0 && len < (int)sizeof(buffer)) {
+        self->sendToChannel(CHANNEL_EVENTS, buffer, len);
+    }
+}
+
 void NetworkManager::handleConfigUpdate(const char* jsonData) {
     // Use StaticJsonDocument with sufficient buffer size to avoid heap fragmentation
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<4096> doc;
     DeserializationError error = deserializeJson(doc, jsonData);
     
     if (error) {
@@ -348,19 +710,63 @@ void NetworkManager::handleConfigUpdate(const char* jsonData) {
             sysConfig.qsConfig.debounceTimeMs = qs["debounce"];
             configChanged = true;
         }
-        if (qs.containsKey("cutTimeMap")) {
-            JsonArray arr = qs["cutTimeMap"];
-            if (arr.size() == 11) {
-                for (size_t i = 0; i < 11; i++) {
-                    sysConfig.qsConfig.cutTimeMap[i] = arr[i];
-                }
+        if (qs.containsKey("cutMode")) {
+            sysConfig.qsConfig.cutMode = QuickShifterEngine::cutModeFromString(qs["cutMode"]);
+            configChanged = true;
+        }
+        if (qs.containsKey("minCutPercent")) {
+            sysConfig.qsConfig.closedLoopMinPercent = qs["minCutPercent"];
+            configChanged = true;
+        }
+        if (qs.containsKey("dropPercent")) {
+            sysConfig.qsConfig.closedLoopDropPercent = qs["dropPercent"];
+            configChanged = true;
+        }
+        if (qs.containsKey("skipSparks")) {
+            sysConfig.qsConfig.skipSparks = qs["skipSparks"];
+            configChanged = true;
+        }
+        if (qs.containsKey("skipCycle")) {
+            sysConfig.qsConfig.skipCycle = qs["skipCycle"];
+            configChanged = true;
+        }
+        if (qs.containsKey("shiftSensor")) {
+            sysConfig.qsConfig.shiftSensorMode = QuickShifterEngine::shiftSensorModeFromString(qs["shiftSensor"]);
+            configChanged = true;
+        }
+        if (qs.containsKey("forceThreshold")) {
+            sysConfig.qsConfig.forceThreshold = qs["forceThreshold"];
+            configChanged = true;
+        }
+        if (qs.containsKey("forceHysteresis")) {
+            sysConfig.qsConfig.forceHysteresis = qs["forceHysteresis"];
+            configChanged = true;
+        }
+        if (qs.containsKey("minThrottle")) {
+            sysConfig.qsConfig.minThrottle = lroundf(qs["minThrottle"].as<float>() * 10.0f);
+            configChanged = true;
+        }
+        if (qs.containsKey("triggerTeeth")) {
+            sysConfig.qsConfig.triggerTeeth = qs["triggerTeeth"];
+            configChanged = true;
+        }
+        if (qs.containsKey("triggerMissing")) {
+            sysConfig.qsConfig.triggerMissing = qs["triggerMissing"];
+            configChanged = true;
+        }
+        if (StorageHandler::readCutMap(qs, sysConfig.qsConfig.cutMap)) {
+            if (CutTimeMap::isValid(sysConfig.qsConfig.cutMap)) {
                 configChanged = true;
+            } else {
+                // Axes must be strictly ascending - drop the map update
+                sysConfig.qsConfig.cutMap = _qsEngine.getConfig().cutMap;
             }
         }
         
         if (configChanged) {
             _qsEngine.setConfig(sysConfig.qsConfig);
-            
+            // Store the values as clamped by the engine
+            sysConfig.qsConfig = _qsEngine.getConfig();
         }
     }
     
@@ -421,6 +827,14 @@ void NetworkManager::handleConfigUpdate(const char* jsonData) {
         }
     }
     
+    // Update sensor calibration
+    if (doc.containsKey("sensors")) {
+        StorageHandler::sensorConfigFromJson(doc["sensors"], sysConfig.sensorConfig);
+        _sensors.setCalibration(sysConfig.sensorConfig);
+        sysConfig.sensorConfig = _sensors.getCalibration();
+        configChanged = true;
+    }
+    
     // Update telemetry configuration
     if (doc.containsKey("telemetry")) {
         JsonObject tel = doc["telemetry"];
@@ -431,6 +845,11 @@ void NetworkManager::handleConfigUpdate(const char* jsonData) {
             
             
         }
+        if (tel.containsKey("sampleRate")) {
+            _sampler.setSampleRate(tel["sampleRate"]);
+            sysConfig.telemetryConfig.sampleRateHz = _sampler.getSampleRate();
+            configChanged = true;
+        }
     }
     
     // Save all changes in a single write operation
@@ -448,9 +867,160 @@ void NetworkManager::handleConfigUpdate(const char* jsonData) {
 
 }
 
+bool NetworkManager::handleConfigPatch(AsyncWebSocketClient* client, const char* jsonData, size_t len) {
+    // Same cheap pre-check as stream requests
+    if (!strstr(jsonData, "\"patch\"")) return false;
+    
+    StaticJsonDocument<MAX_PATCH_SIZE> doc;
+    const DeserializationError error = parseConfigPatch(doc, jsonData, len);
+    const bool tooLarge = error == DeserializationError::NoMemory || doc.overflowed();
+    if (!tooLarge && (error || !doc["patch"].is<JsonObject>())) {
+        return false;   // Only mentions "patch" (an SSID, say), a full update
+    }
+    
+    StaticJsonDocument<1536> reply;
+    JsonObject root = reply.to<JsonObject>();
+    root["type"] = "config";
+    if (!doc["id"].isNull()) root["id"] = doc["id"];
+    if (tooLarge) {
+        root["error"] = "patch too large";
+        root["rev"] = _storage.getRevision();
+    } else {
+        applyConfigPatch(doc["patch"].as<JsonObjectConst>(), root);
+    }
+    doc.clear();
+    
+    char buffer[MessagePool::LARGE_SIZE];
+    const size_t size = serializeJson(reply, buffer, sizeof(buffer));
+    if (size > 0 && size < sizeof(buffer) && client->status() == WS_CONNECTED) {
+        client->text(_messages.acquire(buffer, size));
+    }
+    return true;
+}
+
+DeserializationError NetworkManager::parseConfigPatch(JsonDocument& doc, const char* json, size_t len) {
+    // Only "patch" and "id" are kept, anything else in the message is skipped while parsing
+    StaticJsonDocument<32> filter;
+    ConfigPatch::makeFilter(filter);
+    return deserializeJson(doc, json, len, DeserializationOption::Filter(filter));
+}
+
+int NetworkManager::applyConfigPatch(JsonObjectConst patch, JsonObject reply) {
+    StorageHandler::SystemConfig before;
+    _storage.loadConfig(before);
+    StorageHandler::SystemConfig next = before;
+    
+    uint8_t sections = 0;
+    if (!ConfigPatch::apply(patch, next, sections, reply.createNestedObject("errors"))) {
+        reply["rev"] = _storage.getRevision();
+        return 400;
+    }
+    reply.remove("errors");
+    
+    // Only sections that changed are pushed, setConfig() recompiles the whole map
+    if (memcmp(&next.qsConfig, &before.qsConfig, sizeof(next.qsConfig)) != 0) {
+        _qsEngine.setConfig(next.qsConfig);
+        next.qsConfig = _qsEngine.getConfig();  // As clamped by the engine
+    }
+    if (memcmp(&next.sensorConfig, &before.sensorConfig, sizeof(next.sensorConfig)) != 0) {
+        _sensors.setCalibration(next.sensorConfig);
+        next.sensorConfig = _sensors.getCalibration();
+    }
+    if (sections & StorageHandler::DIRTY_TELEMETRY) {
+        _telemetryUpdateRate = next.telemetryConfig.updateRateMs;
+        _sampler.setSampleRate(next.telemetryConfig.sampleRateHz);
+        next.telemetryConfig.sampleRateHz = _sampler.getSampleRate();
+    }
+    // Network settings apply on the next reboot
+    _storage.saveConfig(next);
+    
+    // Report what actually changed, including any clamping
+    const size_t changed = ConfigPatch::diff(before, next, sections, reply.createNestedObject("changed"));
+    if (changed > ConfigPatch::MAX_CHANGED) {
+        reply["resync"] = true;     // Not all listed, fetch the config again
+    }
+    reply["rev"] = _storage.getRevision();
+    return 200;
+}
+
+void NetworkManager::handleConfigQuery(AsyncWebServerRequest* request) {
+    StorageHandler::SystemConfig sysConfig;
+    _storage.loadConfig(sysConfig);
+    
+    StaticJsonDocument<4096> doc;
+    if (!ConfigPatch::query(sysConfig, request->getParam("path")->value().c_str(), doc.createNestedObject("fields"))) {
+        request->send(404, "application/json", "{\"error\":\"Unknown field\"}");
+        return;
+    }
+    doc["rev"] = _storage.getRevision();
+    
+    char jsonBuffer[2048];
+    size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+    doc.clear();
+    if (jsonSize == 0 || jsonSize >= sizeof(jsonBuffer)) {
+        request->send(500, "text/plain", "Serialization failed");
+        return;
+    }
+    sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+}
+
+void NetworkManager::releasePatchBody(AsyncWebServerRequest* request) {
+    if (_patchBodies.release(request->_tempObject)) {
+        request->_tempObject = nullptr;
+    }
+}
+
+void NetworkManager::handleConfigPatchRequest(AsyncWebServerRequest* request) {
+    const char* body = static_cast<const char*>(request->_tempObject);
+    if (request->contentLength() > MAX_PATCH_SIZE) {
+        releasePatchBody(request);
+        request->send(413, "application/json", "{\"error\":\"patch too large\"}");
+        return;
+    }
+    if (!body) {
+        if (request->contentLength() > 0) {
+            // Every body slot taken by other PATCH requests
+            request->send(503, "application/json", "{\"error\":\"busy\"}");
+            return;
+        }
+        request->send(400, "application/json", "{\"error\":\"Expected {\\\"patch\\\":{..}}\"}");
+        return;
+    }
+    
+    // The document copies what it keeps, the slot is free again right away
+    StaticJsonDocument<MAX_PATCH_SIZE> doc;
+    const DeserializationError error = parseConfigPatch(doc, body, request->contentLength());
+    releasePatchBody(request);
+    if (error == DeserializationError::NoMemory || doc.overflowed()) {
+        request->send(413, "application/json", "{\"error\":\"patch too large\"}");
+        return;
+    }
+    if (error || !doc["patch"].is<JsonObject>()) {
+        request->send(400, "application/json", "{\"error\":\"Expected {\\\"patch\\\":{..}}\"}");
+        return;
+    }
+    
+    StaticJsonDocument<1536> reply;
+    JsonObject root = reply.to<JsonObject>();
+    if (!doc["id"].isNull()) root["id"] = doc["id"];
+    const int status = applyConfigPatch(doc["patch"].as<JsonObjectConst>(), root);
+    doc.clear();
+    
+    char jsonBuffer[MessagePool::LARGE_SIZE];
+    size_t jsonSize = serializeJson(reply, jsonBuffer, sizeof(jsonBuffer));
+    if (jsonSize == 0 || jsonSize >= sizeof(jsonBuffer)) {
+        request->send(500, "text/plain", "Serialization failed");
+        return;
+    }
+    sendPooled(request, status, "application/json", jsonBuffer, jsonSize);
+}
+
 void NetworkManager::setupHttpRoutes() {
     // Serve main page
     _server.on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        if (_assets.handle(request, "/index.html")) {
+            return;
+        }
         if (_storage.hasWebInterface()) {
             request->send(LittleFS, "/index.html", "text/html");
         } else {
@@ -467,6 +1037,9 @@ void NetworkManager::setupHttpRoutes() {
     
     // Serve dashboard page
     _server.on("/dashboard.html", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        if (_assets.handle(request)) {
+            return;
+        }
         if (LittleFS.exists("/dashboard.html")) {
             request->send(LittleFS, "/dashboard.html", "text/html");
         } else {
@@ -482,26 +1055,40 @@ void NetworkManager::setupHttpRoutes() {
     
     // Get current configuration
     _server.on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        StaticJsonDocument<1024> doc;
+        // ?path=qs.cutMap.cutTimeUs[2][7] reads one cell, ?path=qs.cutMap everything below it
+        if (request->hasParam("path")) {
+            handleConfigQuery(request);
+            return;
+        }
+        
+        StaticJsonDocument<4096> doc;
         
         // QuickShifter config
         auto qsConfig = _qsEngine.getConfig();
         JsonObject qs = doc.createNestedObject("qs");
         qs["minRpm"] = qsConfig.minRpmThreshold;
         qs["debounce"] = qsConfig.debounceTimeMs;
-        JsonArray cutTimeArray = qs.createNestedArray("cutTimeMap");
-        for (const auto& cutTime : qsConfig.cutTimeMap) {
-            cutTimeArray.add(cutTime);
-        }
+        qs["cutMode"] = QuickShifterEngine::cutModeToString(qsConfig.cutMode);
+        qs["minCutPercent"] = qsConfig.closedLoopMinPercent;
+        qs["dropPercent"] = qsConfig.closedLoopDropPercent;
+        qs["skipSparks"] = qsConfig.skipSparks;
+        qs["skipCycle"] = qsConfig.skipCycle;
+        qs["shiftSensor"] = QuickShifterEngine::shiftSensorModeToString(qsConfig.shiftSensorMode);
+        qs["forceThreshold"] = qsConfig.forceThreshold;
+        qs["forceHysteresis"] = qsConfig.forceHysteresis;
+        qs["minThrottle"] = qsConfig.minThrottle / 10.0f;
+        qs["triggerTeeth"] = qsConfig.triggerTeeth;
+        qs["triggerMissing"] = qsConfig.triggerMissing;
+        StorageHandler::writeCutMap(qs, qsConfig.cutMap);
         
-        // Network config (include passwords for owner access)
+        // Network config, passwords are write-only (export has them for backups)
         StorageHandler::NetworkConfig netConfig;
         _storage.loadNetworkConfig(netConfig);
         JsonObject net = doc.createNestedObject("network");
         net["apSsid"] = String(netConfig.apSsid);
-        net["apPassword"] = String(netConfig.apPassword);
+        net["apPasswordSet"] = netConfig.apPassword[0] != '\0';
         net["staSsid"] = String(netConfig.staSsid);
-        net["staPassword"] = String(netConfig.staPassword);
+        net["staPasswordSet"] = netConfig.staPassword[0] != '\0';
         net["staMode"] = netConfig.staMode;
         
         // Include stored error if present
@@ -512,9 +1099,18 @@ void NetworkManager::setupHttpRoutes() {
         // Telemetry config
         JsonObject tel = doc.createNestedObject("telemetry");
         tel["updateRate"] = _telemetryUpdateRate;
+        tel["sampleRate"] = _sampler.getSampleRate();
+        
+        // Sensor calibration, with the live input voltages for setting it up
+        JsonObject sensors = doc.createNestedObject("sensors");
+        StorageHandler::sensorConfigToJson(_sensors.getCalibration(), sensors);
+        sensors["tpsMv"] = _sensors.getTpsMv();
+        sensors["mapMv"] = _sensors.getMapMv();
         
         // System info
         doc["hwid"] = _hardwareId;
+        doc["configGen"] = _qsEngine.getConfigGeneration();
+        doc["rev"] = _storage.getRevision();
         doc["uptime"] = millis();
         
         // Error info
@@ -529,7 +1125,7 @@ void NetworkManager::setupHttpRoutes() {
             return;
         }
         
-        char jsonBuffer[1024];
+        char jsonBuffer[2048];
         size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
         
         if (jsonSize == 0 || jsonSize >= sizeof(jsonBuffer)) {
@@ -539,11 +1135,237 @@ void NetworkManager::setupHttpRoutes() {
         }
 
         doc.clear();
-        request->send(200, "application/json", jsonBuffer);
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    // Full configuration backup (same content as stored, as JSON)
+    _server.on("/api/config/export", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        StorageHandler::SystemConfig sysConfig;
+        _storage.loadConfig(sysConfig);
+        
+        StaticJsonDocument<4096> doc;
+        StorageHandler::configToJson(sysConfig, doc.to<JsonObject>());
+        doc["hwid"] = _hardwareId;
+        
+        if (doc.overflowed()) {
+            request->send(500, "text/plain", "Config too large");
+            doc.clear();
+            return;
+        }
+        
+        char jsonBuffer[2048];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        doc.clear();
+        if (jsonSize == 0 || jsonSize >= sizeof(jsonBuffer)) {
+            request->send(500, "text/plain", "Serialization failed");
+            return;
+        }
+        
+        AsyncWebServerResponse* response = beginPooledResponse(200, "application/json", jsonBuffer, jsonSize);
+        response->addHeader("Content-Disposition", "attachment; filename=\"config.json\"");
+        request->send(response);
+    });
+    
+    // Restore a backup, missing fields keep their current values
+    AsyncCallbackJsonWebHandler* importHandler = new AsyncCallbackJsonWebHandler("/api/config/import",
+        [this](AsyncWebServerRequest* request, JsonVariant& json) {
+            StorageHandler::SystemConfig sysConfig;
+            _storage.loadConfig(sysConfig);
+            if (!StorageHandler::configFromJson(json.as<JsonObject>(), sysConfig)) {
+                request->send(400, "application/json", "{\"error\":\"Expected a JSON object\"}");
+                return;
+            }
+            
+            // QS and telemetry apply now, network settings on the next reboot
+            _qsEngine.setConfig(sysConfig.qsConfig);
+            sysConfig.qsConfig = _qsEngine.getConfig();
+            _telemetryUpdateRate = sysConfig.telemetryConfig.updateRateMs;
+            _sampler.setSampleRate(sysConfig.telemetryConfig.sampleRateHz);
+            sysConfig.telemetryConfig.sampleRateHz = _sampler.getSampleRate();
+            _sensors.setCalibration(sysConfig.sensorConfig);
+            sysConfig.sensorConfig = _sensors.getCalibration();
+            _storage.saveConfig(sysConfig);
+            
+            request->send(200, "application/json", "{\"success\":true}");
+        });
+    importHandler->setMethod(HTTP_POST);
+    _server.addHandler(importHandler);
+    
+    // Field patch, same message and reply as over the WebSocket. The body
+    // is collected in a _patchBodies slot, no heap allocation per request.
+    _server.on("/api/config", HTTP_PATCH,
+        [this](AsyncWebServerRequest* request) {
+            handleConfigPatchRequest(request);
+        },
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            if (total > MAX_PATCH_SIZE) return;
+            if (index == 0 && !request->_tempObject) {
+                request->_tempObject = _patchBodies.allocate();
+                if (!request->_tempObject) return;
+                // Aborted uploads never reach the handler
+                request->onDisconnect([this, request]() { releasePatchBody(request); });
+            }
+            char* body = static_cast<char*>(request->_tempObject);
+            if (body && index + len <= total) {
+                memcpy(body + index, data, len);
+                if (index + len == total) body[total] = '\0';
+            }
+        });
+    
+    // Recorded shifts available for capture download (newest first)
+    _server.on("/api/telemetry/shifts", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        StaticJsonDocument<1024> doc;
+        doc["sampleRate"] = _sampler.getSampleRate();
+        doc["capacity"] = _sampler.getCapacity();
+        doc["head"] = _sampler.getHead();
+        
+        JsonArray shifts = doc.createNestedArray("shifts");
+        TelemetrySampler::Trigger trigger;
+        for (size_t i = 0; _sampler.getTrigger(i, trigger); i++) {
+            JsonObject shift = shifts.createNestedObject();
+            shift["t"] = trigger.timestampUs;
+            shift["rpm"] = trigger.rpm;
+            shift["cutUs"] = trigger.cutTimeUs;
+        }
+        
+        char jsonBuffer[1024];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    // Pre/post-trigger window of a recorded shift as binary frames
+    _server.on("/api/telemetry/capture", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleTelemetryCapture(request);
     });
     
+    // Per-shift summary records, newest count by default (from = first sequence number wanted)
+    _server.on("/api/analytics/shifts", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        size_t count = request->hasParam("count") ? request->getParam("count")->value().toInt() : ShiftAnalytics::MAX_QUERY;
+        if (count > ShiftAnalytics::MAX_QUERY) count = ShiftAnalytics::MAX_QUERY;
+        const uint32_t next = _analytics.getNext();
+        uint32_t from = next > count ? next - count : 0;
+        if (request->hasParam("from")) from = request->getParam("from")->value().toInt();
+        
+        StaticJsonDocument<3072> doc;
+        _analytics.toJson(from, count, doc.to<JsonObject>());
+        
+        char jsonBuffer[MessagePool::LARGE_SIZE];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    // Shift path latency/jitter histograms
+    _server.on("/api/perf", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        StaticJsonDocument<768> doc;
+        _qsEngine.getPerf().toJson(doc.to<JsonObject>());
+        
+        char jsonBuffer[640];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    // Boot stage timings and reset cause
+    _server.on("/api/boot", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        StaticJsonDocument<384> doc;
+        _boot.toJson(doc.to<JsonObject>());
+        
+        char jsonBuffer[256];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    // Message pool and heap fragmentation counters
+    _server.on("/api/memory", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        StaticJsonDocument<512> doc;
+        _messages.toJson(doc.to<JsonObject>());
+        
+        char jsonBuffer[512];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    _server.on("/api/perf/reset", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        _qsEngine.resetPerf();
+        request->send(200, "application/json", "{\"success\":true}");
+    });
+    
+    // Session log files
+    _server.on("/api/logs", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        StaticJsonDocument<1024> doc;
+        doc["active"] = _logger.isSessionActive();
+        doc["lostSamples"] = _logger.getLostSamples();
+        _logger.listFiles(doc.createNestedArray("files"));
+        
+        char jsonBuffer[1024];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    // Stream a log file straight from flash (chunked by the web server, never loaded into RAM)
+    _server.on("/api/logs/download", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        char path[32];
+        if (!request->hasParam("name") ||
+            !SessionLogger::getLogPath(request->getParam("name")->value().c_str(), path, sizeof(path)) ||
+            !LittleFS.exists(path)) {
+            request->send(404, "application/json", "{\"success\":false,\"message\":\"Log file not found\"}");
+            return;
+        }
+        request->send(LittleFS, path, "application/octet-stream", true);
+    });
+    
+    _server.on("/api/logs/delete", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        if (!request->hasParam("name", true) ||
+            !_logger.removeFile(request->getParam("name", true)->value().c_str())) {
+            request->send(400, "application/json", "{\"success\":false,\"message\":\"Cannot delete log file\"}");
+            return;
+        }
+        request->send(200, "application/json", "{\"success\":true}");
+    });
+    
+#if QS_HIL
+    // Bench pickup generator: status and reports, start ("scenario", "loopback") and stop
+    _server.on("/api/hil", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        if (!_hil) {
+            request->send(404, "text/plain", "No pickup simulator");
+            return;
+        }
+        StaticJsonDocument<4096> doc;
+        _hil->toJson(doc.to<JsonObject>());
+        
+        char jsonBuffer[2048];
+        size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
+        doc.clear();
+        if (jsonSize == 0 || jsonSize >= sizeof(jsonBuffer)) {
+            request->send(500, "text/plain", "Serialization failed");
+            return;
+        }
+        sendPooled(request, 200, "application/json", jsonBuffer, jsonSize);
+    });
+    
+    _server.on("/api/hil/start", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        const String scenario = request->hasParam("scenario", true)
+                              ? request->getParam("scenario", true)->value() : String("all");
+        const bool external = request->hasParam("loopback", true) &&
+                              request->getParam("loopback", true)->value() == "external";
+        if (!_hil || !_hil->start(scenario.c_str(), external ? PickupSimulator::Loopback::EXTERNAL
+                                                              : PickupSimulator::Loopback::INTERNAL)) {
+            request->send(409, "application/json",
+                          "{\"success\":false,\"message\":\"Busy, unknown scenario or pickup signal present\"}");
+            return;
+        }
+        request->send(200, "application/json", "{\"success\":true}");
+    });
+    
+    _server.on("/api/hil/stop", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        if (_hil) _hil->stop();
+        request->send(200, "application/json", "{\"success\":true}");
+    });
+#endif
+    
     // Reboot endpoint
-    _server.on("/api/reboot", HTTP_POST, [](AsyncWebServerRequest* request) {
+    _server.on("/api/reboot", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        _storage.flush();  // Don't lose a deferred config write
         request->send(200, "text/plain", "Rebooting...");
         delay(1000);
         ESP.restart();
@@ -593,20 +1415,16 @@ void NetworkManager::setupHttpRoutes() {
     
     // 404 handler
     _server.onNotFound([this](AsyncWebServerRequest* request) {
+        // Compressed asset table first, no filesystem access
+        if (_assets.handle(request)) {
+            return;
+        }
+        
         String path = request->url();
         
         // Try to serve file from LittleFS if it exists
         if (LittleFS.exists(path)) {
-            String contentType = "text/plain";
-            if (path.endsWith(".html")) contentType = "text/html";
-            else if (path.endsWith(".css")) contentType = "text/css";
-            else if (path.endsWith(".js")) contentType = "application/javascript";
-            else if (path.endsWith(".json")) contentType = "application/json";
-            else if (path.endsWith(".png")) contentType = "image/png";
-            else if (path.endsWith(".jpg")) contentType = "image/jpeg";
-            else if (path.endsWith(".ico")) contentType = "image/x-icon";
-            
-            request->send(LittleFS, path, contentType);
+            request->send(LittleFS, path, AssetServer::mimeType(path.c_str()));
             return;
         }
         
@@ -624,256 +1442,91 @@ void NetworkManager::setupHttpRoutes() {
     });
 }
 
-void NetworkManager::startOtaUpdate() {
-    _state = State::OTA_UPDATE;
-    _led.setStatus(LedController::Status::OTA_UPDATE);
-    
-    // First, update firmware
-    _ws.closeAll();           // Close all WebSocket connections
-    _ws.cleanupClients();     // Clean up WebSocket clients
-    _server.end();            // Stop the web server
+bool NetworkManager::startOtaUpdate(const String& url) {
+    if (WiFi.status() != WL_CONNECTED) {
+        _lastError = "Not connected to WiFi";
+        return false;
+    }
     
-    // Give time for connections to close
-    delay(500);
-
     Serial.printf("[OTA] Free heap: %d bytes\n", ESP.getFreeHeap());
-    const esp_partition_t* partition = esp_ota_get_next_update_partition(nullptr);
-    Serial.printf("[OTA] OTA Partition size: %u bytes\n", partition->size);
+    if (!_ota.startDownload(url, true)) {
+        return false;
+    }
     
-    bool firmwareSuccess = performOtaUpdate(true);
+    // Web server and WebSocket keep running, progress is pushed by updateOta()
+    _stateBeforeOta = _state;
+    _state = State::OTA_UPDATE;
+    return true;
+}
+
+void NetworkManager::updateOta() {
+    _ota.update();
     
-    if (!firmwareSuccess) {
+    const uint32_t revision = _ota.getRevision();
+    if (revision != _otaRevision) {
+        _otaRevision = revision;
+        broadcastOtaStatus();
         
+        // Engine states queue up behind the OTA colour until it is done
+        if (_ota.isBusy()) {
+            _led.holdStatus(LedController::Status::OTA_UPDATE);
+        } else {
+            _led.releaseStatus();
+        }
         
-          // Ensure error message is printed
-        _lastError = "Firmware update failed. Check firmware server and try again.";
-        StorageHandler::NetworkConfig netConfig;
-        _storage.loadNetworkConfig(netConfig);
-        strlcpy(netConfig.lastError, _lastError.c_str(), sizeof(netConfig.lastError));
-        _storage.saveNetworkConfig(netConfig);
-        _led.setStatus(LedController::Status::ERROR);
-        _led.setBlinking(true);
-        delay(3000);  // Give more time to read error
-        ESP.restart();
-        return;
+        if (_ota.getState() == OTAState::ERROR && _state == State::OTA_UPDATE) {
+            _state = _stateBeforeOta;
+            _lastError = String("OTA update failed: ") + OtaUpdater::errorToString(_ota.getError());
+            StorageHandler::NetworkConfig netConfig;
+            _storage.loadNetworkConfig(netConfig);
+            strlcpy(netConfig.lastError, _lastError.c_str(), sizeof(netConfig.lastError));
+            _storage.saveNetworkConfig(netConfig);
+        }
     }
     
-    
-    
-    
-    // Then, update filesystem
-    bool filesystemSuccess = performOtaUpdate(false);
-    
-    if (filesystemSuccess) {
-        
-        
-        _lastError = "";  // Clear any previous error
-        delay(1000);
-        ESP.restart();
-    } else {
-        
-        
-        
-        _lastError = "Filesystem update failed, but firmware is updated.";
-                StorageHandler::NetworkConfig netConfig;
-        _storage.loadNetworkConfig(netConfig);
-        strlcpy(netConfig.lastError, _lastError.c_str(), sizeof(netConfig.lastError));
-        _storage.saveNetworkConfig(netConfig);
-        
-        delay(2000);
+    if (_ota.isRebootDue()) {
+        Serial.println("[OTA] Rebooting...");
+        _ws.closeAll();
+        _storage.flush();
         ESP.restart();
     }
 }
 
-void update_started() {
-    Serial.println("CALLBACK:  HTTP update process started");
-}
-
-void update_finished() {
-    Serial.println("CALLBACK:  HTTP update process finished");
-    // set led to solid on to indicate completion
-}
-
-void update_progress(int cur, int total) {
-    Serial.printf("CALLBACK:  HTTP update process at %d of %d bytes...\n", cur, total);
-    // blink led to show progress
-}
-
-void update_error(int err) {
-    Serial.printf("CALLBACK:  HTTP update fatal error code %d\n", err);
-    // set led to error state
-}
-
-bool NetworkManager::performOtaUpdate(bool updateFirmware) {
-    if (WiFi.status() != WL_CONNECTED) {
-        
-        _lastError = "Not connected to WiFi";
-        return false;
+void NetworkManager::broadcastOtaStatus() {
+    if (_ws.count() == 0) return;
+    
+    char buffer[192];
+    int len = snprintf(buffer, sizeof(buffer),
+                       "{\"type\":\"ota\",\"state\":\"%s\",\"stage\":\"%s\",\"progress\":%u,"
+                       "\"written\":%u,\"total\":%u,\"error\":\"%s\"}",
+                       _ota.getStateString(), OtaUpdater::stageToString(_ota.getStage()),
+                       _ota.getProgress(), _ota.getWrittenSize(), _ota.getTotalSize(),
+                       OtaUpdater::errorToString(_ota.getError()));
+    if (len > 0 && len < (int)sizeof(buffer)) {
+        sendToChannel(CHANNEL_OTA, buffer, len);
     }
+}
 
-    // http client created outside from the HTTPupdate request so
-    // we can add custom headers
-    WiFiClientSecure wifiClient;
-    HTTPClient httpClient;
-
-    // wifiClient.setCACert(GITHUB_ROOT_CERT);
-    wifiClient.setInsecure(); // Temporary for testing - replace with proper cert validation
-    // HTTPupdate class does this automatically if we pass the wificlient
-    // in this case we are passing it the http client so
-    // we have to manually begin the req
-    httpClient.begin(wifiClient, "https://test.rsp-industries.com/firmware.bin");  // Start connection to the server
-    httpClient.setTimeout(30000);
-
-    // Add security headers
-    httpClient.addHeader("hwid", _hardwareId);     // HTTPupdate class adds ESP.getChipId() in the x-ESP8266-Chip-ID header
-
-    // Add functionality headers
-    // httpClient.addHeader("fwid", config.fw_version);
-    // httpClient.addHeader("fsid", config.fs_version);
-    // httpClient.addHeader("device", device);
-    // httpClient.addHeader("platform", platform);
-    // httpClient.addHeader("mode", firstTime ? "firmware" : "filesystem");
-    
-    HTTPUpdate myESPhttpUpdate;
-    
-    // Needed to follow redirects for GitHub releases
-    myESPhttpUpdate.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-    // Remove automatic reboot
-    myESPhttpUpdate.rebootOnUpdate(false);
-    // Add optional led flashing
-    myESPhttpUpdate.setLedPin(LED_BUILTIN, LOW);
-
-    // Add optional callback notifiers
-    myESPhttpUpdate.onStart(update_started);
-    myESPhttpUpdate.onEnd(update_finished);
-    myESPhttpUpdate.onProgress(update_progress);
-    myESPhttpUpdate.onError(update_error);
-    
-    Serial.println("Starting update from: " + String(OTA_UPDATE_URL));
-    t_httpUpdate_return ret = updateFirmware ? myESPhttpUpdate.update(httpClient) : myESPhttpUpdate.updateSpiffs(httpClient);
-    Serial.println("Update process returned: " + String(ret));
-    
-
-    if (ret == HTTP_UPDATE_FAILED) {
-        Serial.printf("HTTP_UPDATE_FAILED Error (%d): %s\n", myESPhttpUpdate.getLastError(), myESPhttpUpdate.getLastErrorString().c_str());
-        // char err[100];
-        // sprintf(err, "Update Failed: %s", myESPhttpUpdate.getLastErrorString().c_str());
-        // _lastError = err;
-        // _state = State::AP_MODE;
-        // saveConfiguration(config_file_path, config);
-        // delay(1500);
-        // ESP.restart();
-        return false;
-
-    } else {
-        if (ret == HTTP_UPDATE_NO_UPDATES) {
-            Serial.println("No updates available");
-            return false;
-        } else {
-            Serial.printf("Update %s successfully", updateFirmware ? "firmware" : "filesystem");
+void NetworkManager::broadcastPerf() {
+    bool hasSubscribers = false;
+    for (const auto& slot : _clients) {
+        if (slot.id != 0 && (slot.channels & CHANNEL_PERF)) {
+            hasSubscribers = true;
+            break;
         }
-
-        // if (firstTime) {
-        //     httpClient.end();
-        //     wifiClient.stop();
-        //     checkForUpdate(false);
-        // }
-        // else {
-        //     config.wifiMode = WIFI_AP;
-        //     saveConfiguration(config_file_path, config);
-        //     delay(1500);
-        //     ESP.restart();
-        // }
     }
-
-    
-    // // Create secure WiFi client and HTTP client
-    // WiFiClientSecure wifiClient;
-    // HTTPClient httpClient;
-    
-    // // Set SSL certificate for HTTPS
-    // wifiClient.setCACert(GITHUB_ROOT_CERT);
-    
-    // // Begin HTTPS connection
-    // String url = String(OTA_UPDATE_URL);
-    // if (!updateFirmware) {
-    //     // Change URL to filesystem.bin for filesystem update
-    //     url.replace("firmware.bin", "littlefs.bin");
-    // }
-    
-    // Serial.printf("[Network] Fetching %s update from: %s\n", 
-    //               updateFirmware ? "firmware" : "filesystem", url.c_str());
-    
-    // httpClient.begin(wifiClient, url);
-    // httpClient.setTimeout(15000);  // 15 second timeout
+    if (!hasSubscribers) return;
     
-    // // Add security and functionality headers (not query parameters)
-    // httpClient.addHeader("hwid", _hardwareId);
-    // httpClient.addHeader("fwid", FIRMWARE_VERSION);
-    // httpClient.addHeader("fsid", FILESYSTEM_VERSION);
-    // httpClient.addHeader("device", "QuickShifter");
-    // httpClient.addHeader("platform", "ESP32-S2");
-    // httpClient.addHeader("mode", updateFirmware ? "firmware" : "filesystem");
+    StaticJsonDocument<768> doc;
+    JsonObject root = doc.to<JsonObject>();
+    root["type"] = "perf";
+    _qsEngine.getPerf().toJson(root);
     
-    // int httpCode = httpClient.GET();
-    
-    // if (httpCode != HTTP_CODE_OK) {
-        
-    //     _lastError = "OTA failed: HTTP error " + String(httpCode);
-    //     httpClient.end();
-    //     return false;
-    // }
-    
-    // int contentLength = httpClient.getSize();
-    // if (contentLength <= 0) {
-        
-    //     _lastError = "OTA failed: Invalid " + String(updateFirmware ? "firmware" : "filesystem") + " file";
-    //     httpClient.end();
-    //     return false;
-    // }
-    
-    // Serial.printf("[Network] %s size: %d bytes\n", 
-    //               updateFirmware ? "Firmware" : "Filesystem", contentLength);
-    
-    // // Begin OTA update (firmware or filesystem)
-    // int updateType = updateFirmware ? U_FLASH : U_SPIFFS;
-    // if (!Update.begin(contentLength, updateType)) {
-        
-    //     _lastError = "OTA failed: " + String(Update.errorString());
-    //     httpClient.end();
-    //     return false;
-    // }
-    
-    // // Write firmware/filesystem
-    // WiFiClient* stream = httpClient.getStreamPtr();
-    // size_t written = Update.writeStream(*stream);
-    
-    // if (written != contentLength) {
-        
-    //     _lastError = "OTA failed: Incomplete write (" + String(written) + "/" + String(contentLength) + " bytes)";
-    //     httpClient.end();
-    //     return false;
-    // }
-    
-    // // Finalize update
-    // if (!Update.end()) {
-        
-    //     _lastError = "OTA failed: " + String(Update.errorString());
-    //     httpClient.end();
-    //     return false;
-    // }
-    
-    // if (!Update.isFinished()) {
-        
-    //     _lastError = "OTA failed: Update incomplete";
-    //     httpClient.end();
-    //     return false;
-    // }
-    
-    // httpClient.end();
-    // Serial.printf("[Network] %s OTA update completed successfully\n", 
-    //               updateFirmware ? "Firmware" : "Filesystem");
-    return true;
+    char buffer[640];
+    size_t len = serializeJson(doc, buffer, sizeof(buffer));
+    if (!doc.overflowed() && len > 0 && len < sizeof(buffer)) {
+        sendToChannel(CHANNEL_PERF, buffer, len);
+    }
 }
 
 void NetworkManager::setupMdns() {
@@ -919,114 +1572,6 @@ bool NetworkManager::checkSpace(size_t requiredSize) {
     return true;
 }
 
-bool NetworkManager::beginOTA(size_t size, int type) {
-    Serial.printf("[OTA] Beginning OTA update (type=%d)...\n", type);
-    
-    if (!Update.begin(size, type)) {
-        Serial.printf("[OTA] Begin failed: %s\n", Update.errorString());
-        return false;
-    }
-    
-    setOTAState(OTAState::WRITING);
-    return true;
-}
-
-bool NetworkManager::writeOTA(uint8_t* data, size_t len) {
-    size_t written = Update.write(data, len);
-    
-    if (written != len) {
-        Serial.printf("[OTA] Write failed: written=%d, expected=%d\n", written, len);
-        Serial.printf("[OTA] Error: %s\n", Update.errorString());
-        return false;
-    }
-    
-    _writtenSize += written;
-    return true;
-}
-
-bool NetworkManager::endOTA() {
-    Serial.println("[OTA] Finalizing OTA update...");
-    
-    if (!Update.end(true)) {
-        Serial.printf("[OTA] End failed: %s\n", Update.errorString());
-        return false;
-    }
-    
-    Serial.println("[OTA] OTA update finalized successfully");
-    return true;
-}
-
-void NetworkManager::setOTAState(OTAState state) {
-    _otaState = state;
-    Serial.printf("[OTA] State changed: %s\n", getOTAStateString());
-}
-
-void NetworkManager::setOTAError(OTAError error) {
-    _lastOtaError = error;
-    _otaState = OTAState::ERROR;
-    Serial.printf("[OTA] Error: %s\n", getOTAErrorString().c_str());
-}
-
-void NetworkManager::updateOTAProgress(size_t current, size_t total) {
-    if (total == 0) {
-        _otaProgress = 0;
-        return;
-    }
-    
-    _otaProgress = (current * 100) / total;
-    
-    // Log progress every second
-    unsigned long now = millis();
-    if (now - _lastProgressUpdate > 1000) {
-        Serial.printf("[OTA] Progress: %d%% (%d / %d bytes)\n", _otaProgress, current, total);
-        _lastProgressUpdate = now;
-    }
-}
-
-const char* NetworkManager::getOTAStateString() const {
-    switch (_otaState) {
-        case OTAState::IDLE:        return "IDLE";
-        case OTAState::CONNECTING:  return "CONNECTING";
-        case OTAState::DOWNLOADING: return "DOWNLOADING";
-        case OTAState::UPLOADING:   return "UPLOADING";
-        case OTAState::WRITING:     return "WRITING";
-        case OTAState::VERIFYING:   return "VERIFYING";
-        case OTAState::REBOOTING:   return "REBOOTING";
-        case OTAState::SUCCESS:     return "SUCCESS";
-        case OTAState::ERROR:       return "ERROR";
-        default:                    return "UNKNOWN";
-    }
-}
-
-String NetworkManager::getOTAErrorString() const {
-    return String(otaErrorToString(_lastOtaError));
-}
-
-const char* NetworkManager::otaErrorToString(OTAError error) const {
-    switch (error) {
-        case OTAError::NONE:                return "No error";
-        case OTAError::CONNECTION_REFUSED:  return "Connection refused";
-        case OTAError::TIMEOUT:             return "Timeout";
-        case OTAError::DNS_FAILED:          return "DNS resolution failed";
-        case OTAError::SSL_FAILED:          return "SSL/TLS error";
-        case OTAError::HTTP_404:            return "File not found (HTTP 404)";
-        case OTAError::HTTP_500:            return "Server error (HTTP 5xx)";
-        case OTAError::INVALID_RESPONSE:    return "Invalid HTTP response";
-        case OTAError::FILE_TOO_LARGE:      return "File too large";
-        case OTAError::PARTITION_NOT_FOUND: return "OTA partition not found";
-        case OTAError::FLASH_WRITE_FAILED:  return "Flash write failed";
-        case OTAError::FLASH_VERIFY_FAILED: return "Flash verification failed";
-        case OTAError::INSUFFICIENT_SPACE:  return "Insufficient space";
-        case OTAError::OTA_BEGIN_FAILED:    return "OTA begin failed";
-        case OTAError::OTA_END_FAILED:      return "OTA end failed";
-        case OTAError::ROLLBACK_FAILED:     return "Rollback failed";
-        case OTAError::INVALID_URL:         return "Invalid URL";
-        case OTAError::INVALID_FILE:        return "Invalid file";
-        case OTAError::UNKNOWN:             return "Unknown error";
-        default:                            return "Undefined error";
-    }
-}
-
 String NetworkManager::getCurrentPartition() const {
     const esp_partition_t* partition = esp_ota_get_running_partition();
     
@@ -1064,32 +1609,6 @@ bool NetworkManager::canRollback() const {
     return (partition != nullptr);
 }
 
-bool NetworkManager::rollback() {
-    Serial.println("[OTA] Performing manual rollback...");
-    
-    const esp_partition_t* partition = esp_ota_get_last_invalid_partition();
-    
-    if (!partition) {
-        Serial.println("[OTA] No partition available for rollback");
-        setOTAError(OTAError::ROLLBACK_FAILED);
-        return false;
-    }
-    
-    esp_err_t err = esp_ota_set_boot_partition(partition);
-    
-    if (err != ESP_OK) {
-        Serial.printf("[OTA] Rollback failed: %d\n", err);
-        setOTAError(OTAError::ROLLBACK_FAILED);
-        return false;
-    }
-    
-    Serial.println("[OTA] Rollback successful, rebooting...");
-    delay(1000);
-    ESP.restart();
-    
-    return true;
-}
-
 String NetworkManager::getPartitionInfo() const {
     String info = "{";
     
@@ -1109,6 +1628,9 @@ String NetworkManager::getPartitionInfo() const {
 
 // OTA HTTP Handlers
 void NetworkManager::handleOTAPage(AsyncWebServerRequest* request) {
+    if (_assets.handle(request, "/ota.html")) {
+        return;
+    }
     if (LittleFS.exists("/ota.html")) {
         request->send(LittleFS, "/ota.html", "text/html");
     } else {
@@ -1129,8 +1651,8 @@ void NetworkManager::handleOTAInfo(AsyncWebServerRequest* request) {
     json += "\"available_space\":" + String(getAvailableSpace()) + ",";
     json += "\"max_firmware_size\":" + String(getMaxFirmwareSize()) + ",";
     json += "\"can_rollback\":" + String(canRollback() ? "true" : "false") + ",";
-    json += "\"state\":\"" + String(getOTAStateString()) + "\",";
-    json += "\"progress\":" + String(_otaProgress);
+    json += "\"state\":\"" + String(_ota.getStateString()) + "\",";
+    json += "\"progress\":" + String(_ota.getProgress());
     json += "}";
     
     request->send(200, "application/json", json);
@@ -1149,19 +1671,23 @@ void NetworkManager::handleOTAURL(AsyncWebServerRequest* request) {
         return;
     }
     
-    request->send(200, "application/json", "{\"success\":true,\"message\":\"Update started\"}");
+    if (!startOtaUpdate(url)) {
+        String error = "{\"success\":false,\"message\":\"";
+        error += _ota.isBusy() ? OtaUpdater::errorToString(OTAError::BUSY) : _lastError.c_str();
+        error += "\"}";
+        request->send(409, "application/json", error);
+        return;
+    }
     
-    // Start update in background
-    // Note: This is a simplified version - in production you'd want to handle this asynchronously
-    delay(100);
-    startOtaUpdate();
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Update started\"}");
 }
 
 void NetworkManager::handleOTAStatus(AsyncWebServerRequest* request) {
     String json = "{";
-    json += "\"state\":\"" + String(getOTAStateString()) + "\",";
-    json += "\"progress\":" + String(_otaProgress) + ",";
-    json += "\"error\":\"" + getOTAErrorString() + "\"";
+    json += "\"state\":\"" + String(_ota.getStateString()) + "\",";
+    json += "\"stage\":\"" + String(OtaUpdater::stageToString(_ota.getStage())) + "\",";
+    json += "\"progress\":" + String(_ota.getProgress()) + ",";
+    json += "\"error\":\"" + String(OtaUpdater::errorToString(_ota.getError())) + "\"";
     json += "}";
     
     request->send(200, "application/json", json);
@@ -1173,84 +1699,56 @@ void NetworkManager::handleOTARollback(AsyncWebServerRequest* request) {
         return;
     }
     
-    request->send(200, "application/json", "{\"success\":true,\"message\":\"Rollback initiated\"}");
+    if (!_ota.rollback()) {
+        String error = "{\"success\":false,\"message\":\"";
+        error += _ota.isBusy() ? OtaUpdater::errorToString(OTAError::BUSY) : OtaUpdater::errorToString(_ota.getError());
+        error += "\"}";
+        request->send(500, "application/json", error);
+        return;
+    }
     
-    delay(100);
-    rollback();
+    // Reboot follows from updateOta() once the response is out
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Rollback initiated\"}");
 }
 
 void NetworkManager::handleOTAUpload(AsyncWebServerRequest* request) {
-    // This is called after upload completes
-    if (Update.hasError()) {
-        String error = "{\"success\":false,\"message\":\"" + String(Update.errorString()) + "\"}";
+    // Called after the last chunk, the writer task may still be verifying
+    if (!_uploadAccepted) {
+        String error = "{\"success\":false,\"message\":\"";
+        error += _ota.isBusy() ? OtaUpdater::errorToString(OTAError::BUSY) : OtaUpdater::errorToString(_ota.getError());
+        error += "\"}";
+        request->send(409, "application/json", error);
+    } else if (_ota.getState() == OTAState::ERROR) {
+        String error = "{\"success\":false,\"message\":\"" + String(OtaUpdater::errorToString(_ota.getError())) + "\"}";
         request->send(500, "application/json", error);
-        setOTAState(OTAState::ERROR);
-        setOTAError(OTAError::FLASH_WRITE_FAILED);
-        _updateInProgress = false;
     } else {
-        request->send(200, "application/json", "{\"success\":true,\"message\":\"Update successful\"}");
-        setOTAState(OTAState::SUCCESS);
-        _updateInProgress = false;
-        
-        Serial.println("[OTA] Upload successful! Rebooting in 3 seconds...");
-        delay(3000);
-        ESP.restart();
+        request->send(200, "application/json", "{\"success\":true,\"message\":\"Upload received, verifying\"}");
     }
+    _uploadAccepted = false;
 }
 
 void NetworkManager::handleOTAUploadData(AsyncWebServerRequest* request, String filename, 
                                          size_t index, uint8_t* data, size_t len, bool final) {
     if (index == 0) {
-        Serial.printf("[OTA] Upload started: %s\n", filename.c_str());
-        
-        _updateInProgress = true;
-        _otaStartTime = millis();
-        _writtenSize = 0;
-        _totalSize = 0;
-        _otaProgress = 0;
-        
-        // Determine update type from filename
-        int updateType = U_FLASH;
-        if (filename.indexOf("littlefs") >= 0 || filename.indexOf("spiffs") >= 0 || 
-            filename.indexOf("filesystem") >= 0) {
-            updateType = U_SPIFFS;
-            Serial.println("[OTA] Filesystem update detected");
-        } else {
-            Serial.println("[OTA] Firmware update detected");
-        }
+        const OtaUpdater::Stage stage = OtaUpdater::stageForName(filename);
+        Serial.printf("[OTA] Upload started: %s (%s)\n", filename.c_str(), OtaUpdater::stageToString(stage));
         
-        setOTAState(OTAState::UPLOADING);
-        
-        if (!Update.begin(UPDATE_SIZE_UNKNOWN, updateType)) {
-            Serial.printf("[OTA] Begin failed: %s\n", Update.errorString());
-            setOTAError(OTAError::OTA_BEGIN_FAILED);
+        // Multipart overhead makes the request a bit longer than the image
+        _uploadAccepted = _ota.beginUpload(stage, request->contentLength());
+        if (_uploadAccepted) {
+            _stateBeforeOta = _state;
+            _state = State::OTA_UPDATE;
         }
     }
+    if (!_uploadAccepted) return;
     
+    // Copies into the free buffer, the writer task flashes the other one
     if (len) {
-        if (Update.write(data, len) != len) {
-            Serial.printf("[OTA] Write failed: %s\n", Update.errorString());
-            setOTAError(OTAError::FLASH_WRITE_FAILED);
-        } else {
-            _writtenSize += len;
-            
-            // Update progress (approximate since we don't know total size)
-            unsigned long now = millis();
-            if (now - _lastProgressUpdate > 1000) {
-                Serial.printf("[OTA] Uploaded: %d bytes\n", _writtenSize);
-                _lastProgressUpdate = now;
-            }
-        }
+        _ota.feedUpload(data, len);
     }
     
     if (final) {
-        if (Update.end(true)) {
-            Serial.printf("[OTA] Upload complete: %d bytes\n", index + len);
-            _totalSize = index + len;
-            _otaProgress = 100;
-        } else {
-            Serial.printf("[OTA] End failed: %s\n", Update.errorString());
-            setOTAError(OTAError::OTA_END_FAILED);
-        }
+        Serial.printf("[OTA] Upload complete: %u bytes\n", index + len);
+        _ota.finishUpload();
     }
 }
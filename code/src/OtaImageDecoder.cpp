@@ -0,0 +1,344 @@
+#include "OtaImageDecoder.hpp"
+#include <esp_heap_caps.h>
+#include <esp_ota_ops.h>
+
+namespace {
+constexpr char MAGIC[OtaImageDecoder::MAGIC_SIZE] = {'Q', 'O', 'T', 'A'};
+
+void* allocate(size_t size) {
+    void* memory = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return memory ? memory : heap_caps_malloc(size, MALLOC_CAP_8BIT);
+}
+
+uint32_t readLe32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+}
+
+OtaImageDecoder::OtaImageDecoder()
+    : _type(U_FLASH)
+    , _inputSize(0)
+    , _phase(Phase::HEADER)
+    , _error(OTAError::NONE)
+    , _started(false)
+    , _header{}
+    , _headerLength(0)
+    , _flags(0)
+    , _imageWritten(0)
+    , _inflator(nullptr)
+    , _dict(nullptr)
+    , _dictOffset(0)
+    , _inflateDone(false)
+    , _base(nullptr)
+    , _basePos(0)
+    , _patchPhase(PatchPhase::CONTROL)
+    , _control{}
+    , _controlLength(0)
+    , _addRemaining(0)
+    , _copyRemaining(0)
+    , _seek(0)
+{
+    mbedtls_sha256_init(&_sha);
+}
+
+OtaImageDecoder::~OtaImageDecoder() {
+    release();
+    mbedtls_sha256_free(&_sha);
+}
+
+void OtaImageDecoder::begin(int type, size_t inputSize) {
+    release();
+    _type = type;
+    _inputSize = inputSize;
+    _phase = Phase::HEADER;
+    _error = OTAError::NONE;
+    _started = false;
+    _headerLength = 0;
+    _flags = 0;
+    _imageWritten = 0;
+    _dictOffset = 0;
+    _inflateDone = false;
+    _base = nullptr;
+    _basePos = 0;
+    _patchPhase = PatchPhase::CONTROL;
+    _controlLength = 0;
+    mbedtls_sha256_starts_ret(&_sha, 0);
+}
+
+bool OtaImageDecoder::write(const uint8_t* data, size_t len) {
+    if (_error != OTAError::NONE) return false;
+
+    if (_phase == Phase::HEADER && !consumeHeader(data, len)) return false;
+    if (len == 0) return true;
+
+    if (_phase == Phase::RAW) return emit(data, len);
+    return (_flags & COMPRESSED) ? inflate(data, len) : unpack(data, len);
+}
+
+bool OtaImageDecoder::consumeHeader(const uint8_t*& data, size_t& len) {
+    uint8_t* header = reinterpret_cast<uint8_t*>(&_header);
+
+    // The magic decides between a plain image and a container
+    while (_headerLength < MAGIC_SIZE && len > 0) {
+        header[_headerLength++] = *data++;
+        len--;
+    }
+    if (_headerLength < MAGIC_SIZE) return true;
+
+    if (memcmp(_header.magic, MAGIC, MAGIC_SIZE) != 0) {
+        _phase = Phase::RAW;
+        return startImage(_inputSize) && emit(header, MAGIC_SIZE);
+    }
+
+    const size_t needed = sizeof(Header) - _headerLength;
+    const size_t chunk = len < needed ? len : needed;
+    memcpy(header + _headerLength, data, chunk);
+    _headerLength += chunk;
+    data += chunk;
+    len -= chunk;
+    if (_headerLength < sizeof(Header)) return true;
+
+    _flags = _header.flags;
+    Serial.printf("[OTA] Image container: %u bytes%s%s\n", _header.imageSize,
+                  (_flags & COMPRESSED) ? ", compressed" : "", (_flags & DELTA) ? ", delta" : "");
+    if (_header.version != FORMAT_VERSION || (_flags & ~(COMPRESSED | DELTA)) || _header.imageSize == 0) {
+        return fail(OTAError::INVALID_FILE);
+    }
+
+    if (_flags & DELTA) {
+        // The app partition being replaced is the only base there is
+        if (_type != U_FLASH) return fail(OTAError::INVALID_FILE);
+        if (!verifyBase()) return false;
+    }
+
+    if (_flags & COMPRESSED) {
+        _inflator = static_cast<tinfl_decompressor*>(allocate(sizeof(tinfl_decompressor)));
+        _dict = static_cast<uint8_t*>(allocate(DICT_SIZE));
+        if (!_inflator || !_dict) {
+            Serial.println("[OTA] No memory for the inflate window");
+            return fail(OTAError::INSUFFICIENT_SPACE);
+        }
+        tinfl_init(_inflator);
+    }
+
+    _phase = Phase::PAYLOAD;
+    return startImage(_header.imageSize);
+}
+
+bool OtaImageDecoder::startImage(size_t size) {
+    if (!Update.begin(size ? size : UPDATE_SIZE_UNKNOWN, _type)) {
+        Serial.printf("[OTA] Begin failed: %s\n", Update.errorString());
+        return fail(Update.getError() == UPDATE_ERROR_SIZE ? OTAError::FILE_TOO_LARGE : OTAError::OTA_BEGIN_FAILED);
+    }
+    _started = true;
+    return true;
+}
+
+bool OtaImageDecoder::verifyBase() {
+    _base = esp_ota_get_running_partition();
+    if (!_base || _header.baseSize == 0 || _header.baseSize > _base->size) {
+        return fail(OTAError::BASE_MISMATCH);
+    }
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    for (uint32_t offset = 0; offset < _header.baseSize; offset += BASE_CHUNK) {
+        const uint32_t remaining = _header.baseSize - offset;
+        const size_t chunk = remaining < BASE_CHUNK ? remaining : BASE_CHUNK;
+        if (esp_partition_read(_base, offset, _baseChunk, chunk) != ESP_OK) {
+            mbedtls_sha256_free(&sha);
+            return fail(OTAError::BASE_MISMATCH);
+        }
+        mbedtls_sha256_update_ret(&sha, _baseChunk, chunk);
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (memcmp(digest, _header.baseSha256, sizeof(digest)) != 0) {
+        Serial.printf("[OTA] Delta base is not the running firmware (%s)\n", _base->label);
+        return fail(OTAError::BASE_MISMATCH);
+    }
+    return true;
+}
+
+bool OtaImageDecoder::inflate(const uint8_t* data, size_t len) {
+    if (_inflateDone) return true;  // Trailing bytes after the stream
+
+    for (;;) {
+        size_t inBytes = len;
+        size_t outBytes = DICT_SIZE - _dictOffset;
+        const tinfl_status status = tinfl_decompress(_inflator, data, &inBytes, _dict, _dict + _dictOffset,
+                                                     &outBytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        data += inBytes;
+        len -= inBytes;
+
+        if (outBytes > 0 && !unpack(_dict + _dictOffset, outBytes)) return false;
+        _dictOffset = (_dictOffset + outBytes) & (DICT_SIZE - 1);
+
+        if (status == TINFL_STATUS_DONE) {
+            _inflateDone = true;
+            return true;
+        }
+        if (status < TINFL_STATUS_DONE) {
+            Serial.printf("[OTA] Inflate failed: %d\n", status);
+            return fail(OTAError::DECOMPRESS_FAILED);
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            return true;  // All input consumed
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: window wrapped, keep going
+    }
+}
+
+bool OtaImageDecoder::unpack(const uint8_t* data, size_t len) {
+    return (_flags & DELTA) ? patch(data, len) : emit(data, len);
+}
+
+bool OtaImageDecoder::patch(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        switch (_patchPhase) {
+            case PatchPhase::CONTROL: {
+                const size_t needed = CONTROL_SIZE - _controlLength;
+                const size_t chunk = len < needed ? len : needed;
+                memcpy(_control + _controlLength, data, chunk);
+                _controlLength += chunk;
+                data += chunk;
+                len -= chunk;
+                if (_controlLength < CONTROL_SIZE) break;
+
+                _controlLength = 0;
+                _addRemaining = readLe32(_control);
+                _copyRemaining = readLe32(_control + 4);
+                _seek = static_cast<int32_t>(readLe32(_control + 8));
+                _patchPhase = PatchPhase::ADD;
+                break;
+            }
+
+            case PatchPhase::ADD: {
+                size_t chunk = len < BASE_CHUNK ? len : BASE_CHUNK;
+                if (chunk > _addRemaining) chunk = _addRemaining;
+                if (chunk > 0) {
+                    if (_basePos < 0 || _basePos + chunk > _header.baseSize ||
+                        esp_partition_read(_base, _basePos, _baseChunk, chunk) != ESP_OK) {
+                        return fail(OTAError::INVALID_FILE);
+                    }
+                    for (size_t i = 0; i < chunk; i++) {
+                        _baseChunk[i] += data[i];
+                    }
+                    if (!emit(_baseChunk, chunk)) return false;
+                    _basePos += chunk;
+                    _addRemaining -= chunk;
+                    data += chunk;
+                    len -= chunk;
+                }
+                if (_addRemaining == 0) _patchPhase = PatchPhase::COPY;
+                break;
+            }
+
+            case PatchPhase::COPY: {
+                const size_t chunk = len < _copyRemaining ? len : _copyRemaining;
+                if (chunk > 0) {
+                    if (!emit(data, chunk)) return false;
+                    _copyRemaining -= chunk;
+                    data += chunk;
+                    len -= chunk;
+                }
+                if (_copyRemaining == 0) {
+                    _basePos += _seek;
+                    _patchPhase = PatchPhase::CONTROL;
+                }
+                break;
+            }
+        }
+    }
+
+    // A record without add/copy bytes completes without more input
+    if (_patchPhase == PatchPhase::ADD && _addRemaining == 0) _patchPhase = PatchPhase::COPY;
+    if (_patchPhase == PatchPhase::COPY && _copyRemaining == 0) {
+        _basePos += _seek;
+        _patchPhase = PatchPhase::CONTROL;
+    }
+    return true;
+}
+
+bool OtaImageDecoder::emit(const uint8_t* data, size_t len) {
+    if (_phase == Phase::PAYLOAD && _imageWritten + len > _header.imageSize) {
+        return fail(OTAError::INVALID_FILE);
+    }
+
+    mbedtls_sha256_update_ret(&_sha, data, len);
+    if (Update.write(const_cast<uint8_t*>(data), len) != len) {
+        Serial.printf("[OTA] Write failed: %s\n", Update.errorString());
+        return fail(OTAError::FLASH_WRITE_FAILED);
+    }
+    _imageWritten += len;
+    return true;
+}
+
+bool OtaImageDecoder::finish() {
+    if (_error != OTAError::NONE) {
+        abort();
+        return false;
+    }
+
+    if (_phase == Phase::HEADER) {
+        // Shorter than a magic or a container header
+        abort();
+        return fail(OTAError::INVALID_FILE);
+    }
+
+    if (_phase == Phase::PAYLOAD) {
+        const bool complete = _imageWritten == _header.imageSize &&
+                              (!(_flags & COMPRESSED) || _inflateDone) &&
+                              (!(_flags & DELTA) || (_patchPhase == PatchPhase::CONTROL && _controlLength == 0));
+        uint8_t digest[32];
+        mbedtls_sha256_finish_ret(&_sha, digest);
+        if (!complete) {
+            Serial.printf("[OTA] Image incomplete: %u / %u bytes\n", _imageWritten, _header.imageSize);
+            abort();
+            return fail(OTAError::INVALID_FILE);
+        }
+        // Checked before Update.end(), which switches the boot partition
+        if (memcmp(digest, _header.imageSha256, sizeof(digest)) != 0) {
+            Serial.println("[OTA] Image SHA-256 mismatch");
+            abort();
+            return fail(OTAError::FLASH_VERIFY_FAILED);
+        }
+    }
+
+    release();
+    const bool sizeKnown = _phase == Phase::PAYLOAD || _inputSize > 0;
+    if (!Update.end(!sizeKnown)) {
+        Serial.printf("[OTA] End failed: %s\n", Update.errorString());
+        _started = false;
+        return fail(Update.getError() == UPDATE_ERROR_MD5 || Update.getError() == UPDATE_ERROR_MAGIC_BYTE ?
+                    OTAError::FLASH_VERIFY_FAILED : OTAError::OTA_END_FAILED);
+    }
+    _started = false;
+    return true;
+}
+
+void OtaImageDecoder::abort() {
+    if (_started) {
+        Update.abort();
+        _started = false;
+    }
+    release();
+}
+
+bool OtaImageDecoder::fail(OTAError error) {
+    if (_error == OTAError::NONE) {
+        _error = error;
+    }
+    return false;
+}
+
+void OtaImageDecoder::release() {
+    free(_inflator);
+    free(_dict);
+    _inflator = nullptr;
+    _dict = nullptr;
+}
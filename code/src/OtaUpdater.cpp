@@ -0,0 +1,467 @@
+#include "OtaUpdater.hpp"
+#include "TaskManager.hpp"
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <esp_ota_ops.h>
+
+OtaUpdater::OtaUpdater()
+    : _free(nullptr)
+    , _filled(nullptr)
+    , _stageDone(nullptr)
+    , _downloadTask(nullptr)
+    , _fillIndex(-1)
+    , _fillLength(0)
+    , _busy(false)
+    , _uploading(false)
+    , _state(OTAState::IDLE)
+    , _error(OTAError::NONE)
+    , _stage(Stage::NONE)
+    , _progress(0)
+    , _written(0)
+    , _total(0)
+    , _revision(0)
+    , _lastActivity(0)
+    , _lastProgressLog(0)
+    , _finalStage(false)
+    , _rebootAt(0)
+    , _withFilesystem(false)
+{
+}
+
+bool OtaUpdater::begin(const String& hardwareId) {
+    _hardwareId = hardwareId;
+
+    _free = xQueueCreate(BUFFER_COUNT, sizeof(uint8_t));
+    _filled = xQueueCreate(BUFFER_COUNT, sizeof(Block));
+    _stageDone = xSemaphoreCreateBinary();
+    if (!_free || !_filled || !_stageDone) {
+        Serial.println("[OTA] Failed to create buffer queues");
+        return false;
+    }
+    for (uint8_t i = 0; i < BUFFER_COUNT; i++) {
+        xQueueSend(_free, &i, 0);
+    }
+
+    TaskHandle_t writerTask = nullptr;
+    if (xTaskCreatePinnedToCore(writerTaskEntry, "OtaWrite", WRITER_STACK_SIZE, this,
+                                PRIORITY_WRITER, &writerTask, TaskManager::TASK_CORE) != pdPASS ||
+        xTaskCreatePinnedToCore(downloadTaskEntry, "OtaFetch", DOWNLOAD_STACK_SIZE, this,
+                                PRIORITY_DOWNLOAD, &_downloadTask, TaskManager::TASK_CORE) != pdPASS) {
+        Serial.println("[OTA] Failed to create OTA tasks");
+        _downloadTask = nullptr;
+        return false;
+    }
+    return true;
+}
+
+OtaUpdater::Stage OtaUpdater::stageForName(const String& name) {
+    if (name.indexOf("littlefs") >= 0 || name.indexOf("spiffs") >= 0 ||
+        name.indexOf("filesystem") >= 0) {
+        return Stage::FILESYSTEM;
+    }
+    return Stage::FIRMWARE;
+}
+
+bool OtaUpdater::startDownload(const String& url, bool withFilesystem) {
+    if (_busy || !_downloadTask) {
+        return false;
+    }
+
+    _busy = true;
+    _error = OTAError::NONE;
+    _url = url;
+    _withFilesystem = withFilesystem;
+    setState(OTAState::CONNECTING);
+    xTaskNotifyGive(_downloadTask);
+    return true;
+}
+
+bool OtaUpdater::beginUpload(Stage stage, size_t expectedSize) {
+    if (_busy || !_downloadTask) {
+        return false;
+    }
+
+    _busy = true;
+    _error = OTAError::NONE;
+    beginImage(stage, 0, true);
+    _total = expectedSize;
+    _uploading = true;
+    setState(OTAState::UPLOADING);
+    return true;
+}
+
+bool OtaUpdater::feedUpload(const uint8_t* data, size_t len) {
+    if (!_uploading) return false;
+
+    while (len > 0) {
+        uint8_t* buffer = nullptr;
+        size_t space = 0;
+        if (!reserve(buffer, space)) return false;
+
+        const size_t chunk = len < space ? len : space;
+        memcpy(buffer, data, chunk);
+        data += chunk;
+        len -= chunk;
+        if (!commit(chunk)) return false;
+    }
+    return true;
+}
+
+bool OtaUpdater::finishUpload() {
+    if (!_uploading) return false;
+
+    _uploading = false;
+    return submit(true);
+}
+
+bool OtaUpdater::rollback() {
+    if (_busy) {
+        return false;
+    }
+
+    const esp_partition_t* partition = esp_ota_get_last_invalid_partition();
+    if (!partition) {
+        Serial.println("[OTA] No partition available for rollback");
+        fail(OTAError::ROLLBACK_FAILED);
+        return false;
+    }
+
+    const esp_err_t err = esp_ota_set_boot_partition(partition);
+    if (err != ESP_OK) {
+        Serial.printf("[OTA] Rollback failed: %d\n", err);
+        fail(OTAError::ROLLBACK_FAILED);
+        return false;
+    }
+
+    Serial.printf("[OTA] Rollback to %s, rebooting...\n", partition->label);
+    _busy = true;
+    setState(OTAState::REBOOTING);
+    scheduleReboot();
+    return true;
+}
+
+void OtaUpdater::update() {
+    // A browser that went away mid-upload never sends the final chunk
+    if (!_uploading || millis() - _lastActivity < STREAM_TIMEOUT_MS) return;
+    if (uxQueueMessagesWaiting(_filled) > 0) return;  // Writer still busy
+
+    Serial.println("[OTA] Upload stalled, aborting");
+    _uploading = false;
+    if (_fillIndex >= 0) {
+        const uint8_t index = _fillIndex;
+        _fillIndex = -1;
+        xQueueSend(_free, &index, 0);
+    }
+    fail(OTAError::TIMEOUT);
+    _decoder.abort();
+    _busy = false;
+}
+
+bool OtaUpdater::isRebootDue() const {
+    return _rebootAt != 0 && static_cast<int32_t>(millis() - _rebootAt) >= 0;
+}
+
+void OtaUpdater::downloadTaskEntry(void* context) {
+    static_cast<OtaUpdater*>(context)->runDownload();
+}
+
+void OtaUpdater::writerTaskEntry(void* context) {
+    static_cast<OtaUpdater*>(context)->runWriter();
+}
+
+void OtaUpdater::runDownload() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const Stage stage = stageForName(_url);
+        const bool withFilesystem = _withFilesystem && stage == Stage::FIRMWARE &&
+                                    _url.indexOf("firmware.bin") >= 0;
+
+        if (downloadImage(_url, stage, !withFilesystem) && withFilesystem) {
+            String filesystemUrl = _url;
+            filesystemUrl.replace("firmware.bin", "littlefs.bin");
+            if (!downloadImage(filesystemUrl, Stage::FILESYSTEM, true)) {
+                // The new firmware is already the boot partition
+                Serial.println("[OTA] Filesystem update failed, booting the new firmware anyway");
+                scheduleReboot();
+            }
+        }
+    }
+}
+
+bool OtaUpdater::downloadImage(const String& url, Stage stage, bool finalStage) {
+    _stage = stage;
+    setState(OTAState::CONNECTING);
+    Serial.printf("[OTA] Fetching %s from %s\n", stageToString(stage), url.c_str());
+
+    WiFiClientSecure client;
+    client.setInsecure();  // Temporary for testing - replace with proper cert validation
+    HTTPClient http;
+    http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);  // GitHub release assets redirect
+    http.setTimeout(STREAM_TIMEOUT_MS);
+    if (!http.begin(client, url)) {
+        fail(OTAError::INVALID_URL);
+        _busy = false;
+        return false;
+    }
+    http.addHeader("hwid", _hardwareId);
+    http.addHeader("mode", stage == Stage::FILESYSTEM ? "filesystem" : "firmware");
+
+    const int code = http.GET();
+    if (code != HTTP_CODE_OK) {
+        Serial.printf("[OTA] HTTP %d\n", code);
+        fail(code == HTTP_CODE_NOT_FOUND ? OTAError::HTTP_404 :
+             code >= 500                 ? OTAError::HTTP_500 :
+             code == HTTPC_ERROR_READ_TIMEOUT ? OTAError::TIMEOUT :
+             code < 0                    ? OTAError::CONNECTION_REFUSED :
+                                           OTAError::INVALID_RESPONSE);
+        http.end();
+        _busy = false;
+        return false;
+    }
+
+    const int size = http.getSize();
+    if (size <= 0) {
+        fail(OTAError::INVALID_FILE);
+        http.end();
+        _busy = false;
+        return false;
+    }
+    beginImage(stage, size, finalStage);
+    setState(OTAState::DOWNLOADING);
+
+    // Receive straight into the buffer the writer is not flashing
+    WiFiClient* stream = http.getStreamPtr();
+    size_t remaining = size;
+    while (remaining > 0) {
+        uint8_t* buffer = nullptr;
+        size_t space = 0;
+        if (!reserve(buffer, space)) break;
+
+        const size_t available = stream->available();
+        if (available == 0) {
+            if (!stream->connected()) {
+                fail(OTAError::INVALID_RESPONSE);
+                break;
+            }
+            if (millis() - _lastActivity > STREAM_TIMEOUT_MS) {
+                fail(OTAError::TIMEOUT);
+                break;
+            }
+            vTaskDelay(1);
+            continue;
+        }
+
+        size_t chunk = available < space ? available : space;
+        if (chunk > remaining) chunk = remaining;
+        const int received = stream->read(buffer, chunk);
+        if (received <= 0) continue;
+
+        remaining -= received;
+        if (!commit(received)) break;
+    }
+    http.end();
+
+    // The writer finishes (or aborts) the image after the last block
+    if (!submit(true)) {
+        _decoder.abort();
+        _busy = false;
+        return false;
+    }
+    xSemaphoreTake(_stageDone, portMAX_DELAY);
+    return _state != OTAState::ERROR;
+}
+
+void OtaUpdater::beginImage(Stage stage, size_t size, bool finalStage) {
+    xSemaphoreTake(_stageDone, 0);  // Drop a completion nobody waited for
+    _stage = stage;
+    _finalStage = finalStage;
+    _written = 0;
+    _total = size;
+    _progress = 0;
+    _revision++;
+    touch();
+
+    // Update.begin() follows once the decoder has seen the image header
+    _decoder.begin(stage == Stage::FILESYSTEM ? U_SPIFFS : U_FLASH, size);
+}
+
+bool OtaUpdater::reserve(uint8_t*& data, size_t& space) {
+    if (_state == OTAState::ERROR) return false;
+
+    if (_fillIndex < 0) {
+        uint8_t index = 0;
+        if (xQueueReceive(_free, &index, pdMS_TO_TICKS(BUFFER_WAIT_MS)) != pdTRUE) {
+            fail(OTAError::TIMEOUT);
+            return false;
+        }
+        _fillIndex = index;
+        _fillLength = 0;
+    }
+
+    data = _buffers[_fillIndex] + _fillLength;
+    space = BUFFER_SIZE - _fillLength;
+    return true;
+}
+
+bool OtaUpdater::commit(size_t len) {
+    _fillLength += len;
+    touch();
+    return _fillLength < BUFFER_SIZE || submit(false);
+}
+
+bool OtaUpdater::submit(bool last) {
+    if (_fillIndex < 0) {
+        if (!last) return true;
+
+        // The last block may be empty, it still carries the finish marker
+        uint8_t index = 0;
+        if (xQueueReceive(_free, &index, pdMS_TO_TICKS(BUFFER_WAIT_MS)) != pdTRUE) {
+            fail(OTAError::TIMEOUT);
+            return false;
+        }
+        _fillIndex = index;
+        _fillLength = 0;
+    }
+
+    Block block;
+    block.index = static_cast<uint8_t>(_fillIndex);
+    block.length = static_cast<uint16_t>(_fillLength);
+    block.last = last;
+    _fillIndex = -1;
+    _fillLength = 0;
+
+    // Never blocks, the queue holds every buffer there is
+    xQueueSend(_filled, &block, portMAX_DELAY);
+    return true;
+}
+
+void OtaUpdater::runWriter() {
+    Block block;
+    for (;;) {
+        if (xQueueReceive(_filled, &block, portMAX_DELAY) != pdTRUE) continue;
+
+        if (block.length > 0 && _state != OTAState::ERROR) {
+            if (!_decoder.write(_buffers[block.index], block.length)) {
+                fail(_decoder.getError());
+            } else {
+                _written += block.length;
+                touch();
+                if (_total > 0) {
+                    uint32_t progress = static_cast<uint64_t>(_written) * 100 / _total;
+                    if (progress > 99) progress = 99;  // 100 once verified
+                    if (progress != _progress) {
+                        _progress = progress;
+                        _revision++;
+                    }
+                }
+                const uint32_t now = millis();
+                if (now - _lastProgressLog > 1000) {
+                    _lastProgressLog = now;
+                    Serial.printf("[OTA] Progress: %u%% (%u / %u bytes)\n",
+                                  _progress, _written, _total);
+                }
+            }
+        }
+
+        xQueueSend(_free, &block.index, 0);
+        if (block.last) {
+            finishImage();
+        }
+    }
+}
+
+void OtaUpdater::finishImage() {
+    if (_state == OTAState::ERROR) {
+        _decoder.abort();
+        _busy = false;
+    } else {
+        setState(OTAState::VERIFYING);
+        if (!_decoder.finish()) {
+            fail(_decoder.getError());
+            _busy = false;
+        } else {
+            Serial.printf("[OTA] %s finished: %u bytes received, %u bytes image\n", stageToString(_stage),
+                          _written, _decoder.getImageWritten());
+            if (_finalStage) {
+                _progress = 100;
+                setState(OTAState::SUCCESS);
+                scheduleReboot();
+            }
+        }
+    }
+    xSemaphoreGive(_stageDone);
+}
+
+void OtaUpdater::setState(OTAState state) {
+    _state = state;
+    _revision++;
+    Serial.printf("[OTA] State changed: %s\n", stateToString(state));
+}
+
+void OtaUpdater::fail(OTAError error) {
+    _error = error;
+    _state = OTAState::ERROR;
+    _revision++;
+    Serial.printf("[OTA] Error: %s\n", errorToString(error));
+}
+
+void OtaUpdater::scheduleReboot() {
+    const uint32_t at = millis() + REBOOT_DELAY_MS;
+    _rebootAt = at ? at : 1;
+}
+
+const char* OtaUpdater::getStateString() const {
+    return stateToString(_state);
+}
+
+const char* OtaUpdater::stateToString(OTAState state) {
+    switch (state) {
+        case OTAState::IDLE:        return "IDLE";
+        case OTAState::CONNECTING:  return "CONNECTING";
+        case OTAState::DOWNLOADING: return "DOWNLOADING";
+        case OTAState::UPLOADING:   return "UPLOADING";
+        case OTAState::WRITING:     return "WRITING";
+        case OTAState::VERIFYING:   return "VERIFYING";
+        case OTAState::REBOOTING:   return "REBOOTING";
+        case OTAState::SUCCESS:     return "SUCCESS";
+        case OTAState::ERROR:       return "ERROR";
+        default:                    return "UNKNOWN";
+    }
+}
+
+const char* OtaUpdater::errorToString(OTAError error) {
+    switch (error) {
+        case OTAError::NONE:                return "No error";
+        case OTAError::CONNECTION_REFUSED:  return "Connection refused";
+        case OTAError::TIMEOUT:             return "Timeout";
+        case OTAError::DNS_FAILED:          return "DNS resolution failed";
+        case OTAError::SSL_FAILED:          return "SSL/TLS error";
+        case OTAError::HTTP_404:            return "File not found (HTTP 404)";
+        case OTAError::HTTP_500:            return "Server error (HTTP 5xx)";
+        case OTAError::INVALID_RESPONSE:    return "Invalid HTTP response";
+        case OTAError::FILE_TOO_LARGE:      return "File too large";
+        case OTAError::PARTITION_NOT_FOUND: return "OTA partition not found";
+        case OTAError::FLASH_WRITE_FAILED:  return "Flash write failed";
+        case OTAError::FLASH_VERIFY_FAILED: return "Flash verification failed";
+        case OTAError::INSUFFICIENT_SPACE:  return "Insufficient space";
+        case OTAError::OTA_BEGIN_FAILED:    return "OTA begin failed";
+        case OTAError::OTA_END_FAILED:      return "OTA end failed";
+        case OTAError::ROLLBACK_FAILED:     return "Rollback failed";
+        case OTAError::INVALID_URL:         return "Invalid URL";
+        case OTAError::INVALID_FILE:        return "Invalid file";
+        case OTAError::BUSY:                return "Another update is running";
+        case OTAError::DECOMPRESS_FAILED:   return "Corrupt compressed image";
+        case OTAError::BASE_MISMATCH:       return "Delta is for a different firmware";
+        case OTAError::UNKNOWN:             return "Unknown error";
+        default:                            return "Undefined error";
+    }
+}
+
+const char* OtaUpdater::stageToString(Stage stage) {
+    switch (stage) {
+        case Stage::FIRMWARE:   return "firmware";
+        case Stage::FILESYSTEM: return "filesystem";
+        default:                return "none";
+    }
+}
@@ -0,0 +1,111 @@
+#include "PerfCounters.hpp"
+
+PerfCounters::PerfCounters() {
+    clear();  // Static init, nothing records yet
+}
+
+void PerfCounters::reset() {
+    noInterrupts();
+    clear();
+    interrupts();
+}
+
+void PerfCounters::clear() {
+#if QS_PERF
+    for (auto& h : _histograms) {
+        h.bins.fill(0);
+        h.count = 0;
+        h.min = UINT32_MAX;
+        h.max = 0;
+    }
+    _shiftStart = 0;
+    _cutTargetTicks = 0;
+#endif
+}
+
+const char* PerfCounters::probeToString(Probe probe) {
+    switch (probe) {
+        case Probe::SHIFT_LATENCY: return "shiftLatency";
+        case Probe::CUT_END_ERROR: return "cutEndError";
+        case Probe::PICKUP_ISR: return "pickupIsr";
+        case Probe::CUT_TIMER_ISR: return "cutTimerIsr";
+        default: return "unknown";
+    }
+}
+
+#if QS_PERF
+uint32_t PerfCounters::toNs(Probe probe, uint32_t value) const {
+    // Cut timer ticks are µs, everything else is CPU cycles
+    if (probe == Probe::CUT_END_ERROR) {
+        return value > UINT32_MAX / 1000 ? UINT32_MAX : value * 1000;
+    }
+    const uint32_t mhz = getCpuFrequencyMhz();
+    return static_cast<uint32_t>(static_cast<uint64_t>(value) * 1000 / (mhz ? mhz : 1));
+}
+#endif
+
+bool PerfCounters::summarize(Probe probe, Summary& summary) const {
+#if QS_PERF
+    if (probe >= Probe::COUNT) return false;
+
+    // Copy first, the ISRs keep recording
+    const Histogram h = _histograms[static_cast<size_t>(probe)];
+    uint32_t total = 0;
+    for (uint32_t bin : h.bins) total += bin;
+    if (total == 0) return false;
+
+    // Percentiles as the upper edge of the bin that reaches them (at most max)
+    const uint32_t width = 1UL << binShift(probe);
+    const uint32_t p50Rank = (total + 1) / 2;
+    const uint32_t p99Rank = total - total / 100;
+    uint32_t p50 = h.max;
+    uint32_t p99 = h.max;
+    uint32_t seen = 0;
+    bool p50Found = false;
+    for (size_t i = 0; i < BIN_COUNT - 1; i++) {
+        seen += h.bins[i];
+        const uint32_t edge = min<uint32_t>((i + 1) * width - 1, h.max);
+        if (!p50Found && seen >= p50Rank) {
+            p50 = edge;
+            p50Found = true;
+        }
+        if (seen >= p99Rank) {
+            p99 = edge;
+            break;
+        }
+    }
+
+    summary.count = h.count;
+    summary.overflow = h.bins[BIN_COUNT - 1];
+    summary.minNs = toNs(probe, h.min);
+    summary.maxNs = toNs(probe, h.max);
+    summary.p50Ns = toNs(probe, p50);
+    summary.p99Ns = toNs(probe, p99);
+    return true;
+#else
+    (void)probe;
+    (void)summary;
+    return false;
+#endif
+}
+
+void PerfCounters::toJson(JsonObject out) const {
+    out["enabled"] = QS_PERF != 0;
+    out["cpuMhz"] = getCpuFrequencyMhz();
+
+    for (size_t i = 0; i < PROBE_COUNT; i++) {
+        const Probe probe = static_cast<Probe>(i);
+        JsonObject obj = out.createNestedObject(probeToString(probe));
+        Summary summary;
+        if (!summarize(probe, summary)) {
+            obj["count"] = 0;
+            continue;
+        }
+        obj["count"] = summary.count;
+        obj["minNs"] = summary.minNs;
+        obj["p50Ns"] = summary.p50Ns;
+        obj["p99Ns"] = summary.p99Ns;
+        obj["maxNs"] = summary.maxNs;
+        obj["overflow"] = summary.overflow;
+    }
+}
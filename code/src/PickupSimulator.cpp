@@ -0,0 +1,368 @@
+#include "PickupSimulator.hpp"
+
+#if QS_HIL
+#include <driver/gpio.h>
+#include <esp_rom_gpio.h>
+#include <soc/gpio_sig_map.h>
+
+const PickupSimulator::Scenario PickupSimulator::SCENARIOS[SCENARIO_COUNT] = {
+    // name       start  end    ms    noise  miss  shift
+    {"steady",    6000,  6000,  3000,  0,    0,    0},
+    {"sweep",     2000,  14000, 6000,  0,    0,    0},
+    {"accel",     4000,  12000, 1000,  0,    0,    0},
+    {"decel",     12000, 5000,  1500,  0,    0,    0},
+    {"noise",     8000,  8000,  3000,  50,   0,    0},
+    {"missing",   8000,  8000,  3000,  0,    25,   0},
+    {"shift",     9000,  9000,  3000,  0,    0,    500},
+};
+
+PickupSimulator::PickupSimulator(QuickShifterEngine& qsEngine)
+    : _qsEngine(qsEngine)
+    , _outputPin(0)
+    , _ready(false)
+    , _phase(Phase::IDLE)
+    , _loopback(Loopback::INTERNAL)
+    , _current(0)
+    , _last(0)
+    , _phaseStartMs(0)
+    , _nextShiftMs(0)
+    , _txStartUs(0)
+    , _pendingCutUs(0)
+    , _reports{}
+    , _itemCount(0)
+    , _pendingHalf(0)
+    , _noiseSeed(0)
+{
+}
+
+bool PickupSimulator::begin(uint8_t outputPin) {
+    _outputPin = outputPin;
+
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(static_cast<gpio_num_t>(outputPin), RMT_CHANNEL);
+    config.clk_div = RMT_CLOCK_DIVIDER;
+    config.mem_block_num = 1;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(RMT_CHANNEL, 0, 0) != ESP_OK) {
+        Serial.println("[HIL] RMT setup failed");
+        return false;
+    }
+
+    _ready = true;
+    Serial.printf("[HIL] Pickup generator on GPIO %u\n", outputPin);
+    return true;
+}
+
+bool PickupSimulator::start(const char* scenario, Loopback loopback) {
+    if (!_ready || isRunning() || !scenario) return false;
+
+    // Never fight a real pickup signal
+    if (_qsEngine.isSignalActive()) {
+        Serial.println("[HIL] Pickup signal present - not starting");
+        return false;
+    }
+
+    // The waveforms are one pulse per revolution
+    if (_qsEngine.getConfig().triggerTeeth > 1) {
+        Serial.println("[HIL] Multi-tooth trigger wheel configured - not starting");
+        return false;
+    }
+
+    if (strcmp(scenario, "all") == 0) {
+        _current = 0;
+        _last = SCENARIO_COUNT - 1;
+    } else {
+        size_t i = 0;
+        while (i < SCENARIO_COUNT && strcmp(SCENARIOS[i].name, scenario) != 0) i++;
+        if (i == SCENARIO_COUNT) return false;
+        _current = _last = i;
+    }
+
+    for (size_t i = _current; i <= _last; i++) _reports[i] = Report{};
+    _loopback = loopback;
+    connectLoopback(loopback == Loopback::INTERNAL);
+
+    _phaseStartMs = millis();
+    _phase.store(Phase::SETTLE, std::memory_order_release);
+    Serial.printf("[HIL] Running %s (%s loopback)\n", scenario,
+                  loopback == Loopback::INTERNAL ? "internal" : "external");
+    return true;
+}
+
+void PickupSimulator::stop() {
+    if (!isRunning()) return;
+
+    rmt_tx_stop(RMT_CHANNEL);
+    _phase.store(Phase::IDLE, std::memory_order_release);
+    connectLoopback(false);
+    Serial.println("[HIL] Stopped");
+}
+
+void PickupSimulator::update() {
+    const Phase phase = _phase.load(std::memory_order_acquire);
+    const uint32_t now = millis();
+
+    switch (phase) {
+        case Phase::SETTLE:
+            // A fresh signal each time: filter and estimator start from scratch
+            if (now - _phaseStartMs >= SETTLE_MS && !_qsEngine.isSignalActive()) {
+                startScenario();
+            }
+            break;
+
+        case Phase::RUNNING: {
+            const Scenario& scenario = SCENARIOS[_current];
+            if (scenario.shiftEveryMs > 0 && now - _phaseStartMs >= _nextShiftMs &&
+                _nextShiftMs < scenario.durationMs) {
+                _nextShiftMs += scenario.shiftEveryMs;
+                _reports[_current].shifts++;
+                _qsEngine.requestShift();
+            }
+            if (rmt_wait_tx_done(RMT_CHANNEL, 0) == ESP_OK) {
+                _phaseStartMs = now;
+                _phase.store(Phase::DRAIN, std::memory_order_release);
+            }
+            break;
+        }
+
+        case Phase::DRAIN:
+            if (now - _phaseStartMs >= DRAIN_MS) {
+                finishScenario();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void PickupSimulator::startScenario() {
+    const Scenario& scenario = SCENARIOS[_current];
+    Report& report = _reports[_current];
+
+    if (!buildWaveform(scenario, report)) {
+        Serial.printf("[HIL] %s: waveform truncated to %u items\n", scenario.name, MAX_ITEMS);
+    }
+
+    _pendingCutUs = 0;
+    _nextShiftMs = scenario.shiftEveryMs;
+    _phaseStartMs = millis();
+    _txStartUs = micros();
+    _phase.store(Phase::RUNNING, std::memory_order_release);
+    rmt_write_items(RMT_CHANNEL, _items, _itemCount, false);
+}
+
+void PickupSimulator::finishScenario() {
+    _reports[_current].complete = true;
+    printReport(SCENARIOS[_current], _reports[_current]);
+
+    if (_current < _last) {
+        _current++;
+        _phaseStartMs = millis();
+        _phase.store(Phase::SETTLE, std::memory_order_release);
+        return;
+    }
+
+    _phase.store(Phase::IDLE, std::memory_order_release);
+    connectLoopback(false);
+    Serial.println("[HIL] Done");
+}
+
+void PickupSimulator::connectLoopback(bool enable) {
+    const gpio_num_t pin = static_cast<gpio_num_t>(_qsEngine.getPickupPin());
+    if (enable) {
+        // Pad stays an input for PCNT/GPIO interrupts and is driven by RMT as well
+        gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT);
+        esp_rom_gpio_connect_out_signal(pin, RMT_SIG_OUT0_IDX + RMT_CHANNEL, false, false);
+    } else if (_loopback == Loopback::INTERNAL) {
+        gpio_set_direction(pin, GPIO_MODE_INPUT);
+    }
+}
+
+uint16_t PickupSimulator::rpmAt(const Scenario& scenario, int32_t timeUs) {
+    const int32_t durationUs = static_cast<int32_t>(scenario.durationMs) * 1000;
+    if (timeUs <= 0 || durationUs == 0) return scenario.startRpm;
+    if (timeUs >= durationUs) return scenario.endRpm;
+
+    const int32_t delta = static_cast<int32_t>(scenario.endRpm) - scenario.startRpm;
+    return scenario.startRpm + static_cast<int32_t>(static_cast<int64_t>(delta) * timeUs / durationUs);
+}
+
+void PickupSimulator::addHalf(uint8_t level, uint16_t ticks) {
+    if (_itemCount >= MAX_ITEMS) return;
+
+    rmt_item32_t& item = _items[_itemCount];
+    if (_pendingHalf == 0) {
+        item.level0 = level;
+        item.duration0 = ticks;
+        item.level1 = level;
+        item.duration1 = 0;
+        _pendingHalf = 1;
+    } else {
+        item.level1 = level;
+        item.duration1 = ticks;
+        _pendingHalf = 0;
+        _itemCount++;
+    }
+}
+
+void PickupSimulator::addSegment(uint8_t level, uint32_t durationUs) {
+    while (durationUs > MAX_HALF_TICKS) {
+        addHalf(level, MAX_HALF_TICKS);
+        durationUs -= MAX_HALF_TICKS;
+    }
+    if (durationUs > 0) addHalf(level, durationUs);
+}
+
+bool PickupSimulator::buildWaveform(const Scenario& scenario, Report& report) {
+    _itemCount = 0;
+    _pendingHalf = 0;
+    _noiseSeed = 0x51u;  // Same spikes on every run
+
+    const uint64_t durationUs = static_cast<uint64_t>(scenario.durationMs) * 1000;
+
+    // Edge times in 1/256 µs so rounding never accumulates into drift
+    uint64_t edge = 0;
+    for (uint32_t pulse = 0; (edge >> 8) < durationUs; pulse++) {
+        uint16_t rpm = rpmAt(scenario, static_cast<int32_t>(edge >> 8));
+        if (rpm < MIN_RPM) rpm = MIN_RPM;
+        if (rpm > MAX_RPM) rpm = MAX_RPM;
+
+        const uint64_t next = edge + (60000000ULL << 8) / rpm;
+        const uint32_t periodUs = static_cast<uint32_t>((next >> 8) - (edge >> 8));
+        edge = next;
+
+        if (scenario.missingEvery > 0 && pulse > 0 && pulse % scenario.missingEvery == 0) {
+            addSegment(0, periodUs);
+            report.missing++;
+            continue;
+        }
+
+        addSegment(1, PULSE_WIDTH_US);
+        report.pulses++;
+
+        // Linear congruential generator, deterministic noise
+        _noiseSeed = _noiseSeed * 1103515245u + 12345u;
+        if (scenario.noisePerMille > 0 && ((_noiseSeed >> 16) % 1000) < scenario.noisePerMille) {
+            const uint32_t spikeAt = periodUs / 2;
+            addSegment(0, spikeAt - PULSE_WIDTH_US);
+            addSegment(1, SPIKE_WIDTH_US);
+            addSegment(0, periodUs - spikeAt - SPIKE_WIDTH_US);
+            report.spikes++;
+        } else {
+            addSegment(0, periodUs - PULSE_WIDTH_US);
+        }
+    }
+
+    // Odd half: the empty second half ends the transmission
+    if (_pendingHalf && _itemCount < MAX_ITEMS) {
+        _itemCount++;
+        _pendingHalf = 0;
+    }
+    return _itemCount < MAX_ITEMS;
+}
+
+void PickupSimulator::onEngineEvent(const QuickShifterEngine::Event& event, void* context) {
+    PickupSimulator* self = static_cast<PickupSimulator*>(context);
+    const Phase phase = self->_phase.load(std::memory_order_acquire);
+    if (phase != Phase::RUNNING && phase != Phase::DRAIN) return;
+
+    const Scenario& scenario = SCENARIOS[self->_current];
+    Report& report = self->_reports[self->_current];
+
+    switch (event.type) {
+        case QuickShifterEngine::EventType::PULSE_ACCEPTED: {
+            report.accepted++;
+
+            // Compare with the profile at the middle of the measured interval
+            // (a batch of edges in PCNT capture mode)
+            const uint32_t edges = self->_qsEngine.getIntervalsPerEvent();
+            const int32_t midUs = static_cast<int32_t>(event.timestampUs - self->_txStartUs) -
+                                  static_cast<int32_t>(event.cutTimeUs * edges / 2);
+            if (midUs < 0 || midUs > static_cast<int32_t>(scenario.durationMs) * 1000) break;
+
+            const int32_t error = abs(static_cast<int32_t>(event.rpm) - rpmAt(scenario, midUs));
+            report.rpmSamples++;
+            report.rpmErrorSum += error;
+            if (error > report.rpmErrorMax) report.rpmErrorMax = error;
+            break;
+        }
+
+        case QuickShifterEngine::EventType::PULSE_REJECTED:
+            report.rejected++;
+            break;
+
+        case QuickShifterEngine::EventType::CUT_START:
+            self->_pendingCutUs = event.cutTimeUs;
+            break;
+
+        case QuickShifterEngine::EventType::CUT_END: {
+            if (self->_pendingCutUs == 0) break;
+            const int32_t error = static_cast<int32_t>(event.cutTimeUs) - static_cast<int32_t>(self->_pendingCutUs);
+            self->_pendingCutUs = 0;
+            if (report.cuts == 0 || error < report.cutErrorMinUs) report.cutErrorMinUs = error;
+            if (report.cuts == 0 || error > report.cutErrorMaxUs) report.cutErrorMaxUs = error;
+            report.cutErrorSumUs += error;
+            report.cuts++;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void PickupSimulator::printReport(const Scenario& scenario, const Report& report) const {
+    Serial.printf("[HIL] %s: %u pulses (%u spikes, %u missing), %u accepted, %u rejected\n",
+                  scenario.name, report.pulses, report.spikes, report.missing,
+                  report.accepted, report.rejected);
+    if (report.rpmSamples > 0) {
+        Serial.printf("[HIL] %s: RPM error mean %u, max %u\n", scenario.name,
+                      report.rpmErrorSum / report.rpmSamples, report.rpmErrorMax);
+    }
+    if (report.cuts > 0) {
+        Serial.printf("[HIL] %s: %u cuts, length error %d..%d us (mean %d)\n", scenario.name,
+                      report.cuts, report.cutErrorMinUs, report.cutErrorMaxUs,
+                      report.cutErrorSumUs / static_cast<int32_t>(report.cuts));
+    }
+}
+
+void PickupSimulator::toJson(JsonObject out) const {
+    const Phase phase = _phase.load(std::memory_order_acquire);
+    out["running"] = phase != Phase::IDLE;
+    if (phase != Phase::IDLE) out["current"] = SCENARIOS[_current].name;
+    out["loopback"] = _loopback == Loopback::INTERNAL ? "internal" : "external";
+
+    JsonArray scenarios = out.createNestedArray("scenarios");
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        const Report& report = _reports[i];
+        JsonObject obj = scenarios.createNestedObject();
+        obj["name"] = SCENARIOS[i].name;
+        obj["complete"] = report.complete;
+        if (report.pulses == 0) continue;
+
+        obj["pulses"] = report.pulses;
+        obj["spikes"] = report.spikes;
+        obj["missing"] = report.missing;
+        obj["accepted"] = report.accepted;
+        obj["rejected"] = report.rejected;
+        const uint32_t measured = report.accepted + report.rejected;
+        obj["rejectRate"] = measured ? static_cast<float>(report.rejected) / measured : 0.0f;
+        if (report.rpmSamples > 0) {
+            obj["rpmErrorMean"] = static_cast<float>(report.rpmErrorSum) / report.rpmSamples;
+            obj["rpmErrorMax"] = report.rpmErrorMax;
+        }
+        if (report.shifts > 0) {
+            obj["shifts"] = report.shifts;
+            obj["cuts"] = report.cuts;
+        }
+        if (report.cuts > 0) {
+            obj["cutErrorMinUs"] = report.cutErrorMinUs;
+            obj["cutErrorMaxUs"] = report.cutErrorMaxUs;
+            obj["cutErrorMeanUs"] = static_cast<float>(report.cutErrorSumUs) / report.cuts;
+        }
+    }
+}
+
+#endif  // QS_HIL
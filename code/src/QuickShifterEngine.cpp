@@ -4,80 +4,265 @@
 QuickShifterEngine* QuickShifterEngine::_instance = nullptr;
 
 QuickShifterEngine::QuickShifterEngine()
-    : _pickupPin(0)
+    : _loadInput(0)
+    , _sensors(nullptr)
+    , _pickupPin(0)
     , _shiftSensorPin(0)
-    , _ignitionCutPin(0)
+    , _pickupMode(PickupMode::GPIO_ISR)
     , _lastPulseTime(0)
     , _pulseInterval(0)
+    , _rejectedEdges(0)
+    , _captureBatch(PICKUP_CAPTURE_BATCH)
     , _lastShiftSensorTime(0)
+    , _shiftRequested(false)
     , _currentRpm(0)
     , _cutActive(false)
+    , _cutStartTicks(0)
+    , _cutMinTimeUs(0)
+    , _cutPeakRpm(0)
+    , _cutDropCount(0)
+    , _sparkIndex(0)
+    , _lastSparkEdgeTime(0)
+    , _sparkSyncAttached(false)
     , _signalActive(false)
+    , _stateListener(nullptr)
+    , _stateListenerContext(nullptr)
     , _lastUpdateTime(0)
-    , _cutTimer(nullptr)
 {
-    // Initialize debug data
-    _debugData.hasEvent = false;
-    _debugData.debounced = false;
-    _debugData.rpmTooLow = false;
-    _debugData.rpm = 0;
-    _debugData.cutTime = 0;
-    
-    // Set default configuration
-    _config.minRpmThreshold = 3000;
-    _config.debounceTimeMs = 50;
+    // Set default configuration (generation 1, bank 0)
+    Config& config = _configBanks[0].config;
+    config.minRpmThreshold = 3000;
+    config.debounceTimeMs = 50;
+    config.cutMode = CutMode::OPEN_LOOP;
+    config.closedLoopMinPercent = DEFAULT_CLOSED_LOOP_MIN_PERCENT;
+    config.closedLoopDropPercent = DEFAULT_CLOSED_LOOP_DROP_PERCENT;
+    config.skipSparks = 1;
+    config.skipCycle = 0;
+    config.shiftSensorMode = ShiftSensorMode::SWITCH;
+    config.forceThreshold = DEFAULT_FORCE_THRESHOLD;
+    config.forceHysteresis = DEFAULT_FORCE_HYSTERESIS;
+    config.minThrottle = DEFAULT_MIN_THROTTLE;
+    config.triggerTeeth = 1;
+    config.triggerMissing = 0;
     
     // Initialize cut time map to 80ms for all RPM ranges
-    for (auto& cutTime : _config.cutTimeMap) {
-        cutTime = 80;
-    }
+    CutTimeMap::getDefaultTable(config.cutMap, DEFAULT_CUT_TIME_US);
+    _configBanks[0].cutMap.compile(config.cutMap);
+    _configBanks[0].generation.store(1, std::memory_order_relaxed);
+    _configBanks[1].generation.store(0, std::memory_order_relaxed);
+    _activeConfig.store(&_configBanks[0], std::memory_order_release);
     
     // Set singleton instance for ISR trampolines
     _instance = this;
 }
 
-void QuickShifterEngine::begin(uint8_t pickupPin, uint8_t shiftSensorPin, uint8_t ignitionCutPin) {
+void QuickShifterEngine::begin(uint8_t pickupPin, uint8_t shiftSensorPin, PickupMode pickupMode) {
     _pickupPin = pickupPin;
+    _pickupMode = pickupMode;
     _shiftSensorPin = shiftSensorPin;
-    _ignitionCutPin = ignitionCutPin;
     _lastValidInterval = 0;
     
     // Configure pins
-    pinMode(_ignitionCutPin, OUTPUT);
-    digitalWrite(_ignitionCutPin, LOW);
+    CutOutput::Active::begin();
+    Serial.printf("[QS] Cut output: %s on GPIO %u\n", CutOutput::NAME, CutOutput::Active::PIN);
     
     pinMode(_pickupPin, INPUT);
     pinMode(_shiftSensorPin, INPUT);
     pinMode(0, INPUT_PULLUP);
     
-    // Configure built-in LED for debugging
-    pinMode(LED_BUILTIN, OUTPUT);
-    digitalWrite(LED_BUILTIN, LOW);
-    
     // Attach interrupts
-    attachInterrupt(digitalPinToInterrupt(_pickupPin), pickupCoilISR, RISING);
+    if (_pickupMode == PickupMode::PCNT_CAPTURE) {
+        setupPickupCapture();
+    } else {
+        attachInterrupt(digitalPinToInterrupt(_pickupPin), pickupCoilISR, RISING);
+    }
     attachInterrupt(digitalPinToInterrupt(_shiftSensorPin), shiftSensorISR, RISING);
     attachInterrupt(digitalPinToInterrupt(0), buttonISR, FALLING);
 
     
-    // Create hardware timer for ignition cut
-    _cutTimer = xTimerCreate(
-        "IgnitionCut",
-        pdMS_TO_TICKS(80),  // Default period (will be updated per cut)
-        pdFALSE,            // One-shot timer
-        nullptr,            // Timer ID not needed (using static _instance)
-        cutTimerCallback
-    );
+    // Start hardware timer for ignition cut
+    setupCutTimer();
+    
+    updateSparkSync();
+    updateCaptureBatch();
+}
+
+void QuickShifterEngine::setupCutTimer() {
+    timer_config_t timerConfig = {};
+    timerConfig.alarm_en = TIMER_ALARM_DIS;        // Armed per cut from the ISR
+    timerConfig.counter_en = TIMER_PAUSE;
+    timerConfig.intr_type = TIMER_INTR_LEVEL;
+    timerConfig.counter_dir = TIMER_COUNT_UP;
+    timerConfig.auto_reload = TIMER_AUTORELOAD_DIS; // Free-running, alarm is one-shot
+    timerConfig.divider = CUT_TIMER_DIVIDER;
+    
+    timer_init(CUT_TIMER_GROUP, CUT_TIMER_IDX, &timerConfig);
+    timer_set_counter_value(CUT_TIMER_GROUP, CUT_TIMER_IDX, 0);
+    timer_enable_intr(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+    timer_isr_callback_add(CUT_TIMER_GROUP, CUT_TIMER_IDX, cutTimerCallback, this, ESP_INTR_FLAG_IRAM);
+    timer_start(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+}
+
+void QuickShifterEngine::setupPickupCapture() {
+    pcnt_config_t pcntConfig = {};
+    pcntConfig.pulse_gpio_num = _pickupPin;
+    pcntConfig.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    pcntConfig.channel = PCNT_CHANNEL_0;
+    pcntConfig.unit = PICKUP_PCNT_UNIT;
+    pcntConfig.pos_mode = PCNT_COUNT_INC;   // Count rising edges only
+    pcntConfig.neg_mode = PCNT_COUNT_DIS;
+    pcntConfig.lctrl_mode = PCNT_MODE_KEEP;
+    pcntConfig.hctrl_mode = PCNT_MODE_KEEP;
+    pcntConfig.counter_h_lim = _captureBatch;  // Counter resets to 0 on reaching the limit
+    pcntConfig.counter_l_lim = 0;
+    pcnt_unit_config(&pcntConfig);
+    
+    // Hardware glitch filter rejects spikes before they reach the CPU
+    pcnt_set_filter_value(PICKUP_PCNT_UNIT, PICKUP_GLITCH_FILTER_APB);
+    pcnt_filter_enable(PICKUP_PCNT_UNIT);
     
+    pcnt_event_enable(PICKUP_PCNT_UNIT, PCNT_EVT_H_LIM);
     
+    pcnt_counter_pause(PICKUP_PCNT_UNIT);
+    pcnt_counter_clear(PICKUP_PCNT_UNIT);
+    
+    pcnt_isr_service_install(ESP_INTR_FLAG_IRAM);
+    pcnt_isr_handler_add(PICKUP_PCNT_UNIT, pickupCaptureISR, this);
+    
+    pcnt_counter_resume(PICKUP_PCNT_UNIT);
 }
 
 void QuickShifterEngine::setConfig(const Config& config) {
-    _config = config;
+    // Build the next generation in the bank the ISRs are not reading. On the
+    // single core an ISR runs to completion, so none can still hold it.
+    ConfigBank* current = _activeConfig.load(std::memory_order_acquire);
+    ConfigBank& next = (current == &_configBanks[0]) ? _configBanks[1] : _configBanks[0];
+    const uint32_t generation = current->generation.load(std::memory_order_relaxed) + 1;
+    next.generation.store(0, std::memory_order_release);  // getConfig() retries meanwhile
+    
+    Config& cfg = next.config;
+    cfg = config;
+    
+    // Older configs may still name the removed gear axis; no input feeds it
+    if (cfg.cutMap.loadSource != CutTimeMap::LoadSource::THROTTLE) {
+        cfg.cutMap.loadSource = CutTimeMap::LoadSource::NONE;
+    }
+    
+    // Compile the map first; an invalid map keeps the previous one active
+    bool mapValid = next.cutMap.compile(cfg.cutMap);
+    if (!mapValid) {
+        cfg.cutMap = current->config.cutMap;
+        next.cutMap = current->cutMap;
+    }
+    
+    if (cfg.cutMode != CutMode::CLOSED_LOOP) cfg.cutMode = CutMode::OPEN_LOOP;
+    if (cfg.closedLoopMinPercent > 100) cfg.closedLoopMinPercent = 100;
+    if (cfg.closedLoopDropPercent == 0) cfg.closedLoopDropPercent = 1;
+    if (cfg.closedLoopDropPercent > MAX_CLOSED_LOOP_DROP_PERCENT) {
+        cfg.closedLoopDropPercent = MAX_CLOSED_LOOP_DROP_PERCENT;
+    }
+    
+    // Spark skip needs an output that switches within one spark
+    const bool skipUnsupported = cfg.skipCycle > 0 && CutOutput::Active::LEAD_US > 0;
+    if (skipUnsupported) cfg.skipCycle = 0;
+    if (cfg.skipCycle > MAX_SKIP_CYCLE) cfg.skipCycle = MAX_SKIP_CYCLE;
+    if (cfg.skipSparks == 0) cfg.skipSparks = 1;
+    if (cfg.skipCycle > 0 && cfg.skipSparks > cfg.skipCycle) cfg.skipSparks = cfg.skipCycle;
+    
+    if (cfg.shiftSensorMode != ShiftSensorMode::FORCE) cfg.shiftSensorMode = ShiftSensorMode::SWITCH;
+    if (cfg.forceThreshold == 0) cfg.forceThreshold = 1;
+    if (cfg.forceHysteresis >= cfg.forceThreshold) cfg.forceHysteresis = cfg.forceThreshold - 1;
+    if (cfg.minThrottle > 1000) cfg.minThrottle = 1000;
+    if (cfg.triggerTeeth == 0) cfg.triggerTeeth = 1;
+    if (cfg.triggerTeeth > TriggerWheel::MAX_TEETH) cfg.triggerTeeth = TriggerWheel::MAX_TEETH;
+    if (cfg.triggerMissing > TriggerWheel::MAX_MISSING) cfg.triggerMissing = TriggerWheel::MAX_MISSING;
+    if (cfg.triggerMissing >= cfg.triggerTeeth) cfg.triggerMissing = cfg.triggerTeeth - 1;
+    
+    // Publish: the next ISR sees the whole generation or none of it
+    next.generation.store(generation, std::memory_order_release);
+    _activeConfig.store(&next, std::memory_order_release);
+    
+    if (!mapValid) Serial.println("[QS] Invalid cut map axes - keeping previous map");
+    if (skipUnsupported) {
+        Serial.printf("[QS] Spark skip not supported by %s output - using continuous cut\n", CutOutput::NAME);
+    }
+    Serial.printf("[QS] Config generation %u active\n", generation);
+    
+    updateSparkSync();
+    updateCaptureBatch();
+}
+
+QuickShifterEngine::Config QuickShifterEngine::getConfig() const {
+    // Retry if setConfig() started rewriting the bank during the copy
+    Config config;
+    const ConfigBank* bank;
+    uint32_t generation;
+    do {
+        bank = _activeConfig.load(std::memory_order_acquire);
+        generation = bank->generation.load(std::memory_order_acquire);
+        config = bank->config;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (generation == 0 || bank->generation.load(std::memory_order_relaxed) != generation);
+    return config;
+}
+
+void QuickShifterEngine::updateSparkSync() {
+    // GPIO mode already interrupts on every edge; skip before begin()
+    if (_pickupMode != PickupMode::PCNT_CAPTURE || _pickupPin == 0) return;
     
+    // Wheels time the pattern from decoded revolutions, not from edges
+    const Config& config = activeConfig().config;
+    const bool needed = config.skipCycle > 0 && config.triggerTeeth == 1;
+    if (needed && !_sparkSyncAttached) {
+        attachInterrupt(digitalPinToInterrupt(_pickupPin), sparkSyncISR, RISING);
+    } else if (!needed && _sparkSyncAttached) {
+        detachInterrupt(digitalPinToInterrupt(_pickupPin));
+    }
+    _sparkSyncAttached = needed;
+}
+
+void QuickShifterEngine::updateCaptureBatch() {
+    // Gap detection needs every tooth, wheels capture one edge per interrupt
+    if (_pickupMode != PickupMode::PCNT_CAPTURE || _pickupPin == 0) return;
+    
+    const uint8_t batch = activeConfig().config.triggerTeeth > 1 ? 1 : PICKUP_CAPTURE_BATCH;
+    if (batch == _captureBatch) return;
+    
+    pcnt_counter_pause(PICKUP_PCNT_UNIT);
+    pcnt_set_event_value(PICKUP_PCNT_UNIT, PCNT_EVT_H_LIM, batch);
+    pcnt_counter_clear(PICKUP_PCNT_UNIT);
+    _captureBatch = batch;
+    pcnt_counter_resume(PICKUP_PCNT_UNIT);
+    Serial.printf("[QS] Pickup capture: %u edge(s) per interrupt\n", batch);
+}
+
+const char* QuickShifterEngine::cutModeToString(CutMode mode) {
+    return mode == CutMode::CLOSED_LOOP ? "closed" : "open";
+}
+
+QuickShifterEngine::CutMode QuickShifterEngine::cutModeFromString(const char* str) {
+    if (str && strcmp(str, "closed") == 0) return CutMode::CLOSED_LOOP;
+    return CutMode::OPEN_LOOP;
+}
+
+const char* QuickShifterEngine::shiftSensorModeToString(ShiftSensorMode mode) {
+    return mode == ShiftSensorMode::FORCE ? "force" : "switch";
+}
+
+QuickShifterEngine::ShiftSensorMode QuickShifterEngine::shiftSensorModeFromString(const char* str) {
+    if (str && strcmp(str, "force") == 0) return ShiftSensorMode::FORCE;
+    return ShiftSensorMode::SWITCH;
 }
 
 void QuickShifterEngine::update() {
+    // Force sensor request; the cut path shares state with the ISRs
+    if (_shiftRequested) {
+        _shiftRequested = false;
+        noInterrupts();
+        handleShiftSensor();
+        interrupts();
+    }
+    
     unsigned long currentMicros = micros();
     
     // Check signal timeout
@@ -89,31 +274,24 @@ void QuickShifterEngine::update() {
         // Signal lost
         noInterrupts();
         _currentRpm = 0;
+        _rpmEstimator.reset();
+        notifyState();
+        interrupts();
+    } else if (!wasActive && _signalActive) {
+        noInterrupts();
+        notifyState();
         interrupts();
-    }
-    
-    // Print debug messages if we have a shift sensor event
-    if (_debugData.hasEvent) {
-        String debugMsg = "[QS] Shift sensor triggered! | RPM: ";
-        debugMsg += _debugData.rpm;
-        debugMsg += " | Threshold: ";
-        debugMsg += _config.minRpmThreshold;
-        
-        if (_debugData.debounced) {
-            debugMsg += " | DEBOUNCED - ignoring";
-        } else if (_debugData.rpmTooLow) {
-            debugMsg += " | RPM TOO LOW - ignoring";
-        } else {
-            debugMsg += " | Cut time: ";
-            debugMsg += _debugData.cutTime;
-            debugMsg += "ms | CUT TRIGGERED";
-        }
-        
-        Serial.println(debugMsg);
-        _debugData.hasEvent = false;
     }
 }
 
+void QuickShifterEngine::setStateListener(StateListener listener, void* context) {
+    noInterrupts();
+    _stateListener = listener;
+    _stateListenerContext = context;
+    notifyState();
+    interrupts();
+}
+
 uint16_t QuickShifterEngine::getCurrentRpm() const {
     // Thread-safe read of volatile variable
     noInterrupts();
@@ -122,37 +300,97 @@ uint16_t QuickShifterEngine::getCurrentRpm() const {
     return rpm;
 }
 
-uint16_t QuickShifterEngine::calculateCutTime(uint16_t rpm) const {
-    // Map RPM to array index: 5000-5999 -> index 0, 6000-6999 -> index 1, etc.
-    if (rpm < 5000) {
-        return _config.cutTimeMap[0];  // Use first value for RPM < 5k
-    }
-    if (rpm >= 15000) {
-        return _config.cutTimeMap[10]; // Use last value for RPM >= 15k
-    }
-    
-    // Calculate index: (rpm - 5000) / 1000
-    size_t index = (rpm - 5000) / 1000;
-    return _config.cutTimeMap[index];
+uint16_t QuickShifterEngine::getPredictedRpm() const {
+    noInterrupts();
+    uint16_t rpm = _rpmEstimator.predict(micros());
+    interrupts();
+    return rpm;
+}
+
+uint32_t IRAM_ATTR QuickShifterEngine::calculateCutTime(const ConfigBank& bank, uint16_t rpm, uint16_t load) const {
+    // Precompiled lookup: index plus one multiply-add, interpolated in RPM
+    return bank.cutMap.lookup(rpm, load);
 }
 
 void IRAM_ATTR QuickShifterEngine::handlePickupPulse() {
-    unsigned long currentTime = micros();
+    const uint32_t perfStart = PerfCounters::now();
+    unsigned long now = micros();
+    if (!_wheel.isMultiTooth()) handleSparkPulse(now);
+    processPickupEdges(now, 1);
+    _perf.end(PerfCounters::Probe::PICKUP_ISR, perfStart);
+}
+
+void IRAM_ATTR QuickShifterEngine::handleSparkPulse(unsigned long timestamp) {
+    const Config& config = activeConfig().config;
+    if (!_cutActive || config.skipCycle == 0) return;
+    
+    // Edges within half an interval are noise, not a spark
+    if (_lastValidInterval > 0 && (timestamp - _lastSparkEdgeTime) < _lastValidInterval / 2) return;
+    _lastSparkEdgeTime = timestamp;
+    
+    // This pulse fired spark _sparkIndex, set the output for the next one
+    if (++_sparkIndex >= config.skipCycle) _sparkIndex = 0;
+    if (_sparkIndex < config.skipSparks) {
+        CutOutput::Active::engage();
+    } else {
+        CutOutput::Active::release();
+    }
+}
 
+void IRAM_ATTR QuickShifterEngine::processPickupEdges(unsigned long currentTime, uint8_t edgeCount) {
     // 1. Handle Ignition Cut & Signal Loss
-    // If the cut is active, ignore pulses completely to avoid interference
-    if (_cutActive) {
+    // Open loop ignores pulses during the cut completely to avoid interference.
+    // Closed loop keeps measuring; switching spikes are far shorter than a
+    // real interval and get rejected by the predictive filter below.
+    // A multi-tooth wheel is always decoded through the cut, so it keeps its
+    // tooth position (and the spark pattern its revolutions).
+    const Config& config = activeConfig().config;
+    if (config.triggerTeeth != _wheel.getTeeth() || config.triggerMissing != _wheel.getMissing()) {
+        _wheel.configure(config.triggerTeeth, config.triggerMissing);
+    }
+    const bool multiTooth = _wheel.isMultiTooth();
+    const bool closedLoopCut = _cutActive && config.cutMode == CutMode::CLOSED_LOOP;
+    if (_cutActive && !closedLoopCut && !multiTooth) {
+        // Counted edges passed the glitch filter: restart the measurement at
+        // this batch, so the first batch after the cut spans no cut time and
+        // the same edge count (the predictive filter keeps its reference)
+        if (_pickupMode == PickupMode::PCNT_CAPTURE && _lastPulseTime != 0) {
+            _lastPulseTime = currentTime;
+            _rejectedEdges = 0;
+        }
         return;
     }
     
-    // If this is the first pulse or signal was lost (>100ms), establish baseline
-    if (_lastPulseTime == 0 || (currentTime - _lastPulseTime) > 100000) {
+    // In capture mode every counted edge already passed the hardware glitch
+    // filter, so edges of a rejected batch still belong to the next measurement.
+    // Wheels capture one edge at a time and count pitches by time instead.
+    uint16_t edges = edgeCount + _rejectedEdges;
+    
+    // If this is the first pulse or signal was lost (>100ms per pulse), establish baseline
+    if (_lastPulseTime == 0 || (currentTime - _lastPulseTime) > 100000UL * edges) {
         _lastPulseTime = currentTime;
         _lastValidInterval = 0; // Reset predictive filter
+        _rejectedEdges = 0;
+        _rpmEstimator.reset();
+        _wheel.reset();
         return;
     }
 
-    unsigned long currentInterval = currentTime - _lastPulseTime;
+    // Average interval per pulse over the batch (edges == 1 in GPIO mode),
+    // for a wheel the revolution period at the speed of this tooth
+    const unsigned long elapsed = currentTime - _lastPulseTime;
+    unsigned long currentInterval;
+    uint8_t pitches = 0;
+    if (multiTooth) {
+        pitches = _wheel.measure(elapsed);
+        if (pitches == 0) {
+            _lastPulseTime = currentTime;  // First tooth interval is the pitch reference
+            return;
+        }
+        currentInterval = _wheel.revolutionInterval(elapsed, pitches);
+    } else {
+        currentInterval = elapsed / edges;
+    }
     
     // 2. Predictive Filtering
     // We expect the new interval to be within +/- 40% of the previous valid one.
@@ -178,87 +416,194 @@ void IRAM_ATTR QuickShifterEngine::handlePickupPulse() {
         _isIntervalValid = false;
     }
 
-    if (_isIntervalValid) {
+    if (_isIntervalValid && multiTooth) {
+        // Valid tooth: the estimator gets every tooth, RPM and events are
+        // per revolution (averaged over all teeth)
+        _pulseInterval = currentInterval;
+        _lastValidInterval = currentInterval;
+        _lastPulseTime = currentTime;
+        _rpmEstimator.addTooth(currentTime, elapsed, currentInterval);
+        
+        if (!_wheel.accept(currentTime, elapsed, pitches)) {
+            // Until the first full revolution the tooth RPM stands in
+            if (_wheel.getRevolutionUs() == 0) _currentRpm = 60000000UL / currentInterval;
+            return;
+        }
+        
+        const uint32_t revolutionUs = _wheel.getRevolutionUs();
+        _currentRpm = revolutionUs >= 3000 ? 60000000UL / revolutionUs : 20000;
+        recordEvent(EventType::PULSE_ACCEPTED, _currentRpm, revolutionUs);
+        
+        handleSparkPulse(currentTime);
+        if (closedLoopCut) {
+            checkCutTermination(config);
+        }
+    } else if (_isIntervalValid) {
         // Valid pulse: Update state and RPM
         _pulseInterval = currentInterval;
         _lastValidInterval = currentInterval;
         
         // Calculate RPM (safe from div/0 due to <3000 check)
         _currentRpm = 60000000UL / _pulseInterval;
+        _rpmEstimator.addInterval(currentTime, currentInterval, edges);
         
         // Update timestamp only for valid pulses
         _lastPulseTime = currentTime;
+        _rejectedEdges = 0;
+        
+        recordEvent(EventType::PULSE_ACCEPTED, _currentRpm, currentInterval);
+        
+        if (closedLoopCut) {
+            checkCutTermination(config);
+        }
     } else {
         // Invalid pulse (Noise or Glitch)
         // We do NOT update _lastPulseTime.
         // This effectively ignores the noise spike, measuring the next interval 
         // from the last *valid* pulse.
+        if (_pickupMode == PickupMode::PCNT_CAPTURE && !multiTooth) {
+            _rejectedEdges = edges;
+        }
+        
+        recordEvent(EventType::PULSE_REJECTED, _currentRpm, currentInterval);
     }
 }
 
 void IRAM_ATTR QuickShifterEngine::handleShiftSensor(bool fromButton) {
     unsigned long currentTime = micros();
-    unsigned long debounceTimeUs = _config.debounceTimeMs * 1000UL;
-    
-    // Debug: Toggle built-in LED
-    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
     
-    // Mark that we have a new event to log
-    _debugData.hasEvent = true;
-    _debugData.debounced = false;
-    _debugData.rpmTooLow = false;
-    _debugData.rpm = _currentRpm;
-    _debugData.cutTime = 0;
+    // One generation for the whole request, even if a new one is published meanwhile
+    const ConfigBank& bank = activeConfig();
+    const Config& config = bank.config;
+    unsigned long debounceTimeUs = config.debounceTimeMs * 1000UL;
     
     // Debounce check
     if (_lastShiftSensorTime != 0 && 
         (currentTime - _lastShiftSensorTime) < debounceTimeUs) {
-        _debugData.debounced = true;
+        recordEvent(EventType::SHIFT_DEBOUNCED, _currentRpm, 0);
         return; // Ignore bounce
     }
     
     _lastShiftSensorTime = currentTime;
     
     // Check if RPM is above threshold
-    // if (_currentRpm < _config.minRpmThreshold && !fromButton) {
-    //     _debugData.rpmTooLow = true;
+    // if (_currentRpm < config.minRpmThreshold && !fromButton) {
     //     return; // RPM too low, ignore shift request
     // }
     
-    // Calculate cut time based on current RPM
-    uint16_t cutTime = calculateCutTime(_currentRpm);
-    _debugData.cutTime = cutTime;
+    // Throttle gate (no cut while closed) and the map's throttle axis, with
+    // a valid TPS only; without one the request always passes
+    uint16_t load = _loadInput;
+    if (_sensors) {
+        const SensorValues sensors = _sensors->read();
+        if (sensors.flags & SensorValues::TPS_VALID) {
+            if (sensors.tps < config.minThrottle && !fromButton) {
+                recordEvent(EventType::SHIFT_BLOCKED, _currentRpm, sensors.tps);
+                return;
+            }
+            if (config.cutMap.loadSource == CutTimeMap::LoadSource::THROTTLE) {
+                load = sensors.tps;
+            }
+        }
+    }
+    
+    // Calculate cut time for the RPM the engine is at now, not the one of
+    // the last interval (up to a full revolution old at low RPM)
+    uint16_t predictedRpm = _rpmEstimator.predict(currentTime);
+    uint32_t cutTime = calculateCutTime(bank, predictedRpm, load);
+    recordEvent(EventType::SHIFT, predictedRpm, cutTime, currentTime);  // Request time, for the latency to CUT_START
     
     // Trigger ignition cut
-    triggerIgnitionCut(cutTime);
+    triggerIgnitionCut(config, cutTime);
 }
 
-void IRAM_ATTR QuickShifterEngine::triggerIgnitionCut(uint16_t cutTimeMs) {
-    // Set ignition cut pin HIGH
-    digitalWrite(_ignitionCutPin, HIGH);
+void IRAM_ATTR QuickShifterEngine::triggerIgnitionCut(const Config& config, uint32_t cutTimeUs) {
+    if (cutTimeUs < MIN_CUT_TIME_US) cutTimeUs = MIN_CUT_TIME_US;
+    if (cutTimeUs > MAX_CUT_TIME_US) cutTimeUs = MAX_CUT_TIME_US;
+    
+    // Assert the cut output
+    CutOutput::Active::engage();
+    _perf.cutEngaged();
+    const bool wasActive = _cutActive;
     _cutActive = true;
     
-    // Start timer to turn off cut
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    // Arm one-shot alarm relative to the free-running counter, after the
+    // output lead time (relay contact travel) so the spark is interrupted
+    // for the full cut time. A retrigger during an active cut simply moves
+    // the alarm forward.
+    uint64_t now = timer_group_get_counter_value_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+    uint64_t start = now + CutOutput::Active::LEAD_US;
+    timer_group_set_alarm_value_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX, start + cutTimeUs);
+    timer_group_enable_alarm_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+    _perf.cutArmed(start + cutTimeUs);
     
-    // Update timer period
-    xTimerChangePeriodFromISR(_cutTimer, pdMS_TO_TICKS(cutTimeMs), &xHigherPriorityTaskWoken);
-    xTimerStartFromISR(_cutTimer, &xHigherPriorityTaskWoken);
+    // Closed-loop tracking and the spark pattern restart from here on a
+    // retrigger as well (spark 0 is always skipped)
+    _cutStartTicks = start;
+    _sparkIndex = 0;
+    _lastSparkEdgeTime = _lastPulseTime;
+    _cutMinTimeUs = cutTimeUs * config.closedLoopMinPercent / 100;
+    _cutPeakRpm = _currentRpm;
+    _cutDropCount = 0;
     
-    if (xHigherPriorityTaskWoken) {
-        portYIELD_FROM_ISR();
-    }
+    recordEvent(EventType::CUT_START, _currentRpm, cutTimeUs);
+    
+    // Status output last, the alarm is already armed
+    if (!wasActive) notifyState();
+}
 
-    return;
+void IRAM_ATTR QuickShifterEngine::endIgnitionCut(uint64_t nowTicks) {
+    CutOutput::Active::release();
+    _cutActive = false;
+    notifyState();
+    recordEvent(EventType::CUT_END, _currentRpm, static_cast<uint32_t>(nowTicks - _cutStartTicks));
 }
 
-void QuickShifterEngine::cutTimerCallback(TimerHandle_t xTimer) {
-    // Use static instance (singleton pattern)
-    if (!_instance) return;
+void IRAM_ATTR QuickShifterEngine::checkCutTermination(const Config& config) {
+    const uint16_t rpm = _currentRpm;
+    if (rpm >= _cutPeakRpm) {
+        _cutPeakRpm = rpm;
+        _cutDropCount = 0;
+        return;
+    }
+    
+    const uint32_t dropThreshold = static_cast<uint32_t>(_cutPeakRpm) * config.closedLoopDropPercent / 100;
+    if (static_cast<uint32_t>(_cutPeakRpm - rpm) < dropThreshold) {
+        _cutDropCount = 0;
+        return;
+    }
+    if (++_cutDropCount < CLOSED_LOOP_CONFIRM_INTERVALS) {
+        return;
+    }
     
-    // End ignition cut
-    digitalWrite(_instance->_ignitionCutPin, LOW);
-    _instance->_cutActive = false;
+    // Gear engaged: end now, or pull the alarm in to the minimum cut time
+    const uint64_t now = timer_group_get_counter_value_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+    const uint64_t earliest = _cutStartTicks + _cutMinTimeUs;
+    if (now >= earliest) {
+        endIgnitionCut(now);
+    } else {
+        timer_group_set_alarm_value_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX, earliest);
+        timer_group_enable_alarm_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+        _perf.cutArmed(earliest);
+    }
+}
+
+bool IRAM_ATTR QuickShifterEngine::cutTimerCallback(void* arg) {
+    const uint32_t perfStart = PerfCounters::now();
+    QuickShifterEngine* engine = static_cast<QuickShifterEngine*>(arg);
+    if (!engine) return false;
+    
+    // Already ended early by closed-loop termination, nothing to release
+    if (!engine->_cutActive) return false;
+    
+    // End ignition cut directly from the alarm ISR
+    const uint64_t now = timer_group_get_counter_value_in_isr(CUT_TIMER_GROUP, CUT_TIMER_IDX);
+    engine->endIgnitionCut(now);
+    engine->_perf.cutReleased(now);
+    engine->_perf.end(PerfCounters::Probe::CUT_TIMER_ISR, perfStart);
+    
+    // Alarm is not auto-reloaded, it stays disarmed until the next cut
+    return false;
 }
 
 // ISR Trampolines
@@ -268,14 +613,33 @@ void IRAM_ATTR QuickShifterEngine::pickupCoilISR() {
     }
 }
 
-void IRAM_ATTR QuickShifterEngine::shiftSensorISR() {
+void IRAM_ATTR QuickShifterEngine::pickupCaptureISR(void* arg) {
+    // PCNT ISR service has already cleared the H_LIM event
+    QuickShifterEngine* engine = static_cast<QuickShifterEngine*>(arg);
+    if (engine) {
+        engine->processPickupEdges(isrMicros(), engine->_captureBatch);  // IRAM ISR, no micros()
+    }
+}
+
+void IRAM_ATTR QuickShifterEngine::sparkSyncISR() {
     if (_instance) {
+        _instance->handleSparkPulse(micros());
+    }
+}
+
+void IRAM_ATTR QuickShifterEngine::shiftSensorISR() {
+    // The switch input is ignored while the force sensor is the source
+    if (_instance && _instance->activeConfig().config.shiftSensorMode == ShiftSensorMode::SWITCH) {
+        _instance->_perf.shiftEdge();
         _instance->handleShiftSensor();
+        _instance->_perf.shiftDone();
     }
 }
 
 void IRAM_ATTR QuickShifterEngine::buttonISR() {
     if (_instance) {
+        _instance->_perf.shiftEdge();
         _instance->handleShiftSensor(true);
+        _instance->_perf.shiftDone();
     }
 }
@@ -0,0 +1,75 @@
+#include "RpmEstimator.hpp"
+
+namespace {
+// 1e6 / 64: time is scaled to 64 µs units so RPM × time stays within 32 bits
+constexpr int32_t TICKS_PER_SECOND = 15625;
+constexpr uint32_t TICK_SHIFT = 6;
+}
+
+RpmEstimator::RpmEstimator()
+    : _points{}
+    , _head(0)
+    , _count(0)
+    , _rpm(0)
+    , _acceleration(0)
+    , _lastPointUs(0)
+{
+}
+
+void IRAM_ATTR RpmEstimator::reset() {
+    _head = 0;
+    _count = 0;
+    _rpm = 0;
+    _acceleration = 0;
+}
+
+void IRAM_ATTR RpmEstimator::addInterval(uint32_t timestampUs, uint32_t intervalUs, uint16_t pulses) {
+    if (intervalUs == 0) return;
+    addPoint(timestampUs - intervalUs * pulses / 2, intervalUs);
+}
+
+void IRAM_ATTR RpmEstimator::addTooth(uint32_t timestampUs, uint32_t spanUs, uint32_t revolutionUs) {
+    if (revolutionUs == 0) return;
+    addPoint(timestampUs - spanUs / 2, revolutionUs);
+}
+
+void IRAM_ATTR RpmEstimator::addPoint(uint32_t pointUs, uint32_t intervalUs) {
+    uint32_t rpm = 60000000UL / intervalUs;
+    if (rpm > MAX_RPM) rpm = MAX_RPM;
+
+    _points[_head].timestampUs = pointUs;
+    _points[_head].rpm = rpm;
+    _head = (_head + 1) & (WINDOW - 1);
+    if (_count < WINDOW) _count++;
+
+    int32_t acceleration = 0;
+    if (_count >= 2) {
+        const Point& oldest = _points[(_head - _count) & (WINDOW - 1)];
+        const int32_t spanTicks = (pointUs - oldest.timestampUs) >> TICK_SHIFT;
+        if (spanTicks > 0) {
+            // ΔRPM ≤ 20000, × 15625 stays below 2^31
+            acceleration = (static_cast<int32_t>(rpm) - oldest.rpm) * TICKS_PER_SECOND / spanTicks;
+        }
+        if (acceleration > MAX_ACCELERATION) acceleration = MAX_ACCELERATION;
+        if (acceleration < -MAX_ACCELERATION) acceleration = -MAX_ACCELERATION;
+    }
+
+    _rpm = rpm;
+    _acceleration = acceleration;
+    _lastPointUs = pointUs;
+}
+
+uint16_t IRAM_ATTR RpmEstimator::predict(uint32_t timestampUs) const {
+    const int32_t rpm = _rpm;
+    if (rpm == 0) return 0;
+
+    int32_t elapsedUs = static_cast<int32_t>(timestampUs - _lastPointUs);
+    if (elapsedUs < 0) elapsedUs = 0;
+    if (elapsedUs > static_cast<int32_t>(MAX_PREDICTION_US)) elapsedUs = MAX_PREDICTION_US;
+
+    // |acceleration| ≤ 200000 × 1562 ticks stays below 2^31
+    int32_t predicted = rpm + _acceleration * (elapsedUs >> TICK_SHIFT) / TICKS_PER_SECOND;
+    if (predicted < 0) predicted = 0;
+    if (predicted > MAX_RPM) predicted = MAX_RPM;
+    return predicted;
+}
@@ -0,0 +1,169 @@
+#include "SensorAcquisition.hpp"
+
+namespace {
+constexpr uint32_t DEFAULT_VREF_MV = 1100;  // Only used without eFuse calibration
+}
+
+SensorAcquisition::SensorAcquisition(ShiftForceSensor& forceSensor)
+    : _forceSensor(forceSensor)
+    , _tps{}
+    , _map{}
+    , _tpsFromDma(false)
+    , _tpsMv(0)
+    , _mapMv(0)
+    , _mapStale(0)
+    , _values{}
+{
+    getDefaultCalibration(_calibration);
+}
+
+void SensorAcquisition::getDefaultCalibration(Calibration& calibration) {
+    calibration.tpsEnabled = false;
+    calibration.mapEnabled = false;
+    calibration.tpsClosedMv = 400;
+    calibration.tpsOpenMv = 2400;
+    calibration.mapLowMv = 200;
+    calibration.mapHighMv = 2400;
+    calibration.mapLowKpa = 100;    // 10 kPa
+    calibration.mapHighKpa = 1050;  // 105 kPa
+}
+
+bool SensorAcquisition::begin(uint8_t tpsPin, uint8_t mapPin) {
+    bool ok = true;
+    if (!setupInput(tpsPin, _tps)) {
+        Serial.printf("[Sensors] GPIO %u has no ADC channel, TPS disabled\n", tpsPin);
+        ok = false;
+    }
+    if (!setupInput(mapPin, _map)) {
+        Serial.printf("[Sensors] GPIO %u has no ADC channel, MAP disabled\n", mapPin);
+        ok = false;
+    }
+
+    // ADC1 one-shot reads are unavailable once the force sensor DMA runs
+    _tpsFromDma = _tps.unit == 1 && _forceSensor.setAuxPin(tpsPin);
+
+    Serial.printf("[Sensors] TPS on ADC%d ch %u%s, MAP on ADC%d ch %u, %u Hz x%u\n",
+                  _tps.unit, _tps.channel, _tpsFromDma ? " (DMA)" : "",
+                  _map.unit, _map.channel, 1000 / PERIOD_MS, OVERSAMPLE);
+    return ok;
+}
+
+bool SensorAcquisition::setupInput(uint8_t pin, Input& input) {
+    input.unit = 0;
+    const int8_t channel = digitalPinToAnalogChannel(pin);
+    if (channel < 0) return false;
+
+    if (channel < SOC_ADC_MAX_CHANNEL_NUM) {
+        input.unit = 1;
+        input.channel = channel;
+        adc1_config_width(ADC_WIDTH_BIT_13);
+        adc1_config_channel_atten(static_cast<adc1_channel_t>(input.channel), ADC_ATTEN_DB_11);
+    } else {
+        input.unit = 2;
+        input.channel = channel - SOC_ADC_MAX_CHANNEL_NUM;
+        adc2_config_channel_atten(static_cast<adc2_channel_t>(input.channel), ADC_ATTEN_DB_11);
+    }
+
+    esp_adc_cal_characterize(input.unit == 1 ? ADC_UNIT_1 : ADC_UNIT_2, ADC_ATTEN_DB_11,
+                             ADC_WIDTH_BIT_13, DEFAULT_VREF_MV, &input.characteristics);
+    return true;
+}
+
+void SensorAcquisition::setCalibration(const Calibration& calibration) {
+    Calibration clamped = calibration;
+    if (clamped.tpsOpenMv == clamped.tpsClosedMv) clamped.tpsEnabled = false;
+    if (clamped.mapHighMv == clamped.mapLowMv) clamped.mapEnabled = false;
+
+    // The acquisition task preempts the caller, never let it see half a copy
+    noInterrupts();
+    _calibration = clamped;
+    interrupts();
+}
+
+void SensorAcquisition::acquireTask(void* context) {
+    static_cast<SensorAcquisition*>(context)->update();
+}
+
+void SensorAcquisition::update() {
+    const Calibration& cal = _calibration;
+    SensorValues values = _values;
+    values.timestampUs = micros();
+    values.flags &= SensorValues::MAP_VALID;  // Cleared below unless still fresh
+
+    // Throttle position
+    uint16_t mv = 0;
+    bool tpsRead = false;
+    if (_tpsFromDma && _forceSensor.isRunning()) {
+        uint16_t raw = 0;
+        if (_forceSensor.takeAuxAverage(raw)) {
+            // DMA results are 12 bit, the characterization is for 13 bit
+            mv = esp_adc_cal_raw_to_voltage(static_cast<uint32_t>(raw) << 1, &_tps.characteristics);
+            tpsRead = true;
+        }
+    } else if (_tps.unit) {
+        tpsRead = readMv(_tps, mv);
+    }
+    if (tpsRead) {
+        _tpsMv = mv;
+        if (cal.tpsEnabled && inRange(mv, cal.tpsClosedMv, cal.tpsOpenMv)) {
+            values.tps = scale(mv, cal.tpsClosedMv, cal.tpsOpenMv, 0, TPS_FULL_SCALE);
+            values.flags |= SensorValues::TPS_VALID;
+        }
+    }
+
+    // Manifold pressure (ADC2, may lose the arbitration to WiFi)
+    if (_map.unit && readMv(_map, mv)) {
+        _mapMv = mv;
+        _mapStale = 0;
+        values.flags &= ~SensorValues::MAP_VALID;
+        if (cal.mapEnabled && inRange(mv, cal.mapLowMv, cal.mapHighMv)) {
+            values.map = scale(mv, cal.mapLowMv, cal.mapHighMv, cal.mapLowKpa, cal.mapHighKpa);
+            values.flags |= SensorValues::MAP_VALID;
+        }
+    } else if (++_mapStale >= STALE_PERIODS) {
+        _mapStale = STALE_PERIODS;
+        values.flags &= ~SensorValues::MAP_VALID;
+    }
+    if (!cal.mapEnabled) values.flags &= ~SensorValues::MAP_VALID;
+
+    _values = values;
+    _snapshot.write(values);
+}
+
+bool SensorAcquisition::readMv(Input& input, uint16_t& mv) {
+    uint32_t sum = 0;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < OVERSAMPLE; i++) {
+        int raw = 0;
+        if (input.unit == 1) {
+            raw = adc1_get_raw(static_cast<adc1_channel_t>(input.channel));
+        } else if (adc2_get_raw(static_cast<adc2_channel_t>(input.channel), ADC_WIDTH_BIT_13, &raw) != ESP_OK) {
+            continue;
+        }
+        if (raw < 0) continue;
+        sum += raw;
+        count++;
+    }
+    if (count == 0) return false;
+
+    mv = esp_adc_cal_raw_to_voltage(sum / count, &input.characteristics);
+    return true;
+}
+
+int32_t SensorAcquisition::scale(int32_t mv, int32_t mv0, int32_t mv1, int32_t out0, int32_t out1) {
+    if (mv1 == mv0) return out0;
+
+    int32_t out = out0 + (mv - mv0) * (out1 - out0) / (mv1 - mv0);
+    const int32_t low = out0 < out1 ? out0 : out1;
+    const int32_t high = out0 < out1 ? out1 : out0;
+    if (out < low) out = low;
+    if (out > high) out = high;
+    return out;
+}
+
+bool SensorAcquisition::inRange(uint16_t mv, uint16_t lowMv, uint16_t highMv) {
+    // Either end may be the higher voltage (inverted sensors)
+    const int32_t low = (lowMv < highMv ? lowMv : highMv) - FAULT_MARGIN_MV;
+    const int32_t high = (lowMv < highMv ? highMv : lowMv) + FAULT_MARGIN_MV;
+    return mv >= low && mv <= high;
+}
@@ -0,0 +1,316 @@
+#include "SessionLogger.hpp"
+
+namespace {
+// Log files are named %05u.bin, parse the ID back (0 = not a log file)
+uint32_t parseFileId(const char* name) {
+    if (!name) return 0;
+    const char* base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+
+    if (strlen(base) != 9 || strcmp(base + 5, ".bin") != 0) return 0;
+    for (size_t i = 0; i < 5; i++) {
+        if (!isdigit(static_cast<unsigned char>(base[i]))) return 0;
+    }
+    return strtoul(base, nullptr, 10);
+}
+}
+
+SessionLogger::SessionLogger(QuickShifterEngine& qsEngine, TelemetrySampler& sampler)
+    : _qsEngine(qsEngine)
+    , _sampler(sampler)
+    , _blockUsed(0)
+    , _fileSize(0)
+    , _nextFileId(1)
+    , _currentFileId(0)
+    , _sessionId(0)
+    , _initialized(false)
+    , _sessionActive(false)
+    , _lastSignalMs(0)
+    , _sampleIndex(0)
+    , _lostSamples(0)
+{
+}
+
+bool SessionLogger::begin() {
+    if (!LittleFS.exists(LOG_DIR) && !LittleFS.mkdir(LOG_DIR)) {
+        Serial.println("[Log] Failed to create log directory");
+        return false;
+    }
+
+    // Continue numbering after the newest file on flash
+    File dir = LittleFS.open(LOG_DIR);
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+        uint32_t id = parseFileId(entry.name());
+        if (id >= _nextFileId) _nextFileId = id + 1;
+    }
+    dir.close();
+
+    _initialized = true;
+    Serial.printf("[Log] Ready, next log file %05u.bin\n", _nextFileId);
+    return true;
+}
+
+void SessionLogger::logTask(void* context) {
+    static_cast<SessionLogger*>(context)->update();
+}
+
+void SessionLogger::onEngineEvent(const QuickShifterEngine::Event& event, void* context) {
+    SessionLogger* self = static_cast<SessionLogger*>(context);
+    if (!self->_sessionActive) return;
+
+    // Pulses are already covered by the RPM samples
+    switch (event.type) {
+        case QuickShifterEngine::EventType::SHIFT:
+        case QuickShifterEngine::EventType::SHIFT_DEBOUNCED:
+        case QuickShifterEngine::EventType::SHIFT_BLOCKED:
+        case QuickShifterEngine::EventType::CUT_START:
+        case QuickShifterEngine::EventType::CUT_END:
+            self->_events.push(event);
+            break;
+        default:
+            break;
+    }
+}
+
+void SessionLogger::update() {
+    if (!_initialized) return;
+
+    const unsigned long now = millis();
+    const bool signalActive = _qsEngine.isSignalActive();
+    if (signalActive) {
+        _lastSignalMs = now;
+    }
+
+    if (!_sessionActive) {
+        if (signalActive) {
+            startSession();
+        }
+        return;
+    }
+
+    appendSamples();
+    appendEvents();
+
+    if (_sessionActive && now - _lastSignalMs >= SESSION_IDLE_TIMEOUT_MS) {
+        endSession();
+    }
+}
+
+void SessionLogger::startSession() {
+    _sessionId = _nextFileId;
+    if (!openNextFile()) {
+        _initialized = false;  // Don't retry every cycle on a broken filesystem
+        return;
+    }
+
+    _sampleIndex = _sampler.getHead();
+    _sessionActive = true;
+    Serial.printf("[Log] Session %u started\n", _sessionId);
+}
+
+void SessionLogger::endSession() {
+    appendSamples();
+    appendEvents();
+
+    // Last block is written short, the file ends here anyway
+    if (_blockUsed > 0) {
+        writeBlock(false);
+    }
+    closeFile();
+
+    _sessionActive = false;
+    Serial.printf("[Log] Session %u ended (%u samples lost)\n", _sessionId, _lostSamples);
+}
+
+bool SessionLogger::openNextFile() {
+    pruneOldFiles();
+
+    char path[32];
+    snprintf(path, sizeof(path), "%s/%05u.bin", LOG_DIR, _nextFileId);
+    _file = LittleFS.open(path, "w");
+    if (!_file) {
+        Serial.printf("[Log] Failed to open %s\n", path);
+        return false;
+    }
+
+    _currentFileId = _nextFileId++;
+    _fileSize = 0;
+    _blockUsed = 0;
+
+    uint8_t* payload = beginChunk(ChunkType::HEADER, 1, sizeof(FileHeader));
+    if (!payload) return false;
+
+    FileHeader header;
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.reserved = 0;
+    header.sampleRateHz = _sampler.getSampleRate();
+    header.fileId = _currentFileId;
+    header.sessionId = _sessionId;
+    header.startMs = millis();
+    memcpy(payload, &header, sizeof(header));
+    return true;
+}
+
+void SessionLogger::closeFile() {
+    if (_file) {
+        _file.close();
+    }
+    _currentFileId = 0;
+}
+
+void SessionLogger::pruneOldFiles() {
+    for (;;) {
+        size_t count = 0;
+        uint32_t oldestId = UINT32_MAX;
+
+        File dir = LittleFS.open(LOG_DIR);
+        for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+            uint32_t id = parseFileId(entry.name());
+            if (id == 0) continue;
+            count++;
+            if (id < oldestId) oldestId = id;
+        }
+        dir.close();
+
+        const size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+        if (count == 0 || (count < MAX_LOG_FILES && freeBytes >= MAX_FILE_SIZE + BLOCK_SIZE)) {
+            return;
+        }
+
+        char path[32];
+        snprintf(path, sizeof(path), "%s/%05u.bin", LOG_DIR, oldestId);
+        if (!LittleFS.remove(path)) return;
+        Serial.printf("[Log] Rotated out %s\n", path);
+    }
+}
+
+uint8_t* SessionLogger::beginChunk(ChunkType type, uint8_t count, size_t payloadSize) {
+    const size_t needed = sizeof(ChunkHeader) + payloadSize;
+    if (_blockUsed + needed > BLOCK_SIZE) {
+        if (!writeBlock(true)) return nullptr;
+    }
+
+    ChunkHeader header;
+    header.type = static_cast<uint8_t>(type);
+    header.count = count;
+    header.size = payloadSize;
+    memcpy(_block + _blockUsed, &header, sizeof(header));
+
+    uint8_t* payload = _block + _blockUsed + sizeof(header);
+    _blockUsed += needed;
+    return payload;
+}
+
+void SessionLogger::appendSamples() {
+    while (_sessionActive) {
+        const uint32_t oldest = _sampler.getOldest();
+        if (_sampleIndex < oldest) {
+            _lostSamples += oldest - _sampleIndex;
+            _sampleIndex = oldest;
+        }
+
+        const uint32_t available = _sampler.getHead() - _sampleIndex;
+        if (available == 0) return;
+
+        const size_t room = BLOCK_SIZE - _blockUsed;
+        if (room < sizeof(ChunkHeader) + sizeof(TelemetryFrame::Sample)) {
+            if (!writeBlock(true)) return;
+            continue;
+        }
+
+        // Read straight into the block, the header is filled in once the count is known
+        size_t maxSamples = (room - sizeof(ChunkHeader)) / sizeof(TelemetryFrame::Sample);
+        if (maxSamples > UINT8_MAX) maxSamples = UINT8_MAX;
+        if (maxSamples > available) maxSamples = available;
+
+        auto* out = reinterpret_cast<TelemetryFrame::Sample*>(_block + _blockUsed + sizeof(ChunkHeader));
+        const size_t count = _sampler.read(_sampleIndex, out, maxSamples);
+        if (count == 0) return;
+
+        ChunkHeader header;
+        header.type = static_cast<uint8_t>(ChunkType::SAMPLES);
+        header.count = count;
+        header.size = count * sizeof(TelemetryFrame::Sample);
+        memcpy(_block + _blockUsed, &header, sizeof(header));
+        _blockUsed += sizeof(header) + header.size;
+    }
+}
+
+void SessionLogger::appendEvents() {
+    constexpr size_t MAX_EVENTS_PER_CHUNK = 16;
+    QuickShifterEngine::Event events[MAX_EVENTS_PER_CHUNK];
+
+    while (_sessionActive) {
+        size_t count = 0;
+        while (count < MAX_EVENTS_PER_CHUNK && _events.pop(events[count])) {
+            count++;
+        }
+        if (count == 0) return;
+
+        uint8_t* payload = beginChunk(ChunkType::EVENTS, count, count * sizeof(QuickShifterEngine::Event));
+        if (!payload) return;
+        memcpy(payload, events, count * sizeof(QuickShifterEngine::Event));
+    }
+}
+
+bool SessionLogger::writeBlock(bool pad) {
+    // Zero padding reads back as ChunkType::PAD
+    if (pad && _blockUsed < BLOCK_SIZE) {
+        memset(_block + _blockUsed, 0, BLOCK_SIZE - _blockUsed);
+    }
+    const size_t len = pad ? BLOCK_SIZE : _blockUsed;
+
+    const size_t written = _file ? _file.write(_block, len) : 0;
+    _file.flush();
+    _blockUsed = 0;
+
+    if (written != len) {
+        Serial.printf("[Log] Write failed for %05u.bin, stopping session\n", _currentFileId);
+        closeFile();
+        _sessionActive = false;
+        return false;
+    }
+
+    _fileSize += len;
+    if (_fileSize >= MAX_FILE_SIZE) {
+        closeFile();
+        if (!openNextFile()) {
+            _sessionActive = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+void SessionLogger::listFiles(JsonArray files) const {
+    File dir = LittleFS.open(LOG_DIR);
+    if (!dir) return;
+
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+        uint32_t id = parseFileId(entry.name());
+        if (id == 0) continue;
+
+        JsonObject file = files.createNestedObject();
+        file["name"] = String(entry.name());
+        file["size"] = entry.size();
+        file["active"] = _sessionActive && id == _currentFileId;
+    }
+    dir.close();
+}
+
+bool SessionLogger::getLogPath(const char* name, char* path, size_t pathSize) {
+    // Only plain log file names, nothing that could escape LOG_DIR
+    if (!name || strchr(name, '/') || parseFileId(name) == 0) return false;
+
+    snprintf(path, pathSize, "%s/%s", LOG_DIR, name);
+    return true;
+}
+
+bool SessionLogger::removeFile(const char* name) {
+    char path[32];
+    if (!getLogPath(name, path, sizeof(path))) return false;
+    if (_sessionActive && parseFileId(name) == _currentFileId) return false;
+
+    return LittleFS.remove(path);
+}
@@ -0,0 +1,257 @@
+#include "ShiftAnalytics.hpp"
+
+using EventType = QuickShifterEngine::EventType;
+
+ShiftAnalytics::ShiftAnalytics(QuickShifterEngine& qsEngine, TelemetrySampler& sampler)
+    : _qsEngine(qsEngine)
+    , _sampler(sampler)
+    , _records{}
+    , _next(0)
+    , _open{}
+    , _phase(Phase::IDLE)
+    , _pulses{}
+    , _pulseHead(0)
+    , _pulseCount(0)
+    , _published(false)
+    , _shiftUs(0)
+    , _cutEndUs(0)
+    , _lastRpm(0)
+    , _totals{0, 0, 0, 0, 0, 0}
+{
+}
+
+void ShiftAnalytics::onEngineEvent(const QuickShifterEngine::Event& event, void* context) {
+    static_cast<ShiftAnalytics*>(context)->handleEvent(event);
+}
+
+void ShiftAnalytics::handleEvent(const QuickShifterEngine::Event& event) {
+    switch (event.type) {
+        case EventType::PULSE_ACCEPTED:
+            _lastRpm = event.rpm;
+            _pulses[_pulseHead] = Pulse{event.timestampUs, event.rpm};
+            _pulseHead = (_pulseHead + 1) & (RpmEstimator::WINDOW - 1);
+            if (_pulseCount < RpmEstimator::WINDOW) _pulseCount++;
+            if (_phase == Phase::CUTTING || _phase == Phase::SETTLING) {
+                if (event.rpm < _open.minRpm) {
+                    _open.minRpm = event.rpm;
+                    if (_published) publish();
+                }
+            }
+            if (_phase == Phase::SETTLING && event.timestampUs - _cutEndUs >= SETTLE_US) {
+                finish();
+            }
+            break;
+
+        case EventType::SHIFT:
+            beginShift(event);
+            break;
+
+        case EventType::CUT_START:
+            if (_phase == Phase::SHIFTED) {
+                const uint32_t latency = event.timestampUs - _shiftUs;
+                _open.latencyUs = latency > UINT16_MAX ? UINT16_MAX : latency;
+                _open.mapCutUs = event.cutTimeUs;
+                _open.minRpm = event.rpm ? min(event.rpm, _open.entryRpm) : _open.entryRpm;
+                _phase = Phase::CUTTING;
+
+                portENTER_CRITICAL(&_lock);
+                _totals.cuts++;
+                _totals.latencySumUs += _open.latencyUs;
+                if (_open.latencyUs > _totals.latencyMaxUs) _totals.latencyMaxUs = _open.latencyUs;
+                portEXIT_CRITICAL(&_lock);
+            }
+            break;
+
+        case EventType::CUT_END:
+            if (_phase == Phase::CUTTING) {
+                _open.cutUs = event.cutTimeUs;
+                if ((_open.flags & FLAG_CLOSED_LOOP) && _open.cutUs < _open.mapCutUs) {
+                    _open.flags |= FLAG_ENDED_EARLY;
+                }
+                _cutEndUs = event.timestampUs;
+                _phase = Phase::SETTLING;
+                publish();
+            }
+            break;
+
+        case EventType::SHIFT_DEBOUNCED:
+            if (_phase != Phase::IDLE && _open.debounced < UINT8_MAX) {
+                _open.debounced++;
+                if (_published) publish();
+            }
+            portENTER_CRITICAL(&_lock);
+            _totals.debounced++;
+            portEXIT_CRITICAL(&_lock);
+            break;
+
+        case EventType::SHIFT_BLOCKED:
+            portENTER_CRITICAL(&_lock);
+            _totals.blocked++;
+            portEXIT_CRITICAL(&_lock);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ShiftAnalytics::beginShift(const QuickShifterEngine::Event& event) {
+    // A shift during the previous cut only moves its end, that one has no length of its own
+    if (_phase == Phase::SHIFTED || _phase == Phase::CUTTING) {
+        _open.flags |= FLAG_RETRIGGERED;
+    }
+    if (_phase != Phase::IDLE) {
+        finish();
+    }
+
+    const QuickShifterEngine::Config config = _qsEngine.getConfig();
+    const bool closedLoop = config.cutMode == QuickShifterEngine::CutMode::CLOSED_LOOP;
+
+    _open = Record{};
+    _open.sequence = _totals.shifts;
+    _open.timeMs = millis() - (micros() - event.timestampUs) / 1000;
+    _open.entryRpm = _lastRpm;
+    _open.predictedRpm = event.rpm;
+    _open.minRpm = _lastRpm;
+    if (closedLoop) {
+        _open.expectedDropRpm = static_cast<uint32_t>(_lastRpm) * config.closedLoopDropPercent / 100;
+    } else {
+        // The cut takes the drive load off, RPM falls at about the rate it
+        // was climbing: the map time is tuned for a drop of this size
+        const int64_t drop = static_cast<int64_t>(abs(entryAcceleration())) * event.cutTimeUs / 1000000;
+        _open.expectedDropRpm = drop > _lastRpm ? _lastRpm : static_cast<uint16_t>(drop);
+    }
+    _open.mapCutUs = event.cutTimeUs;
+    if (closedLoop) _open.flags |= FLAG_CLOSED_LOOP;
+
+    // Throttle just before the request, from the sampler history
+    uint32_t index = _sampler.findIndex(event.timestampUs);
+    if (index > _sampler.getOldest()) index--;
+    TelemetryFrame::Sample sample;
+    if (_sampler.read(index, &sample, 1) == 1 && (sample.flags & TelemetryFrame::FLAG_TPS_VALID)) {
+        _open.tps = sample.tps;
+        _open.flags |= FLAG_TPS_VALID;
+    }
+
+    _shiftUs = event.timestampUs;
+    _phase = Phase::SHIFTED;
+    _published = false;
+
+    portENTER_CRITICAL(&_lock);
+    _totals.shifts++;
+    portEXIT_CRITICAL(&_lock);
+}
+
+int32_t ShiftAnalytics::entryAcceleration() const {
+    if (_pulseCount < 2) return 0;
+    const Pulse& newest = _pulses[(_pulseHead - 1) & (RpmEstimator::WINDOW - 1)];
+    const Pulse& oldest = _pulses[(_pulseHead - _pulseCount) & (RpmEstimator::WINDOW - 1)];
+    const uint32_t spanUs = newest.timestampUs - oldest.timestampUs;
+    if (spanUs == 0) return 0;
+    return static_cast<int32_t>((static_cast<int64_t>(newest.rpm) - oldest.rpm) * 1000000 / spanUs);
+}
+
+void ShiftAnalytics::publish() {
+    portENTER_CRITICAL(&_lock);
+    _records[_open.sequence & (CAPACITY - 1)] = _open;
+    if (_open.sequence >= _next) _next = _open.sequence + 1;
+    portEXIT_CRITICAL(&_lock);
+    _published = true;
+}
+
+void ShiftAnalytics::finish() {
+    _open.flags |= FLAG_COMPLETE;
+    publish();
+    _phase = Phase::IDLE;
+}
+
+uint32_t ShiftAnalytics::getNext() const {
+    return _next;
+}
+
+uint32_t ShiftAnalytics::getOldest() const {
+    const uint32_t next = _next;
+    return next > CAPACITY ? next - CAPACITY : 0;
+}
+
+size_t ShiftAnalytics::read(uint32_t& from, Record* out, size_t maxRecords) const {
+    size_t count = 0;
+    portENTER_CRITICAL(&_lock);
+    const uint32_t next = _next;
+    const uint32_t oldest = next > CAPACITY ? next - CAPACITY : 0;
+    if (from < oldest) from = oldest;
+    portEXIT_CRITICAL(&_lock);
+
+    // One record per critical section, the events task is never held up for long
+    while (count < maxRecords && from < next) {
+        portENTER_CRITICAL(&_lock);
+        const Record& record = _records[from & (CAPACITY - 1)];
+        const bool valid = record.sequence == from;
+        if (valid) out[count] = record;
+        portEXIT_CRITICAL(&_lock);
+
+        if (valid) count++;
+        from++;
+    }
+    return count;
+}
+
+ShiftAnalytics::Totals ShiftAnalytics::getTotals() const {
+    portENTER_CRITICAL(&_lock);
+    const Totals totals = _totals;
+    portEXIT_CRITICAL(&_lock);
+    return totals;
+}
+
+void ShiftAnalytics::toJson(uint32_t from, size_t count, JsonObject out) const {
+    if (count > MAX_QUERY) count = MAX_QUERY;
+
+    Record records[MAX_QUERY];
+    const size_t copied = read(from, records, count);
+
+    out["oldest"] = getOldest();
+    out["next"] = from;
+    out["capacity"] = CAPACITY;
+
+    // Rows instead of objects, a full reply stays within a pooled buffer
+    JsonArray fields = out.createNestedArray("fields");
+    fields.add("seq");
+    fields.add("timeMs");
+    fields.add("entryRpm");
+    fields.add("predictedRpm");
+    fields.add("minRpm");
+    fields.add("expectedDropRpm");
+    fields.add("mapCutUs");
+    fields.add("cutUs");
+    fields.add("latencyUs");
+    fields.add("tps");
+    fields.add("debounced");
+    fields.add("flags");
+
+    JsonArray shifts = out.createNestedArray("shifts");
+    for (size_t i = 0; i < copied; i++) {
+        const Record& record = records[i];
+        JsonArray row = shifts.createNestedArray();
+        row.add(record.sequence);
+        row.add(record.timeMs);
+        row.add(record.entryRpm);
+        row.add(record.predictedRpm);
+        row.add(record.minRpm);
+        row.add(record.expectedDropRpm);
+        row.add(record.mapCutUs);
+        row.add(record.cutUs);
+        row.add(record.latencyUs);
+        row.add(record.tps);
+        row.add(record.debounced);
+        row.add(record.flags);
+    }
+
+    const Totals totals = getTotals();
+    JsonObject sums = out.createNestedObject("totals");
+    sums["shifts"] = totals.shifts;
+    sums["cuts"] = totals.cuts;
+    sums["debounced"] = totals.debounced;
+    sums["blocked"] = totals.blocked;
+    sums["latencyAvgUs"] = totals.cuts ? totals.latencySumUs / totals.cuts : 0;
+    sums["latencyMaxUs"] = totals.latencyMaxUs;
+}
@@ -0,0 +1,173 @@
+#include "ShiftForceSensor.hpp"
+
+ShiftForceSensor::ShiftForceSensor(QuickShifterEngine& qsEngine)
+    : _qsEngine(qsEngine)
+    , _engineTask(nullptr)
+    , _channel(ADC1_CHANNEL_0)
+    , _auxChannel(-1)
+    , _running(false)
+    , _frameBytes(0)
+    , _filtered(0)
+    , _baseline(0)
+    , _primed(false)
+    , _force(0)
+    , _pressed(false)
+    , _pressSamples(0)
+    , _triggerCount(0)
+    , _overruns(0)
+    , _auxSum(0)
+    , _auxCount(0)
+{
+}
+
+bool ShiftForceSensor::setAuxPin(uint8_t pin) {
+    const int8_t channel = digitalPinToAnalogChannel(pin);
+    if (channel < 0 || channel >= ADC1_CHANNEL_MAX) {
+        return false;
+    }
+    _auxChannel = channel;
+    return true;
+}
+
+bool ShiftForceSensor::takeAuxAverage(uint16_t& raw) {
+    // Sensor task runs at a higher priority, keep it out while swapping
+    noInterrupts();
+    const uint32_t sum = _auxSum;
+    const uint32_t count = _auxCount;
+    _auxSum = 0;
+    _auxCount = 0;
+    interrupts();
+
+    if (count == 0) return false;
+    raw = sum / count;
+    return true;
+}
+
+bool ShiftForceSensor::begin(uint8_t pin) {
+    const int8_t channel = digitalPinToAnalogChannel(pin);
+    if (channel < 0 || channel >= ADC1_CHANNEL_MAX) {
+        Serial.printf("[Force] GPIO %u is not an ADC1 pin\n", pin);
+        return false;
+    }
+    _channel = static_cast<adc1_channel_t>(channel);
+    if (_auxChannel == channel) _auxChannel = -1;
+
+    // Conversions alternate between the channels, the rate scales with them
+    const uint32_t channels = _auxChannel >= 0 ? 2 : 1;
+    _frameBytes = SAMPLES_PER_FRAME * channels * sizeof(adc_digi_output_data_t);
+
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = _frameBytes * DMA_BUFFER_FRAMES;
+    initConfig.conv_num_each_intr = _frameBytes;
+    initConfig.adc1_chan_mask = BIT(_channel) | (_auxChannel >= 0 ? BIT(_auxChannel) : 0);
+    initConfig.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&initConfig) != ESP_OK) {
+        Serial.println("[Force] ADC DMA driver init failed");
+        return false;
+    }
+
+    adc_digi_pattern_config_t patterns[MAX_CHANNELS] = {};
+    for (uint32_t i = 0; i < channels; i++) {
+        patterns[i].atten = ADC_ATTEN_DB_11;
+        patterns[i].channel = i == 0 ? _channel : _auxChannel;
+        patterns[i].unit = 0;  // ADC1
+        patterns[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_configuration_t digiConfig = {};
+    digiConfig.conv_limit_en = true;  // Required on ESP32-S2 in single unit mode
+    digiConfig.conv_limit_num = 250;
+    digiConfig.pattern_num = channels;
+    digiConfig.adc_pattern = patterns;
+    digiConfig.sample_freq_hz = SAMPLE_RATE_HZ * channels;
+    digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    if (adc_digi_controller_configure(&digiConfig) != ESP_OK || adc_digi_start() != ESP_OK) {
+        Serial.println("[Force] ADC DMA start failed");
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    _running = true;
+    Serial.printf("[Force] Sampling GPIO %u (ADC1 ch %d) at %u Hz\n", pin, channel, SAMPLE_RATE_HZ);
+    return true;
+}
+
+void ShiftForceSensor::sensorTask(void* context) {
+    static_cast<ShiftForceSensor*>(context)->update();
+}
+
+void ShiftForceSensor::update() {
+    if (!_running) return;
+
+    // Settings are read once per drain, a change applies from the next frame
+    const bool armed = _qsEngine.getShiftSensorMode() == QuickShifterEngine::ShiftSensorMode::FORCE;
+    const int32_t threshold = _qsEngine.getForceThreshold();
+    const int32_t release = threshold - _qsEngine.getForceHysteresis();
+
+    for (;;) {
+        uint32_t length = 0;
+        const esp_err_t result = adc_digi_read_bytes(_frame, _frameBytes, &length, 0);
+        if (result == ESP_ERR_INVALID_STATE) {
+            // Driver pool was full and dropped a frame, the data read is still valid
+            _overruns++;
+        } else if (result != ESP_OK) {
+            return;  // ESP_ERR_TIMEOUT: no complete frame pending
+        }
+        if (length == 0) return;
+
+        const auto* samples = reinterpret_cast<const adc_digi_output_data_t*>(_frame);
+        const size_t count = length / sizeof(adc_digi_output_data_t);
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t channel = samples[i].type1.channel;
+            if (channel == _channel) {
+                processSample(samples[i].type1.data, armed, threshold, release);
+            } else if (channel == _auxChannel) {
+                _auxSum += samples[i].type1.data;
+                _auxCount++;
+            }
+        }
+    }
+}
+
+void ShiftForceSensor::processSample(uint16_t raw, bool armed, int32_t threshold, int32_t release) {
+    const int32_t sample = static_cast<int32_t>(raw) << FRACTION_BITS;
+    if (!_primed) {
+        _filtered = sample;
+        _baseline = sample;
+        _primed = true;
+        return;
+    }
+
+    _filtered += (sample - _filtered) >> FILTER_SHIFT;
+
+    // Baseline holds while pressed, unless the lever stays loaded (preload change)
+    if (!_pressed || _pressSamples >= MAX_PRESS_SAMPLES) {
+        _baseline += (_filtered - _baseline) >> BASELINE_SHIFT;
+    }
+
+    const int32_t force = (_filtered - _baseline) >> FRACTION_BITS;
+    _force = static_cast<int16_t>(force);
+
+    if (_pressed) {
+        _pressSamples++;
+        if (force < release) {
+            _pressed = false;
+        }
+    } else if (force >= threshold) {
+        _pressed = true;
+        _pressSamples = 0;
+        if (armed) {
+            trigger();
+        }
+    }
+}
+
+void ShiftForceSensor::trigger() {
+    _triggerCount++;
+    _qsEngine.requestShift();
+    if (_engineTask) {
+        xTaskNotifyGive(_engineTask);
+    }
+}
@@ -1,13 +1,62 @@
 #include "StorageHandler.hpp"
+#include "TelemetrySampler.hpp"
+#include <esp_rom_crc.h>
+#include <esp_attr.h>
+
+// Stored section sizes for the current schema versions. When one of these
+// fails, bump the matching *_CONFIG_VERSION and update the size here.
+static_assert(sizeof(QuickShifterEngine::Config) == 320, "QS config layout changed, bump QS_CONFIG_VERSION");
+static_assert(sizeof(StorageHandler::NetworkConfig) == 321, "Network config layout changed, bump NETWORK_CONFIG_VERSION");
+static_assert(sizeof(StorageHandler::TelemetryConfig) == 4, "Telemetry config layout changed, bump TELEMETRY_CONFIG_VERSION");
+static_assert(sizeof(SensorAcquisition::Calibration) == 14, "Sensor config layout changed, bump SENSOR_CONFIG_VERSION");
+
+// Not cleared at boot; a power cycle leaves garbage that fails the CRC
+RTC_NOINIT_ATTR StorageHandler::RecoveryBlock StorageHandler::_recovery;
+
+namespace {
+// Copy a JSON string into a fixed buffer, leaving it unchanged if absent
+void readString(JsonVariant value, char* dest, size_t size) {
+    const char* str = value.as<const char*>();
+    if (str) {
+        strlcpy(dest, str, size);
+    }
+}
+}
 
 StorageHandler::StorageHandler()
     : _initialized(false)
+    , _nvsReady(false)
+    , _configFromFlash(false)
+    , _dirty(0)
+    , _revision(0)
+    , _lastChangeMs(0)
+    , _mutex(nullptr)
 {
+    getDefaultConfig(_config);
 }
 
 bool StorageHandler::begin() {
+    if (!_mutex) {
+        _mutex = xSemaphoreCreateMutex();
+    }
+    
+    // Single read of the binary sections, everything after this is served from RAM
+    _nvsReady = _prefs.begin(NVS_NAMESPACE, false);
+    uint8_t found = 0;
+    if (_nvsReady) {
+        found = readSections(_config);
+        _configFromFlash = (found != 0);
+    } else {
+        Serial.println("[Storage] NVS unavailable, using default config");
+    }
+    
+    storeRecoveryConfig(_config);
+    return _nvsReady;
+}
+
+bool StorageHandler::mountFileSystem() {
     if (!LittleFS.begin(true)) {  // true = format on mount failure
-        
+        Serial.println("[Storage] LittleFS mount failed");
         return false;
     }
     
@@ -15,16 +64,69 @@ bool StorageHandler::begin() {
     
     printInfo();
     
+    SystemConfig legacy = _config;
+    if (_nvsReady && !_configFromFlash && readLegacyConfig(legacy)) {
+        // First boot after the move to NVS (or a fresh FS image carrying
+        // default settings), store everything in the binary format
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _config = legacy;
+        _dirty = DIRTY_ALL;
+        _revision++;
+        xSemaphoreGive(_mutex);
+        if (flush()) {
+            Serial.println("[Storage] Migrated /config.json to NVS");
+        }
+    }
+    
     return true;
 }
 
+bool StorageHandler::loadRecoveryConfig(QuickShifterEngine::Config& qsConfig,
+                                        SensorAcquisition::Calibration& sensorConfig) {
+    if (_recovery.magic != RECOVERY_MAGIC ||
+        _recovery.qsVersion != QS_CONFIG_VERSION ||
+        _recovery.sensorVersion != SENSOR_CONFIG_VERSION ||
+        _recovery.crc != recoveryCrc(_recovery)) {
+        return false;
+    }
+    
+    qsConfig = _recovery.qsConfig;
+    sensorConfig = _recovery.sensorConfig;
+    return true;
+}
+
+void StorageHandler::storeRecoveryConfig(const SystemConfig& config) {
+    // Invalid while half written, a reset in between falls back to NVS
+    _recovery.magic = 0;
+    _recovery.qsVersion = QS_CONFIG_VERSION;
+    _recovery.sensorVersion = SENSOR_CONFIG_VERSION;
+    _recovery.qsConfig = config.qsConfig;
+    _recovery.sensorConfig = config.sensorConfig;
+    _recovery.crc = recoveryCrc(_recovery);
+    _recovery.magic = RECOVERY_MAGIC;
+}
+
+uint32_t StorageHandler::recoveryCrc(const RecoveryBlock& block) {
+    uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&block.qsConfig), sizeof(block.qsConfig));
+    return esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(&block.sensorConfig), sizeof(block.sensorConfig));
+}
+
 void StorageHandler::getDefaultConfig(SystemConfig& config) {
     // QuickShifter defaults
     config.qsConfig.minRpmThreshold = 3000;
     config.qsConfig.debounceTimeMs = 50;
-    for (auto& cutTime : config.qsConfig.cutTimeMap) {
-        cutTime = 80;  // 80ms default for all RPM ranges
-    }
+    CutTimeMap::getDefaultTable(config.qsConfig.cutMap, QuickShifterEngine::DEFAULT_CUT_TIME_US);  // 80ms default everywhere
+    config.qsConfig.cutMode = QuickShifterEngine::CutMode::OPEN_LOOP;
+    config.qsConfig.closedLoopMinPercent = QuickShifterEngine::DEFAULT_CLOSED_LOOP_MIN_PERCENT;
+    config.qsConfig.closedLoopDropPercent = QuickShifterEngine::DEFAULT_CLOSED_LOOP_DROP_PERCENT;
+    config.qsConfig.skipSparks = 1;
+    config.qsConfig.skipCycle = 0;  // Continuous cut
+    config.qsConfig.shiftSensorMode = QuickShifterEngine::ShiftSensorMode::SWITCH;
+    config.qsConfig.forceThreshold = QuickShifterEngine::DEFAULT_FORCE_THRESHOLD;
+    config.qsConfig.forceHysteresis = QuickShifterEngine::DEFAULT_FORCE_HYSTERESIS;
+    config.qsConfig.minThrottle = QuickShifterEngine::DEFAULT_MIN_THROTTLE;
+    config.qsConfig.triggerTeeth = 1;    // One pulse per revolution
+    config.qsConfig.triggerMissing = 0;
     
     // Network defaults
     strcpy(config.networkConfig.apSsid, "rspqs");
@@ -36,102 +138,287 @@ void StorageHandler::getDefaultConfig(SystemConfig& config) {
     
     // Telemetry defaults
     config.telemetryConfig.updateRateMs = 100;
+    config.telemetryConfig.sampleRateHz = TelemetrySampler::DEFAULT_SAMPLE_RATE_HZ;
+    
+    // Sensor defaults (inputs disabled until calibrated)
+    SensorAcquisition::getDefaultCalibration(config.sensorConfig);
+}
+
+template <typename T>
+void StorageHandler::saveSection(T& cached, const T& value, uint8_t dirtyBit) {
+    // Byte compare may over-report on padding, a spare write is harmless
+    if (memcmp(&cached, &value, sizeof(T)) != 0) {
+        cached = value;
+        _dirty |= dirtyBit;
+        _revision++;
+        _lastChangeMs = millis();
+    }
 }
 
 bool StorageHandler::loadConfig(SystemConfig& config) {
-    if (!_initialized) {
-        
-        getDefaultConfig(config);
+    if (!_mutex) {
+        config = _config;
         return false;
     }
     
-    File file = LittleFS.open(CONFIG_FILE, "r");
-    if (!file) {
-        
-        getDefaultConfig(config);
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    config = _config;
+    xSemaphoreGive(_mutex);
+    return _configFromFlash;
+}
+
+bool StorageHandler::saveConfig(const SystemConfig& config) {
+    if (!_mutex) {
         return false;
     }
     
-    // Read file content
-    size_t size = file.size();
-    if (size == 0 || size > 2048) {
-        
-        file.close();
-        getDefaultConfig(config);
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    saveSection(_config.qsConfig, config.qsConfig, DIRTY_QS);
+    saveSection(_config.networkConfig, config.networkConfig, DIRTY_NETWORK);
+    saveSection(_config.telemetryConfig, config.telemetryConfig, DIRTY_TELEMETRY);
+    saveSection(_config.sensorConfig, config.sensorConfig, DIRTY_SENSORS);
+    xSemaphoreGive(_mutex);
+    return true;
+}
+
+void StorageHandler::update() {
+    if (_dirty && millis() - _lastChangeMs >= COMMIT_DELAY_MS) {
+        flush();
+    }
+}
+
+bool StorageHandler::flush() {
+    if (!_mutex || !_dirty) {
+        return true;
+    }
+    
+    // Snapshot under the lock, serialize and write without holding it
+    SystemConfig snapshot;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    snapshot = _config;
+    const uint8_t dirty = _dirty;
+    _dirty = 0;
+    xSemaphoreGive(_mutex);
+    
+    const uint8_t failed = writeSections(snapshot, dirty);
+    if (failed) {
+        // Keep the failed sections dirty, retried after the next quiet period
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _dirty |= failed;
+        _lastChangeMs = millis();
+        xSemaphoreGive(_mutex);
+        Serial.printf("[Storage] Config commit failed (sections 0x%02X)\n", failed);
         return false;
     }
     
-    // Parse JSON with fixed-size buffer
-    StaticJsonDocument<1024> doc;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    if (dirty & (DIRTY_QS | DIRTY_SENSORS)) {
+        storeRecoveryConfig(snapshot);
+    }
     
-    if (error) {
-        
-        
-        getDefaultConfig(config);
+    Serial.printf("[Storage] Config committed (sections 0x%02X)\n", dirty);
+    _configFromFlash = true;
+    return true;
+}
+
+uint8_t StorageHandler::readSections(SystemConfig& config) {
+    uint8_t found = 0;
+    uint8_t migrated = 0;
+    uint16_t stored = 0;
+    
+    if (readSection(KEY_QS, QS_CONFIG_VERSION, &config.qsConfig, sizeof(config.qsConfig), stored)) {
+        if (stored < QS_CONFIG_VERSION) {
+            migrateQsConfig(stored, config.qsConfig);
+        }
+        // Gear maps (no gear input ever fed them) only used their first row
+        if (config.qsConfig.cutMap.loadSource != CutTimeMap::LoadSource::THROTTLE) {
+            config.qsConfig.cutMap.loadSource = CutTimeMap::LoadSource::NONE;
+        }
+        if (CutTimeMap::isValid(config.qsConfig.cutMap)) {
+            found |= DIRTY_QS;
+            if (stored < QS_CONFIG_VERSION) migrated |= DIRTY_QS;
+        } else {
+            CutTimeMap::getDefaultTable(config.qsConfig.cutMap, QuickShifterEngine::DEFAULT_CUT_TIME_US);
+        }
+    }
+    if (readSection(KEY_NETWORK, NETWORK_CONFIG_VERSION, &config.networkConfig, sizeof(config.networkConfig), stored)) {
+        found |= DIRTY_NETWORK;
+        if (stored < NETWORK_CONFIG_VERSION) migrated |= DIRTY_NETWORK;
+    }
+    if (readSection(KEY_TELEMETRY, TELEMETRY_CONFIG_VERSION, &config.telemetryConfig, sizeof(config.telemetryConfig), stored)) {
+        found |= DIRTY_TELEMETRY;
+        if (stored < TELEMETRY_CONFIG_VERSION) migrated |= DIRTY_TELEMETRY;
+    }
+    if (readSection(KEY_SENSORS, SENSOR_CONFIG_VERSION, &config.sensorConfig, sizeof(config.sensorConfig), stored)) {
+        found |= DIRTY_SENSORS;
+        if (stored < SENSOR_CONFIG_VERSION) migrated |= DIRTY_SENSORS;
+    }
+    
+    // Migrated sections are rewritten in the current format on the first update()
+    _dirty |= migrated;
+    return found;
+}
+
+void StorageHandler::migrateQsConfig(uint16_t fromVersion, QuickShifterEngine::Config& config) {
+    SystemConfig defaults;
+    getDefaultConfig(defaults);
+    const QuickShifterEngine::Config& d = defaults.qsConfig;
+    
+    if (fromVersion < 2) {
+        config.cutMode = d.cutMode;
+        config.closedLoopMinPercent = d.closedLoopMinPercent;
+        config.closedLoopDropPercent = d.closedLoopDropPercent;
+    }
+    if (fromVersion < 3) {
+        config.skipSparks = d.skipSparks;
+        config.skipCycle = d.skipCycle;
+    }
+    if (fromVersion < 4) {
+        config.shiftSensorMode = d.shiftSensorMode;
+        config.forceThreshold = d.forceThreshold;
+        config.forceHysteresis = d.forceHysteresis;
+    }
+    if (fromVersion < 5) {
+        config.minThrottle = d.minThrottle;
+    }
+    if (fromVersion < 6) {
+        config.triggerTeeth = d.triggerTeeth;
+        config.triggerMissing = d.triggerMissing;
+    }
+}
+
+uint8_t StorageHandler::writeSections(const SystemConfig& config, uint8_t sections) {
+    if (!_nvsReady) {
+        return sections;
+    }
+    
+    uint8_t failed = 0;
+    if ((sections & DIRTY_QS) &&
+        !writeSection(KEY_QS, QS_CONFIG_VERSION, &config.qsConfig, sizeof(config.qsConfig))) {
+        failed |= DIRTY_QS;
+    }
+    if ((sections & DIRTY_NETWORK) &&
+        !writeSection(KEY_NETWORK, NETWORK_CONFIG_VERSION, &config.networkConfig, sizeof(config.networkConfig))) {
+        failed |= DIRTY_NETWORK;
+    }
+    if ((sections & DIRTY_TELEMETRY) &&
+        !writeSection(KEY_TELEMETRY, TELEMETRY_CONFIG_VERSION, &config.telemetryConfig, sizeof(config.telemetryConfig))) {
+        failed |= DIRTY_TELEMETRY;
+    }
+    if ((sections & DIRTY_SENSORS) &&
+        !writeSection(KEY_SENSORS, SENSOR_CONFIG_VERSION, &config.sensorConfig, sizeof(config.sensorConfig))) {
+        failed |= DIRTY_SENSORS;
+    }
+    return failed;
+}
+
+bool StorageHandler::readSection(const char* key, uint16_t version, void* section, size_t size, uint16_t& storedVersion) {
+    if (!_nvsReady || !_prefs.isKey(key)) {
         return false;
     }
     
-    // Check if document overflowed
-    if (doc.overflowed()) {
-        
-        getDefaultConfig(config);
-        doc.clear();
+    uint8_t blob[sizeof(BlobHeader) + MAX_SECTION_SIZE];
+    const size_t len = _prefs.getBytesLength(key);
+    if (len < sizeof(BlobHeader) || len > sizeof(blob) || _prefs.getBytes(key, blob, len) != len) {
+        Serial.printf("[Storage] Config section '%s' unreadable\n", key);
         return false;
     }
     
-    // Load QuickShifter config
-    config.qsConfig.minRpmThreshold = doc["qs"]["minRpm"] | 3000;
-    config.qsConfig.debounceTimeMs = doc["qs"]["debounce"] | 50;
+    BlobHeader header;
+    memcpy(&header, blob, sizeof(header));
+    const uint8_t* payload = blob + sizeof(header);
     
-    JsonArray cutTimeArray = doc["qs"]["cutTimeMap"];
-    if (cutTimeArray.size() == 11) {
-        for (size_t i = 0; i < 11; i++) {
-            config.qsConfig.cutTimeMap[i] = cutTimeArray[i] | 80;
-        }
-    } else {
-        for (auto& cutTime : config.qsConfig.cutTimeMap) {
-            cutTime = 80;
-        }
+    if (header.magic != BLOB_MAGIC || header.size != len - sizeof(header) ||
+        esp_rom_crc32_le(0, payload, header.size) != header.crc) {
+        Serial.printf("[Storage] Config section '%s' corrupt, using defaults\n", key);
+        return false;
     }
     
-    // Load Network config
-    strlcpy(config.networkConfig.apSsid, doc["network"]["apSsid"] | "rspqs", sizeof(config.networkConfig.apSsid));
-    strlcpy(config.networkConfig.apPassword, doc["network"]["apPassword"] | "", sizeof(config.networkConfig.apPassword));
-    strlcpy(config.networkConfig.staSsid, doc["network"]["staSsid"] | "", sizeof(config.networkConfig.staSsid));
-    strlcpy(config.networkConfig.staPassword, doc["network"]["staPassword"] | "", sizeof(config.networkConfig.staPassword));
-    config.networkConfig.staMode = doc["network"]["staMode"] | false;
-    strlcpy(config.networkConfig.lastError, doc["network"]["lastError"] | "", sizeof(config.networkConfig.lastError));
-    
-    // Load Telemetry config
-    config.telemetryConfig.updateRateMs = doc["telemetry"]["updateRate"] | 100;
-    doc.clear();
+    // Newer firmware wrote it (after a rollback), the layout is unknown
+    if (header.version > version || (header.version == version && header.size != size)) {
+        Serial.printf("[Storage] Config section '%s' v%u not supported, using defaults\n", key, header.version);
+        return false;
+    }
     
+    // Older versions only lack fields appended since, the caller resets those
+    memcpy(section, payload, header.size < size ? header.size : size);
+    storedVersion = header.version;
+    if (header.version < version) {
+        Serial.printf("[Storage] Config section '%s' migrated v%u -> v%u\n", key, header.version, version);
+    }
     return true;
 }
 
-bool StorageHandler::saveConfig(const SystemConfig& config) {
-    if (!_initialized) {
-        
+bool StorageHandler::writeSection(const char* key, uint16_t version, const void* section, size_t size) {
+    if (size > MAX_SECTION_SIZE) {
+        return false;
+    }
+    
+    uint8_t blob[sizeof(BlobHeader) + MAX_SECTION_SIZE];
+    BlobHeader header;
+    header.magic = BLOB_MAGIC;
+    header.version = version;
+    header.size = size;
+    header.crc = esp_rom_crc32_le(0, static_cast<const uint8_t*>(section), size);
+    memcpy(blob, &header, sizeof(header));
+    memcpy(blob + sizeof(header), section, size);
+    
+    const size_t len = sizeof(header) + size;
+    return _prefs.putBytes(key, blob, len) == len;
+}
+
+bool StorageHandler::readLegacyConfig(SystemConfig& config) {
+    if (!_initialized || !LittleFS.exists(LEGACY_CONFIG_FILE)) {
+        return false;
+    }
+    
+    File file = LittleFS.open(LEGACY_CONFIG_FILE, "r");
+    if (!file) {
         return false;
     }
     
-    // Create JSON document with fixed size
-    StaticJsonDocument<1024> doc;
+    // Read file content
+    size_t size = file.size();
+    if (size == 0 || size > 4096) {
+        file.close();
+        return false;
+    }
+    
+    // Parse JSON with fixed-size buffer
+    StaticJsonDocument<4096> doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
     
+    if (error || doc.overflowed()) {
+        doc.clear();
+        return false;
+    }
+    
+    bool success = configFromJson(doc.as<JsonObject>(), config);
+    doc.clear();
+    return success;
+}
+
+void StorageHandler::configToJson(const SystemConfig& config, JsonObject root) {
     // QuickShifter config
-    JsonObject qs = doc.createNestedObject("qs");
+    JsonObject qs = root.createNestedObject("qs");
     qs["minRpm"] = config.qsConfig.minRpmThreshold;
     qs["debounce"] = config.qsConfig.debounceTimeMs;
-    
-    JsonArray cutTimeArray = qs.createNestedArray("cutTimeMap");
-    for (const auto& cutTime : config.qsConfig.cutTimeMap) {
-        cutTimeArray.add(cutTime);
-    }
+    qs["cutMode"] = QuickShifterEngine::cutModeToString(config.qsConfig.cutMode);
+    qs["minCutPercent"] = config.qsConfig.closedLoopMinPercent;
+    qs["dropPercent"] = config.qsConfig.closedLoopDropPercent;
+    qs["skipSparks"] = config.qsConfig.skipSparks;
+    qs["skipCycle"] = config.qsConfig.skipCycle;
+    qs["shiftSensor"] = QuickShifterEngine::shiftSensorModeToString(config.qsConfig.shiftSensorMode);
+    qs["forceThreshold"] = config.qsConfig.forceThreshold;
+    qs["forceHysteresis"] = config.qsConfig.forceHysteresis;
+    qs["minThrottle"] = config.qsConfig.minThrottle / 10.0f;
+    qs["triggerTeeth"] = config.qsConfig.triggerTeeth;
+    qs["triggerMissing"] = config.qsConfig.triggerMissing;
+    
+    writeCutMap(qs, config.qsConfig.cutMap);
     
     // Network config
-    JsonObject network = doc.createNestedObject("network");
+    JsonObject network = root.createNestedObject("network");
     network["apSsid"] = String(config.networkConfig.apSsid);
     network["apPassword"] = String(config.networkConfig.apPassword);
     network["staSsid"] = String(config.networkConfig.staSsid);
@@ -140,128 +427,270 @@ bool StorageHandler::saveConfig(const SystemConfig& config) {
     network["lastError"] = String(config.networkConfig.lastError);
     
     // Telemetry config
-    JsonObject telemetry = doc.createNestedObject("telemetry");
+    JsonObject telemetry = root.createNestedObject("telemetry");
     telemetry["updateRate"] = config.telemetryConfig.updateRateMs;
+    telemetry["sampleRate"] = config.telemetryConfig.sampleRateHz;
     
-    // Check if document overflowed
-    if (doc.overflowed()) {
-        
+    // Sensor calibration
+    sensorConfigToJson(config.sensorConfig, root.createNestedObject("sensors"));
+}
+
+void StorageHandler::sensorConfigToJson(const SensorAcquisition::Calibration& config, JsonObject sensors) {
+    sensors["tpsEnabled"] = config.tpsEnabled;
+    sensors["mapEnabled"] = config.mapEnabled;
+    sensors["tpsClosedMv"] = config.tpsClosedMv;
+    sensors["tpsOpenMv"] = config.tpsOpenMv;
+    sensors["mapLowMv"] = config.mapLowMv;
+    sensors["mapHighMv"] = config.mapHighMv;
+    sensors["mapLowKpa"] = config.mapLowKpa / 10.0f;
+    sensors["mapHighKpa"] = config.mapHighKpa / 10.0f;
+}
+
+bool StorageHandler::sensorConfigFromJson(JsonObject sensors, SensorAcquisition::Calibration& config) {
+    if (sensors.isNull()) {
         return false;
     }
     
-    // Serialize to fixed buffer
-    char jsonBuffer[1024];
-    size_t jsonSize = serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
-    
-    if (jsonSize == 0) {
-        
+    config.tpsEnabled = sensors["tpsEnabled"] | config.tpsEnabled;
+    config.mapEnabled = sensors["mapEnabled"] | config.mapEnabled;
+    config.tpsClosedMv = sensors["tpsClosedMv"] | config.tpsClosedMv;
+    config.tpsOpenMv = sensors["tpsOpenMv"] | config.tpsOpenMv;
+    config.mapLowMv = sensors["mapLowMv"] | config.mapLowMv;
+    config.mapHighMv = sensors["mapHighMv"] | config.mapHighMv;
+    config.mapLowKpa = lroundf((sensors["mapLowKpa"] | config.mapLowKpa / 10.0f) * 10.0f);
+    config.mapHighKpa = lroundf((sensors["mapHighKpa"] | config.mapHighKpa / 10.0f) * 10.0f);
+    return true;
+}
+
+bool StorageHandler::configFromJson(JsonObject root, SystemConfig& config) {
+    if (root.isNull()) {
         return false;
     }
     
-    if (jsonSize >= sizeof(jsonBuffer)) {
-        
-        return false;
+    // QuickShifter config
+    JsonObject qs = root["qs"];
+    config.qsConfig.minRpmThreshold = qs["minRpm"] | config.qsConfig.minRpmThreshold;
+    config.qsConfig.debounceTimeMs = qs["debounce"] | config.qsConfig.debounceTimeMs;
+    if (qs.containsKey("cutMode")) {
+        config.qsConfig.cutMode = QuickShifterEngine::cutModeFromString(qs["cutMode"]);
+    }
+    config.qsConfig.closedLoopMinPercent = qs["minCutPercent"] | config.qsConfig.closedLoopMinPercent;
+    config.qsConfig.closedLoopDropPercent = qs["dropPercent"] | config.qsConfig.closedLoopDropPercent;
+    config.qsConfig.skipSparks = qs["skipSparks"] | config.qsConfig.skipSparks;
+    config.qsConfig.skipCycle = qs["skipCycle"] | config.qsConfig.skipCycle;
+    if (qs.containsKey("shiftSensor")) {
+        config.qsConfig.shiftSensorMode = QuickShifterEngine::shiftSensorModeFromString(qs["shiftSensor"]);
+    }
+    config.qsConfig.forceThreshold = qs["forceThreshold"] | config.qsConfig.forceThreshold;
+    config.qsConfig.forceHysteresis = qs["forceHysteresis"] | config.qsConfig.forceHysteresis;
+    config.qsConfig.minThrottle = lroundf((qs["minThrottle"] | config.qsConfig.minThrottle / 10.0f) * 10.0f);
+    config.qsConfig.triggerTeeth = qs["triggerTeeth"] | config.qsConfig.triggerTeeth;
+    config.qsConfig.triggerMissing = qs["triggerMissing"] | config.qsConfig.triggerMissing;
+    
+    // Cut map (older 1D formats are expanded to every load row)
+    const CutTimeMap::Table previousMap = config.qsConfig.cutMap;
+    if (readCutMap(qs, config.qsConfig.cutMap) && !CutTimeMap::isValid(config.qsConfig.cutMap)) {
+        config.qsConfig.cutMap = previousMap;
     }
     
-    // Atomic write
-    bool success = atomicWrite(CONFIG_FILE, jsonBuffer, jsonSize);
+    // Network config
+    JsonObject network = root["network"];
+    NetworkConfig& net = config.networkConfig;
+    readString(network["apSsid"], net.apSsid, sizeof(net.apSsid));
+    readString(network["apPassword"], net.apPassword, sizeof(net.apPassword));
+    readString(network["staSsid"], net.staSsid, sizeof(net.staSsid));
+    readString(network["staPassword"], net.staPassword, sizeof(net.staPassword));
+    net.staMode = network["staMode"] | net.staMode;
+    readString(network["lastError"], net.lastError, sizeof(net.lastError));
     
-    if (success) {
-        
-    } else {
-        
-    }
+    // Telemetry config
+    JsonObject telemetry = root["telemetry"];
+    config.telemetryConfig.updateRateMs = telemetry["updateRate"] | config.telemetryConfig.updateRateMs;
+    config.telemetryConfig.sampleRateHz = telemetry["sampleRate"] | config.telemetryConfig.sampleRateHz;
     
-    doc.clear();
-
-    return success;
+    // Sensor calibration
+    sensorConfigFromJson(root["sensors"], config.sensorConfig);
+    
+    return true;
 }
 
 bool StorageHandler::loadQsConfig(QuickShifterEngine::Config& config) {
-    SystemConfig sysConfig;
-    bool result = loadConfig(sysConfig);
-    config = sysConfig.qsConfig;
-    return result;
+    if (!_mutex) {
+        config = _config.qsConfig;
+        return false;
+    }
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    config = _config.qsConfig;
+    xSemaphoreGive(_mutex);
+    return _configFromFlash;
 }
 
 bool StorageHandler::saveQsConfig(const QuickShifterEngine::Config& config) {
-    SystemConfig sysConfig;
-    loadConfig(sysConfig);
-    sysConfig.qsConfig = config;
-    return saveConfig(sysConfig);
+    if (!_mutex) return false;
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    saveSection(_config.qsConfig, config, DIRTY_QS);
+    xSemaphoreGive(_mutex);
+    return true;
 }
 
 bool StorageHandler::loadNetworkConfig(NetworkConfig& config) {
-    SystemConfig sysConfig;
-    bool result = loadConfig(sysConfig);
-    config = sysConfig.networkConfig;
-    return result;
+    if (!_mutex) {
+        config = _config.networkConfig;
+        return false;
+    }
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    config = _config.networkConfig;
+    xSemaphoreGive(_mutex);
+    return _configFromFlash;
 }
 
 bool StorageHandler::saveNetworkConfig(const NetworkConfig& config) {
-    SystemConfig sysConfig;
-    loadConfig(sysConfig);
-    sysConfig.networkConfig = config;
-    return saveConfig(sysConfig);
+    if (!_mutex) return false;
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    saveSection(_config.networkConfig, config, DIRTY_NETWORK);
+    xSemaphoreGive(_mutex);
+    return true;
 }
 
 bool StorageHandler::loadTelemetryConfig(TelemetryConfig& config) {
-    SystemConfig sysConfig;
-    bool result = loadConfig(sysConfig);
-    config = sysConfig.telemetryConfig;
-    return result;
+    if (!_mutex) {
+        config = _config.telemetryConfig;
+        return false;
+    }
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    config = _config.telemetryConfig;
+    xSemaphoreGive(_mutex);
+    return _configFromFlash;
 }
 
 bool StorageHandler::saveTelemetryConfig(const TelemetryConfig& config) {
-    SystemConfig sysConfig;
-    loadConfig(sysConfig);
-    sysConfig.telemetryConfig = config;
-    return saveConfig(sysConfig);
+    if (!_mutex) return false;
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    saveSection(_config.telemetryConfig, config, DIRTY_TELEMETRY);
+    xSemaphoreGive(_mutex);
+    return true;
 }
 
-bool StorageHandler::hasWebInterface() const {
-    if (!_initialized) return false;
-    return LittleFS.exists(WEB_HTML_FILE);
+bool StorageHandler::loadSensorConfig(SensorAcquisition::Calibration& config) {
+    if (!_mutex) {
+        config = _config.sensorConfig;
+        return false;
+    }
+    
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    config = _config.sensorConfig;
+    xSemaphoreGive(_mutex);
+    return _configFromFlash;
 }
 
-void StorageHandler::printInfo() {
-    if (!_initialized) return;
+bool StorageHandler::saveSensorConfig(const SensorAcquisition::Calibration& config) {
+    if (!_mutex) return false;
     
-    size_t total = LittleFS.totalBytes();
-    size_t used = LittleFS.usedBytes();
-    
-    Serial.printf("[Storage] Total: %d bytes, Used: %d bytes, Free: %d bytes\n", 
-                  total, used, total - used);
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    saveSection(_config.sensorConfig, config, DIRTY_SENSORS);
+    xSemaphoreGive(_mutex);
+    return true;
 }
 
-bool StorageHandler::atomicWrite(const char* filename, const char* data, size_t len) {
-    // Write to temporary file first
-    File tmpFile = LittleFS.open(CONFIG_TEMP_FILE, "w");
-    if (!tmpFile) {
+bool StorageHandler::readCutMap(JsonObject qs, CutTimeMap::Table& table) {
+    bool found = false;
+    
+    if (qs.containsKey("cutMap")) {
+        JsonObject cutMap = qs["cutMap"];
         
-        return false;
+        if (cutMap.containsKey("loadSource")) {
+            table.loadSource = CutTimeMap::loadSourceFromString(cutMap["loadSource"]);
+            found = true;
+        }
+        
+        JsonArray rpmAxis = cutMap["rpmAxis"];
+        if (rpmAxis.size() == CutTimeMap::RPM_POINTS) {
+            for (size_t i = 0; i < CutTimeMap::RPM_POINTS; i++) {
+                table.rpmAxis[i] = rpmAxis[i] | table.rpmAxis[i];
+            }
+            found = true;
+        }
+        
+        JsonArray loadAxis = cutMap["loadAxis"];
+        if (loadAxis.size() == CutTimeMap::LOAD_POINTS) {
+            for (size_t i = 0; i < CutTimeMap::LOAD_POINTS; i++) {
+                table.loadAxis[i] = loadAxis[i] | table.loadAxis[i];
+            }
+            found = true;
+        }
+        
+        JsonArray rows = cutMap["cutTimeUs"];
+        if (rows.size() == CutTimeMap::LOAD_POINTS) {
+            for (size_t y = 0; y < CutTimeMap::LOAD_POINTS; y++) {
+                JsonArray row = rows[y];
+                if (row.size() != CutTimeMap::RPM_POINTS) continue;
+                for (size_t x = 0; x < CutTimeMap::RPM_POINTS; x++) {
+                    table.cutTimeUs[y][x] = row[x] | table.cutTimeUs[y][x];
+                }
+            }
+            found = true;
+        }
+        return found;
     }
     
-    size_t written = tmpFile.write((const uint8_t*)data, len);
-    tmpFile.flush();  // Ensure data is written to flash
-    tmpFile.close();
+    // Legacy 1D maps: µs ("cutTimeMapUs") or ms ("cutTimeMap")
+    JsonArray flatUs = qs["cutTimeMapUs"];
+    JsonArray flatMs = qs["cutTimeMap"];
+    if (flatUs.size() == CutTimeMap::RPM_POINTS || flatMs.size() == CutTimeMap::RPM_POINTS) {
+        const bool inMs = (flatUs.size() != CutTimeMap::RPM_POINTS);
+        for (size_t x = 0; x < CutTimeMap::RPM_POINTS; x++) {
+            uint32_t cutTime = inMs ? flatMs[x].as<uint32_t>() * 1000UL : flatUs[x].as<uint32_t>();
+            for (auto& row : table.cutTimeUs) {
+                row[x] = cutTime;
+            }
+        }
+        found = true;
+    }
     
-    if (written != len) {
-        
-        LittleFS.remove(CONFIG_TEMP_FILE);
-        return false;
+    return found;
+}
+
+void StorageHandler::writeCutMap(JsonObject qs, const CutTimeMap::Table& table) {
+    JsonObject cutMap = qs.createNestedObject("cutMap");
+    cutMap["loadSource"] = CutTimeMap::loadSourceToString(table.loadSource);
+    
+    JsonArray rpmAxis = cutMap.createNestedArray("rpmAxis");
+    for (const auto& rpm : table.rpmAxis) {
+        rpmAxis.add(rpm);
     }
     
-    // Remove old file if exists
-    if (LittleFS.exists(filename)) {
-        LittleFS.remove(filename);
+    JsonArray loadAxis = cutMap.createNestedArray("loadAxis");
+    for (const auto& load : table.loadAxis) {
+        loadAxis.add(load);
     }
     
-    // Rename temp file to actual filename
-    if (!LittleFS.rename(CONFIG_TEMP_FILE, filename)) {
-        
-        return false;
+    JsonArray rows = cutMap.createNestedArray("cutTimeUs");
+    for (const auto& row : table.cutTimeUs) {
+        JsonArray values = rows.createNestedArray();
+        for (const auto& cutTime : row) {
+            values.add(cutTime);
+        }
     }
+}
+
+bool StorageHandler::hasWebInterface() const {
+    if (!_initialized) return false;
+    // Asset pipeline stores the page compressed
+    return LittleFS.exists(WEB_HTML_FILE) || LittleFS.exists(String(WEB_HTML_FILE) + ".gz");
+}
+
+void StorageHandler::printInfo() {
+    if (!_initialized) return;
     
-    return true;
+    size_t total = LittleFS.totalBytes();
+    size_t used = LittleFS.usedBytes();
+    
+    Serial.printf("[Storage] Total: %d bytes, Used: %d bytes, Free: %d bytes\n", 
+                  total, used, total - used);
 }
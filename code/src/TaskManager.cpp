@@ -0,0 +1,117 @@
+#include "TaskManager.hpp"
+
+TaskManager::TaskManager()
+    : _taskCount(0)
+{
+}
+
+int TaskManager::addTask(const TaskConfig& config) {
+    if (_taskCount >= MAX_TASKS) {
+        Serial.printf("[Tasks] No slot for task %s, all %u in use\n", config.name, MAX_TASKS);
+        return -1;
+    }
+    if (!config.function || config.periodMs == 0) {
+        Serial.printf("[Tasks] Invalid config for task %s\n", config.name);
+        return -1;
+    }
+
+    TaskSlot& slot = _tasks[_taskCount];
+    slot.config = config;
+    slot.periodMs = config.periodMs;
+    slot.handle = nullptr;
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        taskEntry,
+        config.name,
+        config.stackSize,
+        &slot,
+        config.priority,
+        &slot.handle,
+        TASK_CORE
+    );
+
+    if (result != pdPASS) {
+        Serial.printf("[Tasks] Failed to create task %s (%u bytes stack)\n", config.name, config.stackSize);
+        return -1;
+    }
+
+    return static_cast<int>(_taskCount++);
+}
+
+bool TaskManager::setPeriod(int index, uint32_t periodMs) {
+    if (index < 0 || static_cast<size_t>(index) >= _taskCount || periodMs == 0) {
+        return false;
+    }
+
+    _tasks[index].periodMs = periodMs;
+    return true;
+}
+
+uint32_t TaskManager::getPeriod(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= _taskCount) {
+        return 0;
+    }
+
+    return _tasks[index].periodMs;
+}
+
+TaskHandle_t TaskManager::getHandle(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= _taskCount) {
+        return nullptr;
+    }
+
+    return _tasks[index].handle;
+}
+
+uint32_t TaskManager::getStackHighWaterMark(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= _taskCount || !_tasks[index].handle) {
+        return 0;
+    }
+
+    // ESP-IDF reports stack in bytes
+    return uxTaskGetStackHighWaterMark(_tasks[index].handle);
+}
+
+void TaskManager::printStackReport() const {
+    for (size_t i = 0; i < _taskCount; i++) {
+        const TaskSlot& slot = _tasks[i];
+        uint32_t freeStack = getStackHighWaterMark(i);
+        Serial.printf("[Tasks] %-10s prio=%u period=%ums stack used=%u/%u bytes\n",
+                      slot.config.name,
+                      slot.config.priority,
+                      slot.periodMs,
+                      slot.config.stackSize - freeStack,
+                      slot.config.stackSize);
+    }
+}
+
+void TaskManager::taskEntry(void* arg) {
+    TaskSlot* slot = static_cast<TaskSlot*>(arg);
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        slot->config.function(slot->config.context);
+
+        // Never pass a zero delay, it would starve lower priorities
+        TickType_t period = pdMS_TO_TICKS(slot->periodMs);
+        if (period == 0) period = 1;
+
+        if (!slot->config.wakeOnNotify) {
+            vTaskDelayUntil(&lastWake, period);
+            continue;
+        }
+
+        // Sleep until the next period, or less if notified; an early run
+        // keeps the schedule (lastWake) unchanged
+        const TickType_t elapsed = xTaskGetTickCount() - lastWake;
+        if (elapsed < period && ulTaskNotifyTake(pdTRUE, period - elapsed) > 0) {
+            continue;
+        }
+        lastWake += period;
+
+        // Fell more than a period behind: restart the schedule, no catch-up burst
+        if (xTaskGetTickCount() - lastWake >= period) {
+            lastWake = xTaskGetTickCount();
+        }
+    }
+}
@@ -0,0 +1,177 @@
+#include "TelemetrySampler.hpp"
+
+TelemetrySampler::TelemetrySampler(QuickShifterEngine& qsEngine)
+    : _qsEngine(qsEngine)
+    , _timestampUs(nullptr)
+    , _rpm(nullptr)
+    , _tps(nullptr)
+    , _map(nullptr)
+    , _rpmAccel(nullptr)
+    , _flags(nullptr)
+    , _capacity(0)
+    , _head(0)
+    , _sampleRateHz(DEFAULT_SAMPLE_RATE_HZ)
+    , _triggers{}
+    , _triggerCount(0)
+{
+}
+
+bool TelemetrySampler::begin() {
+    if (_capacity) return true;
+
+    // One block for all arrays, allocated once and never freed
+    constexpr size_t bytesPerSample = sizeof(uint32_t) + 4 * sizeof(uint16_t) + sizeof(uint8_t);
+    size_t capacity = psramFound() ? PSRAM_CAPACITY : DRAM_CAPACITY;
+    uint8_t* block = static_cast<uint8_t*>(psramFound() ? ps_malloc(capacity * bytesPerSample)
+                                                        : malloc(capacity * bytesPerSample));
+    if (!block) {
+        Serial.printf("[Sampler] Failed to allocate %u samples\n", capacity);
+        return false;
+    }
+
+    // Widest fields first keeps every array naturally aligned
+    _timestampUs = reinterpret_cast<uint32_t*>(block);
+    _rpm = reinterpret_cast<uint16_t*>(_timestampUs + capacity);
+    _tps = _rpm + capacity;
+    _map = _tps + capacity;
+    _rpmAccel = reinterpret_cast<int16_t*>(_map + capacity);
+    _flags = reinterpret_cast<uint8_t*>(_rpmAccel + capacity);
+    _capacity = capacity;
+
+    Serial.printf("[Sampler] %u samples in %s (%u bytes)\n",
+                  capacity, psramFound() ? "PSRAM" : "DRAM", capacity * bytesPerSample);
+    return true;
+}
+
+void TelemetrySampler::sample() {
+    if (!_capacity) return;
+
+    const uint32_t head = _head.load(std::memory_order_relaxed);
+    const size_t slot = head & (_capacity - 1);
+
+    uint8_t flags = 0;
+    if (_qsEngine.isSignalActive()) flags |= TelemetryFrame::FLAG_SIGNAL_ACTIVE;
+    if (_qsEngine.isCutActive()) flags |= TelemetryFrame::FLAG_CUT_ACTIVE;
+
+    SensorValues sensors = {};
+    if (_qsEngine.readSensors(sensors)) {
+        if (sensors.flags & SensorValues::TPS_VALID) flags |= TelemetryFrame::FLAG_TPS_VALID;
+        if (sensors.flags & SensorValues::MAP_VALID) flags |= TelemetryFrame::FLAG_MAP_VALID;
+    }
+
+    int32_t accel = _qsEngine.getRpmAcceleration() / TelemetryFrame::RPM_ACCEL_SCALE;
+    if (accel > INT16_MAX) accel = INT16_MAX;
+    if (accel < INT16_MIN) accel = INT16_MIN;
+
+    _timestampUs[slot] = micros();
+    _rpm[slot] = _qsEngine.getCurrentRpm();
+    _tps[slot] = sensors.tps;
+    _map[slot] = sensors.map;
+    _rpmAccel[slot] = accel;
+    _flags[slot] = flags;
+
+    _head.store(head + 1, std::memory_order_release);
+}
+
+void TelemetrySampler::onEngineEvent(const QuickShifterEngine::Event& event, void* context) {
+    if (event.type != QuickShifterEngine::EventType::SHIFT) return;
+
+    TelemetrySampler* self = static_cast<TelemetrySampler*>(context);
+    const uint32_t count = self->_triggerCount.load(std::memory_order_relaxed);
+
+    Trigger& trigger = self->_triggers[count % MAX_TRIGGERS];
+    trigger.timestampUs = event.timestampUs;
+    trigger.cutTimeUs = event.cutTimeUs;
+    trigger.rpm = event.rpm;
+
+    self->_triggerCount.store(count + 1, std::memory_order_release);
+}
+
+void TelemetrySampler::setSampleRate(uint16_t rateHz) {
+    if (rateHz == 0) rateHz = 1;
+    if (rateHz > MAX_SAMPLE_RATE_HZ) rateHz = MAX_SAMPLE_RATE_HZ;
+    
+    uint32_t periodMs = (1000 + rateHz - 1) / rateHz;
+    while (1000 % periodMs) periodMs++;
+    _sampleRateHz = 1000 / periodMs;
+}
+
+uint32_t TelemetrySampler::getOldest() const {
+    const uint32_t head = getHead();
+    return head > _capacity ? head - _capacity : 0;
+}
+
+void TelemetrySampler::copySample(uint32_t index, TelemetryFrame::Sample& out) const {
+    const size_t slot = index & (_capacity - 1);
+    out.timestampUs = _timestampUs[slot];
+    out.rpm = _rpm[slot];
+    out.tps = _tps[slot];
+    out.map = _map[slot];
+    out.flags = _flags[slot];
+    out.reserved = 0;
+    out.rpmAccel = _rpmAccel[slot];
+}
+
+size_t TelemetrySampler::read(uint32_t& index, TelemetryFrame::Sample* out, size_t maxSamples) const {
+    if (!_capacity) return 0;
+
+    const uint32_t head = getHead();
+    const uint32_t oldest = head > _capacity ? head - _capacity : 0;
+    if (index < oldest) index = oldest;
+
+    const uint32_t start = index;
+    size_t count = 0;
+    while (index < head && count < maxSamples) {
+        copySample(index, out[count]);
+        index++;
+        count++;
+    }
+
+    // The sampler may have lapped us while copying, drop overwritten samples.
+    // The slot being written now belongs to (head - capacity).
+    const uint32_t after = getHead();
+    const uint32_t safe = after >= _capacity ? after - _capacity + 1 : 0;
+    if (count > 0 && start < safe) {
+        const size_t stale = min<size_t>(count, safe - start);
+        memmove(out, out + stale, (count - stale) * sizeof(TelemetryFrame::Sample));
+        count -= stale;
+    }
+
+    return count;
+}
+
+uint32_t TelemetrySampler::findIndex(uint32_t timestampUs) const {
+    const uint32_t head = getHead();
+    if (!_capacity || head == 0) return head;
+
+    // Walk back from the newest sample, signed difference handles micros() wrap
+    const uint32_t oldest = head > _capacity ? head - _capacity + 1 : 0;
+    uint32_t index = head;
+    while (index > oldest) {
+        const uint32_t sampleTs = _timestampUs[(index - 1) & (_capacity - 1)];
+        if (int32_t(sampleTs - timestampUs) < 0) break;
+        index--;
+    }
+    return index;
+}
+
+bool TelemetrySampler::latest(TelemetryFrame::Sample& out) const {
+    const uint32_t head = getHead();
+    if (!_capacity || head == 0) return false;
+
+    copySample(head - 1, out);
+    return true;
+}
+
+size_t TelemetrySampler::getTriggerCount() const {
+    const uint32_t count = _triggerCount.load(std::memory_order_acquire);
+    return count < MAX_TRIGGERS ? count : MAX_TRIGGERS;
+}
+
+bool TelemetrySampler::getTrigger(size_t age, Trigger& out) const {
+    const uint32_t count = _triggerCount.load(std::memory_order_acquire);
+    if (age >= getTriggerCount()) return false;
+
+    out = _triggers[(count - 1 - age) % MAX_TRIGGERS];
+    return true;
+}
@@ -0,0 +1,98 @@
+#include "TriggerWheel.hpp"
+
+TriggerWheel::TriggerWheel()
+    : _teeth(1)
+    , _missing(0)
+    , _present(1)
+    , _position(0)
+    , _synced(false)
+    , _positionKnown(false)
+    , _pitchUs(0)
+    , _revolutionStartUs(0)
+    , _revolutionStarted(false)
+    , _revolutionUs(0)
+    , _syncLosses(0)
+{
+}
+
+void IRAM_ATTR TriggerWheel::configure(uint8_t teeth, uint8_t missing) {
+    _teeth = teeth;
+    _missing = missing;
+    _present = teeth - missing;
+    reset();
+}
+
+void IRAM_ATTR TriggerWheel::reset() {
+    _position = 0;
+    _synced = false;
+    _positionKnown = false;
+    _pitchUs = 0;
+    _revolutionStarted = false;
+    _revolutionUs = 0;
+}
+
+void IRAM_ATTR TriggerWheel::loseSync() {
+    if (_synced) _syncLosses++;
+    _synced = false;
+    _positionKnown = false;
+    _revolutionStarted = false;
+}
+
+uint8_t IRAM_ATTR TriggerWheel::measure(uint32_t intervalUs) {
+    // First interval: no pitch to compare with yet, it becomes the reference
+    if (_pitchUs == 0) {
+        _pitchUs = intervalUs;
+        return 0;
+    }
+
+    // Rounded to whole pitches; below half a pitch it is noise the RPM filter rejects
+    uint32_t pitches = (intervalUs + _pitchUs / 2) / _pitchUs;
+    if (pitches == 0) pitches = 1;
+    if (pitches > 255) pitches = 255;
+    return pitches;
+}
+
+bool IRAM_ATTR TriggerWheel::accept(uint32_t timestampUs, uint32_t intervalUs, uint8_t pitches) {
+    if (pitches == 0) return false;
+    _pitchUs = pitches > 1 ? intervalUs / pitches : intervalUs;
+
+    if (pitches > MAX_PITCHES) {
+        loseSync();
+        return false;
+    }
+
+    // Not counting yet: any tooth starts it without missing teeth, else the gap does
+    if (!_positionKnown) {
+        if (_missing > 0 && pitches != _missing + 1) return false;
+        _positionKnown = true;
+        _position = 0;
+        _revolutionStartUs = timestampUs;
+        _revolutionStarted = true;
+        return false;
+    }
+
+    uint16_t position = _position + pitches;
+    const bool wrapped = position >= _teeth;
+    if (wrapped) position -= _teeth;
+
+    // A tooth where the wheel has none: miscounted or not the gap after all
+    if (position >= _present) {
+        loseSync();
+        return false;
+    }
+    _position = position;
+    if (!wrapped) return false;
+
+    // The revolution is only timed from tooth 0 to tooth 0
+    if (position != 0) {
+        _revolutionStarted = false;
+        return false;
+    }
+    if (_missing > 0) _synced = true;
+
+    const bool complete = _revolutionStarted;
+    if (complete) _revolutionUs = timestampUs - _revolutionStartUs;
+    _revolutionStartUs = timestampUs;
+    _revolutionStarted = true;
+    return complete;
+}
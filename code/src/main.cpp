@@ -7,149 +7,308 @@
  * - NetworkManager: WiFi, HTTP server, WebSockets, OTA (soft real-time)
  * - StorageHandler: LittleFS persistence layer
  * - LedController: Visual feedback abstraction
+ * - EventDispatcher: Drains engine ISR events to Serial/WebSocket (low priority task)
+ * - TelemetrySampler: Fixed-rate engine history ring buffer (up to 1 kHz)
+ * - SessionLogger: Binary session log files on LittleFS
+ * - ShiftForceSensor: ADC DMA strain gauge/piezo shift detection
+ * - SensorAcquisition: Throttle position and MAP, published lock-free
+ * - ShiftAnalytics: One summary record per shift (latency, cut, RPM drop)
+ * - PickupSimulator: Bench pickup generator and benchmark (QS_HIL builds only)
+ * - BootProfile: Boot stage timings and reset cause
  * 
- * All components are initialized in setup() and updated in loop().
- * Static allocation is used throughout to prevent heap fragmentation.
+ * Boot is staged so the quickshifter is usable within milliseconds: setup()
+ * arms the engine and shift sensors first (config from RTC memory after a
+ * warm reset, else from NVS), then loads the config cache and starts the
+ * remaining tasks. The network task mounts LittleFS and brings up WiFi,
+ * mDNS and the web server on its first run, while the engine already cuts.
+ * 
+ * All components are updated by prioritized
+ * FreeRTOS tasks (TaskManager): engine supervision first (also woken by the
+ * force sensor), then force sensor frames, then TPS/MAP acquisition, then history sampling, then telemetry,
+ * then networking/storage, then log writes and the event drain. loop() only
+ * reports task stack usage. The status LED is driven by engine state
+ * changes (cut path) and LEDC fade interrupts, no task polls it.
+ * Static allocation is used throughout to prevent heap fragmentation; web
+ * server messages and responses recycle MessagePool buffers.
  */
 
 #include <Arduino.h>
+#include <new>
 #include <pins.hpp>
 #include "QuickShifterEngine.hpp"
 #include "NetworkManager.hpp"
 #include "StorageHandler.hpp"
 #include "LedController.hpp"
+#include "EventDispatcher.hpp"
+#include "TaskManager.hpp"
+#include "TelemetrySampler.hpp"
+#include "SessionLogger.hpp"
+#include "ShiftForceSensor.hpp"
+#include "SensorAcquisition.hpp"
+#include "PickupSimulator.hpp"
+#include "ShiftAnalytics.hpp"
+#include "BootProfile.hpp"
 
 // Component instances (static allocation)
 QuickShifterEngine qsEngine;
 StorageHandler storage;
 LedController led;
-NetworkManager* networkManager = nullptr;  // Initialized after storage
+EventDispatcher eventDispatcher(qsEngine);
+TelemetrySampler sampler(qsEngine);
+SessionLogger sessionLogger(qsEngine, sampler);
+ShiftForceSensor forceSensor(qsEngine);
+SensorAcquisition sensorAcquisition(forceSensor);
+ShiftAnalytics shiftAnalytics(qsEngine, sampler);
+TaskManager taskManager;
+#if QS_HIL
+PickupSimulator pickupSimulator(qsEngine);
+#endif
+BootProfile bootProfile;
+NetworkManager* networkManager = nullptr;  // Constructed after storage, in static storage
+alignas(NetworkManager) static uint8_t networkManagerStorage[sizeof(NetworkManager)];
+volatile bool networkStarted = false;       // Set by the network task once begin() returned
+
+// Task periods
+constexpr uint32_t ENGINE_TASK_PERIOD_MS = 5;
+constexpr uint32_t SENSOR_TASK_PERIOD_MS = 1;      // One ADC DMA frame
+constexpr uint32_t TELEMETRY_TASK_PERIOD_MS = 10;   // Broadcast rate itself is set in telemetry config
+constexpr uint32_t NETWORK_TASK_PERIOD_MS = 20;
+constexpr uint32_t EVENTS_TASK_PERIOD_MS = 20;
+constexpr uint32_t LOGGER_TASK_PERIOD_MS = 50;
+// Sampler period follows the configured sample rate
 
-// Timing for status updates
+int samplerTaskIndex = -1;
+
+// Timing for the serial status line
 unsigned long lastStatusUpdate = 0;
-constexpr unsigned long STATUS_UPDATE_INTERVAL = 500;  // Update LED status every 500ms
+constexpr unsigned long STATUS_UPDATE_INTERVAL = 500;
 
-void setup() {
-    // Initialize serial for debugging
-    Serial.begin(115200);
+// Timing for task stack reports
+unsigned long lastStackReport = 0;
+constexpr unsigned long STACK_REPORT_INTERVAL = 30000;
+
+// Engine supervision: signal timeout detection
+void engineTask(void* context) {
+    qsEngine.update();
+}
+
+// Telemetry history sampling
+void samplerTask(void* context) {
+    sampler.sample();
     
-    // 1. Initialize LED Controller first for visual feedback
+    // Follow sample rate changes from the web interface
+    uint32_t periodMs = sampler.getPeriodMs();
+    if (taskManager.getPeriod(samplerTaskIndex) != periodMs) {
+        taskManager.setPeriod(samplerTaskIndex, periodMs);
+    }
+}
+
+// Telemetry broadcast
+void telemetryTask(void* context) {
+    if (networkStarted) {
+        networkManager->updateTelemetry();
+    }
+}
+
+// Start a task, a failure is reported instead of leaving it silently not running
+int startTask(const TaskManager::TaskConfig& config) {
+    const int index = taskManager.addTask(config);
+    if (index < 0) {
+        Serial.printf("[Boot] Task %s NOT running\n", config.name);
+    }
+    return index;
+}
+
+// Apply the cached engine and sensor config (it changed after the engine was armed)
+void applyStoredConfig() {
+    QuickShifterEngine::Config qsConfig;
+    storage.loadQsConfig(qsConfig);
+    qsEngine.setConfig(qsConfig);
     
-    led.begin(R_LED, G_LED, B_LED, LED_BUILTIN);
-    led.setStatus(LedController::Status::NO_SIGNAL);
+    SensorAcquisition::Calibration sensorConfig;
+    storage.loadSensorConfig(sensorConfig);
+    sensorAcquisition.setCalibration(sensorConfig);
+}
+
+// Deferred boot stage, first run of the network task: everything that can
+// take seconds (LittleFS format, STA connect) while the engine already cuts
+void startNetwork() {
+    const uint32_t revision = storage.getRevision();
+    if (storage.mountFileSystem()) {
+        if (storage.getRevision() != revision) {
+            applyStoredConfig();  // Legacy /config.json migrated
+        }
+        sessionLogger.begin();
+        bootProfile.mark(BootProfile::Stage::FILESYSTEM);
+    }
     
-    // 2. Initialize Storage Handler
+    // Continue on failure - the engine runs without network
+    if (networkManager->begin()) {
+        const NetworkManager::State state = networkManager->getState();
+        Serial.printf("[Boot] Network: %s\n",
+                      state == NetworkManager::State::STA_MODE ? "station" :
+                      state == NetworkManager::State::AP_MODE ? "access point" : "error");
+    }
+    networkStarted = true;
     
-    if (!storage.begin()) {
-        
-        led.setStatus(LedController::Status::ERROR);
-        led.setBlinking(true);
-        while (1) { delay(1000); }  // Halt on critical error
+    bootProfile.mark(BootProfile::Stage::NETWORK);
+}
+
+// Network housekeeping, config commits and serial status line
+void networkTask(void* context) {
+    if (!networkStarted) {
+        startNetwork();
+        return;
     }
     
-    // 3. Initialize QuickShifter Engine
+    networkManager->update();
     
-    qsEngine.begin(SPARK_CDI, QS_SW, QS_SCR);
+#if QS_HIL
+    pickupSimulator.update();
+#endif
     
-    // Load configuration from storage
-    QuickShifterEngine::Config qsConfig;
-    if (storage.loadQsConfig(qsConfig)) {
-        qsEngine.setConfig(qsConfig);
-        
-    } else {
+    // Commit deferred config changes once the web interface goes quiet
+    storage.update();
+    
+    // Serial status line (the LED follows engine state changes by itself)
+    unsigned long currentMillis = millis();
+    if (currentMillis - lastStatusUpdate >= STATUS_UPDATE_INTERVAL) {
+        lastStatusUpdate = currentMillis;
         
-        // Save default config for next boot
-        qsConfig = qsEngine.getConfig();
-        storage.saveQsConfig(qsConfig);
+        // Debug output to serial
+        uint16_t rpm = qsEngine.getCurrentRpm();
+        if (rpm > 0) {
+            Serial.printf("[Status] RPM: %d, Signal: %s, Cut: %s\n",
+                         rpm,
+                         qsEngine.isSignalActive() ? "Active" : "Lost",
+                         qsEngine.isCutActive() ? "Active" : "Inactive");
+        }
     }
+}
+
+void setup() {
+    // Initialize serial for debugging
+    Serial.begin(115200);
+    bootProfile.begin();
     
-    // 4. Initialize Network Manager (dependency injection)
+    // 1. Initialize LED Controller first for visual feedback
+    led.begin(R_LED, G_LED, B_LED, LED_BUILTIN);
+    led.setStatus(LedController::Status::NO_SIGNAL);
     
+    // 2. Arm the cut path before any flash access where possible
     
-    networkManager = new NetworkManager(storage, qsEngine, led);
-    if (!networkManager->begin()) {
-        
-        
-        
-        // Continue anyway - system can run without network
+    // Pickup edges are counted in hardware (PCNT) and timestamped per batch
+    qsEngine.begin(SPARK_CDI, QS_SW, QuickShifterEngine::PickupMode::PCNT_CAPTURE);
+    
+    // Warm reset: the config of the last session is still in RTC memory
+    QuickShifterEngine::Config qsConfig;
+    SensorAcquisition::Calibration sensorConfig;
+    const bool recovered = bootProfile.isWarmReset() &&
+                           StorageHandler::loadRecoveryConfig(qsConfig, sensorConfig);
+    if (!recovered) {
+        storage.begin();
+        bootProfile.mark(BootProfile::Stage::CONFIG);
+        if (storage.loadQsConfig(qsConfig)) {
+            bootProfile.setConfigSource(BootProfile::ConfigSource::STORED);
+        } else {
+            // Save default config for next boot
+            qsConfig = qsEngine.getConfig();
+            storage.saveQsConfig(qsConfig);
+        }
+        storage.loadSensorConfig(sensorConfig);
     } else {
-        
-        
+        bootProfile.setConfigSource(BootProfile::ConfigSource::RECOVERY);
     }
+    qsEngine.setConfig(qsConfig);
     
+    // Status LED follows signal/cut changes directly from the engine
+    qsEngine.setStateListener(LedController::onEngineState, &led);
     
+    // Throttle/MAP first, the TPS joins the force sensor's DMA pattern
+    sensorAcquisition.setCalibration(sensorConfig);
+    sensorAcquisition.begin(TSP, MAP_SW);
+    qsEngine.setSensorInput(&sensorAcquisition.snapshot());
     
+    // Force sensor (failure only leaves the digital switch as shift source)
+    forceSensor.begin(PIEZO);
     
+    const int engineTaskIndex = startTask({"Engine", engineTask, nullptr,
+                                           ENGINE_TASK_PERIOD_MS, TaskManager::PRIORITY_ENGINE, 2048, true});
+    if (forceSensor.isRunning()) {
+        if (engineTaskIndex >= 0) {
+            forceSensor.setEngineTask(taskManager.getHandle(engineTaskIndex));
+        }
+        startTask({"Sensor", ShiftForceSensor::sensorTask, &forceSensor,
+                   SENSOR_TASK_PERIOD_MS, TaskManager::PRIORITY_SENSOR, 2048});
+    }
+    startTask({"Acquire", SensorAcquisition::acquireTask, &sensorAcquisition,
+               SensorAcquisition::PERIOD_MS, TaskManager::PRIORITY_ACQUISITION, 3072});
     
-    // Print system info
-    
-    
-    
+    bootProfile.mark(BootProfile::Stage::ENGINE_ARMED);
+    Serial.printf("[Boot] Ready to cut (config: %s)\n",
+                  BootProfile::configSourceToString(bootProfile.getConfigSource()));
     
-    for (size_t i = 0; i < qsConfig.cutTimeMap.size(); i++) {
+    // 3. Configuration cache (NVS only, LittleFS comes with the network)
+    if (recovered) {
+        storage.begin();
+        bootProfile.mark(BootProfile::Stage::CONFIG);
         
-        if (i < qsConfig.cutTimeMap.size() - 1);
+        // NVS is authoritative; byte compare, a spare update is harmless
+        QuickShifterEngine::Config storedQs;
+        SensorAcquisition::Calibration storedSensors;
+        storage.loadQsConfig(storedQs);
+        storage.loadSensorConfig(storedSensors);
+        if (memcmp(&storedQs, &qsConfig, sizeof(qsConfig)) != 0 ||
+            memcmp(&storedSensors, &sensorConfig, sizeof(sensorConfig)) != 0) {
+            Serial.println("[Boot] RTC config differs from NVS, applying NVS");
+            applyStoredConfig();
+            bootProfile.setConfigSource(BootProfile::ConfigSource::STORED);
+        }
     }
     
+    // Telemetry history (failure only disables live telemetry and shift captures)
+    sampler.begin();
     
+    // 4. Network Manager (dependency injection), started by the network task
+    networkManager = new (networkManagerStorage) NetworkManager(storage, qsEngine, led, sampler, sessionLogger,
+                                                                sensorAcquisition, shiftAnalytics, bootProfile);
     
-    // Print network status
+    // 5. Register engine event sinks (Serial is built in)
+    eventDispatcher.addSink(NetworkManager::onEngineEvent, networkManager);
+    eventDispatcher.addSink(TelemetrySampler::onEngineEvent, &sampler);
+    eventDispatcher.addSink(SessionLogger::onEngineEvent, &sessionLogger);
+    eventDispatcher.addSink(ShiftAnalytics::onEngineEvent, &shiftAnalytics);
     
-    if (networkManager->getState() == NetworkManager::State::AP_MODE) {
-        
-        
-        
-    } else if (networkManager->getState() == NetworkManager::State::STA_MODE) {
-        
-        
-    } else if (networkManager->getState() == NetworkManager::State::ERROR) {
-        
-        
+#if QS_HIL
+    // Bench benchmark: generated pickup signal, reports on /api/hil
+    if (pickupSimulator.begin(PICKUP_SQUARE)) {
+        eventDispatcher.addSink(PickupSimulator::onEngineEvent, &pickupSimulator);
+        networkManager->setPickupSimulator(&pickupSimulator);
     }
+#endif
     
-    
+    // 6. Remaining tasks; the network task brings up LittleFS, WiFi and the web server
+    samplerTaskIndex = startTask({"Sampler", samplerTask, nullptr,
+                                  sampler.getPeriodMs(), TaskManager::PRIORITY_SAMPLER, 2048});
+    startTask({"Telemetry", telemetryTask, nullptr,
+               TELEMETRY_TASK_PERIOD_MS, TaskManager::PRIORITY_TELEMETRY, 4096});
+    startTask({"Logger", SessionLogger::logTask, &sessionLogger,
+               LOGGER_TASK_PERIOD_MS, TaskManager::PRIORITY_LOGGER, 4096});
+    startTask({"Events", EventDispatcher::drainTask, &eventDispatcher,
+               EVENTS_TASK_PERIOD_MS, TaskManager::PRIORITY_EVENTS, 3072});
+    startTask({"Network", networkTask, nullptr,
+               NETWORK_TASK_PERIOD_MS, TaskManager::PRIORITY_NETWORK, 8192});
 }
 
 void loop() {
-    // Update all components
-    // QuickShifterEngine handles its own interrupts, just needs periodic update for signal timeout
-    qsEngine.update();
-    
-    // Update network (WebSocket broadcasts, etc.)
-    if (networkManager) {
-        networkManager->update();
-    }
-    
-    // Update LED controller (for blinking effects)
-    led.update();
-    
-    // Periodic status updates based on system state
+    // All periodic work runs in the TaskManager tasks, loop only reports
     unsigned long currentMillis = millis();
-    if (currentMillis - lastStatusUpdate >= STATUS_UPDATE_INTERVAL) {
-        lastStatusUpdate = currentMillis;
-        
-        // Update LED status based on system state
-        if (qsEngine.isCutActive()) {
-            led.setStatus(LedController::Status::IGNITION_CUT);
-            led.setBuiltinLed(true);
-        } else if (qsEngine.isSignalActive()) {
-            led.setStatus(LedController::Status::SIGNAL_OK);
-            led.setBuiltinLed(false);
-        } else {
-            led.setStatus(LedController::Status::NO_SIGNAL);
-            led.setBuiltinLed(false);
-        }
-        
-        // Debug output to serial
-        uint16_t rpm = qsEngine.getCurrentRpm();
-        if (rpm > 0) {
-            Serial.printf("[Status] RPM: %d, Signal: %s, Cut: %s\n",
-                         rpm,
-                         qsEngine.isSignalActive() ? "Active" : "Lost",
-                         qsEngine.isCutActive() ? "Active" : "Inactive");
-        }
+    if (currentMillis - lastStackReport >= STACK_REPORT_INTERVAL) {
+        lastStackReport = currentMillis;
+        taskManager.printStackReport();
+        Serial.printf("[Tasks] %-10s stack free=%u bytes\n", "loop",
+                      uxTaskGetStackHighWaterMark(nullptr));
     }
     
-    // Small yield to prevent watchdog triggers
-    yield();
-}
\ No newline at end of file
+    delay(100);
+}
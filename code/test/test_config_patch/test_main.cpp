@@ -0,0 +1,148 @@
+#include <unity.h>
+#include <string.h>
+#include "ConfigPatch.hpp"
+
+namespace {
+StorageHandler::SystemConfig config;
+StaticJsonDocument<1024> patch;
+StaticJsonDocument<1024> errors;
+uint8_t sections;
+
+bool apply(const char* json) {
+    patch.clear();
+    errors.clear();
+    TEST_ASSERT_FALSE(deserializeJson(patch, json));
+    return ConfigPatch::apply(patch.as<JsonObjectConst>(), config, sections, errors.to<JsonObject>());
+}
+
+// Rejected with exactly this reason for path, config unchanged
+void assertRejected(const char* json, const char* path, const char* reason) {
+    const StorageHandler::SystemConfig before = config;
+    TEST_ASSERT_FALSE(apply(json));
+    TEST_ASSERT_EQUAL_UINT8(0, sections);
+    TEST_ASSERT_EQUAL_STRING(reason, errors[path].as<const char*>());
+    TEST_ASSERT_EQUAL_MEMORY(&before, &config, sizeof(config));
+}
+}
+
+void setUp() {
+    memset(&config, 0, sizeof(config));
+    CutTimeMap::getDefaultTable(config.qsConfig.cutMap, 80000);
+    config.qsConfig.forceThreshold = QuickShifterEngine::DEFAULT_FORCE_THRESHOLD;
+    config.qsConfig.forceHysteresis = QuickShifterEngine::DEFAULT_FORCE_HYSTERESIS;
+    config.qsConfig.triggerTeeth = 1;
+    config.qsConfig.skipSparks = 1;
+    strlcpy(config.networkConfig.apSsid, "rspqs", sizeof(config.networkConfig.apSsid));
+    config.telemetryConfig.sampleRateHz = 100;
+    config.telemetryConfig.updateRateMs = 100;
+}
+
+void tearDown() {}
+
+void test_applies_scalars_and_cells() {
+    TEST_ASSERT_TRUE(apply("{\"qs.minRpm\":3200,\"qs.minThrottle\":12.5,\"qs.cutMap.cutTimeUs[2][7]\":65000,"
+                           "\"sensors.tpsEnabled\":true}"));
+    TEST_ASSERT_EQUAL_UINT8(StorageHandler::DIRTY_QS | StorageHandler::DIRTY_SENSORS, sections);
+    TEST_ASSERT_EQUAL_UINT16(3200, config.qsConfig.minRpmThreshold);
+    TEST_ASSERT_EQUAL_UINT16(125, config.qsConfig.minThrottle);
+    TEST_ASSERT_EQUAL_UINT32(65000, config.qsConfig.cutMap.cutTimeUs[2][7]);
+    TEST_ASSERT_EQUAL_UINT32(80000, config.qsConfig.cutMap.cutTimeUs[2][6]);
+    TEST_ASSERT_TRUE(config.sensorConfig.tpsEnabled);
+}
+
+void test_legacy_map_writes_every_row() {
+    TEST_ASSERT_TRUE(apply("{\"qs.cutTimeMap[4]\":55}"));
+    for (size_t y = 0; y < CutTimeMap::LOAD_POINTS; y++) {
+        TEST_ASSERT_EQUAL_UINT32(55000, config.qsConfig.cutMap.cutTimeUs[y][4]);
+    }
+}
+
+void test_rejects_paths_and_indices() {
+    assertRejected("{\"qs.bogus\":1}", "qs.bogus", "unknown field");
+    assertRejected("{\"qs.cutMap.rpmAxis\":1}", "qs.cutMap.rpmAxis", "index required");
+    assertRejected("{\"qs.minRpm[0]\":1}", "qs.minRpm[0]", "not an array");
+    assertRejected("{\"qs.cutMap.rpmAxis[11]\":1}", "qs.cutMap.rpmAxis[11]", "index out of range");
+    assertRejected("{\"qs.cutMap.rpmAxis[x]\":1}", "qs.cutMap.rpmAxis[x]", "invalid index");
+    assertRejected("{\"qs.cutMap.cutTimeUs[6][0]\":1000}", "qs.cutMap.cutTimeUs[6][0]", "index out of range");
+}
+
+void test_rejects_types() {
+    assertRejected("{\"qs.minRpm\":\"3000\"}", "qs.minRpm", "expected a number");
+    assertRejected("{\"qs.minRpm\":true}", "qs.minRpm", "expected a number");
+    assertRejected("{\"network.staMode\":1}", "network.staMode", "expected a boolean");
+    assertRejected("{\"qs.cutMode\":1}", "qs.cutMode", "expected a string");
+    assertRejected("{\"qs.cutMode\":\"half\"}", "qs.cutMode", "unknown value");
+    assertRejected("{\"network.staSsid\":5}", "network.staSsid", "expected a string");
+    assertRejected("{\"network.lastError\":\"\"}", "network.lastError", "read-only");
+}
+
+void test_rejects_ranges() {
+    assertRejected("{\"qs.minRpm\":20001}", "qs.minRpm", "out of range");
+    assertRejected("{\"qs.minRpm\":-1}", "qs.minRpm", "out of range");
+    assertRejected("{\"qs.minThrottle\":100.1}", "qs.minThrottle", "out of range");
+    assertRejected("{\"qs.cutMap.cutTimeUs[0][0]\":99}", "qs.cutMap.cutTimeUs[0][0]", "out of range");
+    assertRejected("{\"telemetry.sampleRate\":0}", "telemetry.sampleRate", "out of range");
+    assertRejected("{\"network.apSsid\":\"\"}", "network.apSsid", "too short");
+    assertRejected("{\"network.apSsid\":\"0123456789012345678901234567890123\"}", "network.apSsid", "too long");
+}
+
+void test_cross_field_rules() {
+    assertRejected("{\"qs.cutMap.rpmAxis[1]\":4000}", "qs.cutMap", "axes must be strictly ascending");
+    assertRejected("{\"qs.forceHysteresis\":400}", "qs.forceHysteresis", "must be below forceThreshold");
+    assertRejected("{\"qs.skipCycle\":2,\"qs.skipSparks\":3}", "qs.skipSparks", "must not exceed skipCycle");
+    assertRejected("{\"qs.triggerMissing\":1}", "qs.triggerMissing", "must be below triggerTeeth");
+
+    // Checked on the patched copy, so fields changed together pass
+    TEST_ASSERT_TRUE(apply("{\"qs.triggerTeeth\":12,\"qs.triggerMissing\":1}"));
+}
+
+void test_one_bad_entry_rejects_the_whole_patch() {
+    const StorageHandler::SystemConfig before = config;
+    TEST_ASSERT_FALSE(apply("{\"qs.minRpm\":3000,\"qs.debounce\":5000,\"qs.bogus\":1}"));
+    TEST_ASSERT_EQUAL_size_t(2, errors.size());
+    TEST_ASSERT_EQUAL_STRING("out of range", errors["qs.debounce"].as<const char*>());
+    TEST_ASSERT_EQUAL_MEMORY(&before, &config, sizeof(config));
+
+    errors.clear();
+    TEST_ASSERT_FALSE(ConfigPatch::apply(JsonObjectConst(), config, sections, errors.to<JsonObject>()));
+    TEST_ASSERT_EQUAL_STRING("expected an object", errors["patch"].as<const char*>());
+}
+
+void test_diff_withholds_passwords() {
+    const StorageHandler::SystemConfig before = config;
+    TEST_ASSERT_TRUE(apply("{\"network.apPassword\":\"secret123\",\"network.staMode\":true}"));
+    TEST_ASSERT_EQUAL_UINT8(StorageHandler::DIRTY_NETWORK, sections);
+
+    StaticJsonDocument<512> changed;
+    TEST_ASSERT_EQUAL_size_t(2, ConfigPatch::diff(before, config, sections, changed.to<JsonObject>()));
+    TEST_ASSERT_TRUE(changed.containsKey("network.apPassword"));
+    TEST_ASSERT_TRUE(changed["network.apPassword"].isNull());
+    TEST_ASSERT_TRUE(changed["network.staMode"].as<bool>());
+}
+
+void test_query() {
+    StaticJsonDocument<2048> out;
+    TEST_ASSERT_EQUAL_size_t(1, ConfigPatch::query(config, "qs.cutMap.cutTimeUs[2][7]", out.to<JsonObject>()));
+    TEST_ASSERT_EQUAL_UINT32(80000, out["qs.cutMap.cutTimeUs[2][7]"].as<uint32_t>());
+
+    TEST_ASSERT_EQUAL_size_t(0, ConfigPatch::query(config, "network.apPassword", out.to<JsonObject>()));
+    TEST_ASSERT_EQUAL_size_t(0, ConfigPatch::query(config, "qs.cutTimeMap[0]", out.to<JsonObject>()));
+    TEST_ASSERT_EQUAL_size_t(0, ConfigPatch::query(config, "qs.bogus", out.to<JsonObject>()));
+
+    TEST_ASSERT_EQUAL_size_t(2, ConfigPatch::query(config, "telemetry", out.to<JsonObject>()));
+    TEST_ASSERT_EQUAL_UINT16(100, out["telemetry.sampleRate"].as<uint16_t>());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_applies_scalars_and_cells);
+    RUN_TEST(test_legacy_map_writes_every_row);
+    RUN_TEST(test_rejects_paths_and_indices);
+    RUN_TEST(test_rejects_types);
+    RUN_TEST(test_rejects_ranges);
+    RUN_TEST(test_cross_field_rules);
+    RUN_TEST(test_one_bad_entry_rejects_the_whole_patch);
+    RUN_TEST(test_diff_withholds_passwords);
+    RUN_TEST(test_query);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+#include <unity.h>
+#include "CutTimeMap.hpp"
+
+namespace {
+CutTimeMap::Table table;
+CutTimeMap map;
+
+// Cut time falling linearly from 100 ms at 5k to 50 ms at 15k RPM
+void fillRamp(CutTimeMap::Table& t) {
+    for (auto& row : t.cutTimeUs) {
+        for (size_t x = 0; x < CutTimeMap::RPM_POINTS; x++) {
+            row[x] = 100000 - x * 5000;
+        }
+    }
+}
+}
+
+void setUp() {
+    CutTimeMap::getDefaultTable(table, 80000);
+}
+
+void tearDown() {}
+
+void test_flat_table_everywhere() {
+    TEST_ASSERT_TRUE(map.compile(table));
+    TEST_ASSERT_EQUAL_UINT32(80000, map.lookup(0, 0));
+    TEST_ASSERT_EQUAL_UINT32(80000, map.lookup(9876, 0));
+    TEST_ASSERT_EQUAL_UINT32(80000, map.lookup(CutTimeMap::LUT_RPM_MAX, 0));
+    TEST_ASSERT_EQUAL_UINT32(80000, map.lookup(UINT16_MAX, 1000));
+}
+
+void test_rejects_unordered_axis_and_keeps_the_old_map() {
+    TEST_ASSERT_TRUE(map.compile(table));
+
+    CutTimeMap::Table bad = table;
+    fillRamp(bad);
+    bad.rpmAxis[3] = bad.rpmAxis[2];
+    TEST_ASSERT_FALSE(CutTimeMap::isValid(bad));
+    TEST_ASSERT_FALSE(map.compile(bad));
+    TEST_ASSERT_EQUAL_UINT32(80000, map.lookup(10000, 0));
+
+    bad = table;
+    bad.loadAxis[5] = bad.loadAxis[4] - 1;
+    TEST_ASSERT_FALSE(map.compile(bad));
+}
+
+void test_interpolates_between_breakpoints() {
+    fillRamp(table);
+    TEST_ASSERT_TRUE(map.compile(table));
+
+    TEST_ASSERT_UINT32_WITHIN(1, 100000, map.lookup(5000, 0));
+    TEST_ASSERT_UINT32_WITHIN(1, 75000, map.lookup(10000, 0));
+    TEST_ASSERT_UINT32_WITHIN(1, 50000, map.lookup(15000, 0));
+
+    // Between LUT columns too, within the slope rounding
+    for (uint16_t rpm = 5000; rpm <= 15000; rpm += 137) {
+        TEST_ASSERT_UINT32_WITHIN(2, CutTimeMap::interpolate(table, rpm, 0), map.lookup(rpm, 0));
+    }
+}
+
+void test_clamps_outside_the_rpm_axis() {
+    fillRamp(table);
+    TEST_ASSERT_TRUE(map.compile(table));
+
+    TEST_ASSERT_UINT32_WITHIN(1, 100000, map.lookup(0, 0));
+    TEST_ASSERT_UINT32_WITHIN(1, 100000, map.lookup(3000, 0));
+    TEST_ASSERT_UINT32_WITHIN(1, 50000, map.lookup(18000, 0));
+    TEST_ASSERT_UINT32_WITHIN(1, 50000, map.lookup(UINT16_MAX, 0));
+}
+
+void test_load_axis_selects_rows() {
+    for (size_t y = 0; y < CutTimeMap::LOAD_POINTS; y++) {
+        table.cutTimeUs[y].fill(40000 + y * 10000);
+    }
+
+    // Without a load source only the first row counts
+    TEST_ASSERT_TRUE(map.compile(table));
+    TEST_ASSERT_EQUAL_UINT32(40000, map.lookup(8000, 1000));
+
+    table.loadSource = CutTimeMap::LoadSource::THROTTLE;
+    TEST_ASSERT_TRUE(map.compile(table));
+    TEST_ASSERT_UINT32_WITHIN(1, 40000, map.lookup(8000, 0));
+    TEST_ASSERT_UINT32_WITHIN(1, 90000, map.lookup(8000, 1000));
+    TEST_ASSERT_UINT32_WITHIN(1, 90000, map.lookup(8000, 1200));    // Clamped
+    TEST_ASSERT_UINT32_WITHIN(1, 70000, map.lookup(8000, 600));     // Exactly on LUT row 9
+}
+
+void test_load_source_names() {
+    TEST_ASSERT_EQUAL_STRING("tps", CutTimeMap::loadSourceToString(CutTimeMap::LoadSource::THROTTLE));
+    TEST_ASSERT_EQUAL_STRING("none", CutTimeMap::loadSourceToString(CutTimeMap::LoadSource::NONE));
+    TEST_ASSERT_TRUE(CutTimeMap::loadSourceFromString("tps") == CutTimeMap::LoadSource::THROTTLE);
+    TEST_ASSERT_TRUE(CutTimeMap::loadSourceFromString("gear") == CutTimeMap::LoadSource::NONE);
+    TEST_ASSERT_TRUE(CutTimeMap::loadSourceFromString(nullptr) == CutTimeMap::LoadSource::NONE);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_flat_table_everywhere);
+    RUN_TEST(test_rejects_unordered_axis_and_keeps_the_old_map);
+    RUN_TEST(test_interpolates_between_breakpoints);
+    RUN_TEST(test_clamps_outside_the_rpm_axis);
+    RUN_TEST(test_load_axis_selects_rows);
+    RUN_TEST(test_load_source_names);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include <zlib.h>
+#include "OtaImageDecoder.hpp"
+#include "HostHal.hpp"
+
+namespace {
+typedef std::vector<uint8_t> Bytes;
+
+OtaImageDecoder decoder;
+Bytes base;
+
+// Compressible but not trivially (a repeating ramp with sparse noise)
+Bytes makeImage(size_t size, uint32_t seed) {
+    Bytes image(size);
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        image[i] = (seed >> 28) == 0 ? static_cast<uint8_t>(seed >> 16) : static_cast<uint8_t>(i * 7 + (i >> 9));
+    }
+    return image;
+}
+
+void sha256(const Bytes& data, uint8_t digest[32]) {
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    mbedtls_sha256_update_ret(&sha, data.data(), data.size());
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+}
+
+Bytes deflateBytes(const Bytes& data) {
+    uLongf size = compressBound(data.size());
+    Bytes out(size);
+    TEST_ASSERT_EQUAL_INT(Z_OK, compress2(out.data(), &size, data.data(), data.size(), Z_BEST_COMPRESSION));
+    out.resize(size);
+    return out;
+}
+
+// Container around payload decoding to image, as tools/make_ota_image.py builds it
+Bytes container(uint8_t flags, const Bytes& image, const Bytes& payload) {
+    OtaImageDecoder::Header header = {};
+    memcpy(header.magic, "QOTA", OtaImageDecoder::MAGIC_SIZE);
+    header.version = OtaImageDecoder::FORMAT_VERSION;
+    header.flags = flags;
+    header.imageSize = image.size();
+    sha256(image, header.imageSha256);
+    if (flags & OtaImageDecoder::DELTA) {
+        header.baseSize = base.size();
+        sha256(base, header.baseSha256);
+    }
+
+    const Bytes body = (flags & OtaImageDecoder::COMPRESSED) ? deflateBytes(payload) : payload;
+    Bytes out(reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+void appendLe32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+// One patch record: image bytes as a difference to base from basePos, then literal bytes
+void appendRecord(Bytes& patch, const Bytes& image, size_t imagePos, size_t basePos,
+                  uint32_t addLength, uint32_t copyLength, int32_t seek) {
+    appendLe32(patch, addLength);
+    appendLe32(patch, copyLength);
+    appendLe32(patch, static_cast<uint32_t>(seek));
+    for (size_t i = 0; i < addLength; i++) {
+        patch.push_back(static_cast<uint8_t>(image[imagePos + i] - base[basePos + i]));
+    }
+    patch.insert(patch.end(), image.begin() + imagePos + addLength, image.begin() + imagePos + addLength + copyLength);
+}
+
+bool feed(const Bytes& stream, size_t chunk) {
+    decoder.begin(U_FLASH, stream.size());
+    for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+        const size_t len = stream.size() - offset < chunk ? stream.size() - offset : chunk;
+        if (!decoder.write(stream.data() + offset, len)) return false;
+    }
+    return true;
+}
+
+void assertInstalled(const Bytes& image) {
+    TEST_ASSERT_TRUE(decoder.finish());
+    TEST_ASSERT_TRUE(Update.isFinished());
+    TEST_ASSERT_EQUAL_size_t(image.size(), decoder.getImageWritten());
+    TEST_ASSERT_EQUAL_size_t(image.size(), Update.image().size());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), Update.image().data(), image.size());
+}
+
+void assertRejected(OTAError error) {
+    TEST_ASSERT_FALSE(decoder.finish());
+    TEST_ASSERT_TRUE(decoder.getError() == error);
+    TEST_ASSERT_FALSE(Update.isRunning());
+}
+
+// Patch turning base into image: 1000 base bytes dropped, 500 inserted
+Bytes makeDelta(Bytes& image) {
+    image.assign(base.begin(), base.begin() + 40000);
+    for (size_t i = 0; i < image.size(); i += 97) image[i] ^= 0x5A;
+    const Bytes inserted = makeImage(500, 7);
+    image.insert(image.end(), inserted.begin(), inserted.end());
+    image.insert(image.end(), base.begin() + 41000, base.end());
+
+    Bytes patch;
+    appendRecord(patch, image, 0, 0, 40000, 500, 1000);
+    appendRecord(patch, image, 40500, 41000, base.size() - 41000, 0, 0);
+    return patch;
+}
+}
+
+void setUp() {
+    base = makeImage(65536, 1);
+    HostHal::setRunningPartition(base.data(), base.size());
+}
+
+void tearDown() {
+    decoder.abort();
+}
+
+void test_host_sha256() {
+    const char* text = "abc";
+    uint8_t digest[32];
+    sha256(Bytes(text, text + 3), digest);
+    const uint8_t expected[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, digest, 32);
+}
+
+void test_plain_image_passes_through() {
+    const Bytes image = makeImage(10000, 2);
+    TEST_ASSERT_TRUE(feed(image, 3));     // Magic check split over writes
+    assertInstalled(image);
+}
+
+void test_compressed_image() {
+    // Larger than the dictionary, so the window wraps several times
+    const Bytes image = makeImage(150000, 3);
+    const Bytes stream = container(OtaImageDecoder::COMPRESSED, image, image);
+    TEST_ASSERT_TRUE(stream.size() < image.size() / 2);
+
+    TEST_ASSERT_TRUE(feed(stream, 1000));
+    assertInstalled(image);
+}
+
+void test_delta_image() {
+    Bytes image;
+    const Bytes patch = makeDelta(image);
+    TEST_ASSERT_TRUE(feed(container(OtaImageDecoder::DELTA, image, patch), 777));
+    assertInstalled(image);
+}
+
+void test_compressed_delta_image() {
+    Bytes image;
+    const Bytes patch = makeDelta(image);
+    TEST_ASSERT_TRUE(feed(container(OtaImageDecoder::COMPRESSED | OtaImageDecoder::DELTA, image, patch), 5));
+    assertInstalled(image);
+}
+
+void test_delta_against_another_base() {
+    Bytes image;
+    const Bytes patch = makeDelta(image);
+    const Bytes stream = container(OtaImageDecoder::DELTA, image, patch);
+
+    base[123] ^= 1;
+    TEST_ASSERT_FALSE(feed(stream, 4096));
+    assertRejected(OTAError::BASE_MISMATCH);
+    TEST_ASSERT_EQUAL_size_t(0, decoder.getImageWritten());
+}
+
+void test_corrupt_stream() {
+    const Bytes image = makeImage(50000, 4);
+    Bytes stream = container(OtaImageDecoder::COMPRESSED, image, image);
+
+    // First deflate block after the zlib header: reserved block type
+    memset(stream.data() + sizeof(OtaImageDecoder::Header) + 2, 0xFF, 16);
+    TEST_ASSERT_FALSE(feed(stream, 512));
+    assertRejected(OTAError::DECOMPRESS_FAILED);
+    TEST_ASSERT_TRUE(Update.isAborted());
+}
+
+void test_hash_mismatch_keeps_the_boot_partition() {
+    const Bytes image = makeImage(20000, 5);
+    Bytes stream = container(0, image, image);
+    stream.back() ^= 0xFF;
+
+    TEST_ASSERT_TRUE(feed(stream, 1024));
+    assertRejected(OTAError::FLASH_VERIFY_FAILED);
+    TEST_ASSERT_TRUE(Update.isAborted());
+}
+
+void test_truncated_image() {
+    const Bytes image = makeImage(20000, 6);
+    Bytes stream = container(OtaImageDecoder::COMPRESSED, image, image);
+    stream.resize(stream.size() - 10);
+
+    TEST_ASSERT_TRUE(feed(stream, 1024));
+    assertRejected(OTAError::INVALID_FILE);
+    TEST_ASSERT_TRUE(Update.isAborted());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_host_sha256);
+    RUN_TEST(test_plain_image_passes_through);
+    RUN_TEST(test_compressed_image);
+    RUN_TEST(test_delta_image);
+    RUN_TEST(test_compressed_delta_image);
+    RUN_TEST(test_delta_against_another_base);
+    RUN_TEST(test_corrupt_stream);
+    RUN_TEST(test_hash_mismatch_keeps_the_boot_partition);
+    RUN_TEST(test_truncated_image);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+#include <unity.h>
+#include "RpmEstimator.hpp"
+
+namespace {
+RpmEstimator estimator;
+uint32_t now;
+
+// One pulse per revolution at rpm, returns the interval
+uint32_t pulse(uint32_t rpm) {
+    const uint32_t interval = 60000000UL / rpm;
+    now += interval;
+    estimator.addInterval(now, interval);
+    return interval;
+}
+}
+
+void setUp() {
+    estimator.reset();
+    now = 1000000;
+}
+
+void tearDown() {}
+
+void test_steady_speed() {
+    for (int i = 0; i < 12; i++) pulse(6000);
+
+    TEST_ASSERT_EQUAL_UINT16(6000, estimator.getRpm());
+    TEST_ASSERT_EQUAL_INT32(0, estimator.getAcceleration());
+    TEST_ASSERT_EQUAL_UINT16(6000, estimator.predict(now + 50000));
+}
+
+void test_acceleration_and_prediction() {
+    // 10000 RPM/s, the RPM of each interval is its mean
+    float rpm = 6000;
+    uint32_t interval = 0;
+    for (int i = 0; i < 20; i++) {
+        interval = pulse(static_cast<uint32_t>(rpm));
+        rpm += 10000.0f * interval / 1e6f;
+    }
+
+    TEST_ASSERT_INT32_WITHIN(300, 10000, estimator.getAcceleration());
+
+    // Extrapolated from the middle of the last interval
+    const float ahead = (20000 + interval / 2) / 1e6f;
+    const float expected = estimator.getRpm() + estimator.getAcceleration() * ahead;
+    TEST_ASSERT_UINT16_WITHIN(5, static_cast<uint16_t>(expected), estimator.predict(now + 20000));
+    TEST_ASSERT_TRUE(estimator.predict(now + 20000) > estimator.getRpm());
+}
+
+void test_prediction_is_capped() {
+    for (int i = 0; i < 8; i++) pulse(6000 + i * 100);
+
+    const uint16_t capped = estimator.predict(now + RpmEstimator::MAX_PREDICTION_US);
+    TEST_ASSERT_EQUAL_UINT16(capped, estimator.predict(now + 10 * RpmEstimator::MAX_PREDICTION_US));
+
+    // Not before the newest point either
+    TEST_ASSERT_EQUAL_UINT16(estimator.getRpm(), estimator.predict(now - 100000));
+}
+
+void test_acceleration_is_clamped() {
+    pulse(6000);
+    now += 100;
+    estimator.addInterval(now, 100);    // 600000 RPM, clamped to MAX_RPM
+
+    TEST_ASSERT_EQUAL_UINT16(RpmEstimator::MAX_RPM, estimator.getRpm());
+    TEST_ASSERT_EQUAL_INT32(RpmEstimator::MAX_ACCELERATION, estimator.getAcceleration());
+}
+
+void test_reset_forgets_history() {
+    for (int i = 0; i < 4; i++) pulse(9000);
+    estimator.reset();
+
+    TEST_ASSERT_EQUAL_UINT16(0, estimator.getRpm());
+    TEST_ASSERT_EQUAL_INT32(0, estimator.getAcceleration());
+    TEST_ASSERT_EQUAL_UINT16(0, estimator.predict(now));
+
+    // First point after a reset has no slope yet
+    pulse(9000);
+    TEST_ASSERT_EQUAL_INT32(0, estimator.getAcceleration());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_speed);
+    RUN_TEST(test_acceleration_and_prediction);
+    RUN_TEST(test_prediction_is_capped);
+    RUN_TEST(test_acceleration_is_clamped);
+    RUN_TEST(test_reset_forgets_history);
+    return UNITY_END();
+}
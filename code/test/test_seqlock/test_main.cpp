@@ -0,0 +1,88 @@
+#include <unity.h>
+#include "Seqlock.hpp"
+
+namespace {
+// Copied in two halves with a hook in between, standing in for an ISR
+// that interrupts the writer mid-copy
+struct Sample {
+    uint32_t first = 0;
+    uint32_t second = 0;
+
+    Sample() = default;
+    Sample(uint32_t value) : first(value), second(value) {}
+    Sample(const Sample&) = default;
+    Sample& operator=(const Sample& other);
+};
+
+Seqlock<Sample>* active = nullptr;
+void (*midCopy)() = nullptr;
+Sample seen[2];
+size_t seenCount;
+
+Sample& Sample::operator=(const Sample& other) {
+    first = other.first;
+    if (midCopy) {
+        void (*hook)() = midCopy;
+        midCopy = nullptr;      // The nested read copies too
+        hook();
+        midCopy = hook;
+    }
+    second = other.second;
+    return *this;
+}
+
+void readDuringWrite() {
+    if (seenCount < 2) seen[seenCount++] = active->read();
+}
+}
+
+void setUp() {
+    midCopy = nullptr;
+    seenCount = 0;
+}
+
+void tearDown() {
+    midCopy = nullptr;
+}
+
+void test_reads_latest_value() {
+    Seqlock<Sample> lock;
+    TEST_ASSERT_EQUAL_UINT32(0, lock.version());
+    TEST_ASSERT_EQUAL_UINT32(0, lock.read().first);
+
+    lock.write(Sample(7));
+    lock.write(Sample(8));
+    const Sample value = lock.read();
+    TEST_ASSERT_EQUAL_UINT32(8, value.first);
+    TEST_ASSERT_EQUAL_UINT32(8, value.second);
+    TEST_ASSERT_EQUAL_UINT32(2, lock.version());
+}
+
+void test_reader_inside_write_sees_a_whole_copy() {
+    Seqlock<Sample> lock;
+    active = &lock;
+    lock.write(Sample(1));
+
+    midCopy = readDuringWrite;
+    lock.write(Sample(2));
+    midCopy = nullptr;
+
+    // Interrupted while copy 0 was written: the old value from copy 1
+    TEST_ASSERT_EQUAL_size_t(2, seenCount);
+    TEST_ASSERT_EQUAL_UINT32(1, seen[0].first);
+    TEST_ASSERT_EQUAL_UINT32(1, seen[0].second);
+
+    // While copy 1 was written: the new value from copy 0
+    TEST_ASSERT_EQUAL_UINT32(2, seen[1].first);
+    TEST_ASSERT_EQUAL_UINT32(2, seen[1].second);
+
+    TEST_ASSERT_EQUAL_UINT32(2, lock.read().second);
+    TEST_ASSERT_EQUAL_UINT32(2, lock.version());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reads_latest_value);
+    RUN_TEST(test_reader_inside_write_sees_a_whole_copy);
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+#include <unity.h>
+#include "TriggerWheel.hpp"
+
+namespace {
+constexpr uint32_t PITCH_US = 1000;
+
+TriggerWheel wheel;
+uint32_t now;
+
+bool tooth(uint32_t pitches) {
+    const uint32_t interval = pitches * PITCH_US;
+    now += interval;
+    return wheel.accept(now, interval, wheel.measure(interval));
+}
+
+// 12-1: the ten teeth after tooth 0, then the gap; true if it timed a revolution
+bool revolution() {
+    for (int i = 0; i < 10; i++) tooth(1);
+    return tooth(2);
+}
+}
+
+void setUp() {
+    wheel = TriggerWheel();     // Sync losses count since boot, not since configure()
+    wheel.configure(12, 1);
+    now = 0;
+}
+
+void tearDown() {}
+
+void test_measures_pitches() {
+    TEST_ASSERT_EQUAL_UINT8(0, wheel.measure(1000));    // Reference only
+    TEST_ASSERT_EQUAL_UINT8(1, wheel.measure(1400));
+    TEST_ASSERT_EQUAL_UINT8(2, wheel.measure(1600));
+    TEST_ASSERT_EQUAL_UINT8(1, wheel.measure(300));     // Never 0 once measuring
+    TEST_ASSERT_EQUAL_UINT32(12000, wheel.revolutionInterval(1000, 1));
+    TEST_ASSERT_EQUAL_UINT32(12000, wheel.revolutionInterval(2000, 2));
+}
+
+void test_syncs_on_the_second_gap() {
+    for (int i = 0; i < 5; i++) tooth(1);       // Started mid-wheel
+    TEST_ASSERT_FALSE(tooth(2));                // First gap: counting from here
+    TEST_ASSERT_FALSE(wheel.isSynced());
+    TEST_ASSERT_EQUAL_UINT8(0, wheel.getPosition());
+
+    TEST_ASSERT_TRUE(revolution());
+    TEST_ASSERT_TRUE(wheel.isSynced());
+    TEST_ASSERT_EQUAL_UINT32(12 * PITCH_US, wheel.getRevolutionUs());
+
+    tooth(1);
+    tooth(1);
+    TEST_ASSERT_EQUAL_UINT8(2, wheel.getPosition());
+}
+
+void test_lost_tooth_keeps_sync() {
+    tooth(1);
+    tooth(2);
+    revolution();
+    TEST_ASSERT_TRUE(wheel.isSynced());
+
+    // Tooth 5 missed by the pickup: 4 -> 6 in one interval
+    for (int i = 0; i < 4; i++) tooth(1);
+    tooth(2);
+    for (int i = 0; i < 4; i++) tooth(1);
+    TEST_ASSERT_TRUE(tooth(2));
+    TEST_ASSERT_TRUE(wheel.isSynced());
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.getSyncLosses());
+}
+
+void test_tooth_on_a_missing_position_drops_sync() {
+    tooth(1);
+    tooth(2);
+    revolution();
+    TEST_ASSERT_TRUE(wheel.isSynced());
+
+    for (int i = 0; i < 9; i++) tooth(1);
+    tooth(2);                                   // Position 11, where the wheel has no tooth
+    TEST_ASSERT_FALSE(wheel.isSynced());
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.getSyncLosses());
+}
+
+void test_dropout_drops_sync_until_the_next_revolution() {
+    tooth(1);
+    tooth(2);
+    revolution();
+    TEST_ASSERT_TRUE(wheel.isSynced());
+
+    TEST_ASSERT_FALSE(tooth(TriggerWheel::MAX_PITCHES + 2));
+    TEST_ASSERT_FALSE(wheel.isSynced());
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.getSyncLosses());
+
+    // Single teeth until a gap restarts the count, the next gap syncs
+    TEST_ASSERT_FALSE(revolution());
+    TEST_ASSERT_FALSE(wheel.isSynced());
+    TEST_ASSERT_TRUE(revolution());
+    TEST_ASSERT_TRUE(wheel.isSynced());
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.getSyncLosses());
+}
+
+void test_wheel_without_missing_teeth_counts_revolutions() {
+    wheel.configure(4, 0);
+    TEST_ASSERT_TRUE(wheel.isMultiTooth());
+
+    tooth(1);                                   // Reference
+    TEST_ASSERT_FALSE(tooth(1));                // Counting starts on any tooth
+    TEST_ASSERT_FALSE(tooth(1));
+    TEST_ASSERT_FALSE(tooth(1));
+    TEST_ASSERT_FALSE(tooth(1));
+    TEST_ASSERT_TRUE(tooth(1));
+    TEST_ASSERT_EQUAL_UINT32(4 * PITCH_US, wheel.getRevolutionUs());
+    TEST_ASSERT_FALSE(wheel.isSynced());        // No angle reference
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_measures_pitches);
+    RUN_TEST(test_syncs_on_the_second_gap);
+    RUN_TEST(test_lost_tooth_keeps_sync);
+    RUN_TEST(test_tooth_on_a_missing_position_drops_sync);
+    RUN_TEST(test_dropout_drops_sync_until_the_next_revolution);
+    RUN_TEST(test_wheel_without_missing_teeth_counts_revolutions);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+"""
+Static asset pipeline for the LittleFS image.
+
+Reads data/, writes .pio/assets/ and points PlatformIO's filesystem image
+(buildfs/uploadfs) at it:
+
+- .js/.css referenced from HTML are renamed to <name>.<hash>.<ext> and the
+  references rewritten, so the device can serve them as immutable
+- .html/.js/.css/.svg are stored gzip-compressed as <file>.gz
+- /assets.json lists every served asset (URL, stored file, ETag, immutable)
+  for AssetServer, which loads it once at boot
+- anything else (config.json) is copied unchanged and not listed
+
+Runs as a PlatformIO pre: script, or standalone:
+    python tools/build_assets.py [data_dir] [out_dir]
+"""
+
+import gzip
+import hashlib
+import json
+import os
+import re
+import shutil
+import sys
+
+COMPRESSIBLE = (".html", ".js", ".css", ".svg")
+HASHED = (".js", ".css")
+MANIFEST = "assets.json"
+
+
+def content_hash(data):
+    return hashlib.sha1(data).hexdigest()[:8]
+
+
+def hashed_name(name, digest):
+    base, ext = os.path.splitext(name)
+    return "%s.%s%s" % (base, digest, ext)
+
+
+def rewrite_references(html, renames):
+    # src="index.js", href='/style.css' -> hashed names, keeping the leading slash if any
+    def replace(match):
+        attr, quote, slash, name = match.groups()
+        return "%s=%s%s%s%s" % (attr, quote, slash, renames.get(name, name), quote)
+
+    return re.sub(r'(src|href)=(["\'])(/?)([^"\'/?#]+)\2', replace, html)
+
+
+def build_assets(data_dir, out_dir):
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+
+    files = {}
+    for name in sorted(os.listdir(data_dir)):
+        path = os.path.join(data_dir, name)
+        if os.path.isfile(path):
+            with open(path, "rb") as f:
+                files[name] = f.read()
+
+    # Content-hashed names for scripts/styles, computed before HTML rewriting
+    renames = {name: hashed_name(name, content_hash(data))
+               for name, data in files.items() if name.endswith(HASHED)}
+
+    assets = []
+    raw_size = 0
+    stored_size = 0
+    for name, data in files.items():
+        if name.endswith(".html"):
+            data = rewrite_references(data.decode("utf-8"), renames).encode("utf-8")
+
+        if not name.endswith(COMPRESSIBLE):
+            # Not a web asset (e.g. default config.json), copy unchanged
+            with open(os.path.join(out_dir, name), "wb") as f:
+                f.write(data)
+            continue
+
+        served = renames.get(name, name)
+        stored = served + ".gz"
+        compressed = gzip.compress(data, compresslevel=9, mtime=0)
+        with open(os.path.join(out_dir, stored), "wb") as f:
+            f.write(compressed)
+
+        assets.append({
+            "url": "/" + served,
+            "file": "/" + stored,
+            "etag": content_hash(data),
+            "immutable": name in renames,
+        })
+        raw_size += len(data)
+        stored_size += len(compressed)
+
+    with open(os.path.join(out_dir, MANIFEST), "w") as f:
+        json.dump({"version": 1, "assets": assets}, f, separators=(",", ":"))
+
+    print("[assets] %d assets, %d -> %d bytes (%.0f%%)" % (
+        len(assets), raw_size, stored_size, 100.0 * stored_size / max(raw_size, 1)))
+
+
+if __name__ == "__main__":
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    data_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, "data")
+    out_dir = sys.argv[2] if len(sys.argv) > 2 else os.path.join(root, ".pio", "assets")
+    build_assets(data_dir, out_dir)
+else:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+
+    project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+    source_dir = os.path.join(project_dir, "data")
+    output_dir = os.path.join(project_dir, ".pio", "assets")
+    build_assets(source_dir, output_dir)
+    env.Replace(PROJECT_DATA_DIR=output_dir)  # noqa: F821
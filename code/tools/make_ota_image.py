@@ -0,0 +1,199 @@
+"""
+OTA container images for OtaImageDecoder (compressed and/or delta).
+
+    python tools/make_ota_image.py firmware.bin -o firmware.z.bin
+    python tools/make_ota_image.py firmware.bin --base old.bin -o firmware.delta.bin
+
+- Compressed: the image as one zlib stream (default, --no-compress to skip)
+- Delta (--base): a patch against the firmware the device runs now. Only a
+  device whose running partition starts with exactly that file accepts it
+  (SHA-256 check), so --base must be the firmware.bin that was flashed.
+
+The patch is a sequence of records (bsdiff layout, streamed):
+    u32 addLength, u32 copyLength, i32 seek   little endian
+    addLength bytes  added to the base byte by byte (mod 256)
+    copyLength bytes copied as they are
+then the base position moves by seek. Aligned code mostly differs in a few
+bytes (moved addresses), so the added bytes are mostly zero and compress
+well.
+
+Every image is decoded again before it is written and compared with the
+input, output names should end in .bin (the OTA page only offers those).
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = b"QOTA"
+FORMAT_VERSION = 1
+FLAG_COMPRESSED = 0x01
+FLAG_DELTA = 0x02
+HEADER = struct.Struct("<4sBBHII32s32s")  # OtaImageDecoder::Header, 80 bytes
+CONTROL = struct.Struct("<IIi")
+
+KEY_SIZE = 8            # Bytes hashed to find match candidates
+MIN_MATCH = 16          # Exact bytes needed to start a new alignment
+MAX_CANDIDATES = 4      # Base positions kept per key
+GIVE_UP = 256           # Stop extending after this many bytes without gain
+
+
+def build_index(base):
+    index = {}
+    for i in range(len(base) - KEY_SIZE + 1):
+        positions = index.setdefault(base[i:i + KEY_SIZE], [])
+        if len(positions) < MAX_CANDIDATES:
+            positions.append(i)
+    return index
+
+
+def exact_length(base, image, base_pos, pos):
+    length = 0
+    limit = min(len(base) - base_pos, len(image) - pos)
+    while length + 64 <= limit and base[base_pos + length:base_pos + length + 64] == image[pos + length:pos + length + 64]:
+        length += 64
+    while length < limit and base[base_pos + length] == image[pos + length]:
+        length += 1
+    return length
+
+
+def extend(base, image, base_pos, pos):
+    """Length of the approximate match (bsdiff score: matches * 2 - length)."""
+    limit = min(len(base) - base_pos, len(image) - pos)
+    matches = best_matches = best_length = i = 0
+    while i < limit:
+        run = exact_length(base, image, base_pos + i, pos + i)
+        if run:
+            matches += run
+            i += run
+        else:
+            i += 1
+        if matches * 2 - i > best_matches * 2 - best_length:
+            best_matches, best_length = matches, i
+        elif i - best_length > GIVE_UP:
+            break
+    return best_length
+
+
+def find_match(base, image, index, pos, predicted):
+    """Next position >= pos with an exact match, and its base position."""
+    while pos + MIN_MATCH <= len(image):
+        # Prefer staying aligned (a few replaced bytes)
+        if 0 <= predicted < len(base) and exact_length(base, image, predicted, pos) >= MIN_MATCH:
+            return pos, predicted
+        best, best_length = None, MIN_MATCH - 1
+        for candidate in index.get(image[pos:pos + KEY_SIZE], ()):
+            length = exact_length(base, image, candidate, pos)
+            if length > best_length:
+                best, best_length = candidate, length
+        if best is not None:
+            return pos, best
+        pos += 1
+        predicted += 1
+    return len(image), None
+
+
+def make_patch(base, image):
+    index = build_index(base)
+    out = bytearray()
+    pos = base_pos = 0
+    if exact_length(base, image, 0, 0) < MIN_MATCH:
+        pos, base_pos = find_match(base, image, index, 0, 0)
+        if base_pos is None:
+            base_pos = 0
+        # Leading literal bytes ride in a record without add bytes
+        out += CONTROL.pack(0, pos, base_pos)
+        out += image[:pos]
+
+    while pos < len(image):
+        add_length = extend(base, image, base_pos, pos)
+        add = bytes((image[pos + i] - base[base_pos + i]) & 0xFF for i in range(add_length))
+        copy_start = pos + add_length
+        next_pos, next_base = find_match(base, image, index, copy_start, base_pos + add_length)
+        seek = 0 if next_base is None else next_base - (base_pos + add_length)
+        out += CONTROL.pack(add_length, next_pos - copy_start, seek)
+        out += add
+        out += image[copy_start:next_pos]
+        pos, base_pos = next_pos, base_pos + add_length + seek
+    return bytes(out)
+
+
+def apply_patch(base, patch):
+    out = bytearray()
+    offset = base_pos = 0
+    while offset < len(patch):
+        add_length, copy_length, seek = CONTROL.unpack_from(patch, offset)
+        offset += CONTROL.size
+        if base_pos < 0 or base_pos + add_length > len(base):
+            raise ValueError("patch reads outside the base")
+        out += bytes((base[base_pos + i] + patch[offset + i]) & 0xFF for i in range(add_length))
+        offset += add_length
+        base_pos += add_length
+        out += patch[offset:offset + copy_length]
+        offset += copy_length
+        base_pos += seek
+    return bytes(out)
+
+
+def build_image(image, base=None, compress=True):
+    flags = 0
+    payload = image
+    base_size, base_sha = 0, bytes(32)
+    if base is not None:
+        flags |= FLAG_DELTA
+        payload = make_patch(base, image)
+        base_size, base_sha = len(base), hashlib.sha256(base).digest()
+    if compress:
+        flags |= FLAG_COMPRESSED
+        payload = zlib.compress(payload, 9)
+
+    header = HEADER.pack(MAGIC, FORMAT_VERSION, flags, 0, len(image), base_size,
+                         base_sha, hashlib.sha256(image).digest())
+    return header + payload
+
+
+def decode_image(container, base=None):
+    magic, version, flags, _, image_size, base_size, base_sha, image_sha = HEADER.unpack_from(container)
+    if magic != MAGIC or version != FORMAT_VERSION:
+        raise ValueError("not a container image")
+    payload = container[HEADER.size:]
+    if flags & FLAG_COMPRESSED:
+        payload = zlib.decompress(payload)
+    if flags & FLAG_DELTA:
+        if base is None or len(base) != base_size or hashlib.sha256(base).digest() != base_sha:
+            raise ValueError("delta base mismatch")
+        payload = apply_patch(base, payload)
+    if len(payload) != image_size or hashlib.sha256(payload).digest() != image_sha:
+        raise ValueError("decoded image does not match")
+    return payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("image", help="firmware.bin (or a LittleFS image, not with --base)")
+    parser.add_argument("-o", "--output", required=True, help="container image to write")
+    parser.add_argument("--base", help="firmware.bin the device runs now, makes a delta")
+    parser.add_argument("--no-compress", action="store_true", help="store the payload uncompressed")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    base = None
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+
+    container = build_image(image, base, not args.no_compress)
+    if decode_image(container, base) != image:
+        sys.exit("[ota] self-check failed")
+
+    with open(args.output, "wb") as f:
+        f.write(container)
+    print("[ota] %s: %d -> %d bytes (%.1fx smaller)" % (
+        args.output, len(image), len(container), len(image) / float(len(container))))
+
+
+if __name__ == "__main__":
+    main()